@@ -57,6 +57,19 @@ hook.Add("PostRender", "gelly.load-gelly", function()
 		showPopup(GELLY_MAP_TITLE, GELLY_MAP_CONTENT)
 		-- we can continue, but the map won't be loaded
 		ErrorNoHalt(mapErrorMessage)
+	else
+		-- the map is cooked in the background, so a broken map only shows up once that's done
+		hook.Add("Think", "gelly.map-status", function()
+			local mapStatus = gelly.GetMapStatus()
+			if mapStatus == "cooking" then
+				return
+			end
+
+			hook.Remove("Think", "gelly.map-status")
+			if mapStatus == "failed" then
+				showPopup(GELLY_MAP_TITLE, GELLY_MAP_CONTENT)
+			end
+		end)
 	end
 
 	-- setup the gellyx api before other addons can use it
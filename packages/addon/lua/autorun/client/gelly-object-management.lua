@@ -30,20 +30,87 @@ local function getVerticesOfModel(modelPath)
 	return vertices
 end
 
+-- How many meshes each model has, once gelly has been given them. Those meshes
+-- are kept natively, so spawning the model again skips building them.
+local cachedModelMeshCounts = {}
+
+local function getMeshKey(modelPath, meshIndex)
+	return modelPath .. "#" .. meshIndex
+end
+
+-- Classes and models which collide with the convex hull of each of their meshes
+-- instead of the triangles. Hulls are much cheaper for the fluid to collide with,
+-- but fill in any hollows, so anything not listed keeps its triangle meshes.
+-- Models whose collision mesh is a single convex piece don't need listing, as
+-- gelly.AddObjectFromModel gives them their hull anyway.
+local CONVEX_ENTITY_CLASSES = {
+	["gmod_wheel"] = true
+}
+
+-- Keyed by model path, for models made of several pieces whose hollows don't
+-- matter to the fluid
+local CONVEX_MODELS = {}
+
+local function usesConvexHull(entity)
+	return CONVEX_ENTITY_CLASSES[entity:GetClass()] == true or CONVEX_MODELS[entity:GetModel()] == true
+end
+
+local function addCachedObject(entity, modelPath)
+	local meshCount = cachedModelMeshCounts[modelPath]
+	if not meshCount then
+		return nil
+	end
+
+	local objectHandles = {}
+	local offset = meshCount > 1 and MULTI_OBJECT_OFFSET or 0
+
+	for meshIndex = 1, meshCount do
+		local objectHandle = entity:EntIndex() + offset
+		if not gelly.AddCachedObject(getMeshKey(modelPath, meshIndex), objectHandle, usesConvexHull(entity)) then
+			-- The cache was lost somehow, so undo what was added and rebuild
+			for _, addedHandle in ipairs(objectHandles) do
+				gelly.RemoveObject(addedHandle)
+			end
+
+			cachedModelMeshCounts[modelPath] = nil
+			return nil
+		end
+
+		table.insert(objectHandles, objectHandle)
+		offset = offset + 1
+	end
+
+	return objectHandles
+end
+
 local function addObject(entity)
 	logging.info("Adding object #%d to gelly", entity:EntIndex())
 
-	local meshes = getVerticesOfModel(entity:GetModel())
+	local modelPath = entity:GetModel()
+	-- Reads the model's collision mesh natively, which skips building a table of every vertex
+	if gelly.AddObjectFromModel(modelPath, entity:EntIndex(), usesConvexHull(entity)) then
+		objects[entity] = { entity:EntIndex() }
+		return
+	end
 
-	local objectHandles = {}
+	local objectHandles = addCachedObject(entity, modelPath)
+	if objectHandles then
+		objects[entity] = objectHandles
+		return
+	end
+
+	local meshes = getVerticesOfModel(modelPath)
+
+	objectHandles = {}
 	local offset = #meshes > 1 and MULTI_OBJECT_OFFSET or 0
 
-	for _, mesh in ipairs(meshes) do
+	for meshIndex, mesh in ipairs(meshes) do
 		table.insert(objectHandles, entity:EntIndex() + offset)
-		gelly.AddObject(mesh, entity:EntIndex() + offset)
+		gelly.AddObject(mesh, entity:EntIndex() + offset, getMeshKey(modelPath, meshIndex), usesConvexHull(entity))
 		offset = offset + 1
 	end
 
+	cachedModelMeshCounts[modelPath] = #meshes
 	objects[entity] = objectHandles
 end
 
@@ -58,6 +125,40 @@ local function removeObject(entity)
 	objects[entity] = nil
 end
 
+-- Every transform is sent over in one call per tick, as six numbers per object:
+-- the position, then the angles.
+local batchHandles = {}
+local batchTransforms = {}
+local batchSize = 0
+
+local PLAYER_ANGLES = Angle(90, 0, 0)
+
+local function queueTransform(objectHandle, position, angles)
+	local offset = batchSize * 6
+	batchSize = batchSize + 1
+
+	batchHandles[batchSize] = objectHandle
+	batchTransforms[offset + 1] = position.x
+	batchTransforms[offset + 2] = position.y
+	batchTransforms[offset + 3] = position.z
+	batchTransforms[offset + 4] = angles.p
+	batchTransforms[offset + 5] = angles.y
+	batchTransforms[offset + 6] = angles.r
+end
+
+local function flushTransforms()
+	-- Only the handles decide how many objects there are, so stale transforms past the end are harmless
+	for i = #batchHandles, batchSize + 1, -1 do
+		batchHandles[i] = nil
+	end
+
+	if batchSize > 0 then
+		gelly.SetObjectTransforms(batchHandles, batchTransforms)
+	end
+
+	batchSize = 0
+end
+
 local function updateObject(entity)
 	local objectHandles = objects[entity]
 
@@ -69,8 +170,7 @@ local function updateObject(entity)
 		end
 
 		if entity == LocalPlayer() then
-			gelly.SetObjectPosition(objectHandle, entity:GetPos())
-			gelly.SetObjectRotation(objectHandle, Angle(90, 0, 0))
+			queueTransform(objectHandle, entity:GetPos(), PLAYER_ANGLES)
 			return
 		end
 
@@ -84,8 +184,7 @@ local function updateObject(entity)
 			end
 		end
 
-		gelly.SetObjectPosition(objectHandle, transform:GetTranslation())
-		gelly.SetObjectRotation(objectHandle, transform:GetAngles())
+		queueTransform(objectHandle, transform:GetTranslation(), transform:GetAngles())
 	end
 end
 
@@ -119,17 +218,7 @@ hook.Add("GellyLoaded", "gelly.object-management-initialize", function()
 		for entity, _ in pairs(objects) do
 			updateObject(entity)
 		end
-	end)
-end)
 
-hook.Add("GellyRestarted", "gelly.object-management-recreate-entities", function()
-	local entities = {}
-	for entity, _ in pairs(objects) do
-		table.insert(entities, entity)
-	end
-
-	objects = {}
-	for _, entity in ipairs(entities) do
-		addObject(entity)
-	end
+		flushTransforms()
+	end)
 end)
@@ -18,10 +18,9 @@ local function changeMaxParticles(_, _, args)
 		return
 	end
 
+	-- Particles and objects are kept, but the renderer may have been rebuilt
 	gelly.ChangeMaxParticles(maxParticles)
-	-- then reload the settings
 	gellyx.presets.select(gellyx.presets.getActivePreset().Name)
-	hook.Run("GellyRestarted")
 	print("Max particles set to " .. maxParticles .. "!")
 end
 
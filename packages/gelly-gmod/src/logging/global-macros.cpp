@@ -1,6 +1,7 @@
 #include "global-macros.h"
 
 #include <cstdarg>
+#include <cstdio>
 #include <cstring>
 #include <ctime>
 #include <memory>
@@ -15,7 +16,13 @@ void AddLogEntryFromMacro(
 	va_list args;
 	va_start(args, format);
 
-	const auto memoryRequired = std::vsnprintf(nullptr, 0, format, args);
+	// Measuring consumes the arguments, so it gets its own copy of them
+	va_list measureArgs;
+	va_copy(measureArgs, args);
+	const auto memoryRequired =
+		std::vsnprintf(nullptr, 0, format, measureArgs);
+	va_end(measureArgs);
+
 	const auto formatBuffer = std::make_unique<char[]>(memoryRequired + 1);
 	const auto formatBufferPtr = formatBuffer.get();
 
@@ -3,6 +3,7 @@
 #include "scene/Scene.h"
 // clang-format on
 
+#include <algorithm>
 #include <cstdio>
 
 #include "logging/global-macros.h"
@@ -54,6 +55,9 @@ static std::shared_ptr<luajit::LuaShared> luaShared = nullptr;
 
 constexpr int DEFAULT_MAX_PARTICLES = 100000;
 constexpr int MAXIMUM_PARTICLES = 10000000;
+// The renderer's buffers grow geometrically, so they can be bigger than the
+// simulation's limit.
+static int rendererMaxParticles = DEFAULT_MAX_PARTICLES;
 constexpr DWORD LUAJIT_UNHANDLED_PCALL = 0xE24C4A02;
 
 static PVOID emergencyHandler = nullptr;
@@ -257,6 +261,19 @@ LUA_FUNCTION(gelly_Simulate) {
 	return 0;
 }
 
+static const char *GetCookingStatusName(CookingStatus status) {
+	switch (status) {
+		case CookingStatus::COOKING:
+			return "cooking";
+		case CookingStatus::READY:
+			return "ready";
+		case CookingStatus::FAILED:
+			return "failed";
+		default:
+			return "none";
+	}
+}
+
 LUA_FUNCTION(gelly_LoadMap) {
 	START_GELLY_EXCEPTIONS()
 
@@ -267,6 +284,13 @@ LUA_FUNCTION(gelly_LoadMap) {
 	return 0;
 }
 
+LUA_FUNCTION(gelly_GetMapStatus) {
+	START_GELLY_EXCEPTIONS()
+	LUA->PushString(GetCookingStatusName(scene->GetMapStatus()));
+	CATCH_GELLY_EXCEPTIONS()
+	return 1;
+}
+
 LUA_FUNCTION(gelly_AddObject) {
 	START_GELLY_EXCEPTIONS()
 
@@ -274,7 +298,16 @@ LUA_FUNCTION(gelly_AddObject) {
 	LUA->CheckType(1, GarrysMod::Lua::Type::Table);	  // Mesh
 	LUA->CheckType(2, GarrysMod::Lua::Type::Number);  // Ent index
 	const auto entIndex = static_cast<EntIndex>(LUA->GetNumber(2));
-	LUA->Pop();	 // to not interfere with the loop
+	// Optional, keeps the mesh around for gelly.AddCachedObject
+	std::string meshKey;
+	if (LUA->IsType(3, GarrysMod::Lua::Type::String)) {
+		meshKey = LUA->GetString(3);
+	}
+	// Optional, collides with the mesh's convex hull instead
+	const auto shape = LUA->GetBool(4) ? ObjectShape::CONVEX
+									   : ObjectShape::TRIANGLE_MESH;
+
+	LUA->Pop(LUA->Top() - 1);  // to not interfere with the loop
 
 	const uint32_t vertexCount = LUA->ObjLen(1);
 	if (vertexCount <= 0) {
@@ -291,11 +324,46 @@ LUA_FUNCTION(gelly_AddObject) {
 		LUA->Pop();
 	}
 
-	scene->AddEntity(entIndex, vertices);
+	scene->AddEntity(entIndex, vertices, meshKey, shape);
 	CATCH_GELLY_EXCEPTIONS();
 	return 0;
 }
 
+LUA_FUNCTION(gelly_AddCachedObject) {
+	START_GELLY_EXCEPTIONS();
+
+	LUA->CheckType(1, GarrysMod::Lua::Type::String);  // Mesh key
+	LUA->CheckType(2, GarrysMod::Lua::Type::Number);  // Ent index
+	// Optional, same as gelly.AddObject's
+	const auto shape = LUA->GetBool(3) ? ObjectShape::CONVEX
+									   : ObjectShape::TRIANGLE_MESH;
+
+	LUA->PushBool(scene->AddCachedEntity(
+		static_cast<EntIndex>(LUA->GetNumber(2)), LUA->GetString(1), shape
+	));
+
+	CATCH_GELLY_EXCEPTIONS();
+	return 1;
+}
+
+LUA_FUNCTION(gelly_AddObjectFromModel) {
+	START_GELLY_EXCEPTIONS();
+
+	LUA->CheckType(1, GarrysMod::Lua::Type::String);  // Model path
+	LUA->CheckType(2, GarrysMod::Lua::Type::Number);  // Ent index
+	// Optional, same as gelly.AddObject's. Models made of a single convex
+	// piece collide with their hull either way.
+	const auto shape = LUA->GetBool(3) ? ObjectShape::CONVEX
+									   : ObjectShape::TRIANGLE_MESH;
+
+	LUA->PushBool(scene->AddModelEntity(
+		static_cast<EntIndex>(LUA->GetNumber(2)), LUA->GetString(1), shape
+	));
+
+	CATCH_GELLY_EXCEPTIONS();
+	return 1;
+}
+
 LUA_FUNCTION(gelly_AddPlayerObject) {
 	START_GELLY_EXCEPTIONS();
 
@@ -321,6 +389,16 @@ LUA_FUNCTION(gelly_RemoveObject) {
 	return 0;
 }
 
+LUA_FUNCTION(gelly_GetObjectStatus) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Number);  // Handle
+	LUA->PushString(GetCookingStatusName(
+		scene->GetEntityStatus(static_cast<EntIndex>(LUA->GetNumber(1)))
+	));
+	CATCH_GELLY_EXCEPTIONS();
+	return 1;
+}
+
 LUA_FUNCTION(gelly_SetObjectPosition) {
 	START_GELLY_EXCEPTIONS();
 
@@ -335,7 +413,32 @@ LUA_FUNCTION(gelly_SetObjectPosition) {
 	return 0;
 }
 
-inline float rad(float deg) { return deg * (XM_PI / 180.0); }
+// Takes Source's pitch, yaw and roll in degrees. The sines and cosines of all
+// three angles are worked out together in one vector.
+static XMFLOAT4 AngleToQuaternion(float pitch, float yaw, float roll) {
+	XMVECTOR sines;
+	XMVECTOR cosines;
+	XMVectorSinCos(
+		&sines,
+		&cosines,
+		XMVectorScale(XMVectorSet(pitch, yaw, roll, 0.f), XM_PI / 360.f)
+	);
+
+	XMFLOAT4 sine;
+	XMFLOAT4 cosine;
+	XMStoreFloat4(&sine, sines);
+	XMStoreFloat4(&cosine, cosines);
+
+	const float sp = sine.x, sy = sine.y, sr = sine.z;
+	const float cp = cosine.x, cy = cosine.y, cr = cosine.z;
+
+	return {
+		cr * cp * cy + sr * sp * sy,
+		sr * cp * cy - cr * sp * sy,
+		cr * sp * cy + sr * cp * sy,
+		cr * cp * sy - sr * sp * cy
+	};
+}
 
 LUA_FUNCTION(gelly_SetObjectRotation) {
 	START_GELLY_EXCEPTIONS();
@@ -345,24 +448,61 @@ LUA_FUNCTION(gelly_SetObjectRotation) {
 	// we need to convert it from an ang to a quaternion
 	QAngle ang = LUA->GetAngle(2);
 
-	float p = rad(ang.x) / 2.f;
-	float y = rad(ang.y) / 2.f;
-	float r = rad(ang.z) / 2.f;
-	float cr = cos(r);
-	float sr = sin(r);
-	float cp = cos(p);
-	float sp = sin(p);
-	float cy = cos(y);
-	float sy = sin(y);
-
-	XMFLOAT4 quat = {
-		cr * cp * cy + sr * sp * sy,
-		sr * cp * cy - cr * sp * sy,
-		cr * sp * cy + sr * cp * sy,
-		cr * cp * sy - sr * sp * cy
-	};
+	scene->UpdateEntityRotation(
+		static_cast<EntIndex>(LUA->GetNumber(1)),
+		AngleToQuaternion(ang.x, ang.y, ang.z)
+	);
+	CATCH_GELLY_EXCEPTIONS();
+	return 0;
+}
+
+LUA_FUNCTION(gelly_SetObjectTransforms) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Table);	 // Handles
+	LUA->CheckType(2, GarrysMod::Lua::Type::Table);	 // Transforms
+	// Transforms are six numbers per object in a flat table, the position and
+	// then the angles.
+	constexpr size_t valuesPerObject = 6;
+
+	// Kept around since this runs every tick
+	static std::vector<float> transforms;
+	static std::vector<EntIndex> entIndices;
+	static std::vector<Vector> positions;
+	static std::vector<XMFLOAT4> rotations;
+
+	const size_t objectCount = LUA->ObjLen(1);
+	transforms.resize(objectCount * valuesPerObject);
+
+	if (LUA->ObjLen(2) < transforms.size()) {
+		LUA->ThrowError("Transform table is shorter than the handles!");
+	}
+
+	for (size_t i = 0; i < transforms.size(); i++) {
+		LUA->PushNumber(static_cast<double>(i + 1));
+		LUA->GetTable(2);
+		transforms[i] = static_cast<float>(LUA->GetNumber(-1));
+		LUA->Pop();
+	}
+
+	entIndices.resize(objectCount);
+	positions.resize(objectCount);
+	rotations.resize(objectCount);
 
-	scene->UpdateEntityRotation(static_cast<EntIndex>(LUA->GetNumber(1)), quat);
+	for (size_t i = 0; i < objectCount; i++) {
+		LUA->PushNumber(static_cast<double>(i + 1));
+		LUA->GetTable(1);
+		entIndices[i] = static_cast<EntIndex>(LUA->GetNumber(-1));
+		LUA->Pop();
+
+		const float *transform = &transforms[i * valuesPerObject];
+		positions[i] = {transform[0], transform[1], transform[2]};
+		rotations[i] =
+			AngleToQuaternion(transform[3], transform[4], transform[5]);
+	}
+
+	scene->UpdateEntityTransforms(
+		entIndices.data(), positions.data(), rotations.data(), objectCount
+	);
 	CATCH_GELLY_EXCEPTIONS();
 	return 0;
 }
@@ -374,11 +514,13 @@ LUA_FUNCTION(gelly_AddParticles) {
 
 	const uint32_t particleCount = LUA->ObjLen(1);
 	const auto absorption = LUA->GetVector(2);
-	auto builder = ParticleManager::CreateParticleList();
+	auto &builder = scene->BeginParticleList();
 
 	LUA->Pop();	 // To make the loop simpler
 
 	builder.SetAbsorption(absorption.x, absorption.y, absorption.z);
+	// the table alternates between positions and velocities
+	builder.Reserve(particleCount / 2);
 
 	for (uint32_t i = 0; i < particleCount; i += 2) {
 		LUA->PushNumber(i + 1);
@@ -393,18 +535,61 @@ LUA_FUNCTION(gelly_AddParticles) {
 		LUA->Pop(2);
 	}
 
+	const int firstParticle = scene->GetActiveParticles();
 	scene->AddParticles(builder);
+
+	// Particles which didn't fit were dropped, so only the ones that made it
+	// in are given back
+	const auto simData = scene->GetSimData();
+	if (!simData->AreParticleIdsEnabled()) {
+		return 0;
+	}
+
+	LUA->CreateTable();
+	for (int slot = firstParticle; slot < scene->GetActiveParticles();
+		 slot++) {
+		LUA->PushNumber(slot - firstParticle + 1);
+		LUA->PushNumber(simData->GetParticleId(slot));
+		LUA->SetTable(-3);
+	}
 	CATCH_GELLY_EXCEPTIONS();
 
+	return 1;
+}
+
+LUA_FUNCTION(gelly_SetParticleIdsEnabled) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Bool);	// Enabled
+	scene->GetSimData()->SetParticleIdsEnabled(LUA->GetBool(1));
+	CATCH_GELLY_EXCEPTIONS();
 	return 0;
 }
 
+LUA_FUNCTION(gelly_IsParticleAlive) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Number);  // ID
+	LUA->PushBool(
+		scene->GetSimData()->GetParticleSlot(
+			static_cast<ParticleId>(LUA->GetNumber(1))
+		) != INVALID_PARTICLE_SLOT
+	);
+	CATCH_GELLY_EXCEPTIONS();
+	return 1;
+}
+
 LUA_FUNCTION(gelly_GetStatus) {
 	START_GELLY_EXCEPTIONS();
 	// Current status table:
 	//	- ComputeDeviceName: string
 	//	- ActiveParticles: number
 	//	- MaxParticles: number
+	// If the simulation adapts its quality:
+	//	- SolverIterations: number
+	//	- SolverSubsteps: number
+	//	- SimStepTime: number (ms)
+	//	- SimStepBudget: number (ms)
+	// If the simulation reorders particles:
+	//	- ParticleLocality: number (particle radii between neighbouring slots)
 
 	LUA->CreateTable();
 	LUA->PushString(scene->GetComputeDevice());
@@ -413,10 +598,104 @@ LUA_FUNCTION(gelly_GetStatus) {
 	LUA->SetField(-2, "ActiveParticles");
 	LUA->PushNumber(scene->GetMaxParticles());
 	LUA->SetField(-2, "MaxParticles");
+
+	if (scene->HasAdaptiveQuality()) {
+		const auto quality = scene->GetQualityStatus();
+		LUA->PushNumber(quality.iterations);
+		LUA->SetField(-2, "SolverIterations");
+		LUA->PushNumber(quality.substeps);
+		LUA->SetField(-2, "SolverSubsteps");
+		LUA->PushNumber(quality.stepTimeMs);
+		LUA->SetField(-2, "SimStepTime");
+		LUA->PushNumber(quality.targetStepTimeMs);
+		LUA->SetField(-2, "SimStepBudget");
+	}
+
+	if (scene->HasParticleReordering()) {
+		LUA->PushNumber(scene->GetParticleLocality());
+		LUA->SetField(-2, "ParticleLocality");
+	}
 	CATCH_GELLY_EXCEPTIONS();
 	return 1;
 }
 
+#ifndef PRODUCTION_BUILD
+static CRecordingFluidSimulation *GetSimRecorder() {
+	auto *recorder = dynamic_cast<CRecordingFluidSimulation *>(sim.get());
+	if (recorder == nullptr) {
+		throw std::runtime_error("The simulation is not being recorded");
+	}
+
+	return recorder;
+}
+
+LUA_FUNCTION(gelly_StartSimTrace) {
+	START_GELLY_EXCEPTIONS();
+	// The path is relative to the game's working directory. Anything created
+	// before this point (like the map) won't be in the trace.
+	LUA->CheckType(1, GarrysMod::Lua::Type::String);
+
+	const std::string path = LUA->GetString(1);
+	GetSimRecorder()->StartRecording(path);
+	LOG_INFO("Recording simulation trace to %s", path.c_str());
+	CATCH_GELLY_EXCEPTIONS();
+	return 0;
+}
+
+LUA_FUNCTION(gelly_StopSimTrace) {
+	START_GELLY_EXCEPTIONS();
+	GetSimRecorder()->StopRecording();
+	LOG_INFO("Stopped recording simulation trace");
+	CATCH_GELLY_EXCEPTIONS();
+	return 0;
+}
+
+LUA_FUNCTION(gelly_SaveSnapshot) {
+	START_GELLY_EXCEPTIONS();
+	// Same as traces, relative to the game's working directory
+	LUA->CheckType(1, GarrysMod::Lua::Type::String);  // Path
+	const std::string path = LUA->GetString(1);
+	// Quantizing is optional, and roughly halves the size
+	const bool quantize = LUA->GetBool(2);
+
+	CSimSnapshot snapshot;
+	scene->CaptureSnapshot(snapshot);
+	snapshot.WriteToFile(
+		path,
+		quantize ? CSimSnapshot::Quantization::BITS_16
+				 : CSimSnapshot::Quantization::NONE
+	);
+
+	LOG_INFO(
+		"Saved %u particles to snapshot %s",
+		snapshot.GetParticleCount(),
+		path.c_str()
+	);
+	CATCH_GELLY_EXCEPTIONS();
+	return 0;
+}
+
+LUA_FUNCTION(gelly_LoadSnapshot) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::String);  // Path
+	const std::string path = LUA->GetString(1);
+
+	CSimSnapshot snapshot;
+	snapshot.ReadFromFile(path);
+	// Object handles only match up if nothing was added or removed since the
+	// snapshot was saved, which is the case when benchmarking.
+	scene->RestoreSnapshot(snapshot, LUA->GetBool(2));
+
+	LOG_INFO(
+		"Loaded %u particles from snapshot %s",
+		snapshot.GetParticleCount(),
+		path.c_str()
+	);
+	CATCH_GELLY_EXCEPTIONS();
+	return 0;
+}
+#endif
+
 #define GET_LUA_TABLE_NUMBER(name)                 \
 	LUA->GetField(-1, #name);                      \
 	name = static_cast<float>(LUA->GetNumber(-1)); \
@@ -530,6 +809,80 @@ LUA_FUNCTION(gelly_Reset) {
 	return 0;
 }
 
+LUA_FUNCTION(gelly_AddBoxDrain) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Vector);  // Mins
+	LUA->CheckType(2, GarrysMod::Lua::Type::Vector);  // Maxs
+
+	const auto mins = LUA->GetVector(1);
+	const auto maxs = LUA->GetVector(2);
+
+	DrainCreationParams params = {};
+	params.shape = DrainShape::AABB;
+	params.shapeData = DrainCreationParams::AABB{
+		{mins.x, mins.y, mins.z}, {maxs.x, maxs.y, maxs.z}
+	};
+
+	LUA->PushNumber(scene->AddDrain(params));
+	CATCH_GELLY_EXCEPTIONS();
+	return 1;
+}
+
+LUA_FUNCTION(gelly_AddSphereDrain) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Vector);  // Center
+	LUA->CheckType(2, GarrysMod::Lua::Type::Number);  // Radius
+
+	const auto center = LUA->GetVector(1);
+
+	DrainCreationParams params = {};
+	params.shape = DrainShape::SPHERE;
+	params.shapeData = DrainCreationParams::Sphere{
+		{center.x, center.y, center.z}, static_cast<float>(LUA->GetNumber(2))
+	};
+
+	LUA->PushNumber(scene->AddDrain(params));
+	CATCH_GELLY_EXCEPTIONS();
+	return 1;
+}
+
+LUA_FUNCTION(gelly_AddPlaneDrain) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Vector);  // Normal
+	LUA->CheckType(2, GarrysMod::Lua::Type::Number);  // Distance
+
+	// Everything behind the plane, opposite its normal, is drained
+	const auto normal = LUA->GetVector(1);
+
+	DrainCreationParams params = {};
+	params.shape = DrainShape::PLANE;
+	params.shapeData = DrainCreationParams::Plane{
+		{normal.x, normal.y, normal.z}, static_cast<float>(LUA->GetNumber(2))
+	};
+
+	LUA->PushNumber(scene->AddDrain(params));
+	CATCH_GELLY_EXCEPTIONS();
+	return 1;
+}
+
+LUA_FUNCTION(gelly_RemoveDrain) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Number);  // Handle
+	scene->RemoveDrain(static_cast<DrainHandle>(LUA->GetNumber(1)));
+	CATCH_GELLY_EXCEPTIONS();
+	return 0;
+}
+
+LUA_FUNCTION(gelly_GetDrainedParticleCount) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Number);  // Handle
+	LUA->PushNumber(scene->GetDrainedParticleCount(
+		static_cast<DrainHandle>(LUA->GetNumber(1))
+	));
+	CATCH_GELLY_EXCEPTIONS();
+	return 1;
+}
+
 LUA_FUNCTION(gelly_ChangeThresholdRatio) {
 	START_GELLY_EXCEPTIONS();
 	LUA->CheckType(1, GarrysMod::Lua::Type::Number);  // Ratio
@@ -603,43 +956,29 @@ LUA_FUNCTION(gelly_ChangeMaxParticles) {
 		LUA->ThrowError("Cannot set max particles above 1,000,000!");
 	}
 
-	// For safe measure we'll honestly just need to remove the sim and scene,
-	// although the sim context should be fine
-	unsigned int originalWidth = compositor->GetWidth();
-	unsigned int originalHeight = compositor->GetHeight();
-
-	sim.reset();
-	sim = MakeFluidSimulation(simContext.get());
-	scene.reset();
-	compositor.reset();
-	scene = std::make_shared<Scene>(simContext, sim, newMax);
-	compositor = std::make_shared<GModCompositor>(
-		PipelineType::STANDARD,
-		scene->GetSimData(),
-		rendererDevice,
-		originalWidth,
-		originalHeight,
-		newMax
-	);
-
-	scene->SetAbsorptionModifier(compositor->GetAbsorptionModifier());
-	scene->Initialize();
-
-	LUA->Pop();
-
-	// then restore the map
-	LUA->PushSpecial(GarrysMod::Lua::SPECIAL_GLOB);
-	LUA->GetField(-1, "game");
-	LUA->GetField(-1, "GetMap");
-	LUA->Call(0, 1);
+	// Only the renderer is rebuilt, and only when it needs bigger buffers.
+	// The particles and the scene (map included) are resized in place.
+	// The old renderer has to outlive the resize, as the simulation still
+	// has its buffers registered until then.
+	std::shared_ptr<GModCompositor> previousCompositor = compositor;
+	if (newMax > rendererMaxParticles) {
+		rendererMaxParticles = std::min(
+			std::max(newMax, rendererMaxParticles * 2), MAXIMUM_PARTICLES
+		);
 
-	const auto *map = LUA->GetString(-1);
-	const std::string fileName = "maps/" + std::string(map) + ".bsp";
+		compositor = std::make_shared<GModCompositor>(
+			PipelineType::STANDARD,
+			scene->GetSimData(),
+			rendererDevice,
+			previousCompositor->GetWidth(),
+			previousCompositor->GetHeight(),
+			rendererMaxParticles
+		);
 
-	scene->LoadMap(fileName);
+		scene->SetAbsorptionModifier(compositor->GetAbsorptionModifier());
+	}
 
-	// then pop off the special table and the game table
-	LUA->Pop(2);
+	scene->SetMaxParticles(newMax);
 	CATCH_GELLY_EXCEPTIONS();
 	return 0;
 }
@@ -668,6 +1007,44 @@ LUA_FUNCTION(gelly_SetGellySettings) {
 	return 0;
 }
 
+LUA_FUNCTION(gelly_SetSimQualitySettings) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Table);	 // settings
+
+	GET_LUA_TABLE_MEMBER(bool, Adaptive);
+	GET_LUA_TABLE_MEMBER(float, TargetStepTime);
+	GET_LUA_TABLE_MEMBER(float, MinIterations);
+	GET_LUA_TABLE_MEMBER(float, MaxIterations);
+	GET_LUA_TABLE_MEMBER(float, MinSubsteps);
+	GET_LUA_TABLE_MEMBER(float, MaxSubsteps);
+
+	SimQualitySettings settings = {};
+	settings.adaptive = Adaptive_b;
+	settings.targetStepTimeMs = TargetStepTime;
+	settings.minIterations = static_cast<int>(MinIterations);
+	settings.maxIterations = static_cast<int>(MaxIterations);
+	settings.minSubsteps = static_cast<int>(MinSubsteps);
+	settings.maxSubsteps = static_cast<int>(MaxSubsteps);
+
+	scene->SetQualitySettings(settings);
+	CATCH_GELLY_EXCEPTIONS();
+	return 0;
+}
+
+LUA_FUNCTION(gelly_SetCollisionMeshSettings) {
+	START_GELLY_EXCEPTIONS();
+	LUA->CheckType(1, GarrysMod::Lua::Type::Table);	 // settings
+
+	GET_LUA_TABLE_MEMBER(float, MaxTriangles);
+	GET_LUA_TABLE_MEMBER(float, MaxError);
+	GET_LUA_TABLE_MEMBER(float, PrimitiveTolerance);
+
+	scene->SetEntityDecimation(static_cast<uint32_t>(MaxTriangles), MaxError);
+	scene->SetEntityPrimitiveTolerance(PrimitiveTolerance);
+	CATCH_GELLY_EXCEPTIONS();
+	return 0;
+}
+
 LUA_FUNCTION(gelly_GetGellySettings) {
 	START_GELLY_EXCEPTIONS();
 	auto currentSettings = compositor->GetGellySettings();
@@ -742,6 +1119,7 @@ extern "C" __declspec(dllexport) int gmod13_open(lua_State *L) {
 		currentView.height,
 		DEFAULT_MAX_PARTICLES
 	);
+	rendererMaxParticles = DEFAULT_MAX_PARTICLES;
 
 	scene->SetAbsorptionModifier(compositor->GetAbsorptionModifier());
 	scene->Initialize();
@@ -772,17 +1150,29 @@ extern "C" __declspec(dllexport) int gmod13_open(lua_State *L) {
 	DEFINE_LUA_FUNC(gelly, Simulate);
 	DEFINE_LUA_FUNC(gelly, GetStatus);
 	DEFINE_LUA_FUNC(gelly, AddParticles);
+	DEFINE_LUA_FUNC(gelly, SetParticleIdsEnabled);
+	DEFINE_LUA_FUNC(gelly, IsParticleAlive);
 	DEFINE_LUA_FUNC(gelly, LoadMap);
+	DEFINE_LUA_FUNC(gelly, GetMapStatus);
 	DEFINE_LUA_FUNC(gelly, AddObject);
+	DEFINE_LUA_FUNC(gelly, AddCachedObject);
+	DEFINE_LUA_FUNC(gelly, AddObjectFromModel);
 	DEFINE_LUA_FUNC(gelly, AddPlayerObject);
 	DEFINE_LUA_FUNC(gelly, RemoveObject);
+	DEFINE_LUA_FUNC(gelly, GetObjectStatus);
 	DEFINE_LUA_FUNC(gelly, SetObjectPosition);
 	DEFINE_LUA_FUNC(gelly, SetObjectRotation);
+	DEFINE_LUA_FUNC(gelly, SetObjectTransforms);
 	DEFINE_LUA_FUNC(gelly, SetFluidProperties);
 	DEFINE_LUA_FUNC(gelly, SetFluidMaterial);
 	DEFINE_LUA_FUNC(gelly, SetCubemapStrength);
 	DEFINE_LUA_FUNC(gelly, ChangeParticleRadius);
 	DEFINE_LUA_FUNC(gelly, Reset);
+	DEFINE_LUA_FUNC(gelly, AddBoxDrain);
+	DEFINE_LUA_FUNC(gelly, AddSphereDrain);
+	DEFINE_LUA_FUNC(gelly, AddPlaneDrain);
+	DEFINE_LUA_FUNC(gelly, RemoveDrain);
+	DEFINE_LUA_FUNC(gelly, GetDrainedParticleCount);
 	DEFINE_LUA_FUNC(gelly, ChangeThresholdRatio);
 	DEFINE_LUA_FUNC(gelly, SetRenderSettings);
 	DEFINE_LUA_FUNC(gelly, SetDiffuseScale);
@@ -792,6 +1182,14 @@ extern "C" __declspec(dllexport) int gmod13_open(lua_State *L) {
 	DEFINE_LUA_FUNC(gelly, GetVersion);
 	DEFINE_LUA_FUNC(gelly, SetGellySettings);
 	DEFINE_LUA_FUNC(gelly, GetGellySettings);
+	DEFINE_LUA_FUNC(gelly, SetSimQualitySettings);
+	DEFINE_LUA_FUNC(gelly, SetCollisionMeshSettings);
+#ifndef PRODUCTION_BUILD
+	DEFINE_LUA_FUNC(gelly, StartSimTrace);
+	DEFINE_LUA_FUNC(gelly, StopSimTrace);
+	DEFINE_LUA_FUNC(gelly, SaveSnapshot);
+	DEFINE_LUA_FUNC(gelly, LoadSnapshot);
+#endif
 	DumpLuaStack("After defining functions", LUA);
 	LUA->SetField(-2, "gelly");
 	DumpLuaStack("Setting gelly table", LUA);
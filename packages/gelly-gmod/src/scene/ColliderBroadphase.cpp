@@ -0,0 +1,65 @@
+#include "ColliderBroadphase.h"
+
+#include <stdexcept>
+
+ColliderBroadphase::ColliderBroadphase(ISimScene *scene) : simScene(scene) {}
+
+void ColliderBroadphase::Add(
+	ObjectHandle object, const ColliderBounds &bounds
+) {
+	if (!colliderIndices.try_emplace(object, colliders.size()).second) {
+		throw std::invalid_argument(
+			"ColliderBroadphase::Add: The object is already tracked"
+		);
+	}
+
+	colliders.push_back({object, bounds, true});
+}
+
+void ColliderBroadphase::Remove(ObjectHandle object) {
+	const auto it = colliderIndices.find(object);
+	if (it == colliderIndices.end()) {
+		return;
+	}
+
+	// The last collider fills the gap, so the scan stays over packed memory
+	const size_t index = it->second;
+	colliderIndices.erase(it);
+	if (index != colliders.size() - 1) {
+		colliders[index] = colliders.back();
+		colliderIndices[colliders[index].object] = index;
+	}
+
+	colliders.pop_back();
+}
+
+void ColliderBroadphase::Move(
+	ObjectHandle object, const ColliderBounds &bounds
+) {
+	if (const auto it = colliderIndices.find(object);
+		it != colliderIndices.end()) {
+		colliders[it->second].bounds = bounds;
+	}
+}
+
+void ColliderBroadphase::Activate(
+	const std::optional<ColliderBounds> &activeBounds
+) {
+	for (auto &collider : colliders) {
+		const bool enabled =
+			activeBounds.has_value() && collider.bounds.Overlaps(*activeBounds);
+		if (enabled != collider.enabled) {
+			simScene->SetObjectEnabled(collider.object, enabled);
+			collider.enabled = enabled;
+		}
+	}
+}
+
+void ColliderBroadphase::ActivateAll() {
+	for (auto &collider : colliders) {
+		if (!collider.enabled) {
+			simScene->SetObjectEnabled(collider.object, true);
+			collider.enabled = true;
+		}
+	}
+}
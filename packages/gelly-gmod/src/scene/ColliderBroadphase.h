@@ -0,0 +1,113 @@
+#ifndef COLLIDERBROADPHASE_H
+#define COLLIDERBROADPHASE_H
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "fluidsim/ISimScene.h"
+
+/**
+ * Axis aligned box in world space.
+ */
+struct ColliderBounds {
+	float lower[3];
+	float upper[3];
+
+	/**
+	 * \return A box around a sphere, which holds however the sphere turns.
+	 */
+	[[nodiscard]] static ColliderBounds FromSphere(
+		const float center[3], float radius
+	) {
+		return {
+			{center[0] - radius, center[1] - radius, center[2] - radius},
+			{center[0] + radius, center[1] + radius, center[2] + radius}
+		};
+	}
+
+	void Grow(const ColliderBounds &other) {
+		for (int axis = 0; axis < 3; axis++) {
+			lower[axis] = std::min(lower[axis], other.lower[axis]);
+			upper[axis] = std::max(upper[axis], other.upper[axis]);
+		}
+	}
+
+	void Expand(float margin) {
+		for (int axis = 0; axis < 3; axis++) {
+			lower[axis] -= margin;
+			upper[axis] += margin;
+		}
+	}
+
+	[[nodiscard]] bool Overlaps(const ColliderBounds &other) const {
+		for (int axis = 0; axis < 3; axis++) {
+			if (lower[axis] > other.upper[axis] ||
+				upper[axis] < other.lower[axis]) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+/**
+ * Keeps scene objects which are nowhere near the fluid out of the solver, by
+ * disabling them in the scene until they overlap the fluid's bounds again.
+ *
+ * There's only ever one box to test against, so the colliders are kept
+ * packed and scanned linearly, which is cheaper than keeping a sweep and
+ * prune or grid structure up to date as they move. Only the objects which
+ * change state are touched in the scene.
+ *
+ * @code{.cpp}
+ * ColliderBroadphase broadphase(scene);
+ * broadphase.Add(handle, ColliderBounds::FromSphere(position, radius));
+ * broadphase.Activate(fluidBounds);
+ * @endcode
+ */
+class ColliderBroadphase {
+private:
+	struct Collider {
+		ObjectHandle object;
+		ColliderBounds bounds;
+		bool enabled;
+	};
+
+	ISimScene *simScene;
+	std::vector<Collider> colliders;
+	std::unordered_map<ObjectHandle, size_t> colliderIndices;
+
+public:
+	explicit ColliderBroadphase(ISimScene *scene);
+
+	/**
+	 * Starts tracking an object, which is assumed to be enabled like any
+	 * object the scene just created.
+	 * \throws invalid_argument if the object is already tracked.
+	 */
+	void Add(ObjectHandle object, const ColliderBounds &bounds);
+	/**
+	 * Stops tracking an object, without touching it in the scene. Unknown
+	 * objects are ignored.
+	 */
+	void Remove(ObjectHandle object);
+	/**
+	 * Unknown objects are ignored.
+	 */
+	void Move(ObjectHandle object, const ColliderBounds &bounds);
+
+	/**
+	 * Enables the objects overlapping the bounds, and disables the rest.
+	 * \param activeBounds Where the fluid is, or nothing if there's no fluid.
+	 */
+	void Activate(const std::optional<ColliderBounds> &activeBounds);
+	/**
+	 * Enables every object, for when it isn't known where the fluid is.
+	 */
+	void ActivateAll();
+};
+
+#endif	// COLLIDERBROADPHASE_H
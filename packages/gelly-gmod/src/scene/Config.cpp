@@ -3,15 +3,13 @@
 Config::Config(const std::shared_ptr<IFluidSimulation> &sim) : sim(sim) {}
 
 void Config::SetFluidProperties(const ::SetFluidProperties &props) const {
-	auto *cmdList = sim->CreateCommandList();
+	auto *cmdList = sim->BeginCommandList();
 	cmdList->AddCommand(SimCommand{SET_FLUID_PROPERTIES, props});
-	sim->ExecuteCommandList(cmdList);
-	sim->DestroyCommandList(cmdList);
+	sim->SubmitCommandList(cmdList);
 }
 
 void Config::ChangeRadius(float radius) const {
-	auto *cmdList = sim->CreateCommandList();
+	auto *cmdList = sim->BeginCommandList();
 	cmdList->AddCommand(SimCommand{CHANGE_RADIUS, ::ChangeRadius{radius}});
-	sim->ExecuteCommandList(cmdList);
-	sim->DestroyCommandList(cmdList);
+	sim->SubmitCommandList(cmdList);
 }
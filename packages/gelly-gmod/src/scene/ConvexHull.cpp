@@ -0,0 +1,430 @@
+#include "ConvexHull.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+struct HullVector {
+	float x, y, z;
+};
+
+static HullVector Subtract(const HullVector &a, const HullVector &b) {
+	return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+static HullVector Cross(const HullVector &a, const HullVector &b) {
+	return {
+		a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x
+	};
+}
+
+static float Dot(const HullVector &a, const HullVector &b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static float Length(const HullVector &a) { return std::sqrt(Dot(a, a)); }
+
+struct HullFace {
+	uint32_t vertices[3];
+	HullVector normal;
+	// Distance of the face's plane from the origin along the normal
+	float offset;
+	// Points outside of this face which aren't part of the hull yet
+	std::vector<uint32_t> outside;
+
+	[[nodiscard]] float Distance(const HullVector &point) const {
+		return Dot(normal, point) - offset;
+	}
+};
+
+static uint64_t EdgeKey(uint32_t from, uint32_t to) {
+	return static_cast<uint64_t>(from) << 32 | to;
+}
+
+/**
+ * \return False if the triangle has no area to take a normal from.
+ */
+static bool MakeFace(
+	const HullVector *points,
+	uint32_t a,
+	uint32_t b,
+	uint32_t c,
+	HullFace &face
+) {
+	const HullVector normal = Cross(
+		Subtract(points[b], points[a]), Subtract(points[c], points[a])
+	);
+	const float length = Length(normal);
+	if (!(length > 0.f)) {
+		return false;
+	}
+
+	face.vertices[0] = a;
+	face.vertices[1] = b;
+	face.vertices[2] = c;
+	face.normal = {normal.x / length, normal.y / length, normal.z / length};
+	face.offset = Dot(face.normal, points[a]);
+	return true;
+}
+
+/**
+ * Hands each point to the first face it's outside of, points outside of no
+ * face are inside the hull and dropped.
+ */
+static void AssignPoints(
+	const HullVector *points,
+	const std::vector<uint32_t> &candidates,
+	std::vector<HullFace> &faces,
+	size_t firstFace,
+	float epsilon
+) {
+	std::vector<uint32_t> owners(candidates.size());
+	std::transform(
+		std::execution::par_unseq,
+		candidates.begin(),
+		candidates.end(),
+		owners.begin(),
+		[&](uint32_t point) {
+			for (size_t i = firstFace; i < faces.size(); i++) {
+				if (faces[i].Distance(points[point]) > epsilon) {
+					return static_cast<uint32_t>(i);
+				}
+			}
+
+			return UINT32_MAX;
+		}
+	);
+
+	for (size_t i = 0; i < candidates.size(); i++) {
+		if (owners[i] != UINT32_MAX) {
+			faces[owners[i]].outside.push_back(candidates[i]);
+		}
+	}
+}
+
+ConvexHullBuilder::ConvexHullBuilder(uint32_t maxVertices) :
+	maxVertices(maxVertices) {
+	if (maxVertices < 4) {
+		throw std::invalid_argument(
+			"ConvexHullBuilder::ConvexHullBuilder: maxVertices must be at "
+			"least 4"
+		);
+	}
+}
+
+std::optional<ConvexHull> ConvexHullBuilder::Build(
+	const float *pointData, uint32_t pointCount
+) const {
+	if (pointCount < 4) {
+		return std::nullopt;
+	}
+
+	const auto *points = reinterpret_cast<const HullVector *>(pointData);
+	std::vector<uint32_t> indices(pointCount);
+	std::iota(indices.begin(), indices.end(), 0);
+
+	// The extremes along each axis seed the hull and set the tolerance
+	uint32_t extremes[6];
+	float extent = 0.f;
+	for (int axis = 0; axis < 3; axis++) {
+		const auto component = [axis](const HullVector &point) {
+			return axis == 0 ? point.x : (axis == 1 ? point.y : point.z);
+		};
+
+		const auto [min, max] = std::minmax_element(
+			std::execution::par_unseq,
+			indices.begin(),
+			indices.end(),
+			[&](uint32_t a, uint32_t b) {
+				return component(points[a]) < component(points[b]);
+			}
+		);
+
+		extremes[axis * 2] = *min;
+		extremes[axis * 2 + 1] = *max;
+		extent = std::max(
+			extent, component(points[*max]) - component(points[*min])
+		);
+	}
+
+	if (!(extent > 0.f)) {
+		return std::nullopt;
+	}
+
+	// Anything closer to a face than this counts as being on it
+	const float epsilon = extent * 1e-5f;
+
+	// The initial tetrahedron: the two extremes furthest apart, the point
+	// furthest from the line between them, then the point furthest from the
+	// plane through all three.
+	uint32_t a = extremes[0];
+	uint32_t b = extremes[1];
+	float longest = -1.f;
+	for (const uint32_t first : extremes) {
+		for (const uint32_t second : extremes) {
+			const float length =
+				Length(Subtract(points[first], points[second]));
+			if (length > longest) {
+				longest = length;
+				a = first;
+				b = second;
+			}
+		}
+	}
+
+	const HullVector axis = Subtract(points[b], points[a]);
+	const auto distanceFromLine = [&](uint32_t point) {
+		return Length(Cross(axis, Subtract(points[point], points[a]))) /
+			   longest;
+	};
+
+	const uint32_t c = *std::max_element(
+		std::execution::par_unseq,
+		indices.begin(),
+		indices.end(),
+		[&](uint32_t first, uint32_t second) {
+			return distanceFromLine(first) < distanceFromLine(second);
+		}
+	);
+
+	if (!(distanceFromLine(c) > epsilon)) {
+		return std::nullopt;
+	}
+
+	HullFace base = {};
+	MakeFace(points, a, b, c, base);
+	const uint32_t d = *std::max_element(
+		std::execution::par_unseq,
+		indices.begin(),
+		indices.end(),
+		[&](uint32_t first, uint32_t second) {
+			return std::abs(base.Distance(points[first])) <
+				   std::abs(base.Distance(points[second]));
+		}
+	);
+
+	if (!(std::abs(base.Distance(points[d])) > epsilon)) {
+		return std::nullopt;
+	}
+
+	const HullVector centroid = {
+		(points[a].x + points[b].x + points[c].x + points[d].x) * 0.25f,
+		(points[a].y + points[b].y + points[c].y + points[d].y) * 0.25f,
+		(points[a].z + points[b].z + points[c].z + points[d].z) * 0.25f
+	};
+
+	std::vector<HullFace> faces;
+	const uint32_t tetrahedron[4][3] = {
+		{a, b, c}, {a, c, d}, {a, d, b}, {b, d, c}
+	};
+	for (const auto &corners : tetrahedron) {
+		HullFace face = {};
+		MakeFace(points, corners[0], corners[1], corners[2], face);
+
+		// Every face has to point away from the inside
+		if (face.Distance(centroid) > 0.f) {
+			MakeFace(points, corners[0], corners[2], corners[1], face);
+		}
+
+		faces.push_back(std::move(face));
+	}
+
+	AssignPoints(points, indices, faces, 0, epsilon);
+
+	uint32_t vertexCount = 4;
+	std::unordered_map<uint64_t, size_t> edgeFaces;
+	std::vector<size_t> visibleFaces;
+	std::vector<uint8_t> visible;
+	std::vector<std::pair<uint32_t, uint32_t>> horizon;
+	std::vector<HullFace> newFaces;
+	std::vector<uint32_t> orphans;
+	while (vertexCount < maxVertices) {
+		// Always taking the furthest point keeps a capped hull close to the
+		// real one
+		uint32_t eye = UINT32_MAX;
+		size_t eyeFace = 0;
+		float eyeDistance = epsilon;
+		for (size_t i = 0; i < faces.size(); i++) {
+			for (const uint32_t point : faces[i].outside) {
+				const float distance = faces[i].Distance(points[point]);
+				if (distance > eyeDistance) {
+					eyeDistance = distance;
+					eye = point;
+					eyeFace = i;
+				}
+			}
+		}
+
+		if (eye == UINT32_MAX) {
+			break;
+		}
+
+		edgeFaces.clear();
+		for (size_t i = 0; i < faces.size(); i++) {
+			for (int corner = 0; corner < 3; corner++) {
+				edgeFaces[EdgeKey(
+					faces[i].vertices[corner],
+					faces[i].vertices[(corner + 1) % 3]
+				)] = i;
+			}
+		}
+
+		// Rounding can leave the mesh with a hole, in which case there's no
+		// hull to trust
+		const auto findNeighbour = [&](uint32_t from, uint32_t to) {
+			const auto edge = edgeFaces.find(EdgeKey(to, from));
+			return edge == edgeFaces.end() ? SIZE_MAX : edge->second;
+		};
+
+		// Flood out from the eye's face, so the visible region stays in one
+		// piece even when rounding makes a far away face look visible too.
+		visible.assign(faces.size(), 0);
+		visibleFaces.assign(1, eyeFace);
+		visible[eyeFace] = 1;
+		horizon.clear();
+		for (size_t next = 0; next < visibleFaces.size(); next++) {
+			const auto &face = faces[visibleFaces[next]];
+			for (int corner = 0; corner < 3; corner++) {
+				const uint32_t from = face.vertices[corner];
+				const uint32_t to = face.vertices[(corner + 1) % 3];
+				const size_t neighbour = findNeighbour(from, to);
+				if (neighbour == SIZE_MAX) {
+					return std::nullopt;
+				}
+
+				if (visible[neighbour]) {
+					continue;
+				}
+
+				if (faces[neighbour].Distance(points[eye]) > epsilon) {
+					visible[neighbour] = 1;
+					visibleFaces.push_back(neighbour);
+				}
+			}
+		}
+
+		for (const size_t i : visibleFaces) {
+			const auto &face = faces[i];
+			for (int corner = 0; corner < 3; corner++) {
+				const uint32_t from = face.vertices[corner];
+				const uint32_t to = face.vertices[(corner + 1) % 3];
+				if (!visible[findNeighbour(from, to)]) {
+					horizon.emplace_back(from, to);
+				}
+			}
+		}
+
+		// The visible faces are replaced by a fan from the eye to the edge of
+		// the visible region. If the eye is in line with an edge of the
+		// region, it's as good as on the hull already, and adding it would
+		// leave a hole where that edge's face should be.
+		newFaces.clear();
+		for (const auto &[from, to] : horizon) {
+			HullFace face = {};
+			if (!MakeFace(points, from, to, eye, face)) {
+				break;
+			}
+
+			newFaces.push_back(std::move(face));
+		}
+
+		if (newFaces.size() != horizon.size()) {
+			std::erase(faces[eyeFace].outside, eye);
+			continue;
+		}
+
+		orphans.clear();
+		for (const size_t i : visibleFaces) {
+			orphans.insert(
+				orphans.end(),
+				faces[i].outside.begin(),
+				faces[i].outside.end()
+			);
+		}
+
+		size_t kept = 0;
+		for (size_t i = 0; i < faces.size(); i++) {
+			if (visible[i]) {
+				continue;
+			}
+
+			if (kept != i) {
+				faces[kept] = std::move(faces[i]);
+			}
+
+			kept++;
+		}
+
+		faces.resize(kept);
+
+		const size_t firstNewFace = faces.size();
+		std::move(newFaces.begin(), newFaces.end(), std::back_inserter(faces));
+
+		std::erase(orphans, eye);
+		AssignPoints(points, orphans, faces, firstNewFace, epsilon);
+		vertexCount++;
+	}
+
+	std::vector<uint32_t> hullVertices;
+	for (const auto &face : faces) {
+		hullVertices.insert(
+			hullVertices.end(), face.vertices, face.vertices + 3
+		);
+	}
+
+	std::sort(hullVertices.begin(), hullVertices.end());
+	hullVertices.erase(
+		std::unique(hullVertices.begin(), hullVertices.end()),
+		hullVertices.end()
+	);
+
+	// Rounding can leave a vertex slightly outside of a neighbouring face, so
+	// each plane is pushed out to enclose every vertex.
+	for (auto &face : faces) {
+		for (const uint32_t vertex : hullVertices) {
+			face.offset =
+				std::max(face.offset, Dot(face.normal, points[vertex]));
+		}
+	}
+
+	ConvexHull hull;
+
+	// Neighbouring triangles on the same plane only need one plane
+	for (size_t i = 0; i < faces.size(); i++) {
+		const auto &face = faces[i];
+		const bool duplicate = std::any_of(
+			faces.begin(),
+			faces.begin() + static_cast<ptrdiff_t>(i),
+			[&](const HullFace &other) {
+				return Dot(other.normal, face.normal) > 0.9999f &&
+					   std::abs(other.offset - face.offset) < epsilon;
+			}
+		);
+
+		if (!duplicate) {
+			hull.planes.insert(
+				hull.planes.end(),
+				{face.normal.x, face.normal.y, face.normal.z, -face.offset}
+			);
+		}
+	}
+
+	hull.lower[0] = hull.lower[1] = hull.lower[2] = INFINITY;
+	hull.upper[0] = hull.upper[1] = hull.upper[2] = -INFINITY;
+	for (const uint32_t vertex : hullVertices) {
+		const float *position = pointData + vertex * 3;
+		hull.vertices.insert(hull.vertices.end(), position, position + 3);
+
+		for (int i = 0; i < 3; i++) {
+			hull.lower[i] = std::min(hull.lower[i], position[i]);
+			hull.upper[i] = std::max(hull.upper[i], position[i]);
+		}
+	}
+
+	return hull;
+}
@@ -0,0 +1,62 @@
+#ifndef CONVEXHULL_H
+#define CONVEXHULL_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * Convex polyhedron in the layout expected by ObjectCreationParams::Convex.
+ */
+struct ConvexHull {
+	// Four floats per plane, (nx, ny, nz, w) with dot(n, p) + w <= 0 inside
+	std::vector<float> planes;
+	// Three floats per vertex
+	std::vector<float> vertices;
+	float lower[3] = {};
+	float upper[3] = {};
+
+	[[nodiscard]] uint32_t GetPlaneCount() const {
+		return static_cast<uint32_t>(planes.size() / 4);
+	}
+
+	[[nodiscard]] uint32_t GetVertexCount() const {
+		return static_cast<uint32_t>(vertices.size() / 3);
+	}
+};
+
+/**
+ * Builds the convex hull of a point cloud with quickhull.
+ *
+ * The hull grows by always adding the point furthest outside of it, so when
+ * the vertex cap is reached, the points left outside are the ones which
+ * matter least to the shape. Coplanar faces are merged into one plane.
+ *
+ * @code{.cpp}
+ * if (const auto hull = ConvexHullBuilder(32).Build(points, pointCount)) {
+ *     ...
+ * }
+ * @endcode
+ */
+class ConvexHullBuilder {
+private:
+	uint32_t maxVertices;
+
+public:
+	/**
+	 * \throws invalid_argument if maxVertices is less than 4.
+	 */
+	explicit ConvexHullBuilder(uint32_t maxVertices);
+
+	/**
+	 * \param points Three floats per point.
+	 * \return The hull, or nothing if the points are flat, so that they have
+	 * no volume to build a hull around, or too close to flat for rounding to
+	 * leave a closed hull.
+	 */
+	[[nodiscard]] std::optional<ConvexHull> Build(
+		const float *points, uint32_t pointCount
+	) const;
+};
+
+#endif	// CONVEXHULL_H
@@ -0,0 +1,97 @@
+#include "CookingQueue.h"
+
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+CookingQueue::CookingQueue(unsigned int workerCount) {
+	if (workerCount == 0) {
+		throw std::invalid_argument(
+			"CookingQueue::CookingQueue: workerCount must be greater than 0"
+		);
+	}
+
+	workers.reserve(workerCount);
+	for (unsigned int i = 0; i < workerCount; i++) {
+		workers.emplace_back(&CookingQueue::RunWorker, this);
+	}
+}
+
+CookingQueue::~CookingQueue() {
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+		pendingJobs.clear();
+	}
+
+	jobAvailable.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void CookingQueue::RunWorker() {
+	while (true) {
+		CookStep job;
+		{
+			std::unique_lock lock(mutex);
+			jobAvailable.wait(lock, [this] {
+				return stopping || !pendingJobs.empty();
+			});
+
+			if (stopping) {
+				return;
+			}
+
+			job = std::move(pendingJobs.front());
+			pendingJobs.pop_front();
+		}
+
+		FinishStep finish;
+		try {
+			finish = job();
+		} catch (...) {
+			// Handed over to the owning thread, there's nobody to catch it here
+			finish = [error = std::current_exception()] {
+				std::rethrow_exception(error);
+			};
+		}
+
+		std::lock_guard lock(mutex);
+		if (finish) {
+			finishedJobs.push_back(std::move(finish));
+		}
+	}
+}
+
+void CookingQueue::Submit(CookStep job) {
+	{
+		std::lock_guard lock(mutex);
+		pendingJobs.push_back(std::move(job));
+	}
+
+	jobAvailable.notify_one();
+}
+
+void CookingQueue::Finish() {
+	std::vector<FinishStep> jobs;
+	{
+		std::lock_guard lock(mutex);
+		jobs.swap(finishedJobs);
+	}
+
+	std::exception_ptr firstError;
+	for (auto &job : jobs) {
+		try {
+			job();
+		} catch (...) {
+			if (!firstError) {
+				firstError = std::current_exception();
+			}
+		}
+	}
+
+	if (firstError) {
+		std::rethrow_exception(firstError);
+	}
+}
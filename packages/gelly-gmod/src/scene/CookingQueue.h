@@ -0,0 +1,71 @@
+#ifndef COOKINGQUEUE_H
+#define COOKINGQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class CookingStatus {
+	// Never added, or removed since
+	NONE,
+	COOKING,
+	READY,
+	FAILED
+};
+
+/**
+ * Cooks collision geometry on worker threads, so building meshes doesn't
+ * hitch the game thread.
+ *
+ * A job comes in two steps. The cook step runs on a worker and does all of
+ * the CPU work, then returns a finish step, which runs on the owning thread
+ * during Finish. Only the finish step may touch the sim scene.
+ *
+ * @code{.cpp}
+ * queue.Submit([vertices = std::move(vertices)] {
+ *     auto mesh = std::make_shared<WeldedMesh>(Cook(vertices));
+ *     return [mesh] { CreateObject(*mesh); };
+ * });
+ * @endcode
+ */
+class CookingQueue {
+public:
+	using FinishStep = std::function<void()>;
+	using CookStep = std::function<FinishStep()>;
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::deque<CookStep> pendingJobs;
+	std::vector<FinishStep> finishedJobs;
+	bool stopping = false;
+
+	void RunWorker();
+
+public:
+	explicit CookingQueue(unsigned int workerCount);
+	CookingQueue(const CookingQueue &) = delete;
+	CookingQueue &operator=(const CookingQueue &) = delete;
+
+	/**
+	 * Jobs which haven't finished are dropped, a job that's being cooked is
+	 * waited on but its finish step never runs.
+	 */
+	~CookingQueue();
+
+	void Submit(CookStep job);
+	/**
+	 * Runs the finish step of every job cooked since the last call, in the
+	 * order they were cooked.
+	 * \throws Whatever a cook or finish step threw, once every other finish
+	 * step has run.
+	 */
+	void Finish();
+};
+
+#endif	// COOKINGQUEUE_H
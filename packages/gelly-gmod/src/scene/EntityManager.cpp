@@ -1,54 +1,386 @@
 #include "EntityManager.h"
 
-EntityManager::EntityManager(ISimScene *scene) : simScene(scene) {}
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "../logging/global-macros.h"
+#include "ModelCollision.h"
+#include "PhyFile.h"
+
+// Around what FleX handles comfortably per prop, in Source units for the error
+static constexpr uint32_t defaultMaxTriangles = 1000;
+static constexpr float defaultMaxError = 0.25f;
+// Loose enough for tessellated balls and bevelled crates, as a fraction of
+// their size
+static constexpr float defaultPrimitiveTolerance = 0.05f;
+
+EntityManager::EntityManager(ISimScene *scene, CookingQueue &cookingQueue) :
+	simScene(scene),
+	cookingQueue(cookingQueue),
+	broadphase(scene),
+	decimator(defaultMaxTriangles, defaultMaxError),
+	fitter(defaultPrimitiveTolerance) {}
 
 EntityManager::~EntityManager() {
 	for (auto &ent : entities) {
-		simScene->RemoveObject(ent.second);
+		simScene->RemoveObject(ent.second.object);
 	}
 }
 
-std::pair<std::vector<Vector>, std::vector<uint32_t>>
-EntityManager::ProcessGModMesh(std::vector<Vector> vertices) const {
-	std::vector<Vector> processedVertices = vertices;
-	std::vector<uint32_t> indices;
+WeldedMesh EntityManager::ProcessGModMesh(
+	const std::vector<Vector> &vertices, const MeshDecimator &decimator
+) {
+	// Model meshes come in as a triangle soup
+	constexpr float weldTolerance = 0.01f;
+	auto mesh = MeshWelder(weldTolerance)
+					.Weld(
+						reinterpret_cast<const float *>(vertices.data()),
+						static_cast<uint32_t>(vertices.size())
+					);
+	mesh = decimator.Decimate(mesh);
 
 	// FleX expects a different winding order
-	for (size_t i = 0; i < vertices.size(); i += 3) {
-		indices.push_back(i + 2);
-		indices.push_back(i + 1);
-		indices.push_back(i);
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		std::swap(mesh.indices[i], mesh.indices[i + 2]);
 	}
 
-	return std::make_pair(processedVertices, indices);
+	return mesh;
 }
 
-void EntityManager::AddEntity(
-	EntIndex entIndex, const std::vector<Vector> &vertices
+EntityManager::EntityMesh EntityManager::CookEntityMesh(
+	const std::vector<Vector> &vertices,
+	const MeshDecimator &decimator,
+	const PrimitiveFitter &fitter
+) {
+	EntityMesh mesh = {ProcessGModMesh(vertices, decimator)};
+
+	mesh.radius = 0.f;
+	for (size_t i = 0; i < mesh.mesh.vertices.size(); i += 3) {
+		const float *vertex = &mesh.mesh.vertices[i];
+		mesh.radius = std::max(
+			mesh.radius,
+			std::sqrt(
+				vertex[0] * vertex[0] + vertex[1] * vertex[1] +
+				vertex[2] * vertex[2]
+			)
+		);
+	}
+
+	// Built whatever shape was asked for, since later entities sharing the
+	// mesh may want it. Enough vertices to keep the shape of most props,
+	// while staying far cheaper to collide with than the triangles.
+	// A hull which can't be built only rules out the convex shape, the mesh
+	// is still good for everything else.
+	constexpr uint32_t maxHullVertices = 24;
+	try {
+		mesh.hull =
+			ConvexHullBuilder(maxHullVertices)
+				.Build(mesh.mesh.vertices.data(), mesh.mesh.GetVertexCount());
+	} catch (const std::exception &e) {
+		mesh.hullError = e.what();
+	}
+
+	// Like the hull, only used by entities which asked for a convex shape
+	mesh.primitive = fitter.Fit(mesh.mesh);
+	return mesh;
+}
+
+void EntityManager::AddEntityObject(
+	EntIndex entIndex, ObjectHandle object, float radius
+) {
+	constexpr float origin[3] = {0.f, 0.f, 0.f};
+	broadphase.Add(object, ColliderBounds::FromSphere(origin, radius));
+	entities[entIndex] = {object, radius};
+}
+
+void EntityManager::CreateMeshObject(
+	EntIndex entIndex, const EntityMesh &entityMesh
 ) {
+	const auto &mesh = entityMesh.mesh;
+
 	ObjectCreationParams params = {};
 	params.shape = ObjectShape::TRIANGLE_MESH;
 
-	ObjectCreationParams::TriangleMesh mesh = {};
-	mesh.indexType = ObjectCreationParams::TriangleMesh::IndexType::UINT32;
+	ObjectCreationParams::TriangleMesh meshParams = {};
+	meshParams.indexType =
+		ObjectCreationParams::TriangleMesh::IndexType::UINT32;
+	meshParams.vertices = mesh.vertices.data();
+	meshParams.vertexCount = mesh.GetVertexCount();
+	meshParams.indices32 = mesh.indices.data();
+	meshParams.indexCount = mesh.GetIndexCount();
+	meshParams.scale[0] = 1.f;
+	meshParams.scale[1] = 1.f;
+	meshParams.scale[2] = 1.f;
+
+	params.shapeData = meshParams;
+
+	AddEntityObject(
+		entIndex, simScene->CreateObject(params), entityMesh.radius
+	);
+}
+
+void EntityManager::CreateConvexObject(
+	EntIndex entIndex, const EntityMesh &entityMesh
+) {
+	const auto &hull = *entityMesh.hull;
+
+	ObjectCreationParams params = {};
+	params.shape = ObjectShape::CONVEX;
+
+	ObjectCreationParams::Convex convexParams = {};
+	convexParams.planes = hull.planes.data();
+	convexParams.planeCount = hull.GetPlaneCount();
+	for (int i = 0; i < 3; i++) {
+		convexParams.lower[i] = hull.lower[i];
+		convexParams.upper[i] = hull.upper[i];
+		convexParams.scale[i] = 1.f;
+	}
+
+	params.shapeData = convexParams;
+
+	AddEntityObject(
+		entIndex, simScene->CreateObject(params), entityMesh.radius
+	);
+}
+
+void EntityManager::CreatePrimitiveObject(
+	EntIndex entIndex, const EntityMesh &entityMesh
+) {
+	const auto &primitive = *entityMesh.primitive;
+
+	ObjectCreationParams params = {};
+	params.shape = primitive.shape;
+
+	if (primitive.shape == ObjectShape::SPHERE) {
+		ObjectCreationParams::Sphere sphereParams = {};
+		sphereParams.radius = primitive.radius;
+		std::copy_n(primitive.center, 3, sphereParams.center);
+		params.shapeData = sphereParams;
+	} else {
+		ObjectCreationParams::Box boxParams = {};
+		std::copy_n(primitive.halfExtents, 3, boxParams.halfExtents);
+		std::copy_n(primitive.center, 3, boxParams.center);
+		std::copy_n(primitive.rotation, 4, boxParams.rotation);
+		params.shapeData = boxParams;
+	}
+
+	// The primitive hugs the mesh, so the mesh's radius bounds it too
+	AddEntityObject(
+		entIndex, simScene->CreateObject(params), entityMesh.radius
+	);
+}
+
+void EntityManager::CreateEntityObject(
+	EntIndex entIndex, const EntityMesh &mesh, ObjectShape shape
+) {
+	if (shape == ObjectShape::CONVEX && mesh.primitive) {
+		CreatePrimitiveObject(entIndex, mesh);
+		return;
+	}
+
+	if (shape == ObjectShape::CONVEX && mesh.hull) {
+		CreateConvexObject(entIndex, mesh);
+		return;
+	}
+
+	CreateMeshObject(entIndex, mesh);
+}
+
+uint64_t EntityManager::BeginCooking(EntIndex entIndex, ObjectShape shape) {
+	RemoveEntity(entIndex);
+
+	const uint64_t ticket = nextTicket++;
+	pendingEntities[entIndex] = {ticket, shape};
+	return ticket;
+}
+
+void EntityManager::ActivateEntity(
+	EntIndex entIndex, uint64_t ticket, const EntityMesh &mesh
+) {
+	const auto pending = pendingEntities.find(entIndex);
+	if (pending == pendingEntities.end() || pending->second.ticket != ticket) {
+		return;
+	}
+
+	const auto entity = std::move(pending->second);
+	pendingEntities.erase(pending);
+
+	CreateEntityObject(entIndex, mesh, entity.shape);
+	if (entity.position) {
+		UpdateEntityPosition(entIndex, *entity.position);
+	}
+
+	if (entity.rotation) {
+		UpdateEntityRotation(entIndex, *entity.rotation);
+	}
+}
+
+void EntityManager::FinishCooking(
+	const std::string &meshKey,
+	EntIndex entIndex,
+	uint64_t ticket,
+	uint64_t generation,
+	const std::shared_ptr<const EntityMesh> &mesh
+) {
+	std::vector<std::pair<EntIndex, uint64_t>> waiting;
+	if (meshKey.empty()) {
+		waiting.emplace_back(entIndex, ticket);
+	} else if (const auto key = cookingKeys.find(meshKey);
+			   key != cookingKeys.end()) {
+		waiting = std::move(key->second);
+		cookingKeys.erase(key);
+	}
+
+	if (mesh && !meshKey.empty() && generation == cacheGeneration) {
+		meshesByKey[meshKey] = mesh;
+	}
+
+	for (const auto &[waitingIndex, waitingTicket] : waiting) {
+		if (mesh) {
+			ActivateEntity(waitingIndex, waitingTicket, *mesh);
+			continue;
+		}
+
+		const auto pending = pendingEntities.find(waitingIndex);
+		if (pending != pendingEntities.end() &&
+			pending->second.ticket == waitingTicket) {
+			pendingEntities.erase(pending);
+			failedEntities.insert(waitingIndex);
+		}
+	}
+}
+
+void EntityManager::AddEntity(
+	EntIndex entIndex,
+	std::vector<Vector> vertices,
+	const std::string &meshKey,
+	ObjectShape shape
+) {
+	const uint64_t ticket = BeginCooking(entIndex, shape);
+	if (!meshKey.empty()) {
+		auto &waiting = cookingKeys[meshKey];
+		waiting.emplace_back(entIndex, ticket);
+
+		// The mesh is already on its way
+		if (waiting.size() > 1) {
+			return;
+		}
+	}
+
+	// Only the finish step touches the manager, the cook step runs on a
+	// worker and works on its own copies.
+	cookingQueue.Submit([this,
+						 vertices = std::move(vertices),
+						 decimator = decimator,
+						 fitter = fitter,
+						 meshKey,
+						 entIndex,
+						 ticket,
+						 generation = cacheGeneration] {
+		std::shared_ptr<const EntityMesh> mesh;
+		std::string error;
+		try {
+			mesh = std::make_shared<const EntityMesh>(
+				CookEntityMesh(vertices, decimator, fitter)
+			);
+		} catch (const std::exception &e) {
+			error = e.what();
+		}
+
+		return [this, mesh, error, meshKey, entIndex, ticket, generation] {
+			if (!mesh) {
+				LOG_WARNING(
+					"Failed to cook the mesh of entity #%d: %s",
+					static_cast<int>(entIndex),
+					error.c_str()
+				);
+			} else if (!mesh->hullError.empty()) {
+				LOG_WARNING(
+					"Failed to build the convex hull of entity #%d, it "
+					"collides with its triangles instead: %s",
+					static_cast<int>(entIndex),
+					mesh->hullError.c_str()
+				);
+			}
+
+			FinishCooking(meshKey, entIndex, ticket, generation, mesh);
+		};
+	});
+}
+
+bool EntityManager::AddModelEntity(
+	EntIndex entIndex, const std::string &modelPath, ObjectShape shape
+) {
+	if (convexModels.contains(modelPath)) {
+		shape = ObjectShape::CONVEX;
+	}
+
+	if (AddCachedEntity(entIndex, modelPath, shape)) {
+		return true;
+	}
+
+	if (unreadableModels.contains(modelPath)) {
+		return false;
+	}
+
+	// The file is small and parsing it is cheap next to cooking, so it's
+	// done here, where a malformed file can still send the caller to
+	// AddEntity instead.
+	PhyMesh mesh;
+	try {
+		const auto phyData = ReadPhyFile(modelPath);
+		if (!phyData) {
+			unreadableModels.insert(modelPath);
+			return false;
+		}
+
+		mesh = ParsePhyFile(phyData->data(), phyData->size());
+	} catch (const std::runtime_error &e) {
+		LOG_WARNING(
+			"Failed to read the collision mesh of %s: %s",
+			modelPath.c_str(),
+			e.what()
+		);
+		unreadableModels.insert(modelPath);
+		return false;
+	}
+
+	// Its hull is the same shape, but much cheaper to collide with
+	if (mesh.ledgeCount == 1) {
+		convexModels.insert(modelPath);
+		shape = ObjectShape::CONVEX;
+	}
+
+	AddEntity(entIndex, std::move(mesh.triangles), modelPath, shape);
+	return true;
+}
 
-	const auto [processedVertices, indices] = ProcessGModMesh(vertices);
-	mesh.vertices = reinterpret_cast<const float *>(processedVertices.data());
-	mesh.vertexCount = processedVertices.size();
-	mesh.indices32 = indices.data();
-	mesh.indexCount = indices.size();
-	mesh.scale[0] = 1.f;
-	mesh.scale[1] = 1.f;
-	mesh.scale[2] = 1.f;
+bool EntityManager::AddCachedEntity(
+	EntIndex entIndex, const std::string &meshKey, ObjectShape shape
+) {
+	if (const auto mesh = meshesByKey.find(meshKey);
+		mesh != meshesByKey.end()) {
+		// Nothing to cook, so the entity is ready straight away
+		ActivateEntity(entIndex, BeginCooking(entIndex, shape), *mesh->second);
+		return true;
+	}
 
-	params.shapeData = mesh;
+	if (const auto waiting = cookingKeys.find(meshKey);
+		waiting != cookingKeys.end()) {
+		waiting->second.emplace_back(entIndex, BeginCooking(entIndex, shape));
+		return true;
+	}
 
-	entities[entIndex] = simScene->CreateObject(params);
+	return false;
 }
 
 void EntityManager::AddPlayerObject(
 	EntIndex entIndex, float radius, float halfHeight
 ) {
+	RemoveEntity(entIndex);
+
 	ObjectCreationParams params = {};
 	params.shape = ObjectShape::CAPSULE;
 
@@ -58,24 +390,126 @@ void EntityManager::AddPlayerObject(
 
 	params.shapeData = capsule;
 
-	entities[entIndex] = simScene->CreateObject(params);
+	AddEntityObject(
+		entIndex, simScene->CreateObject(params), radius + halfHeight
+	);
+}
+
+void EntityManager::SetDecimation(uint32_t maxTriangles, float maxError) {
+	decimator = MeshDecimator(maxTriangles, maxError);
+	ClearMeshCache();
+}
+
+void EntityManager::SetPrimitiveTolerance(float tolerance) {
+	fitter = PrimitiveFitter(tolerance);
+	ClearMeshCache();
+}
+
+void EntityManager::ClearMeshCache() {
+	meshesByKey.clear();
+	cacheGeneration++;
 }
 
 void EntityManager::RemoveEntity(EntIndex entIndex) {
 	if (auto it = entities.find(entIndex); it != entities.end()) {
-		simScene->RemoveObject(it->second);
+		broadphase.Remove(it->second.object);
+		simScene->RemoveObject(it->second.object);
 		entities.erase(it);
 	}
+
+	// Cancels any cook in flight, its result is dropped once it finishes
+	pendingEntities.erase(entIndex);
+	failedEntities.erase(entIndex);
+}
+
+CookingStatus EntityManager::GetEntityStatus(EntIndex entIndex) const {
+	if (entities.contains(entIndex)) {
+		return CookingStatus::READY;
+	}
+
+	if (pendingEntities.contains(entIndex)) {
+		return CookingStatus::COOKING;
+	}
+
+	if (failedEntities.contains(entIndex)) {
+		return CookingStatus::FAILED;
+	}
+
+	return CookingStatus::NONE;
 }
 
 void EntityManager::UpdateEntityPosition(EntIndex entIndex, Vector position) {
-	simScene->SetObjectPosition(
-		entities[entIndex], position.x, position.y, position.z
-	);
+	if (const auto entity = entities.find(entIndex); entity != entities.end()) {
+		const auto &[object, radius] = entity->second;
+		const float center[3] = {position.x, position.y, position.z};
+		simScene->SetObjectPosition(object, center[0], center[1], center[2]);
+		broadphase.Move(object, ColliderBounds::FromSphere(center, radius));
+	} else if (const auto pending = pendingEntities.find(entIndex);
+			   pending != pendingEntities.end()) {
+		pending->second.position = position;
+	}
 }
 
 void EntityManager::UpdateEntityRotation(EntIndex entIndex, XMFLOAT4 rotation) {
-	simScene->SetObjectQuaternion(
-		entities[entIndex], rotation.y, rotation.z, rotation.w, rotation.x
+	if (const auto entity = entities.find(entIndex); entity != entities.end()) {
+		simScene->SetObjectQuaternion(
+			entity->second.object,
+			rotation.y,
+			rotation.z,
+			rotation.w,
+			rotation.x
+		);
+	} else if (const auto pending = pendingEntities.find(entIndex);
+			   pending != pendingEntities.end()) {
+		pending->second.rotation = rotation;
+	}
+}
+
+void EntityManager::UpdateEntityTransforms(
+	const EntIndex *entIndices,
+	const Vector *positions,
+	const XMFLOAT4 *rotations,
+	size_t entityCount
+) {
+	batchHandles.clear();
+	batchTransforms.clear();
+
+	for (size_t i = 0; i < entityCount; i++) {
+		const auto &position = positions[i];
+		const auto &rotation = rotations[i];
+
+		const auto entity = entities.find(entIndices[i]);
+		if (entity == entities.end()) {
+			if (const auto pending = pendingEntities.find(entIndices[i]);
+				pending != pendingEntities.end()) {
+				pending->second.position = position;
+				pending->second.rotation = rotation;
+			}
+
+			continue;
+		}
+
+		const auto &[object, radius] = entity->second;
+		const float center[3] = {position.x, position.y, position.z};
+		broadphase.Move(object, ColliderBounds::FromSphere(center, radius));
+		batchHandles.push_back(object);
+		batchTransforms.push_back(
+			{{position.x, position.y, position.z},
+			 {rotation.y, rotation.z, rotation.w, rotation.x}}
+		);
+	}
+
+	simScene->SetObjectTransforms(
+		batchHandles.data(),
+		batchTransforms.data(),
+		static_cast<uint>(batchHandles.size())
 	);
-}
\ No newline at end of file
+}
+
+void EntityManager::ActivateEntities(
+	const std::optional<ColliderBounds> &activeBounds
+) {
+	broadphase.Activate(activeBounds);
+}
+
+void EntityManager::ActivateAllEntities() { broadphase.ActivateAll(); }
\ No newline at end of file
@@ -2,31 +2,232 @@
 #define ENTITIES_H
 
 #include <memory>
+#include <optional>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "ColliderBroadphase.h"
+#include "ConvexHull.h"
+#include "CookingQueue.h"
 #include "EntIndex.h"
 #include "GarrysMod/Lua/SourceCompat.h"
+#include "MeshDecimator.h"
+#include "MeshWelder.h"
+#include "PrimitiveFitter.h"
 #include "fluidsim/IFluidSimulation.h"
 #include "fluidsim/ISimScene.h"
 
 class EntityManager {
 private:
-	std::unordered_map<EntIndex, ObjectHandle> entities;
+	struct Entity {
+		ObjectHandle object;
+		// Around the entity's origin, so its bounds hold however it turns
+		float radius;
+	};
+
+	std::unordered_map<EntIndex, Entity> entities;
 	// Gelly's interface uses raw pointers
 	ISimScene *simScene;
+	CookingQueue &cookingQueue;
+	ColliderBroadphase broadphase;
+
+	// Reused by every batched update so that they don't allocate
+	std::vector<ObjectHandle> batchHandles;
+	std::vector<ObjectTransform> batchTransforms;
+
+	struct EntityMesh {
+		WeldedMesh mesh;
+		// Nothing if the mesh is flat, or building the hull failed
+		std::optional<ConvexHull> hull;
+		// Why building the hull failed, if it did
+		std::string hullError;
+		// Furthest any vertex is from the origin, the hull lies within it too
+		float radius;
+		// Stands in for the hull when the mesh is close enough to a sphere or
+		// box
+		std::optional<FittedPrimitive> primitive;
+	};
+
+	// Cooked meshes by the key Lua gave them (usually the model and mesh
+	// index), so spawning the same model again skips cooking. The scene
+	// shares the FleX mesh between every object using it.
+	std::unordered_map<std::string, std::shared_ptr<const EntityMesh>>
+		meshesByKey;
+	// Entities waiting on a key which is still being cooked, along with
+	// their tickets
+	std::unordered_map<std::string, std::vector<std::pair<EntIndex, uint64_t>>>
+		cookingKeys;
+	// Bumped whenever the cached meshes are dropped, so that meshes cooked
+	// with the old settings don't make it back in
+	uint64_t cacheGeneration = 0;
+
+	struct PendingEntity {
+		// Tells the entity's latest cook apart from one that was superseded
+		// or cancelled
+		uint64_t ticket;
+		ObjectShape shape;
+		// The last transform given while cooking, applied once it's ready
+		std::optional<Vector> position;
+		std::optional<XMFLOAT4> rotation;
+	};
 
-	[[nodiscard]] std::pair<std::vector<Vector>, std::vector<uint32_t>>
-	ProcessGModMesh(std::vector<Vector> vertices) const;
+	std::unordered_map<EntIndex, PendingEntity> pendingEntities;
+	std::unordered_set<EntIndex> failedEntities;
+	uint64_t nextTicket = 0;
+	// Models given to AddModelEntity which can't be read natively, so they
+	// aren't read again every time they spawn
+	std::unordered_set<std::string> unreadableModels;
+	// Models whose collision mesh is a single convex piece, which collide
+	// with its hull whatever shape they were given
+	std::unordered_set<std::string> convexModels;
+
+	/**
+	 * Drops the cached meshes, including any still cooking.
+	 */
+	void ClearMeshCache();
+
+	// Bounds the cost of colliding with high detail models
+	MeshDecimator decimator;
+	PrimitiveFitter fitter;
+
+	[[nodiscard]] static WeldedMesh ProcessGModMesh(
+		const std::vector<Vector> &vertices, const MeshDecimator &decimator
+	);
+	/**
+	 * Does all of the CPU work for a mesh, safe to run on a worker thread.
+	 */
+	[[nodiscard]] static EntityMesh CookEntityMesh(
+		const std::vector<Vector> &vertices,
+		const MeshDecimator &decimator,
+		const PrimitiveFitter &fitter
+	);
+	/**
+	 * Tracks a newly created object as the entity, starting at the origin
+	 * like the object does.
+	 */
+	void AddEntityObject(EntIndex entIndex, ObjectHandle object, float radius);
+	void CreateMeshObject(EntIndex entIndex, const EntityMesh &mesh);
+	void CreateConvexObject(EntIndex entIndex, const EntityMesh &mesh);
+	void CreatePrimitiveObject(EntIndex entIndex, const EntityMesh &mesh);
+	/**
+	 * When a convex shape is asked for, prefers the mesh's primitive over its
+	 * hull, and falls back to the triangle mesh if the mesh is flat. A
+	 * triangle mesh is always kept as one.
+	 */
+	void CreateEntityObject(
+		EntIndex entIndex, const EntityMesh &mesh, ObjectShape shape
+	);
+
+	/**
+	 * Replaces anything already added under the index with a pending entity.
+	 * \return The entity's ticket.
+	 */
+	uint64_t BeginCooking(EntIndex entIndex, ObjectShape shape);
+	/**
+	 * Creates the entity's object, unless the ticket is out of date.
+	 */
+	void ActivateEntity(
+		EntIndex entIndex, uint64_t ticket, const EntityMesh &mesh
+	);
+	void FinishCooking(
+		const std::string &meshKey,
+		EntIndex entIndex,
+		uint64_t ticket,
+		uint64_t generation,
+		const std::shared_ptr<const EntityMesh> &mesh
+	);
 
 public:
-	explicit EntityManager(ISimScene *scene);
+	EntityManager(ISimScene *scene, CookingQueue &cookingQueue);
 	~EntityManager();
 
-	void AddEntity(EntIndex entIndex, const std::vector<Vector> &vertices);
+	/**
+	 * Cooks the entity's mesh in the background, the entity collides with
+	 * the fluid once its status is READY.
+	 * \param meshKey If not empty, the mesh is kept under this key for
+	 * AddCachedEntity.
+	 * \param shape Either TRIANGLE_MESH, or CONVEX to collide with the mesh's
+	 * convex hull instead, which is much cheaper for small props. Convex
+	 * meshes close enough to a sphere or box collide as one.
+	 */
+	void AddEntity(
+		EntIndex entIndex,
+		std::vector<Vector> vertices,
+		const std::string &meshKey = {},
+		ObjectShape shape = ObjectShape::TRIANGLE_MESH
+	);
+	/**
+	 * Adds an entity using a mesh previously given to AddEntity. If that mesh
+	 * is still cooking, the entity is added once it's done.
+	 * \return False if there's no mesh with that key, in which case nothing is
+	 * added.
+	 */
+	bool AddCachedEntity(
+		EntIndex entIndex,
+		const std::string &meshKey,
+		ObjectShape shape = ObjectShape::TRIANGLE_MESH
+	);
+	/**
+	 * Like AddEntity, but reads the model's collision mesh natively instead
+	 * of being handed its vertices. The mesh is cached under the model's
+	 * path, so later entities using the model skip reading it.
+	 *
+	 * A model whose collision mesh is a single convex piece is its own hull,
+	 * so it always collides as ObjectShape::CONVEX.
+	 * \return False if the model has no collision mesh, or one that can't be
+	 * parsed (such as a ragdoll's), in which case nothing is added and the
+	 * vertices have to come from AddEntity.
+	 */
+	bool AddModelEntity(
+		EntIndex entIndex,
+		const std::string &modelPath,
+		ObjectShape shape = ObjectShape::TRIANGLE_MESH
+	);
 	void AddPlayerObject(EntIndex entIndex, float radius, float halfHeight);
+	/**
+	 * Changes how far entity meshes are simplified, see MeshDecimator.
+	 * Entities which were already added keep their meshes, but the cached
+	 * ones are dropped so that the next AddEntity uses the new settings.
+	 */
+	void SetDecimation(uint32_t maxTriangles, float maxError);
+	/**
+	 * Changes how closely a mesh has to match a sphere or box to be replaced
+	 * by one, see PrimitiveFitter. Only convex entities are replaced, and 0
+	 * keeps every mesh. Like SetDecimation, only entities added from now on
+	 * are affected.
+	 */
+	void SetPrimitiveTolerance(float tolerance);
 	void RemoveEntity(EntIndex entIndex);
+	[[nodiscard]] CookingStatus GetEntityStatus(EntIndex entIndex) const;
+	/**
+	 * Entities which are still cooking keep the transform and get it once
+	 * they're ready.
+	 */
 	void UpdateEntityPosition(EntIndex entIndex, Vector position);
 	void UpdateEntityRotation(EntIndex entIndex, XMFLOAT4 rotation);
+	/**
+	 * Updates every entity in one go. Rotations are laid out the same way as
+	 * in UpdateEntityRotation, and unknown entities are skipped.
+	 */
+	void UpdateEntityTransforms(
+		const EntIndex *entIndices,
+		const Vector *positions,
+		const XMFLOAT4 *rotations,
+		size_t entityCount
+	);
+
+	/**
+	 * Keeps entities which don't overlap the bounds out of the simulation.
+	 * \param activeBounds Where the fluid is, or nothing if there's no fluid.
+	 */
+	void ActivateEntities(const std::optional<ColliderBounds> &activeBounds);
+	/**
+	 * Puts every entity back into the simulation.
+	 */
+	void ActivateAllEntities();
 };
 
 #endif	// ENTITIES_H
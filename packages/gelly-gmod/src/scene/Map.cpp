@@ -2,9 +2,14 @@
 
 #include <GMFS.h>
 
+#include <utility>
 #include <vector>
 
 #include "../logging/global-macros.h"
+#include "MapCache.h"
+
+// Relative to the game's directory, like the log files
+static constexpr auto mapCacheDirectory = "garrysmod/cache/gelly/maps";
 
 void Map::CheckMapPath(const std::string &mapPath) {
 	if (mapPath.empty()) {
@@ -16,67 +21,154 @@ void Map::CheckMapPath(const std::string &mapPath) {
 	}
 }
 
-BSPMap Map::LoadMap(const std::string &mapPath) {
+std::vector<uint8_t> Map::ReadMapFile(const std::string &mapPath) {
 	CheckMapPath(mapPath);
 	const auto file = FileSystem::Open(mapPath.c_str(), "rb");
 	size_t fileSize = FileSystem::Size(file);
 	std::vector<uint8_t> fileData(fileSize);
 	FileSystem::Read(fileData.data(), fileSize, file);
+	FileSystem::Close(file);
+
+	return fileData;
+}
 
-	const BSPMap map(fileData.data(), fileSize);
+BSPMap Map::ParseMap(
+	const std::vector<uint8_t> &mapData, const std::string &mapPath
+) {
+	const BSPMap map(mapData.data(), mapData.size());
 	if (!map.IsValid()) {
 		throw std::runtime_error("Failed to load map: " + mapPath);
 	}
 
-	FileSystem::Close(file);
 	return map;
 }
 
-ObjectCreationParams Map::CreateMapParams(const BSPMap &map) {
-	ObjectCreationParams params = {};
-	params.shape = ObjectShape::TRIANGLE_MESH;
-	ObjectCreationParams::TriangleMesh mesh = {};
-	mesh.vertices = reinterpret_cast<const float *>(map.GetVertices());
-	mesh.vertexCount = map.GetNumVertices();
+WeldedMesh Map::WeldMap(const BSPMap &map) {
+	// BSP faces are stored as a triangle soup, so every shared edge has its
+	// vertices duplicated. Welding them makes FleX's mesh several times
+	// smaller and quicker to build.
+	constexpr float weldTolerance = 0.01f;
+	auto mesh = MeshWelder(weldTolerance)
+					.Weld(
+						reinterpret_cast<const float *>(map.GetVertices()),
+						map.GetNumVertices()
+					);
+
+	// BSP triangles wind the other way around
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		std::swap(mesh.indices[i], mesh.indices[i + 2]);
+	}
 
-	auto *indices = new uint32_t[mesh.vertexCount];
+	return mesh;
+}
 
-	for (int i = 0; i < mesh.vertexCount; i += 3) {
-		indices[i] = i + 2;
-		indices[i + 1] = i + 1;
-		indices[i + 2] = i;
+CookedMap Map::CookMap(
+	const std::vector<uint8_t> &mapData, const std::string &mapPath
+) {
+	const auto key = MapCache::HashMapData(mapData.data(), mapData.size());
+	const MapCache cache(mapCacheDirectory);
+
+	CookedMap cooked = {};
+	WeldedMesh mesh;
+	if (auto cachedMesh = cache.Load(key)) {
+		mesh = std::move(*cachedMesh);
+		cooked.fromCache = true;
+	} else {
+		const auto map = ParseMap(mapData, mapPath);
+		mesh = WeldMap(map);
+		cooked.mapVertexCount = static_cast<uint32_t>(map.GetNumVertices());
+
+		// The map still works without the cache, it just loads slower next
+		// time
+		try {
+			cache.Store(key, mesh);
+		} catch (const std::exception &e) {
+			cooked.cacheError = e.what();
+		}
 	}
 
-	mesh.indexCount = mesh.vertexCount;
-	mesh.indices32 = indices;
-	mesh.indexType = ObjectCreationParams::TriangleMesh::IndexType::UINT32;
-	mesh.scale[0] = 1.0f;
-	mesh.scale[1] = 1.0f;
-	mesh.scale[2] = 1.0f;
+	// Splitting is cheap next to welding, so the cache keeps the whole mesh
+	// and the chunk size can change without invalidating it
+	cooked.vertexCount = mesh.GetVertexCount();
+	cooked.triangleCount = mesh.GetIndexCount() / 3;
+	cooked.chunks = SplitMapMesh(mesh, cooked.chunkSize);
+	return cooked;
+}
 
-	params.shapeData = mesh;
+ObjectCreationParams Map::CreateMapParams(const WeldedMesh &mesh) {
+	ObjectCreationParams params = {};
+	params.shape = ObjectShape::TRIANGLE_MESH;
+	ObjectCreationParams::TriangleMesh meshParams = {};
+	meshParams.vertices = mesh.vertices.data();
+	meshParams.vertexCount = mesh.GetVertexCount();
+	meshParams.indexCount = mesh.GetIndexCount();
+	meshParams.indices32 = mesh.indices.data();
+	meshParams.indexType =
+		ObjectCreationParams::TriangleMesh::IndexType::UINT32;
+	meshParams.scale[0] = 1.0f;
+	meshParams.scale[1] = 1.0f;
+	meshParams.scale[2] = 1.0f;
+
+	params.shapeData = meshParams;
 	return params;
 }
 
 ObjectHandle Map::CreateMapObject(const ObjectCreationParams &params) const {
-	const auto handle = simScene->CreateObject(params);
-	const auto triangleMesh = std::get<0>(params.shapeData);
-	delete[] triangleMesh.indices32;
-
-	return handle;
+	return simScene->CreateObject(params);
 }
 
-Map::Map(ISimScene *scene, const std::string &mapPath)
-	: simScene(scene), mapObject(INVALID_OBJECT_HANDLE) {
-	const auto map = LoadMap(mapPath);
-	const auto params = CreateMapParams(map);
-	mapObject = CreateMapObject(params);
+Map::Map(ISimScene *scene, const CookedMap &map, const std::string &mapPath)
+	: simScene(scene), broadphase(scene) {
+	if (map.fromCache) {
+		LOG_INFO("Using cooked collision geometry for %s", mapPath.c_str());
+	} else {
+		LOG_INFO(
+			"Welded map mesh from %u to %u vertices, %u triangles",
+			map.mapVertexCount,
+			map.vertexCount,
+			map.triangleCount
+		);
+	}
+
+	if (!map.cacheError.empty()) {
+		LOG_WARNING(
+			"Failed to cache the map's geometry: %s", map.cacheError.c_str()
+		);
+	}
 
-	LOG_INFO("Map loaded: %s\nID: %u", mapPath.c_str(), mapObject);
+	chunks.reserve(map.chunks.size());
+	try {
+		for (const auto &chunk : map.chunks) {
+			const auto params = CreateMapParams(chunk.mesh);
+			chunks.push_back(CreateMapObject(params));
+			broadphase.Add(chunks.back(), chunk.bounds);
+		}
+	} catch (...) {
+		// The destructor won't run, so the chunks made so far are cleaned
+		// up here
+		for (const auto chunk : chunks) {
+			simScene->RemoveObject(chunk);
+		}
+
+		throw;
+	}
+
+	LOG_INFO(
+		"Map loaded: %s\nChunks: %zu (%.0f units)",
+		mapPath.c_str(),
+		chunks.size(),
+		map.chunkSize
+	);
 }
 
 Map::~Map() {
-	if (mapObject != INVALID_OBJECT_HANDLE) {
-		simScene->RemoveObject(mapObject);
+	for (const auto chunk : chunks) {
+		simScene->RemoveObject(chunk);
 	}
-}
\ No newline at end of file
+}
+
+void Map::ActivateChunks(const std::optional<ColliderBounds> &activeBounds) {
+	broadphase.Activate(activeBounds);
+}
+
+void Map::ActivateAllChunks() { broadphase.ActivateAll(); }
\ No newline at end of file
@@ -4,42 +4,104 @@
 #include "BSPParser.h"
 // clang-format on
 
+#include <optional>
 #include <string>
+#include <vector>
 
+#include "ColliderBroadphase.h"
+#include "MapChunk.h"
+#include "MeshWelder.h"
 #include "fluidsim/ISimScene.h"
 
+/**
+ * A map's collision mesh, split into chunks, and what happened while cooking
+ * it, which is logged once the map is created on the game thread.
+ */
+struct CookedMap {
+	std::vector<MapChunk> chunks;
+	// Size of the grid cells the chunks were split along
+	float chunkSize = 0.f;
+	// Of the whole mesh, before it was split
+	uint32_t vertexCount = 0;
+	uint32_t triangleCount = 0;
+	// Whether the mesh came straight out of the on-disk cache
+	bool fromCache = false;
+	// Vertices in the BSP before welding, if it was cooked
+	uint32_t mapVertexCount = 0;
+	// Why the mesh couldn't be stored in the cache, if it couldn't
+	std::string cacheError;
+};
+
 /**
  * Instantiates a map object in the simulation's scene.
  * \note Maps are not entities. They don't have a position or rotation,
  * or even a lifetime.
  * \note Maps are given with the path to the map file, relative to garrysmod/
  *
+ * Loading is split so that the slow part can run off the game thread: the
+ * file is read on the game thread, cooked anywhere, and the map object is
+ * created back on the game thread.
+ *
+ * The map is made of one object per chunk, so that only the chunks near the
+ * fluid have to be collided with. Chunks far away from it are disabled.
+ *
  * For example:
  * @code{.cpp}
- * Map map(scene, "maps/some_map.bsp");
+ * const auto mapData = Map::ReadMapFile("maps/some_map.bsp");
+ * const auto cooked = Map::CookMap(mapData, "maps/some_map.bsp");
+ * Map map(scene, cooked, "maps/some_map.bsp");
  * @endcode
- *
- * \throws runtime_error if the map could not be loaded.
- * \throws invalid_argument if the map path is empty/non-existent.
  */
 class Map {
 private:
 	ISimScene *simScene = nullptr;
-	ObjectHandle mapObject;
+	std::vector<ObjectHandle> chunks;
+	ColliderBroadphase broadphase;
 
 	static void CheckMapPath(const std::string &mapPath);
-	[[nodiscard]] static BSPMap LoadMap(const std::string &mapPath);
-	[[nodiscard]] static ObjectCreationParams CreateMapParams(const BSPMap &map
+	[[nodiscard]] static BSPMap ParseMap(
+		const std::vector<uint8_t> &mapData, const std::string &mapPath
+	);
+	[[nodiscard]] static WeldedMesh WeldMap(const BSPMap &map);
+	[[nodiscard]] static ObjectCreationParams CreateMapParams(
+		const WeldedMesh &mesh
 	);
 	[[nodiscard]] ObjectHandle CreateMapObject(
 		const ObjectCreationParams &params
 	) const;
 
 public:
-	Map(ISimScene *scene, const std::string &mapPath);
+	/**
+	 * \throws invalid_argument if the map path is empty/non-existent.
+	 */
+	[[nodiscard]] static std::vector<uint8_t> ReadMapFile(
+		const std::string &mapPath
+	);
+	/**
+	 * Gets the map's collision mesh from the on-disk cache, cooking and
+	 * storing it first if needed. Doesn't touch the game, so it's safe to
+	 * call from any thread.
+	 * \param mapPath Only used for messages.
+	 * \throws runtime_error if the map could not be parsed.
+	 */
+	[[nodiscard]] static CookedMap CookMap(
+		const std::vector<uint8_t> &mapData, const std::string &mapPath
+	);
+
+	Map(ISimScene *scene, const CookedMap &map, const std::string &mapPath);
 	Map(Map &&other) = delete;
 
 	~Map();
+
+	/**
+	 * Enables the chunks overlapping the bounds, and disables the rest.
+	 * \param activeBounds Where the fluid is, or nothing if there's no fluid.
+	 */
+	void ActivateChunks(const std::optional<ColliderBounds> &activeBounds);
+	/**
+	 * Enables every chunk, for when it isn't known where the fluid is.
+	 */
+	void ActivateAllChunks();
 };
 
 #endif	// MAP_H
@@ -0,0 +1,204 @@
+#include "MapCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+// Entries are written in the machine's byte order, the magic doubles as a
+// check that it matches.
+static constexpr uint32_t entryMagic = 0x4743474d;	// "MGCG"
+
+struct EntryHeader {
+	uint32_t magic;
+	uint32_t cookerVersion;
+	uint64_t key;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+};
+
+MapCache::MapCache(std::filesystem::path directory) :
+	directory(std::move(directory)) {}
+
+std::filesystem::path MapCache::GetEntryPath(uint64_t key) const {
+	char fileName[32] = {};
+	std::snprintf(
+		fileName,
+		sizeof(fileName),
+		"%016llx.bin",
+		static_cast<unsigned long long>(key)
+	);
+
+	return directory / fileName;
+}
+
+std::filesystem::path MapCache::GetTemporaryPath(uint64_t key) const {
+	// Every writer gets its own file, whether it's another thread storing the
+	// same map or another game sharing the directory. The tag tells processes
+	// apart and the counter tells writers within one apart.
+	static const uint64_t processTag =
+		(static_cast<uint64_t>(std::random_device()()) << 32) |
+		std::random_device()();
+	static std::atomic<uint64_t> nextWriter = 0;
+
+	char fileName[64] = {};
+	std::snprintf(
+		fileName,
+		sizeof(fileName),
+		"%016llx.%016llx.%llu.tmp",
+		static_cast<unsigned long long>(key),
+		static_cast<unsigned long long>(processTag),
+		static_cast<unsigned long long>(nextWriter++)
+	);
+
+	return directory / fileName;
+}
+
+uint64_t MapCache::HashMapData(const uint8_t *data, size_t size) {
+	// FNV-1a, eight bytes at a time since maps run into the tens of megabytes
+	constexpr uint64_t offsetBasis = 0xcbf29ce484222325ull;
+	constexpr uint64_t prime = 0x100000001b3ull;
+
+	uint64_t hash = offsetBasis;
+	size_t offset = 0;
+	for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+		uint64_t word;
+		std::memcpy(&word, data + offset, sizeof(word));
+		hash ^= word;
+		hash *= prime;
+	}
+
+	for (; offset < size; offset++) {
+		hash ^= data[offset];
+		hash *= prime;
+	}
+
+	// The size catches maps which differ only in trailing zeroes
+	hash ^= size;
+	hash *= prime;
+	return hash;
+}
+
+std::optional<WeldedMesh> MapCache::Load(uint64_t key) const {
+	const auto path = GetEntryPath(key);
+	std::error_code error;
+	const auto fileSize = std::filesystem::file_size(path, error);
+	if (error || fileSize < sizeof(EntryHeader)) {
+		return std::nullopt;
+	}
+
+	std::ifstream stream(path, std::ios::binary);
+	EntryHeader header = {};
+	if (!stream.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+		return std::nullopt;
+	}
+
+	if (header.magic != entryMagic || header.cookerVersion != cookerVersion ||
+		header.key != key || header.indexCount % 3 != 0) {
+		return std::nullopt;
+	}
+
+	const uint64_t expectedSize = sizeof(EntryHeader) +
+								  header.vertexCount * 3ull * sizeof(float) +
+								  header.indexCount * 1ull * sizeof(uint32_t);
+	if (fileSize != expectedSize) {
+		return std::nullopt;
+	}
+
+	WeldedMesh mesh;
+	mesh.vertices.resize(header.vertexCount * 3ull);
+	mesh.indices.resize(header.indexCount);
+
+	// Read straight into the mesh, there's nothing left to process
+	stream.read(
+		reinterpret_cast<char *>(mesh.vertices.data()),
+		static_cast<std::streamsize>(mesh.vertices.size() * sizeof(float))
+	);
+	stream.read(
+		reinterpret_cast<char *>(mesh.indices.data()),
+		static_cast<std::streamsize>(mesh.indices.size() * sizeof(uint32_t))
+	);
+
+	if (!stream) {
+		return std::nullopt;
+	}
+
+	// A bad index would take FleX down with it
+	if (std::any_of(
+			mesh.indices.begin(),
+			mesh.indices.end(),
+			[&header](uint32_t index) { return index >= header.vertexCount; }
+		)) {
+		return std::nullopt;
+	}
+
+	return mesh;
+}
+
+void MapCache::Store(uint64_t key, const WeldedMesh &mesh) const {
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		throw std::runtime_error(
+			"MapCache::Store: Failed to create " + directory.string() + ": " +
+			error.message()
+		);
+	}
+
+	const auto path = GetEntryPath(key);
+	const auto temporaryPath = GetTemporaryPath(key);
+
+	{
+		std::ofstream stream(
+			temporaryPath, std::ios::binary | std::ios::trunc
+		);
+		if (!stream) {
+			throw std::runtime_error(
+				"MapCache::Store: Failed to open " + temporaryPath.string() +
+				" for writing"
+			);
+		}
+
+		const EntryHeader header = {
+			entryMagic,
+			cookerVersion,
+			key,
+			mesh.GetVertexCount(),
+			mesh.GetIndexCount()
+		};
+
+		stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		stream.write(
+			reinterpret_cast<const char *>(mesh.vertices.data()),
+			static_cast<std::streamsize>(mesh.vertices.size() * sizeof(float))
+		);
+		stream.write(
+			reinterpret_cast<const char *>(mesh.indices.data()),
+			static_cast<std::streamsize>(
+				mesh.indices.size() * sizeof(uint32_t)
+			)
+		);
+
+		if (!stream) {
+			stream.close();
+			std::filesystem::remove(temporaryPath, error);
+			throw std::runtime_error(
+				"MapCache::Store: Failed to write " + temporaryPath.string()
+			);
+		}
+	}
+
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error) {
+		const auto message = error.message();
+		std::filesystem::remove(temporaryPath, error);
+		throw std::runtime_error(
+			"MapCache::Store: Failed to move the entry into " + path.string() +
+			": " + message
+		);
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+#include "MeshWelder.h"
+
+/**
+ * Keeps cooked map collision geometry on disk, so loading a map which was
+ * seen before skips parsing and welding it.
+ *
+ * Entries are keyed by a hash of the BSP's contents, so an updated map is
+ * cooked again even if its name stays the same. Entries written by a
+ * different cooker version are ignored.
+ *
+ * @code{.cpp}
+ * const MapCache cache("garrysmod/cache/gelly/maps");
+ * const auto key = MapCache::HashMapData(data.data(), data.size());
+ * if (auto mesh = cache.Load(key)) {
+ *     ...
+ * }
+ * @endcode
+ */
+class MapCache {
+private:
+	std::filesystem::path directory;
+
+	[[nodiscard]] std::filesystem::path GetEntryPath(uint64_t key) const;
+	/**
+	 * \return A path no other call returns, in this process or any other.
+	 */
+	[[nodiscard]] std::filesystem::path GetTemporaryPath(uint64_t key) const;
+
+public:
+	/**
+	 * Must be bumped whenever the cooked geometry would change, for example
+	 * when the weld tolerance does.
+	 */
+	static constexpr uint32_t cookerVersion = 1;
+
+	explicit MapCache(std::filesystem::path directory);
+
+	[[nodiscard]] static uint64_t HashMapData(const uint8_t *data, size_t size);
+
+	/**
+	 * \return The cooked mesh, or nothing if there's no usable entry for the
+	 * key (missing, stale or corrupt).
+	 */
+	[[nodiscard]] std::optional<WeldedMesh> Load(uint64_t key) const;
+	/**
+	 * Writes the entry to a temporary file first, so a half written entry is
+	 * never picked up. Safe to call for the same key from several threads or
+	 * processes at once, the last one to finish wins.
+	 * \throws runtime_error if the entry could not be written.
+	 */
+	void Store(uint64_t key, const WeldedMesh &mesh) const;
+};
+
+#endif	// MAPCACHE_H
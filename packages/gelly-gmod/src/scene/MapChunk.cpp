@@ -0,0 +1,121 @@
+#include "MapChunk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <numeric>
+#include <utility>
+
+/**
+ * Packs a grid cell into a sortable key, 21 bits per axis.
+ */
+static uint64_t GetCellKey(const float *position, float cellSize) {
+	uint64_t key = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		const auto cell = static_cast<int64_t>(
+			std::floor(position[axis] / cellSize)
+		);
+		key = key << 21 | (static_cast<uint64_t>(cell + (1 << 20)) & 0x1FFFFF);
+	}
+
+	return key;
+}
+
+std::vector<MapChunk> SplitMapMesh(const WeldedMesh &mesh, float &chunkSize) {
+	const size_t triangleCount = mesh.indices.size() / 3;
+	std::vector<float> centres(triangleCount * 3);
+	for (size_t i = 0; i < triangleCount; i++) {
+		for (int corner = 0; corner < 3; corner++) {
+			const uint32_t vertex = mesh.indices[i * 3 + corner];
+			for (int axis = 0; axis < 3; axis++) {
+				centres[i * 3 + axis] += mesh.vertices[vertex * 3 + axis] / 3.f;
+			}
+		}
+	}
+
+	std::vector<uint64_t> cells(triangleCount);
+	std::vector<uint32_t> order(triangleCount);
+	std::iota(order.begin(), order.end(), 0);
+	for (chunkSize = minMapChunkSize;; chunkSize *= 2.f) {
+		std::transform(
+			std::execution::par_unseq,
+			order.begin(),
+			order.end(),
+			cells.begin(),
+			[&](uint32_t triangle) {
+				return GetCellKey(&centres[triangle * 3], chunkSize);
+			}
+		);
+
+		std::vector<uint64_t> uniqueCells = cells;
+		std::sort(
+			std::execution::par_unseq, uniqueCells.begin(), uniqueCells.end()
+		);
+		const auto cellCount = static_cast<size_t>(
+			std::unique(uniqueCells.begin(), uniqueCells.end()) -
+			uniqueCells.begin()
+		);
+
+		if (cellCount <= maxMapChunks) {
+			break;
+		}
+	}
+
+	// Triangles keep their original order within a chunk
+	std::sort(
+		std::execution::par_unseq,
+		order.begin(),
+		order.end(),
+		[&](uint32_t a, uint32_t b) {
+			return cells[a] != cells[b] ? cells[a] < cells[b] : a < b;
+		}
+	);
+
+	std::vector<MapChunk> chunks;
+	std::vector<uint32_t> remap(mesh.GetVertexCount(), UINT32_MAX);
+	std::vector<uint32_t> chunkVertices;
+	for (size_t first = 0; first < order.size();) {
+		const uint64_t cell = cells[order[first]];
+		size_t last = first;
+		while (last < order.size() && cells[order[last]] == cell) {
+			last++;
+		}
+
+		MapChunk chunk = {};
+		chunk.bounds = {
+			{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}
+		};
+		for (size_t i = first; i < last; i++) {
+			for (int corner = 0; corner < 3; corner++) {
+				const uint32_t vertex = mesh.indices[order[i] * 3 + corner];
+				if (remap[vertex] == UINT32_MAX) {
+					remap[vertex] = chunk.mesh.GetVertexCount();
+					chunkVertices.push_back(vertex);
+
+					const float *position = &mesh.vertices[vertex * 3];
+					chunk.mesh.vertices.insert(
+						chunk.mesh.vertices.end(), position, position + 3
+					);
+					chunk.bounds.Grow({
+						{position[0], position[1], position[2]},
+						{position[0], position[1], position[2]}
+					});
+				}
+
+				chunk.mesh.indices.push_back(remap[vertex]);
+			}
+		}
+
+		// Border vertices are copied into every chunk that uses them, so the
+		// remap is reset for the next chunk
+		for (const uint32_t vertex : chunkVertices) {
+			remap[vertex] = UINT32_MAX;
+		}
+
+		chunkVertices.clear();
+		chunks.push_back(std::move(chunk));
+		first = last;
+	}
+
+	return chunks;
+}
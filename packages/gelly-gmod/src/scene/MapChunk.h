@@ -0,0 +1,35 @@
+#ifndef MAPCHUNK_H
+#define MAPCHUNK_H
+
+#include <cstddef>
+#include <vector>
+
+#include "ColliderBroadphase.h"
+#include "MeshWelder.h"
+
+// Size of the smallest grid cells a map is split along
+constexpr float minMapChunkSize = 512.f;
+// The scene's shape slots are shared with props and players
+constexpr size_t maxMapChunks = 1024;
+
+/**
+ * A piece of the map's collision mesh, made of the triangles whose centres
+ * fall in the same cell of a grid.
+ */
+struct MapChunk {
+	WeldedMesh mesh;
+	// Around the chunk's vertices, which can poke out of its cell
+	ColliderBounds bounds;
+};
+
+/**
+ * Splits the map's mesh along a grid, the cells are made bigger until there
+ * are few enough chunks to leave room in the scene for everything else.
+ * Kept apart from Map so that it doesn't need the game.
+ * \param chunkSize Set to the size of the cells the mesh was split along.
+ */
+[[nodiscard]] std::vector<MapChunk> SplitMapMesh(
+	const WeldedMesh &mesh, float &chunkSize
+);
+
+#endif	// MAPCHUNK_H
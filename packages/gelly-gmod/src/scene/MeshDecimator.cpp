@@ -0,0 +1,505 @@
+#include "MeshDecimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+// Symmetric 4x4 matrix, stored as its upper triangle row by row
+struct Quadric {
+	double terms[10] = {};
+
+	static Quadric FromPlane(const double *plane, double weight) {
+		Quadric quadric;
+		int term = 0;
+		for (int row = 0; row < 4; row++) {
+			for (int column = row; column < 4; column++) {
+				quadric.terms[term++] = plane[row] * plane[column] * weight;
+			}
+		}
+
+		return quadric;
+	}
+
+	Quadric &operator+=(const Quadric &other) {
+		for (int i = 0; i < 10; i++) {
+			terms[i] += other.terms[i];
+		}
+
+		return *this;
+	}
+
+	Quadric operator+(const Quadric &other) const {
+		Quadric sum = *this;
+		sum += other;
+		return sum;
+	}
+
+	/**
+	 * \return The summed squared distance of the point to every plane in the
+	 * quadric.
+	 */
+	[[nodiscard]] double Error(const double *p) const {
+		const double *q = terms;
+		return q[0] * p[0] * p[0] + 2 * q[1] * p[0] * p[1] +
+			   2 * q[2] * p[0] * p[2] + 2 * q[3] * p[0] + q[4] * p[1] * p[1] +
+			   2 * q[5] * p[1] * p[2] + 2 * q[6] * p[1] + q[7] * p[2] * p[2] +
+			   2 * q[8] * p[2] + q[9];
+	}
+};
+
+struct DecimatorVertex {
+	double position[3];
+	Quadric quadric;
+	// Bumped whenever the vertex moves, which makes queued collapses stale
+	uint32_t version = 0;
+	bool removed = false;
+	// May still list removed triangles, which are skipped
+	std::vector<uint32_t> triangles;
+};
+
+struct DecimatorTriangle {
+	uint32_t corners[3];
+	bool removed = false;
+
+	[[nodiscard]] bool Contains(uint32_t vertex) const {
+		return corners[0] == vertex || corners[1] == vertex ||
+			   corners[2] == vertex;
+	}
+};
+
+struct EdgeCollapse {
+	double cost;
+	// The kept vertex moves to the target, the other one is removed
+	uint32_t kept;
+	uint32_t removed;
+	uint32_t keptVersion;
+	uint32_t removedVersion;
+	double target[3];
+
+	bool operator>(const EdgeCollapse &other) const {
+		return cost > other.cost;
+	}
+};
+
+// Open edges are weighted well above a single face, so holes and the outline
+// of open meshes survive the decimation.
+static constexpr double boundaryWeight = 10.0;
+
+static void Cross(const double *a, const double *b, double *out) {
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double Dot(const double *a, const double *b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void TriangleNormal(
+	const double *p0, const double *p1, const double *p2, double *normal
+) {
+	const double e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+	const double e1[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+	Cross(e0, e1, normal);
+}
+
+static uint64_t EdgeKey(uint32_t a, uint32_t b) {
+	return static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+}
+
+static EdgeCollapse PlanCollapse(
+	const std::vector<DecimatorVertex> &vertices, uint32_t a, uint32_t b
+) {
+	const auto &first = vertices[a];
+	const auto &second = vertices[b];
+	const Quadric quadric = first.quadric + second.quadric;
+
+	const double midpoint[3] = {
+		(first.position[0] + second.position[0]) * 0.5,
+		(first.position[1] + second.position[1]) * 0.5,
+		(first.position[2] + second.position[2]) * 0.5
+	};
+
+	EdgeCollapse collapse = {};
+	collapse.cost = std::numeric_limits<double>::infinity();
+	collapse.kept = a;
+	collapse.removed = b;
+	collapse.keptVersion = first.version;
+	collapse.removedVersion = second.version;
+
+	for (const double *candidate :
+		 {first.position, second.position, midpoint}) {
+		const double cost = quadric.Error(candidate);
+		if (cost < collapse.cost) {
+			collapse.cost = cost;
+			std::copy(candidate, candidate + 3, collapse.target);
+		}
+	}
+
+	return collapse;
+}
+
+static void GatherNeighbours(
+	const std::vector<DecimatorVertex> &vertices,
+	const std::vector<DecimatorTriangle> &triangles,
+	uint32_t vertex,
+	std::vector<uint32_t> &neighbours
+) {
+	neighbours.clear();
+	for (const uint32_t triangle : vertices[vertex].triangles) {
+		if (triangles[triangle].removed) {
+			continue;
+		}
+
+		for (const uint32_t corner : triangles[triangle].corners) {
+			if (corner != vertex) {
+				neighbours.push_back(corner);
+			}
+		}
+	}
+
+	std::sort(neighbours.begin(), neighbours.end());
+	neighbours.erase(
+		std::unique(neighbours.begin(), neighbours.end()), neighbours.end()
+	);
+}
+
+/**
+ * \return False if the collapse would flip a triangle over, or pinch the mesh
+ * into a non-manifold shape.
+ */
+static bool CanCollapse(
+	const std::vector<DecimatorVertex> &vertices,
+	const std::vector<DecimatorTriangle> &triangles,
+	const EdgeCollapse &collapse,
+	std::vector<uint32_t> &keptNeighbours,
+	std::vector<uint32_t> &removedNeighbours
+) {
+	size_t sharedTriangles = 0;
+	for (const uint32_t moved : {collapse.kept, collapse.removed}) {
+		for (const uint32_t index : vertices[moved].triangles) {
+			const auto &triangle = triangles[index];
+			if (triangle.removed) {
+				continue;
+			}
+
+			if (triangle.Contains(collapse.kept) &&
+				triangle.Contains(collapse.removed)) {
+				// Collapsed away, and seen from both ends
+				sharedTriangles += moved == collapse.kept;
+				continue;
+			}
+
+			const double *corners[3];
+			const double *movedCorners[3];
+			for (int i = 0; i < 3; i++) {
+				corners[i] = vertices[triangle.corners[i]].position;
+				movedCorners[i] = triangle.corners[i] == moved
+									  ? collapse.target
+									  : corners[i];
+			}
+
+			double before[3];
+			double after[3];
+			TriangleNormal(corners[0], corners[1], corners[2], before);
+			TriangleNormal(
+				movedCorners[0], movedCorners[1], movedCorners[2], after
+			);
+
+			if (Dot(before, after) <= 0.0) {
+				return false;
+			}
+		}
+	}
+
+	// The only vertices both ends may share are the far corners of the
+	// triangles on the edge, anything else would end up with two triangles
+	// along one edge.
+	GatherNeighbours(vertices, triangles, collapse.kept, keptNeighbours);
+	GatherNeighbours(vertices, triangles, collapse.removed, removedNeighbours);
+
+	size_t sharedNeighbours = 0;
+	auto kept = keptNeighbours.begin();
+	auto removed = removedNeighbours.begin();
+	while (kept != keptNeighbours.end() && removed != removedNeighbours.end()) {
+		if (*kept < *removed) {
+			++kept;
+		} else if (*removed < *kept) {
+			++removed;
+		} else {
+			sharedNeighbours++;
+			++kept;
+			++removed;
+		}
+	}
+
+	return sharedNeighbours == sharedTriangles;
+}
+
+MeshDecimator::MeshDecimator(uint32_t maxTriangles, float maxError) :
+	maxTriangles(maxTriangles), maxError(maxError) {
+	if (maxTriangles == 0) {
+		throw std::invalid_argument(
+			"MeshDecimator::MeshDecimator: maxTriangles must be greater than 0"
+		);
+	}
+
+	if (!(maxError >= 0.f)) {
+		throw std::invalid_argument(
+			"MeshDecimator::MeshDecimator: maxError must not be negative"
+		);
+	}
+}
+
+WeldedMesh MeshDecimator::Decimate(const WeldedMesh &mesh) const {
+	const uint32_t vertexCount = mesh.GetVertexCount();
+	const uint32_t indexCount = mesh.GetIndexCount();
+	if (std::any_of(
+			std::execution::par_unseq,
+			mesh.indices.begin(),
+			mesh.indices.end(),
+			[vertexCount](uint32_t index) { return index >= vertexCount; }
+		)) {
+		throw std::invalid_argument(
+			"MeshDecimator::Decimate: Index out of range of the vertices"
+		);
+	}
+
+	uint32_t triangleCount = indexCount / 3;
+	if (triangleCount <= maxTriangles && maxError == 0.f) {
+		return mesh;
+	}
+
+	std::vector<DecimatorVertex> vertices(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			vertices[i].position[axis] = mesh.vertices[i * 3 + axis];
+		}
+	}
+
+	std::vector<DecimatorTriangle> triangles(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		for (int corner = 0; corner < 3; corner++) {
+			const uint32_t vertex = mesh.indices[i * 3 + corner];
+			triangles[i].corners[corner] = vertex;
+			vertices[vertex].triangles.push_back(i);
+		}
+	}
+
+	// Every triangle's plane, worked out up front since it's the bulk of the
+	// setup on big meshes
+	std::vector<Quadric> faceQuadrics(triangleCount);
+	std::transform(
+		std::execution::par_unseq,
+		triangles.begin(),
+		triangles.end(),
+		faceQuadrics.begin(),
+		[&vertices](const DecimatorTriangle &triangle) {
+			double normal[3];
+			const double *origin = vertices[triangle.corners[0]].position;
+			TriangleNormal(
+				origin,
+				vertices[triangle.corners[1]].position,
+				vertices[triangle.corners[2]].position,
+				normal
+			);
+
+			const double length = std::sqrt(Dot(normal, normal));
+			if (!(length > 0.0)) {
+				return Quadric();
+			}
+
+			const double plane[4] = {
+				normal[0] / length,
+				normal[1] / length,
+				normal[2] / length,
+				-Dot(normal, origin) / length
+			};
+			return Quadric::FromPlane(plane, 1.0);
+		}
+	);
+
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		for (const uint32_t corner : triangles[i].corners) {
+			vertices[corner].quadric += faceQuadrics[i];
+		}
+	}
+
+	// Sorting the edges pairs up the ones shared by two triangles, whatever
+	// is left on its own is open.
+	std::vector<std::pair<uint64_t, uint32_t>> edges;
+	edges.reserve(static_cast<size_t>(triangleCount) * 3);
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		for (int corner = 0; corner < 3; corner++) {
+			edges.emplace_back(
+				EdgeKey(
+					triangles[i].corners[corner],
+					triangles[i].corners[(corner + 1) % 3]
+				),
+				i * 3 + corner
+			);
+		}
+	}
+
+	std::sort(std::execution::par, edges.begin(), edges.end());
+
+	std::priority_queue<
+		EdgeCollapse,
+		std::vector<EdgeCollapse>,
+		std::greater<EdgeCollapse>>
+		queue;
+	for (size_t first = 0; first < edges.size();) {
+		size_t last = first + 1;
+		while (last < edges.size() && edges[last].first == edges[first].first) {
+			last++;
+		}
+
+		const auto a = static_cast<uint32_t>(edges[first].first >> 32);
+		const auto b = static_cast<uint32_t>(edges[first].first);
+		if (last - first == 1) {
+			// A plane along the edge, facing away from its triangle
+			const auto &triangle = triangles[edges[first].second / 3];
+			const double *p0 = vertices[a].position;
+			const double *p1 = vertices[b].position;
+			const double direction[3] = {
+				p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]
+			};
+
+			double faceNormal[3];
+			double normal[3];
+			TriangleNormal(
+				vertices[triangle.corners[0]].position,
+				vertices[triangle.corners[1]].position,
+				vertices[triangle.corners[2]].position,
+				faceNormal
+			);
+			Cross(direction, faceNormal, normal);
+
+			const double length = std::sqrt(Dot(normal, normal));
+			if (length > 0.0) {
+				const double plane[4] = {
+					normal[0] / length,
+					normal[1] / length,
+					normal[2] / length,
+					-Dot(normal, p0) / length
+				};
+				const auto quadric = Quadric::FromPlane(plane, boundaryWeight);
+				vertices[a].quadric += quadric;
+				vertices[b].quadric += quadric;
+			}
+		}
+
+		first = last;
+	}
+
+	// Queued after every quadric is complete
+	for (size_t i = 0; i < edges.size(); i++) {
+		if (i == 0 || edges[i].first != edges[i - 1].first) {
+			queue.push(PlanCollapse(
+				vertices,
+				static_cast<uint32_t>(edges[i].first >> 32),
+				static_cast<uint32_t>(edges[i].first)
+			));
+		}
+	}
+
+	edges.clear();
+	edges.shrink_to_fit();
+
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	std::vector<uint32_t> keptNeighbours;
+	std::vector<uint32_t> removedNeighbours;
+	while (!queue.empty()) {
+		const EdgeCollapse collapse = queue.top();
+		queue.pop();
+
+		auto &kept = vertices[collapse.kept];
+		auto &removed = vertices[collapse.removed];
+		if (kept.removed || removed.removed ||
+			kept.version != collapse.keptVersion ||
+			removed.version != collapse.removedVersion) {
+			continue;
+		}
+
+		// The queue is ordered by cost, so nothing after this is cheap enough
+		if (triangleCount <= maxTriangles && collapse.cost > maxCost) {
+			break;
+		}
+
+		if (!CanCollapse(
+				vertices,
+				triangles,
+				collapse,
+				keptNeighbours,
+				removedNeighbours
+			)) {
+			continue;
+		}
+
+		std::copy(collapse.target, collapse.target + 3, kept.position);
+		kept.quadric += removed.quadric;
+		kept.version++;
+		removed.removed = true;
+
+		for (const uint32_t index : removed.triangles) {
+			auto &triangle = triangles[index];
+			if (triangle.removed) {
+				continue;
+			}
+
+			if (triangle.Contains(collapse.kept)) {
+				triangle.removed = true;
+				triangleCount--;
+				continue;
+			}
+
+			std::replace(
+				std::begin(triangle.corners),
+				std::end(triangle.corners),
+				collapse.removed,
+				collapse.kept
+			);
+			kept.triangles.push_back(index);
+		}
+
+		removed.triangles.clear();
+		std::erase_if(kept.triangles, [&triangles](uint32_t index) {
+			return triangles[index].removed;
+		});
+
+		// Every edge around the moved vertex costs something different now
+		GatherNeighbours(vertices, triangles, collapse.kept, keptNeighbours);
+		for (const uint32_t neighbour : keptNeighbours) {
+			queue.push(PlanCollapse(vertices, collapse.kept, neighbour));
+		}
+	}
+
+	// Renumbered in the order the vertices are first used, like the welder
+	WeldedMesh decimated;
+	decimated.indices.reserve(static_cast<size_t>(triangleCount) * 3);
+	std::vector<uint32_t> newIndex(
+		vertexCount, std::numeric_limits<uint32_t>::max()
+	);
+	for (const auto &triangle : triangles) {
+		if (triangle.removed) {
+			continue;
+		}
+
+		for (const uint32_t vertex : triangle.corners) {
+			if (newIndex[vertex] == std::numeric_limits<uint32_t>::max()) {
+				newIndex[vertex] = decimated.GetVertexCount();
+				for (const double component : vertices[vertex].position) {
+					decimated.vertices.push_back(static_cast<float>(component));
+				}
+			}
+
+			decimated.indices.push_back(newIndex[vertex]);
+		}
+	}
+
+	return decimated;
+}
@@ -0,0 +1,47 @@
+#ifndef MESHDECIMATOR_H
+#define MESHDECIMATOR_H
+
+#include <cstdint>
+
+#include "MeshWelder.h"
+
+/**
+ * Simplifies a welded mesh by collapsing edges, cheapest first, where the cost
+ * of a collapse is measured with quadric error metrics (the sum of squared
+ * distances from the new vertex to the planes of the triangles it replaces).
+ *
+ * Edges are collapsed until the mesh fits in the triangle budget, and after
+ * that only while the error stays below the threshold, so detail which
+ * doesn't change the shape (like a finely tessellated flat panel) is dropped
+ * even from small meshes. Collapses which would flip a triangle or make the
+ * mesh non-manifold are skipped, and open edges are weighted so that holes
+ * keep their outline. Triangle winding is preserved.
+ *
+ * @code{.cpp}
+ * const auto mesh = MeshDecimator(1000, 0.5f).Decimate(welded);
+ * @endcode
+ */
+class MeshDecimator {
+private:
+	uint32_t maxTriangles;
+	float maxError;
+
+public:
+	/**
+	 * \param maxTriangles Triangle budget, meshes with more are simplified
+	 * until they fit, whatever the error.
+	 * \param maxError Distance the simplified surface may move by when the
+	 * mesh is already within budget.
+	 * \throws invalid_argument if maxTriangles is 0 or maxError is negative.
+	 */
+	MeshDecimator(uint32_t maxTriangles, float maxError);
+
+	/**
+	 * \brief Decimates a mesh, which should be welded beforehand since
+	 * triangles can only be collapsed along the edges they share.
+	 * \throws invalid_argument if an index is out of range.
+	 */
+	[[nodiscard]] WeldedMesh Decimate(const WeldedMesh &mesh) const;
+};
+
+#endif	// MESHDECIMATOR_H
@@ -0,0 +1,218 @@
+#include "MeshWelder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+struct CellEntry {
+	int32_t cell[3];
+	uint32_t vertex;
+
+	[[nodiscard]] bool SameCell(const CellEntry &other) const {
+		return cell[0] == other.cell[0] && cell[1] == other.cell[1] &&
+			   cell[2] == other.cell[2];
+	}
+
+	bool operator<(const CellEntry &other) const {
+		return std::tie(cell[0], cell[1], cell[2], vertex) <
+			   std::tie(
+				   other.cell[0], other.cell[1], other.cell[2], other.vertex
+			   );
+	}
+};
+
+struct TriangleEntry {
+	// Rotated so the smallest index comes first, which keeps the winding
+	uint32_t corners[3];
+	uint32_t triangle;
+	bool degenerate;
+
+	[[nodiscard]] bool SameCorners(const TriangleEntry &other) const {
+		return corners[0] == other.corners[0] &&
+			   corners[1] == other.corners[1] && corners[2] == other.corners[2];
+	}
+
+	bool operator<(const TriangleEntry &other) const {
+		return std::tie(corners[0], corners[1], corners[2], triangle) <
+			   std::tie(
+				   other.corners[0],
+				   other.corners[1],
+				   other.corners[2],
+				   other.triangle
+			   );
+	}
+};
+
+static constexpr uint32_t unusedVertex = std::numeric_limits<uint32_t>::max();
+
+static int32_t SnapToCell(float value, float inverseTolerance) {
+	// Clamped so the cast can't overflow, this is far beyond any map
+	constexpr auto limit =
+		static_cast<float>(std::numeric_limits<int32_t>::max() / 2);
+	const float cell = std::floor(value * inverseTolerance);
+	return static_cast<int32_t>(std::clamp(cell, -limit, limit));
+}
+
+static bool HasArea(
+	const float *vertices, uint32_t a, uint32_t b, uint32_t c, float minArea
+) {
+	const float *p0 = vertices + a * 3;
+	const float *p1 = vertices + b * 3;
+	const float *p2 = vertices + c * 3;
+
+	const float e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+	const float e1[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+	const float cross[3] = {
+		e0[1] * e1[2] - e0[2] * e1[1],
+		e0[2] * e1[0] - e0[0] * e1[2],
+		e0[0] * e1[1] - e0[1] * e1[0]
+	};
+
+	// The cross product's length is twice the area
+	const float doubleAreaSq =
+		cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2];
+	return doubleAreaSq > minArea * minArea * 4.f;
+}
+
+MeshWelder::MeshWelder(float tolerance) : tolerance(tolerance) {
+	if (!(tolerance > 0.f)) {
+		throw std::invalid_argument(
+			"MeshWelder::MeshWelder: tolerance must be greater than 0"
+		);
+	}
+}
+
+WeldedMesh MeshWelder::Weld(
+	const float *vertices,
+	uint32_t vertexCount,
+	const uint32_t *indices,
+	uint32_t indexCount
+) const {
+	if (indices == nullptr) {
+		indexCount = vertexCount;
+	}
+
+	if (indexCount % 3 != 0) {
+		throw std::invalid_argument(
+			"MeshWelder::Weld: The mesh is not made of whole triangles"
+		);
+	}
+
+	if (indices != nullptr &&
+		std::any_of(
+			std::execution::par_unseq,
+			indices,
+			indices + indexCount,
+			[vertexCount](uint32_t index) { return index >= vertexCount; }
+		)) {
+		throw std::invalid_argument(
+			"MeshWelder::Weld: Index out of range of the vertices"
+		);
+	}
+
+	// Sorting by cell groups the vertices which should be merged, without
+	// needing a hash map shared between threads.
+	std::vector<CellEntry> cells(vertexCount);
+	const float inverseTolerance = 1.f / tolerance;
+	std::for_each(
+		std::execution::par_unseq,
+		cells.begin(),
+		cells.end(),
+		[&](CellEntry &entry) {
+			const auto vertex = static_cast<uint32_t>(&entry - cells.data());
+			entry.vertex = vertex;
+			for (int axis = 0; axis < 3; axis++) {
+				entry.cell[axis] =
+					SnapToCell(vertices[vertex * 3 + axis], inverseTolerance);
+			}
+		}
+	);
+
+	std::sort(std::execution::par, cells.begin(), cells.end());
+
+	std::vector<uint32_t> remap(vertexCount);
+	for (size_t first = 0; first < cells.size();) {
+		size_t last = first + 1;
+		while (last < cells.size() && cells[last].SameCell(cells[first])) {
+			last++;
+		}
+
+		for (size_t i = first; i < last; i++) {
+			remap[cells[i].vertex] = cells[first].vertex;
+		}
+
+		first = last;
+	}
+
+	const uint32_t triangleCount = indexCount / 3;
+	std::vector<TriangleEntry> triangles(triangleCount);
+	const float minArea = tolerance * tolerance;
+	std::for_each(
+		std::execution::par_unseq,
+		triangles.begin(),
+		triangles.end(),
+		[&](TriangleEntry &entry) {
+			const auto triangle =
+				static_cast<uint32_t>(&entry - triangles.data());
+			uint32_t corners[3];
+			for (uint32_t i = 0; i < 3; i++) {
+				const uint32_t index = triangle * 3 + i;
+				corners[i] = remap[indices ? indices[index] : index];
+			}
+
+			auto *smallest = std::min_element(corners, corners + 3);
+			std::rotate_copy(corners, smallest, corners + 3, entry.corners);
+			entry.triangle = triangle;
+			entry.degenerate = corners[0] == corners[1] ||
+							   corners[1] == corners[2] ||
+							   corners[0] == corners[2] ||
+							   !HasArea(
+								   vertices,
+								   corners[0],
+								   corners[1],
+								   corners[2],
+								   minArea
+							   );
+		}
+	);
+
+	std::vector<uint8_t> keep(triangleCount, 0);
+	std::sort(std::execution::par, triangles.begin(), triangles.end());
+	for (size_t i = 0; i < triangles.size(); i++) {
+		const auto &entry = triangles[i];
+		const bool duplicate = i > 0 && entry.SameCorners(triangles[i - 1]);
+		keep[entry.triangle] = !entry.degenerate && !duplicate;
+	}
+
+	// Vertices are renumbered in the order they're first used, so only the
+	// ones still referenced are kept and neighbouring triangles stay close in
+	// memory.
+	WeldedMesh mesh;
+	std::vector<uint32_t> newIndex(vertexCount, unusedVertex);
+	for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+		if (!keep[triangle]) {
+			continue;
+		}
+
+		for (uint32_t i = 0; i < 3; i++) {
+			const uint32_t index = triangle * 3 + i;
+			const uint32_t vertex = remap[indices ? indices[index] : index];
+			if (newIndex[vertex] == unusedVertex) {
+				newIndex[vertex] = mesh.GetVertexCount();
+				mesh.vertices.insert(
+					mesh.vertices.end(),
+					vertices + vertex * 3,
+					vertices + vertex * 3 + 3
+				);
+			}
+
+			mesh.indices.push_back(newIndex[vertex]);
+		}
+	}
+
+	return mesh;
+}
@@ -0,0 +1,59 @@
+#ifndef MESHWELDER_H
+#define MESHWELDER_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Indexed triangle mesh with three floats per vertex, the layout expected by
+ * ObjectCreationParams::TriangleMesh.
+ */
+struct WeldedMesh {
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+
+	[[nodiscard]] uint32_t GetVertexCount() const {
+		return static_cast<uint32_t>(vertices.size() / 3);
+	}
+
+	[[nodiscard]] uint32_t GetIndexCount() const {
+		return static_cast<uint32_t>(indices.size());
+	}
+};
+
+/**
+ * Merges vertices which are within a tolerance of each other, and drops any
+ * triangles which end up degenerate or duplicated because of it.
+ *
+ * Vertices are snapped to a grid with cells as big as the tolerance, every
+ * vertex in a cell becomes the first vertex (by original index) in that cell.
+ * Triangle winding is preserved, and the result is deterministic.
+ *
+ * @code{.cpp}
+ * const auto mesh = MeshWelder(0.01f).Weld(vertices, vertexCount);
+ * @endcode
+ */
+class MeshWelder {
+private:
+	float tolerance;
+
+public:
+	explicit MeshWelder(float tolerance);
+
+	/**
+	 * \brief Welds an indexed mesh.
+	 * \param vertices Three floats per vertex.
+	 * \param indices Three indices per triangle, or null if the vertices
+	 * are a triangle soup (every three vertices make a triangle).
+	 * \throws invalid_argument if the counts don't describe whole triangles,
+	 * or an index is out of range.
+	 */
+	[[nodiscard]] WeldedMesh Weld(
+		const float *vertices,
+		uint32_t vertexCount,
+		const uint32_t *indices = nullptr,
+		uint32_t indexCount = 0
+	) const;
+};
+
+#endif	// MESHWELDER_H
@@ -0,0 +1,180 @@
+#include "ModelCollision.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// "VPHY", which starts every solid written by newer compilers
+static constexpr int32_t vphysicsId = 0x59485056;
+// Solids made of convex polygons, the only kind studiomdl writes
+static constexpr int16_t polygonModelType = 0;
+// Size of the header following "VPHY"
+static constexpr size_t solidHeaderSize = 28;
+// Sizes of IVP's compact surface, ledge and triangle
+static constexpr size_t surfaceHeaderSize = 48;
+static constexpr size_t ledgeHeaderSize = 16;
+static constexpr size_t triangleSize = 16;
+// Ledge points are padded to four floats
+static constexpr size_t pointSize = 16;
+// IVP works in meters
+static constexpr float unitsPerMeter = 1.f / 0.0254f;
+
+/**
+ * Reads little endian values out of the file, making sure they're in bounds.
+ */
+class PhyReader {
+private:
+	const uint8_t *data;
+	size_t size;
+
+public:
+	PhyReader(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+	template <typename T>
+	[[nodiscard]] T Read(size_t offset) const {
+		if (offset > size || size - offset < sizeof(T)) {
+			throw std::runtime_error("ParsePhyFile: Unexpected end of file");
+		}
+
+		T value;
+		std::memcpy(&value, data + offset, sizeof(T));
+		return value;
+	}
+
+	/**
+	 * Converts from IVP's space, which is in meters with Y pointing down.
+	 */
+	[[nodiscard]] Vector ReadPoint(size_t offset) const {
+		const auto x = Read<float>(offset);
+		const auto y = Read<float>(offset + 4);
+		const auto z = Read<float>(offset + 8);
+		return {x * unitsPerMeter, z * unitsPerMeter, -y * unitsPerMeter};
+	}
+};
+
+static Vector Subtract(const Vector &a, const Vector &b) {
+	return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+/**
+ * Appends a ledge's triangles, facing into the ledge like GMod's meshes.
+ * \return Where the ledge's points start, which is past the last ledge.
+ */
+static size_t ReadLedge(
+	const PhyReader &reader, size_t ledge, std::vector<Vector> &triangles
+) {
+	const auto pointOffset = reader.Read<int32_t>(ledge);
+	const auto triangleCount = reader.Read<int16_t>(ledge + 12);
+	if (pointOffset <= 0 || triangleCount < 0) {
+		throw std::runtime_error("ParsePhyFile: Malformed ledge");
+	}
+
+	const size_t points = ledge + pointOffset;
+	const size_t firstVertex = triangles.size();
+	for (int16_t i = 0; i < triangleCount; i++) {
+		const size_t triangle = ledge + ledgeHeaderSize + i * triangleSize;
+		for (int edge = 0; edge < 3; edge++) {
+			// The low 16 bits of each edge are the index of its first point
+			const auto edgeData =
+				reader.Read<uint32_t>(triangle + 4 + edge * 4);
+			triangles.push_back(
+				reader.ReadPoint(points + (edgeData & 0xFFFF) * pointSize)
+			);
+		}
+	}
+
+	if (triangles.size() == firstVertex) {
+		return points;
+	}
+
+	// Ledges are convex, so any triangle facing the same way as the offset
+	// from the ledge's centre to it is facing out
+	Vector center = {0.f, 0.f, 0.f};
+	for (size_t i = firstVertex; i < triangles.size(); i++) {
+		center.x += triangles[i].x;
+		center.y += triangles[i].y;
+		center.z += triangles[i].z;
+	}
+
+	const auto vertexCount =
+		static_cast<float>(triangles.size() - firstVertex);
+	center = {
+		center.x / vertexCount, center.y / vertexCount, center.z / vertexCount
+	};
+
+	for (size_t i = firstVertex; i < triangles.size(); i += 3) {
+		const Vector ab = Subtract(triangles[i + 1], triangles[i]);
+		const Vector ac = Subtract(triangles[i + 2], triangles[i]);
+		const Vector normal = {
+			ab.y * ac.z - ab.z * ac.y,
+			ab.z * ac.x - ab.x * ac.z,
+			ab.x * ac.y - ab.y * ac.x
+		};
+
+		const Vector outward = Subtract(triangles[i], center);
+		if (normal.x * outward.x + normal.y * outward.y + normal.z * outward.z >
+			0.f) {
+			std::swap(triangles[i + 1], triangles[i + 2]);
+		}
+	}
+
+	return points;
+}
+
+PhyMesh ParsePhyFile(const uint8_t *data, size_t size) {
+	const PhyReader reader(data, size);
+
+	const auto headerSize = reader.Read<int32_t>(0);
+	const auto solidCount = reader.Read<int32_t>(8);
+	if (headerSize < 16) {
+		throw std::runtime_error("ParsePhyFile: Malformed header");
+	}
+
+	if (solidCount != 1) {
+		throw std::runtime_error(
+			"ParsePhyFile: Expected a single solid, found " +
+			std::to_string(solidCount)
+		);
+	}
+
+	const size_t solid = headerSize;
+	const auto solidSize = reader.Read<int32_t>(solid);
+	const size_t solidEnd = solid + 4 + solidSize;
+	if (solidSize <= 0 || solidEnd > size) {
+		throw std::runtime_error("ParsePhyFile: Malformed solid");
+	}
+
+	// Older compilers wrote the compact surface without a header
+	size_t surface = solid + 4;
+	if (reader.Read<int32_t>(surface) == vphysicsId) {
+		if (reader.Read<int16_t>(surface + 6) != polygonModelType) {
+			throw std::runtime_error("ParsePhyFile: Unsupported solid type");
+		}
+
+		surface += solidHeaderSize;
+	}
+
+	// The ledges are followed by their points, then the tree of ledges
+	const auto treeOffset = reader.Read<int32_t>(surface + 32);
+	const size_t ledgesEnd = std::min(
+		surface + static_cast<size_t>(std::max(treeOffset, 0)), solidEnd
+	);
+
+	PhyMesh mesh;
+	size_t pointsStart = ledgesEnd;
+	for (size_t ledge = surface + surfaceHeaderSize; ledge < pointsStart;) {
+		pointsStart =
+			std::min(pointsStart, ReadLedge(reader, ledge, mesh.triangles));
+		mesh.ledgeCount++;
+
+		const auto triangleCount = reader.Read<int16_t>(ledge + 12);
+		ledge += ledgeHeaderSize + triangleCount * triangleSize;
+	}
+
+	if (mesh.triangles.empty()) {
+		throw std::runtime_error("ParsePhyFile: Solid has no triangles");
+	}
+
+	return mesh;
+}
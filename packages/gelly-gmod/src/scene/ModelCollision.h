@@ -0,0 +1,33 @@
+#ifndef MODELCOLLISION_H
+#define MODELCOLLISION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "GarrysMod/Lua/SourceCompat.h"
+
+/**
+ * A model's collision mesh, as a triangle soup in Source units.
+ */
+struct PhyMesh {
+	std::vector<Vector> triangles;
+	// How many convex pieces the model was compiled with. A mesh made of a
+	// single one is its own convex hull.
+	int ledgeCount = 0;
+};
+
+/**
+ * Turns a model's .phy file, which holds the collision mesh the model was
+ * compiled with, into a triangle soup. The soup is relative to the model's
+ * root bone and wound like GMod's own meshes, so it can be cooked like any
+ * other entity mesh.
+ *
+ * The mesh is made of the convex pieces the model was compiled with. Only
+ * models with a single solid are supported, which is every prop, as the
+ * solids of ragdolls each follow their own bone.
+ * \throws runtime_error if the file is malformed or has more than one solid.
+ */
+[[nodiscard]] PhyMesh ParsePhyFile(const uint8_t *data, size_t size);
+
+#endif	// MODELCOLLISION_H
@@ -1,19 +1,22 @@
 #include "ParticleManager.h"
 
 ParticleListBuilder::ParticleListBuilder() :
-	particles(), absorption{0.f, 0.f, 0.f}, absorptionSet(false) {}
+	positions(),
+	velocities(),
+	absorption{0.f, 0.f, 0.f},
+	absorptionSet(false) {}
 
-ParticleListBuilder ParticleListBuilder::AddParticle(
+ParticleListBuilder &ParticleListBuilder::AddParticle(
 	const Vector &position, const Vector &velocity
 ) {
-	particles.push_back(::AddParticle{
-		position.x, position.y, position.z, velocity.x, velocity.y, velocity.z
-	});
+	// w is filled in by the simulation, which owns the inverse mass
+	positions.push_back({position.x, position.y, position.z, 0.f});
+	velocities.push_back({velocity.x, velocity.y, velocity.z});
 
 	return *this;
 }
 
-ParticleListBuilder ParticleListBuilder::SetAbsorption(
+ParticleListBuilder &ParticleListBuilder::SetAbsorption(
 	float r, float g, float b
 ) {
 	absorption[0] = r;
@@ -24,47 +27,131 @@ ParticleListBuilder ParticleListBuilder::SetAbsorption(
 	return *this;
 }
 
+void ParticleListBuilder::Reserve(size_t particleCount) {
+	positions.reserve(particleCount);
+	velocities.reserve(particleCount);
+}
+
+void ParticleListBuilder::Clear() {
+	positions.clear();
+	velocities.clear();
+	absorption[0] = 0.f;
+	absorption[1] = 0.f;
+	absorption[2] = 0.f;
+	absorptionSet = false;
+}
+
 ParticleManager::ParticleManager(const std::shared_ptr<IFluidSimulation> &sim) :
-	sim(sim) {}
+	sim(sim), particleList() {}
 
 ISimCommandList *ParticleManager::CreateCommandListFromBuilder(
 	const ParticleListBuilder &builder
 ) const {
-	auto *cmdList = sim->CreateCommandList();
-	for (const auto &particle : builder.particles) {
-		cmdList->AddCommand(SimCommand{ADD_PARTICLE, particle});
-	}
+	auto *cmdList = sim->BeginCommandList();
+	cmdList->AddCommand(SimCommand{
+		ADD_PARTICLE_BATCH,
+		AddParticleBatch{
+			builder.positions.data(),
+			builder.velocities.data(),
+			nullptr,
+			static_cast<uint>(builder.GetParticleCount())
+		}
+	});
 
 	return cmdList;
 }
 
-ParticleListBuilder ParticleManager::CreateParticleList() { return {}; }
+ParticleListBuilder &ParticleManager::BeginParticleList() {
+	particleList.Clear();
+	return particleList;
+}
 
 void ParticleManager::AddParticles(
 	const ParticleListBuilder &builder,
 	const std::shared_ptr<gelly::renderer::splatting::AbsorptionModifier>
 		&absorptionModifier
-) const {
+) {
 	auto *cmdList = CreateCommandListFromBuilder(builder);
 
-	absorptionModifier->StartModifying();
-	for (int i = 0; i < builder.particles.size(); ++i) {
-		absorptionModifier->ModifyAbsorption(
-			sim->GetSimulationData()->GetActiveParticles() + i,
-			reinterpret_cast<const gelly::renderer::splatting::float3 &>(
-				builder.absorption
-			)
+	const auto &absorption =
+		reinterpret_cast<const gelly::renderer::splatting::float3 &>(
+			builder.absorption
 		);
+	const int firstParticle = sim->GetSimulationData()->GetActiveParticles();
+	const int lastParticle = firstParticle + builder.GetParticleCount();
+
+	if (absorptions.size() < lastParticle) {
+		absorptions.resize(lastParticle);
+	}
+
+	absorptionModifier->StartModifying();
+	for (int i = firstParticle; i < lastParticle; ++i) {
+		absorptions[i] = absorption;
+		absorptionModifier->ModifyAbsorption(i, absorption);
+	}
+	absorptionModifier->EndModifying();
+
+	sim->SubmitCommandList(cmdList);
+}
+
+void ParticleManager::RemapAbsorption(
+	const uint32_t *previousSlots,
+	int particleCount,
+	const std::shared_ptr<gelly::renderer::splatting::AbsorptionModifier>
+		&absorptionModifier
+) {
+	remappedAbsorptions.resize(particleCount);
+	for (int i = 0; i < particleCount; ++i) {
+		const uint32_t previousSlot = previousSlots[i];
+		remappedAbsorptions[i] = previousSlot < absorptions.size()
+									 ? absorptions[previousSlot]
+									 : gelly::renderer::splatting::float3{};
+	}
+
+	// Nothing past the remapped particles is alive anymore
+	absorptions.swap(remappedAbsorptions);
+
+	absorptionModifier->StartModifying();
+	for (int i = 0; i < particleCount; ++i) {
+		absorptionModifier->ModifyAbsorption(i, absorptions[i]);
 	}
 	absorptionModifier->EndModifying();
+}
+
+void ParticleManager::CaptureAbsorption(
+	std::vector<SimFloat3> &out, int particleCount
+) const {
+	out.resize(particleCount);
+	for (int i = 0; i < particleCount; ++i) {
+		const auto &absorption = i < absorptions.size()
+									 ? absorptions[i]
+									 : gelly::renderer::splatting::float3{};
+		out[i] = {absorption.x, absorption.y, absorption.z};
+	}
+}
+
+void ParticleManager::RestoreAbsorption(
+	const std::vector<SimFloat3> &in,
+	const std::shared_ptr<gelly::renderer::splatting::AbsorptionModifier>
+		&absorptionModifier
+) {
+	const int particleCount = std::min(
+		static_cast<int>(in.size()),
+		sim->GetSimulationData()->GetMaxParticles()
+	);
+
+	absorptions.resize(particleCount);
 
-	sim->ExecuteCommandList(cmdList);
-	sim->DestroyCommandList(cmdList);
+	absorptionModifier->StartModifying();
+	for (int i = 0; i < particleCount; ++i) {
+		absorptions[i] = {in[i].x, in[i].y, in[i].z};
+		absorptionModifier->ModifyAbsorption(i, absorptions[i]);
+	}
+	absorptionModifier->EndModifying();
 }
 
 void ParticleManager::ClearParticles() const {
-	auto *cmdList = sim->CreateCommandList();
+	auto *cmdList = sim->BeginCommandList();
 	cmdList->AddCommand(SimCommand{RESET, Reset{}});
-	sim->ExecuteCommandList(cmdList);
-	sim->DestroyCommandList(cmdList);
+	sim->SubmitCommandList(cmdList);
 }
@@ -12,7 +12,10 @@ class ParticleListBuilder {
 	friend class ParticleManager;
 
 protected:
-	std::vector<AddParticle> particles;
+	// Kept as separate arrays so they can be handed to the simulation as a
+	// single particle batch without any conversion.
+	std::vector<SimFloat4> positions;
+	std::vector<SimFloat3> velocities;
 	float absorption[3];
 	bool absorptionSet = false;
 
@@ -20,16 +23,33 @@ public:
 	ParticleListBuilder();
 	~ParticleListBuilder() = default;
 
-	ParticleListBuilder AddParticle(
+	ParticleListBuilder &AddParticle(
 		const Vector &position, const Vector &velocity
 	);
 
-	ParticleListBuilder SetAbsorption(float r, float g, float b);
+	ParticleListBuilder &SetAbsorption(float r, float g, float b);
+	void Reserve(size_t particleCount);
+	/**
+	 * Empties the builder while keeping its capacity.
+	 */
+	void Clear();
+
+	[[nodiscard]] size_t GetParticleCount() const { return positions.size(); }
+	[[nodiscard]] const SimFloat4 *GetPositions() const {
+		return positions.data();
+	}
 };
 
 class ParticleManager {
 private:
 	std::shared_ptr<IFluidSimulation> sim;
+	// Reused for every emission so that emitters firing each tick don't
+	// reallocate the particle arrays.
+	ParticleListBuilder particleList;
+	// The renderer's absorption buffer is write-only, so a copy is kept here
+	// for when the simulation moves particles between slots.
+	std::vector<gelly::renderer::splatting::float3> absorptions;
+	std::vector<gelly::renderer::splatting::float3> remappedAbsorptions;
 
 	[[nodiscard]] ISimCommandList *CreateCommandListFromBuilder(
 		const ParticleListBuilder &builder
@@ -39,12 +59,39 @@ public:
 	explicit ParticleManager(const std::shared_ptr<IFluidSimulation> &sim);
 	~ParticleManager() = default;
 
-	static ParticleListBuilder CreateParticleList();
+	/**
+	 * Returns the manager's particle list, emptied and ready to be filled.
+	 * \note The list is only valid until the next call to this function.
+	 */
+	[[nodiscard]] ParticleListBuilder &BeginParticleList();
 	void AddParticles(
 		const ParticleListBuilder &builder,
 		const std::shared_ptr<gelly::renderer::splatting::AbsorptionModifier>
 			&absorptionModifier
-	) const;
+	);
+	/**
+	 * Moves each particle's absorption along with it after the simulation
+	 * moved particles between slots.
+	 */
+	void RemapAbsorption(
+		const uint32_t *previousSlots,
+		int particleCount,
+		const std::shared_ptr<gelly::renderer::splatting::AbsorptionModifier>
+			&absorptionModifier
+	);
+	/**
+	 * Copies the absorption of the first particleCount particles.
+	 */
+	void CaptureAbsorption(std::vector<SimFloat3> &out, int particleCount)
+		const;
+	/**
+	 * Overwrites the absorption of every particle, starting from the first.
+	 */
+	void RestoreAbsorption(
+		const std::vector<SimFloat3> &in,
+		const std::shared_ptr<gelly::renderer::splatting::AbsorptionModifier>
+			&absorptionModifier
+	);
 	void ClearParticles() const;
 };
 
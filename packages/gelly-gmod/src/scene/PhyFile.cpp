@@ -0,0 +1,28 @@
+#include "PhyFile.h"
+
+#include <GMFS.h>
+
+#include <stdexcept>
+#include <string_view>
+
+std::optional<std::vector<uint8_t>> ReadPhyFile(const std::string &modelPath
+) {
+	constexpr std::string_view modelExtension = ".mdl";
+	if (!modelPath.ends_with(modelExtension)) {
+		throw std::invalid_argument("Model path is not a .mdl: " + modelPath);
+	}
+
+	const auto phyPath =
+		modelPath.substr(0, modelPath.size() - modelExtension.size()) + ".phy";
+	if (!FileSystem::Exists(phyPath.c_str())) {
+		return std::nullopt;
+	}
+
+	const auto file = FileSystem::Open(phyPath.c_str(), "rb");
+	size_t fileSize = FileSystem::Size(file);
+	std::vector<uint8_t> fileData(fileSize);
+	FileSystem::Read(fileData.data(), fileSize, file);
+	FileSystem::Close(file);
+
+	return fileData;
+}
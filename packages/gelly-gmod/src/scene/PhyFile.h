@@ -0,0 +1,21 @@
+#ifndef PHYFILE_H
+#define PHYFILE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Reads the .phy file next to a model, which holds the collision mesh the
+ * model was compiled with, straight from the game's filesystem. Kept apart
+ * from ParsePhyFile so that the parser doesn't need the game.
+ * \param modelPath Such as "models/props_c17/oildrum001.mdl".
+ * \return Nothing if the model has no collision mesh.
+ * \throws invalid_argument if the path isn't a .mdl.
+ */
+[[nodiscard]] std::optional<std::vector<uint8_t>> ReadPhyFile(
+	const std::string &modelPath
+);
+
+#endif	// PHYFILE_H
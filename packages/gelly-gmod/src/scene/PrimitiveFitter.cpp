@@ -0,0 +1,389 @@
+#include "PrimitiveFitter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+#include <vector>
+
+struct FitVector {
+	float x, y, z;
+};
+
+static FitVector Subtract(const FitVector &a, const FitVector &b) {
+	return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+static FitVector Cross(const FitVector &a, const FitVector &b) {
+	return {
+		a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x
+	};
+}
+
+static float Dot(const FitVector &a, const FitVector &b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static float Length(const FitVector &a) { return std::sqrt(Dot(a, a)); }
+
+/**
+ * Points spread over the mesh's surface, along with its area and how it's
+ * spread out.
+ */
+struct Surface {
+	// Every vertex, then every triangle's centre
+	std::vector<FitVector> points;
+	float area = 0.f;
+	// Covariance of the surface, weighted by area
+	double covariance[3][3] = {};
+};
+
+static Surface SampleSurface(const WeldedMesh &mesh) {
+	const auto *vertices =
+		reinterpret_cast<const FitVector *>(mesh.vertices.data());
+
+	Surface surface;
+	surface.points.assign(vertices, vertices + mesh.GetVertexCount());
+
+	double mean[3] = {};
+	double moments[3][3] = {};
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		const FitVector corners[3] = {
+			vertices[mesh.indices[i]],
+			vertices[mesh.indices[i + 1]],
+			vertices[mesh.indices[i + 2]]
+		};
+
+		const float area =
+			Length(Cross(
+				Subtract(corners[1], corners[0]),
+				Subtract(corners[2], corners[0])
+			)) *
+			0.5f;
+
+		const FitVector sum = {
+			corners[0].x + corners[1].x + corners[2].x,
+			corners[0].y + corners[1].y + corners[2].y,
+			corners[0].z + corners[1].z + corners[2].z
+		};
+
+		surface.points.push_back({sum.x / 3.f, sum.y / 3.f, sum.z / 3.f});
+		surface.area += area;
+
+		// Second moment of a triangle: area / 12 * (sum of the corners'
+		// outer products + the outer product of their sum)
+		const float s[3] = {sum.x, sum.y, sum.z};
+		for (int row = 0; row < 3; row++) {
+			mean[row] += area * s[row] / 3.0;
+			for (int column = 0; column < 3; column++) {
+				double moment = s[row] * s[column];
+				for (const auto &corner : corners) {
+					const float c[3] = {corner.x, corner.y, corner.z};
+					moment += c[row] * c[column];
+				}
+
+				moments[row][column] += area / 12.0 * moment;
+			}
+		}
+	}
+
+	if (surface.area > 0.f) {
+		for (int row = 0; row < 3; row++) {
+			for (int column = 0; column < 3; column++) {
+				surface.covariance[row][column] =
+					moments[row][column] / surface.area -
+					mean[row] * mean[column] / (surface.area * surface.area);
+			}
+		}
+	}
+
+	return surface;
+}
+
+/**
+ * Finds the eigenvectors of a symmetric matrix with Jacobi rotations.
+ * \param axes Receives one eigenvector per row, forming a rotation.
+ */
+static void GetPrincipalAxes(const double matrix[3][3], FitVector axes[3]) {
+	double a[3][3];
+	double v[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+	std::copy(&matrix[0][0], &matrix[0][0] + 9, &a[0][0]);
+
+	for (int sweep = 0; sweep < 32; sweep++) {
+		const double offDiagonal =
+			std::abs(a[0][1]) + std::abs(a[0][2]) + std::abs(a[1][2]);
+		if (offDiagonal < 1e-12) {
+			break;
+		}
+
+		for (int p = 0; p < 2; p++) {
+			for (int q = p + 1; q < 3; q++) {
+				if (std::abs(a[p][q]) < 1e-15) {
+					continue;
+				}
+
+				// Rotates the pq plane so that a[p][q] becomes 0
+				const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+				const double t =
+					(theta >= 0.0 ? 1.0 : -1.0) /
+					(std::abs(theta) + std::sqrt(theta * theta + 1.0));
+				const double c = 1.0 / std::sqrt(t * t + 1.0);
+				const double s = t * c;
+
+				for (int k = 0; k < 3; k++) {
+					const double akp = a[k][p];
+					const double akq = a[k][q];
+					a[k][p] = c * akp - s * akq;
+					a[k][q] = s * akp + c * akq;
+				}
+
+				for (int k = 0; k < 3; k++) {
+					const double apk = a[p][k];
+					const double aqk = a[q][k];
+					a[p][k] = c * apk - s * aqk;
+					a[q][k] = s * apk + c * aqk;
+				}
+
+				for (int k = 0; k < 3; k++) {
+					const double vkp = v[k][p];
+					const double vkq = v[k][q];
+					v[k][p] = c * vkp - s * vkq;
+					v[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+
+	// The eigenvectors are the columns
+	for (int i = 0; i < 2; i++) {
+		axes[i] = {
+			static_cast<float>(v[0][i]),
+			static_cast<float>(v[1][i]),
+			static_cast<float>(v[2][i])
+		};
+	}
+
+	// Keeps the frame right handed, so it can be turned into a quaternion
+	axes[2] = Cross(axes[0], axes[1]);
+}
+
+/**
+ * \param axes Rows of a rotation, from the frame to the mesh's.
+ */
+static void GetQuaternion(const FitVector axes[3], float quaternion[4]) {
+	// The axes are the columns of the rotation matrix
+	const float m00 = axes[0].x, m01 = axes[1].x, m02 = axes[2].x;
+	const float m10 = axes[0].y, m11 = axes[1].y, m12 = axes[2].y;
+	const float m20 = axes[0].z, m21 = axes[1].z, m22 = axes[2].z;
+
+	const float trace = m00 + m11 + m22;
+	float x, y, z, w;
+	if (trace > 0.f) {
+		const float s = std::sqrt(trace + 1.f) * 2.f;
+		w = 0.25f * s;
+		x = (m21 - m12) / s;
+		y = (m02 - m20) / s;
+		z = (m10 - m01) / s;
+	} else if (m00 > m11 && m00 > m22) {
+		const float s = std::sqrt(1.f + m00 - m11 - m22) * 2.f;
+		w = (m21 - m12) / s;
+		x = 0.25f * s;
+		y = (m01 + m10) / s;
+		z = (m02 + m20) / s;
+	} else if (m11 > m22) {
+		const float s = std::sqrt(1.f + m11 - m00 - m22) * 2.f;
+		w = (m02 - m20) / s;
+		x = (m01 + m10) / s;
+		y = 0.25f * s;
+		z = (m12 + m21) / s;
+	} else {
+		const float s = std::sqrt(1.f + m22 - m00 - m11) * 2.f;
+		w = (m10 - m01) / s;
+		x = (m02 + m20) / s;
+		y = (m12 + m21) / s;
+		z = 0.25f * s;
+	}
+
+	const float length = std::sqrt(x * x + y * y + z * z + w * w);
+	quaternion[0] = x / length;
+	quaternion[1] = y / length;
+	quaternion[2] = z / length;
+	quaternion[3] = w / length;
+}
+
+static std::optional<FittedPrimitive> FitSphere(
+	const Surface &surface, float tolerance
+) {
+	FitVector lower = surface.points[0];
+	FitVector upper = surface.points[0];
+	for (const auto &point : surface.points) {
+		lower = {
+			std::min(lower.x, point.x),
+			std::min(lower.y, point.y),
+			std::min(lower.z, point.z)
+		};
+		upper = {
+			std::max(upper.x, point.x),
+			std::max(upper.y, point.y),
+			std::max(upper.z, point.z)
+		};
+	}
+
+	const FitVector center = {
+		(lower.x + upper.x) * 0.5f,
+		(lower.y + upper.y) * 0.5f,
+		(lower.z + upper.z) * 0.5f
+	};
+
+	float nearest = INFINITY;
+	float furthest = 0.f;
+	for (const auto &point : surface.points) {
+		const float distance = Length(Subtract(point, center));
+		nearest = std::min(nearest, distance);
+		furthest = std::max(furthest, distance);
+	}
+
+	// Halfway between keeps every point as close to the surface as possible
+	const float radius = (nearest + furthest) * 0.5f;
+	const float sphereArea = 4.f * std::numbers::pi_v<float> * radius * radius;
+	if (!(radius > 0.f) || furthest - radius > tolerance * radius ||
+		surface.area < sphereArea * (1.f - 2.f * tolerance)) {
+		return std::nullopt;
+	}
+
+	FittedPrimitive sphere = {};
+	sphere.shape = ObjectShape::SPHERE;
+	sphere.center[0] = center.x;
+	sphere.center[1] = center.y;
+	sphere.center[2] = center.z;
+	sphere.radius = radius;
+	return sphere;
+}
+
+/**
+ * \param axes Rows of the box's rotation.
+ * \return The box, if the surface fits it.
+ */
+static std::optional<FittedPrimitive> FitBox(
+	const Surface &surface, const FitVector axes[3], float tolerance
+) {
+	float lower[3] = {INFINITY, INFINITY, INFINITY};
+	float upper[3] = {-INFINITY, -INFINITY, -INFINITY};
+	for (const auto &point : surface.points) {
+		for (int axis = 0; axis < 3; axis++) {
+			const float distance = Dot(point, axes[axis]);
+			lower[axis] = std::min(lower[axis], distance);
+			upper[axis] = std::max(upper[axis], distance);
+		}
+	}
+
+	FittedPrimitive box = {};
+	box.shape = ObjectShape::BOX;
+	float center[3];
+	float size = 0.f;
+	for (int axis = 0; axis < 3; axis++) {
+		center[axis] = (lower[axis] + upper[axis]) * 0.5f;
+		box.halfExtents[axis] = (upper[axis] - lower[axis]) * 0.5f;
+		size = std::max(size, box.halfExtents[axis]);
+	}
+
+	const float *half = box.halfExtents;
+	if (!(std::min({half[0], half[1], half[2]}) > size * 0.01f)) {
+		return std::nullopt;
+	}
+
+	const float boxArea =
+		8.f * (half[0] * half[1] + half[1] * half[2] + half[2] * half[0]);
+	if (surface.area < boxArea * (1.f - 2.f * tolerance)) {
+		return std::nullopt;
+	}
+
+	// Every point has to lie on one of the faces, points well inside mean
+	// the mesh is concave
+	const float maxDistance = tolerance * size;
+	for (const auto &point : surface.points) {
+		float faceDistance = INFINITY;
+		for (int axis = 0; axis < 3; axis++) {
+			const float offset =
+				std::abs(Dot(point, axes[axis]) - center[axis]);
+			faceDistance = std::min(faceDistance, half[axis] - offset);
+		}
+
+		if (faceDistance > maxDistance) {
+			return std::nullopt;
+		}
+	}
+
+	// The center was measured along the box's axes
+	for (int i = 0; i < 3; i++) {
+		box.center[i] = 0.f;
+	}
+
+	for (int axis = 0; axis < 3; axis++) {
+		box.center[0] += axes[axis].x * center[axis];
+		box.center[1] += axes[axis].y * center[axis];
+		box.center[2] += axes[axis].z * center[axis];
+	}
+
+	GetQuaternion(axes, box.rotation);
+	return box;
+}
+
+PrimitiveFitter::PrimitiveFitter(float tolerance) : tolerance(tolerance) {
+	if (tolerance < 0.f) {
+		throw std::invalid_argument(
+			"PrimitiveFitter::PrimitiveFitter: tolerance must not be negative"
+		);
+	}
+}
+
+std::optional<FittedPrimitive> PrimitiveFitter::Fit(const WeldedMesh &mesh
+) const {
+	if (tolerance == 0.f || mesh.indices.empty()) {
+		return std::nullopt;
+	}
+
+	for (const uint32_t index : mesh.indices) {
+		if (index >= mesh.GetVertexCount()) {
+			throw std::invalid_argument(
+				"PrimitiveFitter::Fit: Index out of range"
+			);
+		}
+	}
+
+	const Surface surface = SampleSurface(mesh);
+	if (!(surface.area > 0.f)) {
+		return std::nullopt;
+	}
+
+	if (auto sphere = FitSphere(surface, tolerance)) {
+		return sphere;
+	}
+
+	// Most box shaped props are modelled along their own axes, which is also
+	// the only way to fit a cube since its principal axes are arbitrary
+	const FitVector modelAxes[3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+	FitVector principalAxes[3];
+	GetPrincipalAxes(surface.covariance, principalAxes);
+
+	const FitVector *frames[] = {modelAxes, principalAxes};
+
+	std::optional<FittedPrimitive> best;
+	for (const FitVector *axes : frames) {
+		auto box = FitBox(surface, axes, tolerance);
+		if (!box) {
+			continue;
+		}
+
+		const auto volume = [](const FittedPrimitive &primitive) {
+			return primitive.halfExtents[0] * primitive.halfExtents[1] *
+				   primitive.halfExtents[2];
+		};
+
+		if (!best || volume(*box) < volume(*best)) {
+			best = box;
+		}
+	}
+
+	return best;
+}
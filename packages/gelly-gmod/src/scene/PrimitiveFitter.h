@@ -0,0 +1,63 @@
+#ifndef PRIMITIVEFITTER_H
+#define PRIMITIVEFITTER_H
+
+#include <optional>
+
+#include "MeshWelder.h"
+#include "fluidsim/ISimScene.h"
+
+/**
+ * A sphere or box standing in for a mesh, in the mesh's frame.
+ */
+struct FittedPrimitive {
+	// Either SPHERE or BOX
+	ObjectShape shape;
+	float center[3];
+	// Spheres only
+	float radius;
+	// Boxes only, along with the quaternion (x, y, z, w) from the box's frame
+	// to the mesh's
+	float halfExtents[3];
+	float rotation[4];
+};
+
+/**
+ * Recognizes meshes which are close enough to a sphere or a box to be
+ * replaced by one, since the fluid collides with those analytically instead
+ * of walking a mesh.
+ *
+ * Spheres are centered on the mesh's bounds. Boxes are fitted along the
+ * mesh's own axes and along its principal axes (from the covariance of its
+ * surface), whichever is tighter. Either way the fit is accepted when every
+ * vertex and triangle centre is within the tolerance of the primitive's
+ * surface, and the mesh covers nearly all of that surface, so open or
+ * concave meshes are left alone.
+ *
+ * @code{.cpp}
+ * if (const auto primitive = PrimitiveFitter(0.05f).Fit(mesh)) {
+ *     // Create a sphere or box instead of the mesh
+ * }
+ * @endcode
+ */
+class PrimitiveFitter {
+private:
+	float tolerance;
+
+public:
+	/**
+	 * \param tolerance How far the mesh may stray from the primitive's
+	 * surface, as a fraction of the primitive's size (its radius, or its
+	 * largest half extent).
+	 * \throws invalid_argument if tolerance is negative.
+	 */
+	explicit PrimitiveFitter(float tolerance);
+
+	/**
+	 * \return Nothing if the mesh isn't close to a sphere or box, or the
+	 * tolerance is 0.
+	 */
+	[[nodiscard]] std::optional<FittedPrimitive> Fit(const WeldedMesh &mesh
+	) const;
+};
+
+#endif	// PRIMITIVEFITTER_H
@@ -1,24 +1,71 @@
 #include "Scene.h"
 
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+// The fluid's bounds trail it by a step, this gives fluid room to move
+// before it reaches a collider which isn't enabled yet
+static constexpr float colliderActivationMargin = 256.f;
+
+static unsigned int GetCookingWorkerCount() {
+	// Cooking uses parallel algorithms too, so a few workers are plenty
+	return std::clamp(std::thread::hardware_concurrency() / 4, 1u, 4u);
+}
+
 Scene::Scene(
 	const std::shared_ptr<ISimContext> &simContext,
 	const std::shared_ptr<IFluidSimulation> &sim,
 	int maxParticles
 ) :
-	simContext(simContext), sim(sim), ents(), particles(sim), config(sim) {
+	simContext(simContext),
+	sim(sim),
+	ents(),
+	particles(sim),
+	config(sim),
+	cooking(GetCookingWorkerCount()) {
 	sim->SetMaxParticles(maxParticles);
 }
 
-void Scene::AddEntity(EntIndex entIndex, std::vector<Vector> vertices) {
-	ents->AddEntity(entIndex, vertices);
+void Scene::AddEntity(
+	EntIndex entIndex,
+	std::vector<Vector> vertices,
+	const std::string &meshKey,
+	ObjectShape shape
+) {
+	ents->AddEntity(entIndex, std::move(vertices), meshKey, shape);
+}
+
+bool Scene::AddCachedEntity(
+	EntIndex entIndex, const std::string &meshKey, ObjectShape shape
+) {
+	return ents->AddCachedEntity(entIndex, meshKey, shape);
+}
+
+bool Scene::AddModelEntity(
+	EntIndex entIndex, const std::string &modelPath, ObjectShape shape
+) {
+	return ents->AddModelEntity(entIndex, modelPath, shape);
 }
 
 void Scene::AddPlayerObject(EntIndex entIndex, float radius, float halfHeight) {
 	ents->AddPlayerObject(entIndex, radius, halfHeight);
 }
 
+void Scene::SetEntityDecimation(uint32_t maxTriangles, float maxError) {
+	ents->SetDecimation(maxTriangles, maxError);
+}
+
+void Scene::SetEntityPrimitiveTolerance(float tolerance) {
+	ents->SetPrimitiveTolerance(tolerance);
+}
+
 void Scene::RemoveEntity(EntIndex entIndex) { ents->RemoveEntity(entIndex); }
 
+CookingStatus Scene::GetEntityStatus(EntIndex entIndex) const {
+	return ents->GetEntityStatus(entIndex);
+}
+
 void Scene::UpdateEntityPosition(EntIndex entIndex, Vector position) {
 	ents->UpdateEntityPosition(entIndex, position);
 }
@@ -27,16 +74,156 @@ void Scene::UpdateEntityRotation(EntIndex entIndex, XMFLOAT4 rotation) {
 	ents->UpdateEntityRotation(entIndex, rotation);
 }
 
+void Scene::UpdateEntityTransforms(
+	const EntIndex *entIndices,
+	const Vector *positions,
+	const XMFLOAT4 *rotations,
+	size_t entityCount
+) {
+	ents->UpdateEntityTransforms(entIndices, positions, rotations, entityCount);
+}
+
 void Scene::LoadMap(const std::string &mapPath) {
-	map.emplace(sim->GetScene(), mapPath);
+	map.reset();
+	const uint64_t ticket = ++mapTicket;
+	mapStatus = CookingStatus::NONE;
+
+	// Reading goes through the game's filesystem, so it stays on this thread
+	auto mapData = Map::ReadMapFile(mapPath);
+	mapStatus = CookingStatus::COOKING;
+
+	cooking.Submit([this, ticket, mapPath, mapData = std::move(mapData)] {
+		std::shared_ptr<const CookedMap> cooked;
+		std::string error;
+		try {
+			cooked = std::make_shared<const CookedMap>(
+				Map::CookMap(mapData, mapPath)
+			);
+		} catch (const std::exception &e) {
+			error = e.what();
+		}
+
+		return [this, ticket, mapPath, cooked, error] {
+			if (ticket != mapTicket) {
+				return;
+			}
+
+			if (!cooked) {
+				LOG_ERROR(
+					"Failed to load map %s: %s", mapPath.c_str(), error.c_str()
+				);
+				mapStatus = CookingStatus::FAILED;
+				return;
+			}
+
+			map.emplace(sim->GetScene(), *cooked, mapPath);
+			mapStatus = CookingStatus::READY;
+		};
+	});
+}
+
+ParticleListBuilder &Scene::BeginParticleList() {
+	return particles.BeginParticleList();
 }
 
-void Scene::AddParticles(const ParticleListBuilder &builder) const {
+void Scene::AddParticles(const ParticleListBuilder &builder) {
 	particles.AddParticles(builder, absorptionModifier);
+
+	const SimFloat4 *positions = builder.GetPositions();
+	for (size_t i = 0; i < builder.GetParticleCount(); i++) {
+		const ColliderBounds bounds = {
+			{positions[i].x, positions[i].y, positions[i].z},
+			{positions[i].x, positions[i].y, positions[i].z}
+		};
+
+		if (addedParticleBounds) {
+			addedParticleBounds->Grow(bounds);
+		} else {
+			addedParticleBounds = bounds;
+		}
+	}
 }
 
 void Scene::ClearParticles() const { particles.ClearParticles(); }
 
+void Scene::CaptureSnapshot(CSimSnapshot &snapshot) {
+	snapshot.Clear();
+	if (!sim->CheckFeatureSupport(GELLY_FEATURE::FLUIDSIM_SNAPSHOTS)) {
+		return;
+	}
+
+	sim->CaptureSnapshot(snapshot);
+	particles.CaptureAbsorption(
+		snapshot.absorptions, static_cast<int>(snapshot.GetParticleCount())
+	);
+}
+
+void Scene::RestoreSnapshot(
+	const CSimSnapshot &snapshot, bool restoreColliders
+) {
+	snapshot.Restore(sim.get(), restoreColliders);
+	activateAllColliders = true;
+
+	if (!snapshot.absorptions.empty()) {
+		particles.RestoreAbsorption(snapshot.absorptions, absorptionModifier);
+	}
+}
+
+void Scene::SetMaxParticles(int maxParticles) {
+	sim->SetMaxParticles(maxParticles);
+	activateAllColliders = true;
+
+	std::vector<SimFloat3> absorptions;
+	particles.CaptureAbsorption(
+		absorptions, sim->GetSimulationData()->GetActiveParticles()
+	);
+	particles.RestoreAbsorption(absorptions, absorptionModifier);
+}
+
+void Scene::UpdateColliders() {
+	std::optional<ColliderBounds> fluidBounds;
+	ColliderBounds bounds = {};
+	if (sim->GetParticleBounds(bounds.lower, bounds.upper)) {
+		fluidBounds = bounds;
+	}
+
+	if (addedParticleBounds) {
+		if (fluidBounds) {
+			fluidBounds->Grow(*addedParticleBounds);
+		} else {
+			fluidBounds = addedParticleBounds;
+		}
+	}
+
+	addedParticleBounds.reset();
+
+	const bool boundsSupported =
+		sim->CheckFeatureSupport(GELLY_FEATURE::FLUIDSIM_PARTICLE_BOUNDS);
+	if (!boundsSupported || std::exchange(activateAllColliders, false)) {
+		if (map) {
+			map->ActivateAllChunks();
+		}
+
+		if (ents) {
+			ents->ActivateAllEntities();
+		}
+
+		return;
+	}
+
+	if (fluidBounds) {
+		fluidBounds->Expand(colliderActivationMargin);
+	}
+
+	if (map) {
+		map->ActivateChunks(fluidBounds);
+	}
+
+	if (ents) {
+		ents->ActivateEntities(fluidBounds);
+	}
+}
+
 void Scene::SetFluidProperties(const ::SetFluidProperties &props) const {
 	config.SetFluidProperties(props);
 }
@@ -45,7 +232,15 @@ void Scene::ChangeRadius(float radius) const { config.ChangeRadius(radius); }
 
 void Scene::Initialize() {
 	sim->Initialize();
-	ents.emplace(sim->GetScene());
+	ents.emplace(sim->GetScene(), cooking);
+
+	sim->GetSimulationData()->SetParticleRemapListener(
+		[this](const uint32_t *previousSlots, int particleCount) {
+			particles.RemapAbsorption(
+				previousSlots, particleCount, absorptionModifier
+			);
+		}
+	);
 
 	SetTimeStepMultiplier(DEFAULT_TIMESTEP_MULTIPLIER);
 }
@@ -8,6 +8,7 @@
 #include <fluidsim/IFluidSimulation.h>
 
 #include "Config.h"
+#include "CookingQueue.h"
 #include "EntIndex.h"
 #include "EntityManager.h"
 #include "GarrysMod/Lua/SourceCompat.h"
@@ -26,8 +27,27 @@ private:
 
 	std::optional<EntityManager> ents;
 	std::optional<Map> map;
+	// Bumped by every LoadMap, so a map which finishes cooking after another
+	// was asked for is dropped
+	uint64_t mapTicket = 0;
+	CookingStatus mapStatus = CookingStatus::NONE;
+	// The simulation only knows where particles are once they've been
+	// stepped, so colliders are also activated around any added since
+	std::optional<ColliderBounds> addedParticleBounds;
+	// Set when particles were replaced wholesale, so that everything
+	// collides until the simulation has measured them
+	bool activateAllColliders = false;
 	ParticleManager particles;
 	Config config;
+	// Declared last so that it's destroyed first, its finish steps point
+	// back into the scene
+	CookingQueue cooking;
+
+	/**
+	 * Takes the map chunks and entities far from the fluid out of the
+	 * simulation.
+	 */
+	void UpdateColliders();
 
 public:
 	Scene(
@@ -41,19 +61,70 @@ public:
 	Scene(Scene &&) = delete;
 	Scene &operator=(Scene &&) = delete;
 
-	~Scene(){LOG_INFO("Scene destructor called")};
+	~Scene() {
+		LOG_INFO("Scene destructor called");
+		// The simulation can outlive us
+		sim->GetSimulationData()->SetParticleRemapListener(nullptr);
+	}
 
-	void AddEntity(EntIndex entIndex, std::vector<Vector> vertices);
+	void AddEntity(
+		EntIndex entIndex,
+		std::vector<Vector> vertices,
+		const std::string &meshKey = {},
+		ObjectShape shape = ObjectShape::TRIANGLE_MESH
+	);
+	bool AddCachedEntity(
+		EntIndex entIndex,
+		const std::string &meshKey,
+		ObjectShape shape = ObjectShape::TRIANGLE_MESH
+	);
+	bool AddModelEntity(
+		EntIndex entIndex,
+		const std::string &modelPath,
+		ObjectShape shape = ObjectShape::TRIANGLE_MESH
+	);
 	void AddPlayerObject(EntIndex entIndex, float radius, float halfHeight);
+	void SetEntityDecimation(uint32_t maxTriangles, float maxError);
+	void SetEntityPrimitiveTolerance(float tolerance);
 	void RemoveEntity(EntIndex entIndex);
+	[[nodiscard]] CookingStatus GetEntityStatus(EntIndex entIndex) const;
 	void UpdateEntityPosition(EntIndex entIndex, Vector position);
 	void UpdateEntityRotation(EntIndex entIndex, XMFLOAT4 rotation);
+	void UpdateEntityTransforms(
+		const EntIndex *entIndices,
+		const Vector *positions,
+		const XMFLOAT4 *rotations,
+		size_t entityCount
+	);
 
+	/**
+	 * Reads the map, then cooks it in the background. The map collides with
+	 * the fluid once its status is READY.
+	 */
 	void LoadMap(const std::string &mapPath);
+	[[nodiscard]] CookingStatus GetMapStatus() const { return mapStatus; }
 
-	void AddParticles(const ParticleListBuilder &builder) const;
+	[[nodiscard]] ParticleListBuilder &BeginParticleList();
+	void AddParticles(const ParticleListBuilder &builder);
 	void ClearParticles() const;
 
+	/**
+	 * Captures the fluid, including each particle's absorption. Left empty if
+	 * the simulation can't capture snapshots.
+	 */
+	void CaptureSnapshot(CSimSnapshot &snapshot);
+	/**
+	 * \param restoreColliders Only makes sense for snapshots captured in this
+	 * scene, as the object handles have to match.
+	 */
+	void RestoreSnapshot(const CSimSnapshot &snapshot, bool restoreColliders);
+	/**
+	 * Resizes the simulation in place, keeping the particles and objects.
+	 * The absorption is written out again since the renderer may have been
+	 * swapped out for a bigger one.
+	 */
+	void SetMaxParticles(int maxParticles);
+
 	void SetFluidProperties(const SetFluidProperties &props) const;
 	void ChangeRadius(float radius) const;
 
@@ -69,7 +140,59 @@ public:
 		return sim->GetComputeDeviceName();
 	}
 
-	void Simulate(float dt) { sim->Update(dt); }
+	[[nodiscard]] bool HasAdaptiveQuality() const {
+		return sim->CheckFeatureSupport(
+			GELLY_FEATURE::FLUIDSIM_ADAPTIVE_QUALITY
+		);
+	}
+
+	[[nodiscard]] SimQualityStatus GetQualityStatus() const {
+		return sim->GetQualityStatus();
+	}
+
+	[[nodiscard]] bool HasParticleReordering() const {
+		return sim->CheckFeatureSupport(
+			GELLY_FEATURE::FLUIDSIM_PARTICLE_REORDERING
+		);
+	}
+
+	[[nodiscard]] float GetParticleLocality() const {
+		return sim->GetParticleLocality();
+	}
+
+	void SetQualitySettings(const SimQualitySettings &settings) const {
+		sim->SetQualitySettings(settings);
+	}
+
+	[[nodiscard]] DrainHandle AddDrain(const DrainCreationParams &params
+	) const {
+		return sim->GetScene()->CreateDrain(params);
+	}
+
+	void RemoveDrain(DrainHandle handle) const {
+		sim->GetScene()->RemoveDrain(handle);
+	}
+
+	[[nodiscard]] uint GetDrainedParticleCount(DrainHandle handle) const {
+		return sim->GetScene()->GetDrainedParticleCount(handle);
+	}
+
+	/**
+	 * \brief Publishes the results of the last step and starts the next one,
+	 * which finishes in the background while the frame is rendered.
+	 * \note This means the foam particle count trails a step behind, which
+	 * isn't noticeable in practice.
+	 * \note Anything which finished cooking since the last call is created
+	 * here, and collides from the step after.
+	 * \note Only the map chunks and entities near the fluid are collided
+	 * with.
+	 */
+	void Simulate(float dt) {
+		sim->WaitForResult();
+		UpdateColliders();
+		sim->KickUpdate(dt);
+		cooking.Finish();
+	}
 
 	void SetTimeStepMultiplier(float timeStepMultiplier) {
 		sim->SetTimeStepMultiplier(fmaxf(timeStepMultiplier, 0.0001f));
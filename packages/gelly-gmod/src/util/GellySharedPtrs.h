@@ -13,9 +13,15 @@ std::shared_ptr<ISimContext> MakeSimContext(Args &&...args) {
 
 template <class... Args>
 std::shared_ptr<IFluidSimulation> MakeFluidSimulation(Args &&...args) {
+	IFluidSimulation *sim =
+		CreateD3D11FlexFluidSimulation(std::forward<Args>(args)...);
+#ifndef PRODUCTION_BUILD
+	// Lets gelly.StartSimTrace record gameplay for replaying later
+	sim = CreateRecordingFluidSimulation(sim);
+#endif
+
 	return std::shared_ptr<IFluidSimulation>(
-		CreateD3D11FlexFluidSimulation(std::forward<Args>(args)...),
-		[](auto *ptr) { DestroyGellyFluidSim(ptr); }
+		sim, [](auto *ptr) { DestroyGellyFluidSim(ptr); }
 	);
 }
 
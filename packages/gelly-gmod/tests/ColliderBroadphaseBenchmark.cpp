@@ -0,0 +1,72 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ColliderBroadphase.h"
+#include "MockSimScene.h"
+
+/**
+ * Times a frame of the broadphase the way the scene drives it: every
+ * collider is moved, then the fluid's bounds are tested against all of them.
+ * The colliders orbit on a ring which the fluid only covers part of, so
+ * some of them change state every frame.
+ *
+ * Not a test, it's run by hand from a release build:
+ * gelly_gmod_broadphase_benchmark [colliders]
+ */
+int main(int argc, char **argv) {
+	const int colliderCount = argc > 1 ? std::atoi(argv[1]) : 8000;
+	constexpr int warmupFrames = 100;
+	constexpr int frames = 1000;
+	constexpr float ringRadius = 1000.f;
+
+	MockSimScene scene;
+	ColliderBroadphase broadphase(&scene);
+	std::vector<ObjectHandle> objects;
+	for (int i = 0; i < colliderCount; i++) {
+		objects.push_back(scene.CreateObject({}));
+		const float origin[3] = {0.f, 0.f, 0.f};
+		broadphase.Add(objects.back(), ColliderBounds::FromSphere(origin, 10.f));
+	}
+
+	const float fluidCenter[3] = {ringRadius, 0.f, 0.f};
+	const auto fluidBounds = ColliderBounds::FromSphere(fluidCenter, 200.f);
+
+	// Where every collider is each frame is worked out up front, so only the
+	// broadphase is timed
+	std::vector<ColliderBounds> bounds(colliderCount);
+	std::chrono::nanoseconds elapsed{0};
+	for (int frame = 0; frame < warmupFrames + frames; frame++) {
+		for (int i = 0; i < colliderCount; i++) {
+			const float angle = 6.2831853f * static_cast<float>(i) /
+									static_cast<float>(colliderCount) +
+								0.01f * static_cast<float>(frame);
+			const float center[3] = {
+				std::cos(angle) * ringRadius, std::sin(angle) * ringRadius, 0.f
+			};
+			bounds[i] = ColliderBounds::FromSphere(center, 10.f);
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < colliderCount; i++) {
+			broadphase.Move(objects[i], bounds[i]);
+		}
+
+		broadphase.Activate(fluidBounds);
+		if (frame >= warmupFrames) {
+			elapsed += std::chrono::steady_clock::now() - start;
+		}
+	}
+
+	const double microseconds =
+		std::chrono::duration<double, std::micro>(elapsed).count() / frames;
+	std::printf(
+		"%d colliders: %.1fus per frame (%zu state changes)\n",
+		colliderCount,
+		microseconds,
+		scene.enabledCalls.size()
+	);
+	return 0;
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "ColliderBroadphase.h"
+#include "MockSimScene.h"
+
+namespace {
+using EnabledCalls = std::vector<std::pair<ObjectHandle, bool>>;
+
+ColliderBounds BoxAt(float x, float halfSize = 1.f) {
+	const float center[3] = {x, 0.f, 0.f};
+	return ColliderBounds::FromSphere(center, halfSize);
+}
+
+class ColliderBroadphaseTest : public ::testing::Test {
+protected:
+	MockSimScene scene;
+	ColliderBroadphase broadphase{&scene};
+
+	/**
+	 * Creates an object in the scene and tracks it, like EntityManager does.
+	 */
+	ObjectHandle AddAt(float x) {
+		const auto object = scene.CreateObject({});
+		broadphase.Add(object, BoxAt(x));
+		return object;
+	}
+};
+}  // namespace
+
+TEST_F(ColliderBroadphaseTest, OnlyTogglesCollidersWhichChange) {
+	const auto near = AddAt(0.f);
+	const auto far = AddAt(100.f);
+
+	broadphase.Activate(BoxAt(0.f, 5.f));
+	EXPECT_EQ(scene.enabledCalls, (EnabledCalls{{far, false}}));
+
+	// Nothing changed, so the scene isn't touched
+	scene.enabledCalls.clear();
+	broadphase.Activate(BoxAt(1.f, 5.f));
+	EXPECT_TRUE(scene.enabledCalls.empty());
+
+	broadphase.Activate(BoxAt(100.f, 5.f));
+	EXPECT_EQ(scene.enabledCalls, (EnabledCalls{{near, false}, {far, true}}));
+}
+
+TEST_F(ColliderBroadphaseTest, NoFluidDisablesEverything) {
+	const auto a = AddAt(0.f);
+	const auto b = AddAt(100.f);
+
+	broadphase.Activate(std::nullopt);
+	EXPECT_FALSE(scene.enabled[a]);
+	EXPECT_FALSE(scene.enabled[b]);
+	EXPECT_EQ(scene.enabledCalls.size(), 2u);
+}
+
+TEST_F(ColliderBroadphaseTest, ActivateAllOnlyEnablesDisabledColliders) {
+	const auto near = AddAt(0.f);
+	const auto far = AddAt(100.f);
+	broadphase.Activate(BoxAt(0.f));
+	scene.enabledCalls.clear();
+
+	broadphase.ActivateAll();
+	EXPECT_EQ(scene.enabledCalls, (EnabledCalls{{far, true}}));
+	EXPECT_TRUE(scene.enabled[near]);
+
+	scene.enabledCalls.clear();
+	broadphase.ActivateAll();
+	EXPECT_TRUE(scene.enabledCalls.empty());
+}
+
+TEST_F(ColliderBroadphaseTest, MovedCollidersAreTestedAtTheirNewBounds) {
+	const auto object = AddAt(0.f);
+	broadphase.Activate(BoxAt(0.f));
+
+	broadphase.Move(object, BoxAt(50.f));
+	broadphase.Activate(BoxAt(0.f));
+	EXPECT_FALSE(scene.enabled[object]);
+
+	broadphase.Move(object, BoxAt(1.f));
+	broadphase.Activate(BoxAt(0.f));
+	EXPECT_TRUE(scene.enabled[object]);
+
+	// Unknown objects are ignored
+	broadphase.Move(object + 100, BoxAt(50.f));
+	broadphase.Activate(BoxAt(0.f));
+	EXPECT_TRUE(scene.enabled[object]);
+}
+
+TEST_F(ColliderBroadphaseTest, RemovingFillsTheGapWithTheLastCollider) {
+	const auto a = AddAt(0.f);
+	const auto b = AddAt(10.f);
+	const auto c = AddAt(20.f);
+
+	broadphase.Remove(a);
+	scene.RemoveObject(a);
+	broadphase.Remove(a);
+
+	// c took a's place, moving it has to reach c and nothing else
+	broadphase.Move(c, BoxAt(100.f));
+	broadphase.Activate(BoxAt(10.f, 5.f));
+	EXPECT_EQ(scene.enabledCalls, (EnabledCalls{{c, false}}));
+	EXPECT_TRUE(scene.enabled[b]);
+
+	broadphase.Remove(c);
+	scene.enabledCalls.clear();
+	broadphase.Activate(std::nullopt);
+	EXPECT_EQ(scene.enabledCalls, (EnabledCalls{{b, false}}));
+
+	// Removed objects can be tracked again
+	broadphase.Add(c, BoxAt(0.f));
+	broadphase.Activate(std::nullopt);
+	EXPECT_FALSE(scene.enabled[c]);
+}
+
+TEST_F(ColliderBroadphaseTest, RejectsObjectsWhichAreAlreadyTracked) {
+	const auto object = AddAt(0.f);
+	EXPECT_THROW(broadphase.Add(object, BoxAt(1.f)), std::invalid_argument);
+}
+
+TEST(ColliderBounds, OverlapsIncludesTouching) {
+	EXPECT_TRUE(BoxAt(0.f).Overlaps(BoxAt(2.f)));
+	EXPECT_FALSE(BoxAt(0.f).Overlaps(BoxAt(2.5f)));
+
+	auto bounds = BoxAt(0.f);
+	bounds.Expand(0.5f);
+	EXPECT_TRUE(bounds.Overlaps(BoxAt(2.5f)));
+
+	bounds.Grow(BoxAt(10.f));
+	EXPECT_EQ(bounds.lower[0], -1.5f);
+	EXPECT_EQ(bounds.upper[0], 11.f);
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "ConvexHull.h"
+
+namespace {
+std::vector<float> CubeCorners() {
+	std::vector<float> points;
+	for (int corner = 0; corner < 8; corner++) {
+		points.push_back(corner & 1 ? 1.f : -1.f);
+		points.push_back(corner & 2 ? 1.f : -1.f);
+		points.push_back(corner & 4 ? 1.f : -1.f);
+	}
+
+	return points;
+}
+
+/**
+ * Evenly spread points on a unit sphere.
+ */
+std::vector<float> SpherePoints(int count) {
+	const float goldenAngle = 3.14159265f * (3.f - std::sqrt(5.f));
+
+	std::vector<float> points;
+	for (int i = 0; i < count; i++) {
+		const float y = 1.f - 2.f * (static_cast<float>(i) + 0.5f) /
+								  static_cast<float>(count);
+		const float radius = std::sqrt(1.f - y * y);
+		const float angle = goldenAngle * static_cast<float>(i);
+		points.insert(
+			points.end(),
+			{std::cos(angle) * radius, y, std::sin(angle) * radius}
+		);
+	}
+
+	return points;
+}
+
+/**
+ * \return How far the point is outside of the hull, negative if inside.
+ */
+float DistanceOutside(const ConvexHull &hull, const float *point) {
+	float distance = -INFINITY;
+	for (uint32_t plane = 0; plane < hull.GetPlaneCount(); plane++) {
+		const float *p = &hull.planes[plane * 4];
+		distance = std::max(
+			distance, p[0] * point[0] + p[1] * point[1] + p[2] * point[2] + p[3]
+		);
+	}
+
+	return distance;
+}
+
+std::optional<ConvexHull> Build(
+	const std::vector<float> &points, uint32_t maxVertices = 64
+) {
+	return ConvexHullBuilder(maxVertices)
+		.Build(points.data(), static_cast<uint32_t>(points.size() / 3));
+}
+}  // namespace
+
+TEST(ConvexHull, Cube) {
+	auto points = CubeCorners();
+	// Points inside don't change anything
+	points.insert(points.end(), {0.f, 0.f, 0.f, 0.5f, -0.25f, 0.75f});
+
+	const auto hull = Build(points);
+	ASSERT_TRUE(hull.has_value());
+	EXPECT_EQ(hull->GetVertexCount(), 8u);
+	ASSERT_EQ(hull->GetPlaneCount(), 6u);
+
+	for (uint32_t plane = 0; plane < 6; plane++) {
+		const float *p = &hull->planes[plane * 4];
+		const float axisAligned =
+			std::abs(p[0]) + std::abs(p[1]) + std::abs(p[2]);
+		EXPECT_NEAR(axisAligned, 1.f, 1e-5f);
+		EXPECT_NEAR(p[3], -1.f, 1e-5f);
+	}
+
+	for (int i = 0; i < 3; i++) {
+		EXPECT_EQ(hull->lower[i], -1.f);
+		EXPECT_EQ(hull->upper[i], 1.f);
+	}
+
+	for (size_t i = 0; i < points.size(); i += 3) {
+		EXPECT_LE(DistanceOutside(*hull, &points[i]), 1e-5f);
+	}
+}
+
+TEST(ConvexHull, CappedSphere) {
+	const auto points = SpherePoints(500);
+	constexpr uint32_t maxVertices = 24;
+
+	const auto hull = Build(points, maxVertices);
+	ASSERT_TRUE(hull.has_value());
+	EXPECT_EQ(hull->GetVertexCount(), maxVertices);
+	EXPECT_GE(hull->GetPlaneCount(), 4u);
+	EXPECT_LE(hull->GetPlaneCount(), 2 * maxVertices - 4);
+
+	// Every vertex is one of the points, so the hull sits inside the sphere,
+	// but taking the furthest point each time keeps it close to it
+	for (uint32_t vertex = 0; vertex < hull->GetVertexCount(); vertex++) {
+		const float *v = &hull->vertices[vertex * 3];
+		EXPECT_NEAR(v[0] * v[0] + v[1] * v[1] + v[2] * v[2], 1.f, 1e-4f);
+		EXPECT_LE(DistanceOutside(*hull, v), 1e-5f);
+	}
+
+	for (size_t i = 0; i < points.size(); i += 3) {
+		EXPECT_LE(DistanceOutside(*hull, &points[i]), 0.5f);
+	}
+
+	const auto uncapped = Build(points, 1000);
+	ASSERT_TRUE(uncapped.has_value());
+	EXPECT_EQ(uncapped->GetVertexCount(), 500u);
+}
+
+TEST(ConvexHull, CoplanarPointsAreMerged) {
+	// A grid over every face of the cube, so most points lie on a face or an
+	// edge of the hull, in line with other points
+	std::vector<float> points;
+	constexpr int steps = 6;
+	for (int axis = 0; axis < 3; axis++) {
+		for (const float side : {-1.f, 1.f}) {
+			for (int u = 0; u <= steps; u++) {
+				for (int v = 0; v <= steps; v++) {
+					float point[3];
+					point[axis] = side;
+					point[(axis + 1) % 3] = -1.f + 2.f * u / steps;
+					point[(axis + 2) % 3] = -1.f + 2.f * v / steps;
+					points.insert(points.end(), point, point + 3);
+				}
+			}
+		}
+	}
+
+	const auto hull = Build(points);
+	ASSERT_TRUE(hull.has_value());
+	EXPECT_EQ(hull->GetVertexCount(), 8u);
+	EXPECT_EQ(hull->GetPlaneCount(), 6u);
+
+	for (size_t i = 0; i < points.size(); i += 3) {
+		EXPECT_LE(DistanceOutside(*hull, &points[i]), 1e-5f);
+	}
+}
+
+TEST(ConvexHull, FlatPointsHaveNoHull) {
+	std::vector<float> square;
+	for (int x = 0; x < 4; x++) {
+		for (int y = 0; y < 4; y++) {
+			square.insert(
+				square.end(),
+				{static_cast<float>(x), static_cast<float>(y), 2.f}
+			);
+		}
+	}
+
+	EXPECT_FALSE(Build(square).has_value());
+
+	// Still flat as far as the tolerance goes
+	square[2] += 1e-5f;
+	EXPECT_FALSE(Build(square).has_value());
+
+	const std::vector<float> line = {
+		0.f, 0.f, 0.f, 1.f, 1.f, 1.f, 2.f, 2.f, 2.f, 3.f, 3.f, 3.f
+	};
+	EXPECT_FALSE(Build(line).has_value());
+
+	const std::vector<float> triangle = {
+		0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f
+	};
+	EXPECT_FALSE(Build(triangle).has_value());
+	EXPECT_FALSE(Build(std::vector<float>(12, 5.f)).has_value());
+}
+
+TEST(ConvexHull, NeedsAtLeastATetrahedron) {
+	EXPECT_THROW(ConvexHullBuilder{3}, std::invalid_argument);
+
+	const auto hull = Build(CubeCorners(), 4);
+	ASSERT_TRUE(hull.has_value());
+	EXPECT_EQ(hull->GetVertexCount(), 4u);
+	EXPECT_EQ(hull->GetPlaneCount(), 4u);
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CookingQueue.h"
+
+namespace {
+/**
+ * Spins until the condition holds, giving up after a while so that a broken
+ * queue fails the test instead of hanging it.
+ */
+template <typename Condition>
+bool WaitFor(Condition condition) {
+	const auto deadline =
+		std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (!condition()) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+
+		std::this_thread::yield();
+	}
+
+	return true;
+}
+
+/**
+ * Records which job's finish step ran on which thread.
+ */
+struct FinishLog {
+	std::mutex mutex;
+	std::vector<std::pair<int, std::thread::id>> steps;
+
+	void Add(int job) {
+		std::lock_guard lock(mutex);
+		steps.emplace_back(job, std::this_thread::get_id());
+	}
+};
+
+/**
+ * Runs its callback when destroyed, which for a job's captures is when the
+ * job is dropped.
+ */
+struct OnDestroy {
+	std::function<void()> callback;
+
+	~OnDestroy() { callback(); }
+};
+}  // namespace
+
+TEST(CookingQueue, FinishStepsRunInFinishOnTheCallingThread) {
+	constexpr int jobCount = 20;
+
+	CookingQueue queue(1);
+	FinishLog log;
+	std::atomic<int> cooked = 0;
+	std::atomic<bool> cookedOnCaller = false;
+	const auto caller = std::this_thread::get_id();
+
+	for (int job = 0; job < jobCount; job++) {
+		queue.Submit([&, job] {
+			if (std::this_thread::get_id() == caller) {
+				cookedOnCaller = true;
+			}
+
+			cooked++;
+			return [&log, job] { log.Add(job); };
+		});
+	}
+
+	ASSERT_TRUE(WaitFor([&] { return cooked == jobCount; }));
+	EXPECT_FALSE(cookedOnCaller);
+
+	// Cooking alone never runs a finish step, give the worker a moment to
+	// prove it
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_TRUE(log.steps.empty());
+
+	// A single worker cooks the jobs in the order they were submitted
+	queue.Finish();
+	ASSERT_EQ(log.steps.size(), static_cast<size_t>(jobCount));
+	for (int job = 0; job < jobCount; job++) {
+		EXPECT_EQ(log.steps[job].first, job);
+		EXPECT_EQ(log.steps[job].second, caller);
+	}
+
+	// Every finish step runs once
+	queue.Finish();
+	EXPECT_EQ(log.steps.size(), static_cast<size_t>(jobCount));
+}
+
+TEST(CookingQueue, ErrorsReachFinishWithoutDroppingOtherJobs) {
+	CookingQueue queue(1);
+	FinishLog log;
+	std::atomic<int> cooked = 0;
+
+	queue.Submit([&] {
+		cooked++;
+		return [&log] { log.Add(0); };
+	});
+	queue.Submit([&]() -> CookingQueue::FinishStep {
+		cooked++;
+		throw std::runtime_error("Cook step failed");
+	});
+	queue.Submit([&] {
+		cooked++;
+		return [&log] {
+			log.Add(2);
+			throw std::logic_error("Finish step failed");
+		};
+	});
+	queue.Submit([&] {
+		cooked++;
+		return [&log] { log.Add(3); };
+	});
+
+	ASSERT_TRUE(WaitFor([&] { return cooked == 4; }));
+
+	// The first error is the one thrown, once every other step has run
+	try {
+		queue.Finish();
+		FAIL() << "Finish didn't throw";
+	} catch (const std::runtime_error &e) {
+		EXPECT_STREQ(e.what(), "Cook step failed");
+	}
+
+	ASSERT_EQ(log.steps.size(), 3u);
+	EXPECT_EQ(log.steps[0].first, 0);
+	EXPECT_EQ(log.steps[1].first, 2);
+	EXPECT_EQ(log.steps[2].first, 3);
+
+	// The errors were handed over along with their jobs
+	EXPECT_NO_THROW(queue.Finish());
+}
+
+TEST(CookingQueue, DestructorJoinsWorkersAndDropsPendingJobs) {
+	std::atomic<bool> blockerFinished = false;
+	std::atomic<int> pendingCooked = 0;
+	std::atomic<int> finishStepsRun = 0;
+
+	{
+		// Outlives the queue, since the queue's destructor sets it
+		std::promise<void> release;
+		std::atomic<bool> blockerStarted = false;
+		CookingQueue queue(1);
+
+		queue.Submit([&, gate = release.get_future().share()] {
+			blockerStarted = true;
+			gate.wait();
+
+			// Give the destructor a chance to return early
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			blockerFinished = true;
+			return [&finishStepsRun] { finishStepsRun++; };
+		});
+
+		ASSERT_TRUE(WaitFor([&] { return blockerStarted.load(); }));
+
+		// Dropping the first pending job lets the blocker go, which can only
+		// happen once the destructor has started
+		auto releaser = std::make_shared<OnDestroy>();
+		releaser->callback = [&release] { release.set_value(); };
+		queue.Submit([&, releaser = std::move(releaser)] {
+			pendingCooked++;
+			return [&finishStepsRun] { finishStepsRun++; };
+		});
+
+		for (int job = 0; job < 5; job++) {
+			queue.Submit([&] {
+				pendingCooked++;
+				return [&finishStepsRun] { finishStepsRun++; };
+			});
+		}
+	}
+
+	EXPECT_TRUE(blockerFinished);
+	EXPECT_EQ(pendingCooked, 0);
+	EXPECT_EQ(finishStepsRun, 0);
+}
+
+TEST(CookingQueue, RejectsZeroWorkers) {
+	EXPECT_THROW(CookingQueue(0), std::invalid_argument);
+}
@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "EntityManager.h"
+#include "MockSimScene.h"
+
+namespace {
+/**
+ * A tetrahedron as a triangle soup, which is neither a box nor a sphere so
+ * that a convex entity collides with its hull. Its size tells the meshes in
+ * the scene apart.
+ */
+std::vector<Vector> Tetrahedron(float size = 10.f) {
+	const Vector corners[] = {
+		{0.f, 0.f, 0.f}, {size, 0.f, 0.f}, {0.f, size, 0.f}, {0.f, 0.f, size}
+	};
+	const int faces[][3] = {{0, 2, 1}, {0, 1, 3}, {0, 3, 2}, {1, 2, 3}};
+
+	std::vector<Vector> vertices;
+	for (const auto &face : faces) {
+		for (const int corner : face) {
+			vertices.push_back(corners[corner]);
+		}
+	}
+
+	return vertices;
+}
+
+// Not a whole triangle, so cooking it fails
+const std::vector<Vector> brokenMesh = {{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}};
+
+class EntityManagerTest : public ::testing::Test {
+protected:
+	MockSimScene scene;
+	// A single worker cooks jobs in the order they were submitted
+	CookingQueue queue{1};
+	EntityManager manager{&scene, queue};
+	// Dropped first, which lets the worker go if a test didn't
+	std::promise<void> release;
+
+	/**
+	 * Holds up the worker, so that everything added afterwards stays in
+	 * flight until Release.
+	 */
+	void Block() {
+		queue.Submit([gate = release.get_future().share()] {
+			gate.wait();
+			return CookingQueue::FinishStep();
+		});
+	}
+
+	void Release() { release.set_value(); }
+
+	/**
+	 * Runs Finish until every job submitted so far is done.
+	 */
+	void FinishAll() {
+		bool done = false;
+		queue.Submit([&done] {
+			return [&done] { done = true; };
+		});
+
+		const auto deadline =
+			std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (!done) {
+			ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+			queue.Finish();
+			std::this_thread::yield();
+		}
+	}
+
+	[[nodiscard]] size_t CountShapes(ObjectShape shape) const {
+		size_t count = 0;
+		for (const auto &[object, objectShape] : scene.shapes) {
+			count += objectShape == shape;
+		}
+
+		return count;
+	}
+
+	[[nodiscard]] std::vector<float> SortedExtents() const {
+		std::vector<float> extents;
+		for (const auto &[object, extent] : scene.extents) {
+			extents.push_back(extent);
+		}
+
+		std::sort(extents.begin(), extents.end());
+		return extents;
+	}
+};
+}  // namespace
+
+TEST_F(EntityManagerTest, CooksEntitiesInTheBackground) {
+	Block();
+	manager.AddEntity(1, Tetrahedron(), {}, ObjectShape::CONVEX);
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::COOKING);
+
+	// Nothing reaches the scene until Finish
+	Release();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_TRUE(scene.shapes.empty());
+
+	FinishAll();
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::READY);
+	EXPECT_EQ(scene.shapes.size(), 1u);
+	EXPECT_EQ(CountShapes(ObjectShape::CONVEX), 1u);
+}
+
+TEST_F(EntityManagerTest, ReAddingWhileCookingDropsTheStaleResult) {
+	// The stale cook finishes first, and must not be taken for the new one
+	Block();
+	manager.AddEntity(1, Tetrahedron(10.f), {}, ObjectShape::TRIANGLE_MESH);
+	manager.AddEntity(1, Tetrahedron(20.f), {}, ObjectShape::CONVEX);
+	Release();
+	FinishAll();
+
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::READY);
+	EXPECT_EQ(scene.shapes.size(), 1u);
+	EXPECT_EQ(CountShapes(ObjectShape::CONVEX), 1u);
+	EXPECT_EQ(SortedExtents(), std::vector<float>{20.f});
+}
+
+TEST_F(EntityManagerTest, StaleResultDoesntReplaceACachedEntity) {
+	manager.AddEntity(
+		2, Tetrahedron(20.f), "tetrahedron", ObjectShape::CONVEX
+	);
+	FinishAll();
+
+	// Re-added from the cache, so it's ready before the stale cook finishes
+	Block();
+	manager.AddEntity(1, Tetrahedron(10.f), {}, ObjectShape::TRIANGLE_MESH);
+	ASSERT_TRUE(
+		manager.AddCachedEntity(1, "tetrahedron", ObjectShape::CONVEX)
+	);
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::READY);
+
+	Release();
+	FinishAll();
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::READY);
+	EXPECT_EQ(scene.shapes.size(), 2u);
+	EXPECT_EQ(CountShapes(ObjectShape::TRIANGLE_MESH), 0u);
+	EXPECT_EQ(SortedExtents(), (std::vector<float>{20.f, 20.f}));
+}
+
+TEST_F(EntityManagerTest, ReAddingOnACookingKeyWaitsForIt) {
+	Block();
+	manager.AddEntity(
+		1, Tetrahedron(), "tetrahedron", ObjectShape::TRIANGLE_MESH
+	);
+	manager.AddEntity(1, Tetrahedron(), "tetrahedron", ObjectShape::CONVEX);
+	manager.AddEntity(2, Tetrahedron(), "tetrahedron", ObjectShape::CONVEX);
+	Release();
+	FinishAll();
+
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::READY);
+	EXPECT_EQ(manager.GetEntityStatus(2), CookingStatus::READY);
+	EXPECT_EQ(scene.shapes.size(), 2u);
+	EXPECT_EQ(CountShapes(ObjectShape::CONVEX), 2u);
+}
+
+TEST_F(EntityManagerTest, RemovingWhileCookingCancelsTheCook) {
+	Block();
+	manager.AddEntity(1, Tetrahedron());
+	manager.RemoveEntity(1);
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::NONE);
+
+	Release();
+	FinishAll();
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::NONE);
+	EXPECT_TRUE(scene.shapes.empty());
+}
+
+TEST_F(EntityManagerTest, OnlyTheLatestCookCanFail) {
+	Block();
+	manager.AddEntity(1, brokenMesh);
+	manager.AddEntity(1, Tetrahedron(20.f));
+	manager.AddEntity(2, Tetrahedron(10.f));
+	manager.AddEntity(2, brokenMesh);
+	Release();
+	FinishAll();
+
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::READY);
+	EXPECT_EQ(manager.GetEntityStatus(2), CookingStatus::FAILED);
+	EXPECT_EQ(SortedExtents(), std::vector<float>{20.f});
+
+	// A failed entity can be added again
+	manager.AddEntity(2, Tetrahedron());
+	FinishAll();
+	EXPECT_EQ(manager.GetEntityStatus(2), CookingStatus::READY);
+}
+
+TEST_F(EntityManagerTest, ModelsWithoutAUsableMeshAreLeftToLua) {
+	EXPECT_TRUE(manager.AddModelEntity(1, "models/tetrahedron.mdl"));
+	FinishAll();
+	EXPECT_EQ(manager.GetEntityStatus(1), CookingStatus::READY);
+
+	// Claims two solids, like a ragdoll's
+	EXPECT_FALSE(manager.AddModelEntity(2, "models/ragdoll.mdl"));
+	EXPECT_FALSE(manager.AddModelEntity(3, "models/missing.mdl"));
+	EXPECT_EQ(manager.GetEntityStatus(2), CookingStatus::NONE);
+	EXPECT_EQ(manager.GetEntityStatus(3), CookingStatus::NONE);
+
+	// And stay that way, without being read again
+	EXPECT_FALSE(manager.AddModelEntity(2, "models/ragdoll.mdl"));
+	EXPECT_EQ(scene.shapes.size(), 1u);
+}
+
+TEST_F(EntityManagerTest, SingleConvexPiecesCollideWithTheirHull) {
+	EXPECT_TRUE(manager.AddModelEntity(1, "models/tetrahedron.mdl"));
+	EXPECT_TRUE(manager.AddModelEntity(2, "models/two-tetrahedra.mdl"));
+	FinishAll();
+	EXPECT_EQ(CountShapes(ObjectShape::CONVEX), 1u);
+	EXPECT_EQ(CountShapes(ObjectShape::TRIANGLE_MESH), 1u);
+
+	// Entities added from the cache get the same shape
+	EXPECT_TRUE(manager.AddModelEntity(3, "models/tetrahedron.mdl"));
+	EXPECT_TRUE(manager.AddModelEntity(4, "models/two-tetrahedra.mdl"));
+	EXPECT_EQ(CountShapes(ObjectShape::CONVEX), 2u);
+	EXPECT_EQ(CountShapes(ObjectShape::TRIANGLE_MESH), 2u);
+
+	// Anything can still ask for its hull
+	EXPECT_TRUE(manager.AddModelEntity(
+		5, "models/two-tetrahedra.mdl", ObjectShape::CONVEX
+	));
+	FinishAll();
+	EXPECT_EQ(CountShapes(ObjectShape::CONVEX), 3u);
+}
@@ -0,0 +1,29 @@
+// Stands in for the parts of the module which need Garry's Mod, so that
+// EntityManager can be built into the tests.
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "PhyFile.h"
+#include "logging/helpers/save-log-to-file.h"
+
+// The entries stay in g_macroLog, where the tests can look at them
+void logging::SaveLogToFile(const Log &log) {}
+
+// "models/<name>.mdl" is read from "fixtures/<name>.phy"
+std::optional<std::vector<uint8_t>> ReadPhyFile(const std::string &modelPath
+) {
+	const auto path = std::filesystem::path(GELLY_GMOD_TEST_FIXTURES) /
+					  std::filesystem::path(modelPath)
+						  .filename()
+						  .replace_extension(".phy");
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream) {
+		return std::nullopt;
+	}
+
+	return std::vector<uint8_t>(
+		std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()
+	);
+}
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "MapCache.h"
+
+namespace {
+class MapCacheTest : public ::testing::Test {
+protected:
+	// Where the fields of an entry's header start
+	static constexpr std::streamoff magicOffset = 0;
+	static constexpr std::streamoff versionOffset = 4;
+
+	std::filesystem::path directory;
+	WeldedMesh mesh;
+
+	void SetUp() override {
+		const auto *test =
+			::testing::UnitTest::GetInstance()->current_test_info();
+		directory = std::filesystem::temp_directory_path() /
+					(std::string("gelly-map-cache-") + test->name());
+		std::filesystem::remove_all(directory);
+
+		mesh.vertices = {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f};
+		mesh.indices = {0, 1, 2};
+	}
+
+	void TearDown() override { std::filesystem::remove_all(directory); }
+
+	/**
+	 * Entries are named after their key in hex.
+	 */
+	[[nodiscard]] std::filesystem::path EntryPath(uint64_t key) const {
+		char fileName[32] = {};
+		std::snprintf(
+			fileName,
+			sizeof(fileName),
+			"%016llx.bin",
+			static_cast<unsigned long long>(key)
+		);
+
+		return directory / fileName;
+	}
+
+	void PatchEntry(uint64_t key, std::streamoff offset, uint32_t value) const {
+		std::fstream stream(
+			EntryPath(key), std::ios::binary | std::ios::in | std::ios::out
+		);
+		stream.seekp(offset);
+		stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+};
+}  // namespace
+
+TEST_F(MapCacheTest, StoredEntriesLoadBack) {
+	const MapCache cache(directory);
+	cache.Store(42, mesh);
+
+	const auto loaded = cache.Load(42);
+	ASSERT_TRUE(loaded.has_value());
+	EXPECT_EQ(loaded->vertices, mesh.vertices);
+	EXPECT_EQ(loaded->indices, mesh.indices);
+
+	// Nothing is left behind from writing it
+	EXPECT_TRUE(std::filesystem::exists(EntryPath(42)));
+	EXPECT_EQ(
+		std::distance(
+			std::filesystem::directory_iterator(directory),
+			std::filesystem::directory_iterator()
+		),
+		1
+	);
+}
+
+TEST_F(MapCacheTest, StoringReplacesTheEntry) {
+	const MapCache cache(directory);
+	cache.Store(42, mesh);
+
+	mesh.indices = {2, 1, 0};
+	cache.Store(42, mesh);
+	EXPECT_EQ(cache.Load(42)->indices, mesh.indices);
+}
+
+TEST_F(MapCacheTest, ConcurrentStoresDontCollide) {
+	// Like several cooks of the same map finishing at once
+	constexpr int writerCount = 8;
+	constexpr int storesPerWriter = 50;
+
+	std::vector<WeldedMesh> meshes(writerCount, mesh);
+	for (int i = 0; i < writerCount; i++) {
+		meshes[i].vertices[0] = static_cast<float>(i);
+	}
+
+	std::atomic<int> failures = 0;
+	std::vector<std::thread> writers;
+	for (int i = 0; i < writerCount; i++) {
+		writers.emplace_back([&, i] {
+			const MapCache cache(directory);
+			for (int store = 0; store < storesPerWriter; store++) {
+				try {
+					cache.Store(42, meshes[i]);
+				} catch (const std::runtime_error &) {
+					failures++;
+				}
+			}
+		});
+	}
+
+	for (auto &writer : writers) {
+		writer.join();
+	}
+
+	EXPECT_EQ(failures, 0);
+
+	// Whichever writer won, its entry is whole
+	const auto loaded = MapCache(directory).Load(42);
+	ASSERT_TRUE(loaded.has_value());
+	EXPECT_EQ(
+		std::count_if(
+			meshes.begin(),
+			meshes.end(),
+			[&loaded](const WeldedMesh &written) {
+				return written.vertices == loaded->vertices;
+			}
+		),
+		1
+	);
+
+	// None of the writers' temporary files are left behind
+	EXPECT_EQ(
+		std::distance(
+			std::filesystem::directory_iterator(directory),
+			std::filesystem::directory_iterator()
+		),
+		1
+	);
+}
+
+TEST_F(MapCacheTest, MissingEntriesAreNotLoaded) {
+	const MapCache cache(directory);
+	EXPECT_FALSE(cache.Load(42).has_value());
+
+	cache.Store(42, mesh);
+	EXPECT_FALSE(cache.Load(43).has_value());
+}
+
+TEST_F(MapCacheTest, RejectsTheWrongMagic) {
+	const MapCache cache(directory);
+	cache.Store(42, mesh);
+
+	PatchEntry(42, magicOffset, 0x12345678);
+	EXPECT_FALSE(cache.Load(42).has_value());
+}
+
+TEST_F(MapCacheTest, RejectsOtherCookerVersions) {
+	const MapCache cache(directory);
+	cache.Store(42, mesh);
+
+	PatchEntry(42, versionOffset, MapCache::cookerVersion + 1);
+	EXPECT_FALSE(cache.Load(42).has_value());
+}
+
+TEST_F(MapCacheTest, RejectsEntriesForAnotherKey) {
+	const MapCache cache(directory);
+	cache.Store(42, mesh);
+
+	// As if the entry had been written under the wrong name
+	std::filesystem::rename(EntryPath(42), EntryPath(43));
+
+	EXPECT_FALSE(cache.Load(43).has_value());
+}
+
+TEST_F(MapCacheTest, RejectsTruncatedEntries) {
+	const MapCache cache(directory);
+	cache.Store(42, mesh);
+
+	const auto entry = EntryPath(42);
+	std::filesystem::resize_file(
+		entry, std::filesystem::file_size(entry) - sizeof(uint32_t)
+	);
+	EXPECT_FALSE(cache.Load(42).has_value());
+
+	std::filesystem::resize_file(entry, 8);
+	EXPECT_FALSE(cache.Load(42).has_value());
+}
+
+TEST_F(MapCacheTest, RejectsOutOfRangeIndices) {
+	const MapCache cache(directory);
+	cache.Store(42, mesh);
+
+	const auto lastIndex = static_cast<std::streamoff>(
+		std::filesystem::file_size(EntryPath(42)) - sizeof(uint32_t)
+	);
+	PatchEntry(42, lastIndex, mesh.GetVertexCount());
+	EXPECT_FALSE(cache.Load(42).has_value());
+}
+
+TEST(MapCacheHash, DependsOnEveryByte) {
+	const uint8_t data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 0};
+	uint8_t changed[sizeof(data)];
+	std::copy(std::begin(data), std::end(data), changed);
+	changed[8] = 10;
+
+	const auto hash = MapCache::HashMapData(data, sizeof(data));
+	EXPECT_EQ(hash, MapCache::HashMapData(data, sizeof(data)));
+	EXPECT_NE(hash, MapCache::HashMapData(changed, sizeof(changed)));
+
+	// Trailing zeroes still count
+	EXPECT_NE(hash, MapCache::HashMapData(data, sizeof(data) - 1));
+}
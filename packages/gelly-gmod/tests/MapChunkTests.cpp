@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "MapChunk.h"
+
+namespace {
+// A triangle's corners, in order
+using Triangle = std::array<float, 9>;
+
+std::vector<Triangle> Triangles(const WeldedMesh &mesh) {
+	std::vector<Triangle> triangles;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		Triangle triangle;
+		for (int corner = 0; corner < 3; corner++) {
+			const uint32_t vertex = mesh.indices[i + corner];
+			std::copy_n(
+				&mesh.vertices[vertex * 3], 3, triangle.begin() + corner * 3
+			);
+		}
+
+		triangles.push_back(triangle);
+	}
+
+	return triangles;
+}
+
+/**
+ * Which grid cell the triangle's centre falls in, worked out the same way
+ * as the split does.
+ */
+std::array<float, 3> Cell(const Triangle &triangle, float chunkSize) {
+	std::array<float, 3> centre = {0.f, 0.f, 0.f};
+	for (int corner = 0; corner < 3; corner++) {
+		for (int axis = 0; axis < 3; axis++) {
+			centre[axis] += triangle[corner * 3 + axis] / 3.f;
+		}
+	}
+
+	for (float &axis : centre) {
+		axis = std::floor(axis / chunkSize);
+	}
+
+	return centre;
+}
+
+/**
+ * Checks that the chunks hold every triangle of the mesh exactly once, a
+ * cell each, with bounds around their vertices.
+ */
+void ExpectSplit(
+	const WeldedMesh &mesh,
+	const std::vector<MapChunk> &chunks,
+	float chunkSize
+) {
+	EXPECT_GE(chunkSize, minMapChunkSize);
+	EXPECT_LE(chunks.size(), maxMapChunks);
+
+	std::vector<Triangle> split;
+	std::set<std::array<float, 3>> cells;
+	for (const auto &chunk : chunks) {
+		ASSERT_GT(chunk.mesh.GetIndexCount(), 0u);
+
+		const auto triangles = Triangles(chunk.mesh);
+		const auto cell = Cell(triangles.front(), chunkSize);
+		EXPECT_TRUE(cells.insert(cell).second) << "Two chunks share a cell";
+		for (const auto &triangle : triangles) {
+			EXPECT_EQ(Cell(triangle, chunkSize), cell);
+		}
+
+		split.insert(split.end(), triangles.begin(), triangles.end());
+
+		// Every vertex is used, and inside the bounds
+		std::vector<bool> used(chunk.mesh.GetVertexCount(), false);
+		for (const uint32_t index : chunk.mesh.indices) {
+			ASSERT_LT(index, chunk.mesh.GetVertexCount());
+			used[index] = true;
+		}
+
+		EXPECT_TRUE(std::all_of(used.begin(), used.end(), [](bool vertex) {
+			return vertex;
+		}));
+
+		for (size_t i = 0; i < chunk.mesh.vertices.size(); i += 3) {
+			for (int axis = 0; axis < 3; axis++) {
+				const float position = chunk.mesh.vertices[i + axis];
+				EXPECT_GE(position, chunk.bounds.lower[axis]);
+				EXPECT_LE(position, chunk.bounds.upper[axis]);
+			}
+		}
+	}
+
+	auto expected = Triangles(mesh);
+	std::sort(expected.begin(), expected.end());
+	std::sort(split.begin(), split.end());
+	EXPECT_EQ(split, expected);
+}
+
+/**
+ * Rolling terrain of quads, spanning size * size units from the origin.
+ */
+WeldedMesh Terrain(int quads, float size) {
+	WeldedMesh mesh;
+	const float quadSize = size / static_cast<float>(quads);
+	for (int y = 0; y <= quads; y++) {
+		for (int x = 0; x <= quads; x++) {
+			mesh.vertices.insert(
+				mesh.vertices.end(),
+				{x * quadSize,
+				 y * quadSize,
+				 256.f * std::sin(x * 0.1f) * std::cos(y * 0.1f)}
+			);
+		}
+	}
+
+	const auto vertexIndex = [&](int x, int y) {
+		return static_cast<uint32_t>(y * (quads + 1) + x);
+	};
+
+	for (int y = 0; y < quads; y++) {
+		for (int x = 0; x < quads; x++) {
+			const auto a = vertexIndex(x, y);
+			const auto b = vertexIndex(x + 1, y);
+			const auto c = vertexIndex(x + 1, y + 1);
+			const auto d = vertexIndex(x, y + 1);
+			mesh.indices.insert(mesh.indices.end(), {a, b, c, a, c, d});
+		}
+	}
+
+	return mesh;
+}
+}  // namespace
+
+TEST(MapChunk, SplitsTerrainAlongTheGrid) {
+	// Small enough for the smallest cells, 8x8 of them
+	const auto mesh = Terrain(64, 4096.f);
+	float chunkSize = 0.f;
+	const auto chunks = SplitMapMesh(mesh, chunkSize);
+
+	EXPECT_EQ(chunkSize, minMapChunkSize);
+	EXPECT_GE(chunks.size(), 64u);
+	ExpectSplit(mesh, chunks, chunkSize);
+
+	// Vertices on the borders are copied into each chunk using them
+	size_t vertexCount = 0;
+	for (const auto &chunk : chunks) {
+		vertexCount += chunk.mesh.GetVertexCount();
+	}
+
+	EXPECT_GT(vertexCount, mesh.GetVertexCount());
+}
+
+TEST(MapChunk, LargeMapsStayWithinTheChunkLimit) {
+	// As big as a map can be, which would be 128x128 of the smallest cells
+	const auto terrain = Terrain(256, 65536.f);
+	float chunkSize = 0.f;
+	auto chunks = SplitMapMesh(terrain, chunkSize);
+	EXPECT_GT(chunkSize, minMapChunkSize);
+	ExpectSplit(terrain, chunks, chunkSize);
+
+	// Small triangles strewn all through the same space, as they would be in
+	// a map full of buildings
+	WeldedMesh scattered;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> coordinate(-32768.f, 32768.f);
+	std::uniform_real_distribution<float> offset(-64.f, 64.f);
+	for (uint32_t i = 0; i < 20000; i++) {
+		const float corner[] = {
+			coordinate(random), coordinate(random), coordinate(random)
+		};
+		for (int vertex = 0; vertex < 3; vertex++) {
+			for (const float axis : corner) {
+				scattered.vertices.push_back(axis + offset(random));
+			}
+
+			scattered.indices.push_back(i * 3 + vertex);
+		}
+	}
+
+	chunks = SplitMapMesh(scattered, chunkSize);
+	EXPECT_GT(chunkSize, minMapChunkSize);
+	ExpectSplit(scattered, chunks, chunkSize);
+}
+
+TEST(MapChunk, EmptyMapsHaveNoChunks) {
+	float chunkSize = 0.f;
+	EXPECT_TRUE(SplitMapMesh(WeldedMesh{}, chunkSize).empty());
+	EXPECT_EQ(chunkSize, minMapChunkSize);
+}
+
+TEST(MapChunk, SingleTriangleMapsHaveOneChunk) {
+	WeldedMesh mesh;
+	mesh.vertices = {-100.f, 20.f, 5.f, 300.f, -40.f, 5.f, 0.f, 600.f, -70.f};
+	mesh.indices = {0, 1, 2};
+
+	float chunkSize = 0.f;
+	const auto chunks = SplitMapMesh(mesh, chunkSize);
+	ASSERT_EQ(chunks.size(), 1u);
+	EXPECT_EQ(chunkSize, minMapChunkSize);
+	EXPECT_EQ(chunks[0].mesh.vertices, mesh.vertices);
+	EXPECT_EQ(chunks[0].mesh.indices, mesh.indices);
+
+	// The triangle pokes out of its cell, and the bounds follow it
+	const float lower[] = {-100.f, -40.f, -70.f};
+	const float upper[] = {300.f, 600.f, 5.f};
+	for (int axis = 0; axis < 3; axis++) {
+		EXPECT_EQ(chunks[0].bounds.lower[axis], lower[axis]);
+		EXPECT_EQ(chunks[0].bounds.upper[axis], upper[axis]);
+	}
+}
@@ -0,0 +1,309 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "MeshDecimator.h"
+
+namespace {
+using Point = std::array<float, 3>;
+
+constexpr float pi = 3.14159265f;
+
+Point Corner(const WeldedMesh &mesh, uint32_t triangle, int corner) {
+	const float *p = &mesh.vertices[mesh.indices[triangle * 3 + corner] * 3];
+	return {p[0], p[1], p[2]};
+}
+
+/**
+ * The triangle's normal, scaled by twice its area.
+ */
+Point Normal(const WeldedMesh &mesh, uint32_t triangle) {
+	const auto a = Corner(mesh, triangle, 0);
+	const auto b = Corner(mesh, triangle, 1);
+	const auto c = Corner(mesh, triangle, 2);
+	const Point ab = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+	const Point ac = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+	return {
+		ab[1] * ac[2] - ab[2] * ac[1],
+		ab[2] * ac[0] - ab[0] * ac[2],
+		ab[0] * ac[1] - ab[1] * ac[0]
+	};
+}
+
+uint32_t TriangleCount(const WeldedMesh &mesh) {
+	return mesh.GetIndexCount() / 3;
+}
+
+/**
+ * Counts the triangles using each directed edge.
+ */
+std::map<std::pair<uint32_t, uint32_t>, int> DirectedEdges(
+	const WeldedMesh &mesh
+) {
+	std::map<std::pair<uint32_t, uint32_t>, int> edges;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		for (int corner = 0; corner < 3; corner++) {
+			edges[{
+				mesh.indices[i + corner], mesh.indices[i + (corner + 1) % 3]
+			}]++;
+		}
+	}
+
+	return edges;
+}
+
+/**
+ * The edges used by a single triangle, which make up the mesh's outline.
+ */
+std::vector<std::pair<Point, Point>> OpenEdges(const WeldedMesh &mesh) {
+	const auto edges = DirectedEdges(mesh);
+	std::vector<std::pair<Point, Point>> open;
+	for (const auto &[edge, count] : edges) {
+		if (!edges.contains({edge.second, edge.first})) {
+			const float *a = &mesh.vertices[edge.first * 3];
+			const float *b = &mesh.vertices[edge.second * 3];
+			open.emplace_back(Point{a[0], a[1], a[2]}, Point{b[0], b[1], b[2]});
+		}
+	}
+
+	return open;
+}
+
+/**
+ * A closed sphere of rings of quads, wound to face out, with triangle fans
+ * at the poles. The poles and the seam share their vertices.
+ */
+WeldedMesh UVSphere(float radius, int rings, int slices) {
+	WeldedMesh mesh;
+	const auto vertexIndex = [&](int ring, int slice) -> uint32_t {
+		if (ring == 0) {
+			return 0;
+		}
+
+		if (ring == rings) {
+			return 1;
+		}
+
+		return 2 + (ring - 1) * slices + slice % slices;
+	};
+
+	const auto addVertex = [&](float polar, float azimuth) {
+		mesh.vertices.insert(
+			mesh.vertices.end(),
+			{radius * std::sin(polar) * std::cos(azimuth),
+			 radius * std::sin(polar) * std::sin(azimuth),
+			 radius * std::cos(polar)}
+		);
+	};
+
+	addVertex(0.f, 0.f);
+	addVertex(pi, 0.f);
+	for (int ring = 1; ring < rings; ring++) {
+		for (int slice = 0; slice < slices; slice++) {
+			addVertex(
+				pi * static_cast<float>(ring) / rings,
+				2.f * pi * static_cast<float>(slice) / slices
+			);
+		}
+	}
+
+	for (int ring = 0; ring < rings; ring++) {
+		for (int slice = 0; slice < slices; slice++) {
+			const auto a = vertexIndex(ring, slice);
+			const auto b = vertexIndex(ring + 1, slice);
+			const auto c = vertexIndex(ring + 1, slice + 1);
+			const auto d = vertexIndex(ring, slice + 1);
+			if (ring != 0) {
+				mesh.indices.insert(mesh.indices.end(), {a, b, d});
+			}
+
+			if (ring != rings - 1) {
+				mesh.indices.insert(mesh.indices.end(), {b, c, d});
+			}
+		}
+	}
+
+	return mesh;
+}
+
+/**
+ * A flat grid of quads in the XY plane facing +Z, spanning cells * cells
+ * units from the origin. Cells within the hole are left out.
+ */
+WeldedMesh Panel(int cells, int holeFirst = 0, int holeLast = 0) {
+	WeldedMesh mesh;
+	for (int y = 0; y <= cells; y++) {
+		for (int x = 0; x <= cells; x++) {
+			mesh.vertices.insert(
+				mesh.vertices.end(),
+				{static_cast<float>(x), static_cast<float>(y), 0.f}
+			);
+		}
+	}
+
+	const auto vertexIndex = [&](int x, int y) {
+		return static_cast<uint32_t>(y * (cells + 1) + x);
+	};
+
+	for (int y = 0; y < cells; y++) {
+		for (int x = 0; x < cells; x++) {
+			if (x >= holeFirst && x < holeLast && y >= holeFirst &&
+				y < holeLast) {
+				continue;
+			}
+
+			const auto a = vertexIndex(x, y);
+			const auto b = vertexIndex(x + 1, y);
+			const auto c = vertexIndex(x + 1, y + 1);
+			const auto d = vertexIndex(x, y + 1);
+			mesh.indices.insert(mesh.indices.end(), {a, b, c, a, c, d});
+		}
+	}
+
+	return mesh;
+}
+
+float Area(const WeldedMesh &mesh) {
+	float area = 0.f;
+	for (uint32_t i = 0; i < TriangleCount(mesh); i++) {
+		const auto normal = Normal(mesh, i);
+		area += 0.5f * std::sqrt(
+						   normal[0] * normal[0] + normal[1] * normal[1] +
+						   normal[2] * normal[2]
+					   );
+	}
+
+	return area;
+}
+
+/**
+ * Checks that no two triangles share a directed edge, which a flipped
+ * triangle or a non-manifold collapse would cause.
+ */
+void ExpectManifold(const WeldedMesh &mesh) {
+	for (const auto &[edge, count] : DirectedEdges(mesh)) {
+		EXPECT_EQ(count, 1) << "Edge " << edge.first << "-" << edge.second;
+	}
+}
+}  // namespace
+
+TEST(MeshDecimator, RespectsTheTriangleBudget) {
+	const auto sphere = UVSphere(10.f, 40, 80);
+	ASSERT_GT(TriangleCount(sphere), 6000u);
+
+	for (const uint32_t budget : {2000u, 500u, 100u}) {
+		const auto decimated = MeshDecimator(budget, 0.f).Decimate(sphere);
+		EXPECT_LE(TriangleCount(decimated), budget);
+		EXPECT_GT(TriangleCount(decimated), budget / 2);
+
+		// Still closed, so every edge is shared both ways
+		EXPECT_TRUE(OpenEdges(decimated).empty());
+		ExpectManifold(decimated);
+	}
+
+	// Within budget and without an error to spend, nothing changes
+	const auto untouched = MeshDecimator(10000, 0.f).Decimate(sphere);
+	EXPECT_EQ(untouched.vertices, sphere.vertices);
+	EXPECT_EQ(untouched.indices, sphere.indices);
+}
+
+TEST(MeshDecimator, CollapsesAFlatPanel) {
+	const auto panel = Panel(16);
+	ASSERT_EQ(TriangleCount(panel), 512u);
+
+	// Well within budget, but none of the detail changes the shape
+	const auto decimated = MeshDecimator(1000, 0.01f).Decimate(panel);
+	EXPECT_LE(TriangleCount(decimated), 4u);
+	EXPECT_NEAR(Area(decimated), 256.f, 1e-3f);
+
+	for (size_t i = 0; i < decimated.vertices.size(); i += 3) {
+		EXPECT_EQ(decimated.vertices[i + 2], 0.f);
+	}
+}
+
+TEST(MeshDecimator, NeverFlipsTriangles) {
+	const auto sphere = UVSphere(10.f, 24, 48);
+	const auto decimated = MeshDecimator(60, 0.f).Decimate(sphere);
+	ASSERT_GT(TriangleCount(decimated), 0u);
+
+	// Facing out like the sphere did, as the sphere is centred on the origin
+	for (uint32_t i = 0; i < TriangleCount(decimated); i++) {
+		const auto normal = Normal(decimated, i);
+		Point center = {0.f, 0.f, 0.f};
+		for (int corner = 0; corner < 3; corner++) {
+			const auto point = Corner(decimated, i, corner);
+			for (int axis = 0; axis < 3; axis++) {
+				center[axis] += point[axis] / 3.f;
+			}
+		}
+
+		EXPECT_GT(
+			normal[0] * center[0] + normal[1] * center[1] +
+				normal[2] * center[2],
+			0.f
+		) << "Triangle " << i;
+	}
+
+	ExpectManifold(decimated);
+
+	// A panel keeps facing +Z, whatever the budget
+	const auto panel = MeshDecimator(8, 0.f).Decimate(Panel(16));
+	ASSERT_GT(TriangleCount(panel), 0u);
+	for (uint32_t i = 0; i < TriangleCount(panel); i++) {
+		EXPECT_GT(Normal(panel, i)[2], 0.f) << "Triangle " << i;
+	}
+}
+
+TEST(MeshDecimator, KeepsOpenBoundaries) {
+	// A 16x16 panel with a 4x4 hole in the middle
+	const auto panel = Panel(16, 6, 10);
+	const auto decimated = MeshDecimator(1000, 0.01f).Decimate(panel);
+	EXPECT_LT(TriangleCount(decimated), TriangleCount(panel) / 4);
+	EXPECT_NEAR(Area(decimated), 256.f - 16.f, 1e-3f);
+
+	// Every open edge still runs along the outline or the hole, and together
+	// they're as long as both
+	const auto onSquare = [](const Point &point, float min, float max) {
+		const bool inside = point[0] >= min && point[0] <= max &&
+							point[1] >= min && point[1] <= max;
+		return inside && (point[0] == min || point[0] == max ||
+						  point[1] == min || point[1] == max);
+	};
+
+	float length = 0.f;
+	for (const auto &[a, b] : OpenEdges(decimated)) {
+		const bool outline = onSquare(a, 0.f, 16.f) && onSquare(b, 0.f, 16.f);
+		const bool hole = onSquare(a, 6.f, 10.f) && onSquare(b, 6.f, 10.f);
+		EXPECT_TRUE(outline || hole);
+		length += std::hypot(b[0] - a[0], b[1] - a[1]);
+	}
+
+	EXPECT_NEAR(length, 16.f * 4 + 4.f * 4, 1e-3f);
+	ExpectManifold(decimated);
+}
+
+TEST(MeshDecimator, RejectsInvalidMeshes) {
+	EXPECT_THROW(MeshDecimator(0, 0.f), std::invalid_argument);
+	EXPECT_THROW(MeshDecimator(10, -1.f), std::invalid_argument);
+	EXPECT_THROW(
+		MeshDecimator(10, std::numeric_limits<float>::quiet_NaN()),
+		std::invalid_argument
+	);
+
+	auto panel = Panel(2);
+	panel.indices.back() = panel.GetVertexCount();
+
+	// Checked even when there'd be nothing to decimate
+	for (const auto &decimator :
+		 {MeshDecimator(1, 0.f), MeshDecimator(100, 0.f)}) {
+		EXPECT_THROW(
+			std::ignore = decimator.Decimate(panel), std::invalid_argument
+		);
+	}
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <tuple>
+
+#include "MeshWelder.h"
+
+namespace {
+/**
+ * Twice the signed area of the triangle projected onto the XY plane, which
+ * tells its winding apart.
+ */
+float WindingXY(const WeldedMesh &mesh, uint32_t triangle) {
+	const float *a = &mesh.vertices[mesh.indices[triangle * 3] * 3];
+	const float *b = &mesh.vertices[mesh.indices[triangle * 3 + 1] * 3];
+	const float *c = &mesh.vertices[mesh.indices[triangle * 3 + 2] * 3];
+	return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+}  // namespace
+
+TEST(MeshWelder, MergesVerticesWithinTheTolerance) {
+	// A quad as a triangle soup, the shared corners are slightly off
+	const float vertices[] = {
+		0.f, 0.f, 0.f,
+		1.f, 0.f, 0.f,
+		1.f, 1.f, 0.f,
+		0.001f, 0.f, 0.f,
+		1.f, 1.002f, 0.f,
+		0.f, 1.f, 0.f,
+	};
+
+	const auto mesh = MeshWelder(0.01f).Weld(vertices, 6);
+	EXPECT_EQ(mesh.GetVertexCount(), 4u);
+	ASSERT_EQ(mesh.GetIndexCount(), 6u);
+	EXPECT_EQ(mesh.indices[0], mesh.indices[3]);
+	EXPECT_EQ(mesh.indices[2], mesh.indices[4]);
+
+	// The lowest original index in a cell wins
+	EXPECT_EQ(mesh.vertices[mesh.indices[3] * 3], 0.f);
+	EXPECT_EQ(mesh.vertices[mesh.indices[4] * 3 + 1], 1.f);
+}
+
+TEST(MeshWelder, KeepsTheWinding) {
+	const float vertices[] = {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f};
+	const uint32_t indices[] = {0, 1, 2, 0, 2, 1};
+
+	const auto mesh = MeshWelder(0.01f).Weld(vertices, 3, indices, 6);
+
+	// Opposite windings are different faces, so neither is a duplicate
+	ASSERT_EQ(mesh.GetIndexCount(), 6u);
+	EXPECT_GT(WindingXY(mesh, 0), 0.f);
+	EXPECT_LT(WindingXY(mesh, 1), 0.f);
+}
+
+TEST(MeshWelder, DropsDuplicateTriangles) {
+	const float vertices[] = {
+		0.f, 0.f, 0.f,
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f,
+		0.f, 0.f, 0.005f,
+	};
+	// The same triangle starting from another corner, and once more through
+	// a vertex which welds onto the first
+	const uint32_t indices[] = {0, 1, 2, 1, 2, 0, 3, 1, 2};
+
+	const auto mesh = MeshWelder(0.01f).Weld(vertices, 4, indices, 9);
+	EXPECT_EQ(mesh.GetVertexCount(), 3u);
+	ASSERT_EQ(mesh.GetIndexCount(), 3u);
+	EXPECT_EQ(mesh.indices, (std::vector<uint32_t>{0, 1, 2}));
+	EXPECT_GT(WindingXY(mesh, 0), 0.f);
+}
+
+TEST(MeshWelder, DropsDegenerateTriangles) {
+	const float vertices[] = {
+		0.f, 0.f, 0.f,
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f,
+		// Welds onto the first vertex
+		0.f, 0.005f, 0.f,
+		// In line with the first two
+		2.f, 0.f, 0.f,
+	};
+	const uint32_t indices[] = {0, 1, 2, 0, 3, 1, 0, 1, 4, 2, 2, 1};
+
+	const auto mesh = MeshWelder(0.01f).Weld(vertices, 5, indices, 12);
+	EXPECT_EQ(mesh.GetVertexCount(), 3u);
+	EXPECT_EQ(mesh.indices, (std::vector<uint32_t>{0, 1, 2}));
+}
+
+TEST(MeshWelder, OnlyKeepsUsedVertices) {
+	const float vertices[] = {
+		5.f, 5.f, 5.f,
+		0.f, 0.f, 0.f,
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f,
+	};
+	const uint32_t indices[] = {1, 2, 3};
+
+	const auto mesh = MeshWelder(0.01f).Weld(vertices, 4, indices, 3);
+	ASSERT_EQ(mesh.GetVertexCount(), 3u);
+	EXPECT_EQ(
+		mesh.vertices,
+		(std::vector<float>{0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f})
+	);
+}
+
+TEST(MeshWelder, RejectsInvalidMeshes) {
+	const float vertices[] = {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f};
+	const uint32_t outOfRange[] = {0, 1, 3};
+	const MeshWelder welder(0.01f);
+
+	EXPECT_THROW(
+		std::ignore = welder.Weld(vertices, 2), std::invalid_argument
+	);
+	EXPECT_THROW(
+		std::ignore = welder.Weld(vertices, 3, outOfRange, 3),
+		std::invalid_argument
+	);
+	EXPECT_THROW(MeshWelder{0.f}, std::invalid_argument);
+	EXPECT_EQ(welder.Weld(vertices, 0).GetIndexCount(), 0u);
+}
@@ -0,0 +1,81 @@
+#ifndef GELLY_GMOD_MOCKSIMSCENE_H
+#define GELLY_GMOD_MOCKSIMSCENE_H
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "fluidsim/ISimScene.h"
+
+/**
+ * Only keeps track of which objects exist, their shapes and whether they're
+ * enabled, along with every call to SetObjectEnabled.
+ */
+class MockSimScene : public ISimScene {
+private:
+	ObjectHandle nextObject = 0;
+
+public:
+	std::unordered_map<ObjectHandle, bool> enabled;
+	std::unordered_map<ObjectHandle, ObjectShape> shapes;
+	// How far a mesh or hull reaches along X, which tells meshes of different
+	// sizes apart
+	std::unordered_map<ObjectHandle, float> extents;
+	std::vector<std::pair<ObjectHandle, bool>> enabledCalls;
+
+	ObjectHandle CreateObject(const ObjectCreationParams &params) override {
+		const auto handle = nextObject++;
+		enabled[handle] = true;
+		shapes[handle] = params.shape;
+
+		using Params = ObjectCreationParams;
+		if (const auto *mesh =
+				std::get_if<Params::TriangleMesh>(&params.shapeData)) {
+			float extent = 0.f;
+			for (uint i = 0; i < mesh->vertexCount; i++) {
+				extent = std::max(extent, mesh->vertices[i * 3]);
+			}
+
+			extents[handle] = extent;
+		} else if (const auto *convex =
+					   std::get_if<Params::Convex>(&params.shapeData)) {
+			extents[handle] = convex->upper[0];
+		}
+
+		return handle;
+	}
+
+	void RemoveObject(ObjectHandle handle) override {
+		enabled.erase(handle);
+		shapes.erase(handle);
+		extents.erase(handle);
+	}
+
+	void SetObjectEnabled(ObjectHandle handle, bool enabled) override {
+		this->enabled.at(handle) = enabled;
+		enabledCalls.emplace_back(handle, enabled);
+	}
+
+	void SetObjectPosition(ObjectHandle handle, float x, float y, float z)
+		override {}
+	void SetObjectQuaternion(
+		ObjectHandle handle, float x, float y, float z, float w
+	) override {}
+	void SetObjectTransforms(
+		const ObjectHandle *handles,
+		const ObjectTransform *transforms,
+		uint objectCount
+	) override {}
+
+	DrainHandle CreateDrain(const DrainCreationParams &params) override {
+		return INVALID_DRAIN_HANDLE;
+	}
+	void RemoveDrain(DrainHandle handle) override {}
+	uint GetDrainedParticleCount(DrainHandle handle) override { return 0; }
+
+	void Update() override {}
+};
+
+#endif	// GELLY_GMOD_MOCKSIMSCENE_H
@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "ModelCollision.h"
+
+namespace {
+/**
+ * fixtures/tetrahedron.phy holds a single solid, made of a single ledge with
+ * corners at the origin and 10 units along each axis. These are where its
+ * fields are.
+ */
+namespace tetrahedron {
+constexpr size_t headerSize = 0;
+constexpr size_t solidCount = 8;
+constexpr size_t solidSize = 16;
+constexpr size_t solidHeader = 20;
+constexpr size_t solidType = solidHeader + 6;
+constexpr size_t surface = solidHeader + 28;
+constexpr size_t treeOffset = surface + 32;
+constexpr size_t ledge = surface + 48;
+constexpr size_t pointOffset = ledge;
+constexpr size_t firstEdge = ledge + 16 + 4;
+// Past the solid is only the text section, which isn't read
+constexpr size_t solidEnd = 268;
+}  // namespace tetrahedron
+
+using Point = std::array<float, 3>;
+
+std::vector<uint8_t> ReadFixture(const char *name) {
+	std::ifstream stream(
+		std::string(GELLY_GMOD_TEST_FIXTURES) + "/" + name, std::ios::binary
+	);
+	return {
+		std::istreambuf_iterator<char>(stream),
+		std::istreambuf_iterator<char>()
+	};
+}
+
+template <typename T>
+void Patch(std::vector<uint8_t> &data, size_t offset, T value) {
+	std::memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+std::vector<Vector> Parse(const std::vector<uint8_t> &data) {
+	return ParsePhyFile(data.data(), data.size()).triangles;
+}
+
+void ExpectMalformed(const std::vector<uint8_t> &data) {
+	EXPECT_THROW(std::ignore = Parse(data), std::runtime_error);
+}
+
+/**
+ * Checks for the tetrahedron's four faces, each wound to face into it.
+ */
+void ExpectTetrahedron(const std::vector<Vector> &triangles) {
+	ASSERT_EQ(triangles.size(), 12u);
+
+	std::vector<Point> corners;
+	for (const auto &vertex : triangles) {
+		corners.push_back({vertex.x, vertex.y, vertex.z});
+	}
+
+	std::sort(corners.begin(), corners.end());
+	corners.erase(std::unique(corners.begin(), corners.end()), corners.end());
+	ASSERT_EQ(corners.size(), 4u);
+
+	const Point expected[] = {
+		{0.f, 0.f, 0.f}, {0.f, 0.f, 10.f}, {0.f, 10.f, 0.f}, {10.f, 0.f, 0.f}
+	};
+	for (size_t i = 0; i < corners.size(); i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			EXPECT_NEAR(corners[i][axis], expected[i][axis], 1e-4f);
+		}
+	}
+
+	const Point center = {2.5f, 2.5f, 2.5f};
+	for (size_t i = 0; i < triangles.size(); i += 3) {
+		const auto &a = triangles[i];
+		const auto &b = triangles[i + 1];
+		const auto &c = triangles[i + 2];
+		const Point ab = {b.x - a.x, b.y - a.y, b.z - a.z};
+		const Point ac = {c.x - a.x, c.y - a.y, c.z - a.z};
+		const Point normal = {
+			ab[1] * ac[2] - ab[2] * ac[1],
+			ab[2] * ac[0] - ab[0] * ac[2],
+			ab[0] * ac[1] - ab[1] * ac[0]
+		};
+
+		const Point inward = {
+			center[0] - a.x, center[1] - a.y, center[2] - a.z
+		};
+		EXPECT_GT(
+			normal[0] * inward[0] + normal[1] * inward[1] +
+				normal[2] * inward[2],
+			0.f
+		);
+	}
+}
+}  // namespace
+
+TEST(ModelCollision, ParsesASingleLedge) {
+	const auto data = ReadFixture("tetrahedron.phy");
+	ASSERT_GT(data.size(), tetrahedron::solidEnd);
+	ExpectTetrahedron(Parse(data));
+}
+
+TEST(ModelCollision, CountsTheConvexPieces) {
+	const auto single = ReadFixture("tetrahedron.phy");
+	EXPECT_EQ(ParsePhyFile(single.data(), single.size()).ledgeCount, 1);
+
+	// The second is 20 units along X from the first
+	const auto pair = ReadFixture("two-tetrahedra.phy");
+	const auto mesh = ParsePhyFile(pair.data(), pair.size());
+	EXPECT_EQ(mesh.ledgeCount, 2);
+	ASSERT_EQ(mesh.triangles.size(), 24u);
+
+	std::vector<Vector> second;
+	for (size_t i = 12; i < mesh.triangles.size(); i++) {
+		const auto &vertex = mesh.triangles[i];
+		second.push_back({vertex.x - 20.f, vertex.y, vertex.z});
+	}
+
+	ExpectTetrahedron({mesh.triangles.begin(), mesh.triangles.begin() + 12});
+	ExpectTetrahedron(second);
+}
+
+TEST(ModelCollision, ParsesSolidsWithoutAHeader) {
+	// Older compilers wrote the surface straight after the solid's size
+	auto data = ReadFixture("tetrahedron.phy");
+	data.erase(
+		data.begin() + tetrahedron::solidHeader,
+		data.begin() + tetrahedron::surface
+	);
+	Patch<int32_t>(
+		data,
+		tetrahedron::solidSize,
+		tetrahedron::solidEnd - tetrahedron::surface
+	);
+
+	ExpectTetrahedron(Parse(data));
+}
+
+TEST(ModelCollision, RejectsTruncatedFiles) {
+	const auto data = ReadFixture("tetrahedron.phy");
+	for (size_t size = 0; size < tetrahedron::solidEnd; size++) {
+		EXPECT_THROW(
+			std::ignore = ParsePhyFile(data.data(), size), std::runtime_error
+		) << "Truncated to " << size << " bytes";
+	}
+
+	EXPECT_NO_THROW(
+		std::ignore = ParsePhyFile(data.data(), tetrahedron::solidEnd)
+	);
+}
+
+TEST(ModelCollision, RejectsBadOffsets) {
+	const auto fixture = ReadFixture("tetrahedron.phy");
+
+	const auto withHeaderSize = [&](int32_t value) {
+		auto data = fixture;
+		Patch(data, tetrahedron::headerSize, value);
+		return data;
+	};
+	ExpectMalformed(withHeaderSize(0));
+	ExpectMalformed(withHeaderSize(-16));
+	ExpectMalformed(withHeaderSize(static_cast<int32_t>(fixture.size())));
+
+	const auto withSolidSize = [&](int32_t value) {
+		auto data = fixture;
+		Patch(data, tetrahedron::solidSize, value);
+		return data;
+	};
+	ExpectMalformed(withSolidSize(0));
+	ExpectMalformed(withSolidSize(-1));
+	ExpectMalformed(withSolidSize(0x7FFFFFFF));
+
+	const auto withPointOffset = [&](int32_t value) {
+		auto data = fixture;
+		Patch(data, tetrahedron::pointOffset, value);
+		return data;
+	};
+	ExpectMalformed(withPointOffset(0));
+	ExpectMalformed(withPointOffset(-80));
+	ExpectMalformed(withPointOffset(0x10000000));
+
+	// A point index past the end of the file
+	auto data = fixture;
+	Patch<uint32_t>(data, tetrahedron::firstEdge, 0xFFFF);
+	ExpectMalformed(data);
+
+	// A tree before the ledges leaves the solid without any
+	data = fixture;
+	Patch<int32_t>(data, tetrahedron::treeOffset, -1);
+	ExpectMalformed(data);
+}
+
+TEST(ModelCollision, RejectsUnsupportedSolids) {
+	// Ragdolls have a solid for every bone
+	auto data = ReadFixture("tetrahedron.phy");
+	Patch<int32_t>(data, tetrahedron::solidCount, 2);
+	ExpectMalformed(data);
+
+	Patch<int32_t>(data, tetrahedron::solidCount, 0);
+	ExpectMalformed(data);
+
+	// Anything but a polygon model, like a ball
+	data = ReadFixture("tetrahedron.phy");
+	Patch<int16_t>(data, tetrahedron::solidType, 1);
+	ExpectMalformed(data);
+}
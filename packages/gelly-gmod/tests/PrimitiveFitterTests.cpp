@@ -0,0 +1,287 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
+
+#include "PrimitiveFitter.h"
+
+namespace {
+using Point = std::array<float, 3>;
+
+constexpr float pi = 3.14159265f;
+
+void AddVertex(WeldedMesh &mesh, const Point &point) {
+	mesh.vertices.insert(mesh.vertices.end(), point.begin(), point.end());
+}
+
+/**
+ * Adds the quad as two triangles, the corners going around its edge.
+ */
+void AddQuad(
+	WeldedMesh &mesh,
+	const Point &a,
+	const Point &b,
+	const Point &c,
+	const Point &d
+) {
+	const auto first = mesh.GetVertexCount();
+	for (const auto &corner : {a, b, c, d}) {
+		AddVertex(mesh, corner);
+	}
+
+	mesh.indices.insert(
+		mesh.indices.end(),
+		{first, first + 1, first + 2, first, first + 2, first + 3}
+	);
+}
+
+/**
+ * Rotates the point by the quaternion (x, y, z, w).
+ */
+Point Rotate(const float *q, const Point &p) {
+	// p + 2w(q x p) + 2q x (q x p)
+	const Point t = {
+		2.f * (q[1] * p[2] - q[2] * p[1]),
+		2.f * (q[2] * p[0] - q[0] * p[2]),
+		2.f * (q[0] * p[1] - q[1] * p[0])
+	};
+
+	return {
+		p[0] + q[3] * t[0] + q[1] * t[2] - q[2] * t[1],
+		p[1] + q[3] * t[1] + q[2] * t[0] - q[0] * t[2],
+		p[2] + q[3] * t[2] + q[0] * t[1] - q[1] * t[0]
+	};
+}
+
+/**
+ * A closed box made of quads, every corner is rotated by the quaternion and
+ * then moved by the offset.
+ */
+WeldedMesh Box(
+	const Point &halfExtents,
+	const Point &offset,
+	const float rotation[4] = nullptr
+) {
+	const float identity[4] = {0.f, 0.f, 0.f, 1.f};
+	const float *q = rotation ? rotation : identity;
+
+	const auto corner = [&](int x, int y, int z) {
+		const Point local = {
+			x ? halfExtents[0] : -halfExtents[0],
+			y ? halfExtents[1] : -halfExtents[1],
+			z ? halfExtents[2] : -halfExtents[2]
+		};
+
+		const Point rotated = Rotate(q, local);
+		return Point{
+			rotated[0] + offset[0], rotated[1] + offset[1], rotated[2] + offset[2]
+		};
+	};
+
+	WeldedMesh mesh;
+	for (int side = 0; side < 2; side++) {
+		AddQuad(
+			mesh,
+			corner(side, 0, 0),
+			corner(side, 1, 0),
+			corner(side, 1, 1),
+			corner(side, 0, 1)
+		);
+		AddQuad(
+			mesh,
+			corner(0, side, 0),
+			corner(1, side, 0),
+			corner(1, side, 1),
+			corner(0, side, 1)
+		);
+		AddQuad(
+			mesh,
+			corner(0, 0, side),
+			corner(1, 0, side),
+			corner(1, 1, side),
+			corner(0, 1, side)
+		);
+	}
+
+	return mesh;
+}
+
+/**
+ * A sphere made of rings of quads, with triangle fans at the poles.
+ */
+WeldedMesh UVSphere(float radius, const Point &center, int rings, int slices) {
+	const auto point = [&](int ring, int slice) {
+		const float polar = pi * static_cast<float>(ring) / rings;
+		const float azimuth = 2.f * pi * static_cast<float>(slice) / slices;
+		return Point{
+			center[0] + radius * std::sin(polar) * std::cos(azimuth),
+			center[1] + radius * std::sin(polar) * std::sin(azimuth),
+			center[2] + radius * std::cos(polar)
+		};
+	};
+
+	WeldedMesh mesh;
+	for (int ring = 0; ring < rings; ring++) {
+		for (int slice = 0; slice < slices; slice++) {
+			const auto first = mesh.GetVertexCount();
+			AddVertex(mesh, point(ring, slice));
+			AddVertex(mesh, point(ring + 1, slice));
+			AddVertex(mesh, point(ring + 1, slice + 1));
+			AddVertex(mesh, point(ring, slice + 1));
+
+			// The poles squash a quad into a triangle
+			if (ring != 0) {
+				mesh.indices.insert(
+					mesh.indices.end(), {first, first + 1, first + 3}
+				);
+			}
+
+			if (ring != rings - 1) {
+				mesh.indices.insert(
+					mesh.indices.end(), {first + 1, first + 2, first + 3}
+				);
+			}
+		}
+	}
+
+	return mesh;
+}
+
+const PrimitiveFitter fitter(0.05f);
+}  // namespace
+
+TEST(PrimitiveFitter, Cube) {
+	const auto primitive = fitter.Fit(Box({1.f, 1.f, 1.f}, {3.f, 0.f, 0.f}));
+	ASSERT_TRUE(primitive.has_value());
+	EXPECT_EQ(primitive->shape, ObjectShape::BOX);
+
+	const Point center = {3.f, 0.f, 0.f};
+	for (int i = 0; i < 3; i++) {
+		EXPECT_NEAR(primitive->center[i], center[i], 1e-5f);
+		EXPECT_NEAR(primitive->halfExtents[i], 1.f, 1e-5f);
+	}
+
+	// A cube is fitted along the mesh's own axes
+	EXPECT_NEAR(std::abs(primitive->rotation[3]), 1.f, 1e-5f);
+}
+
+TEST(PrimitiveFitter, RotatedBox) {
+	// Half a radian around (1, 2, 3)
+	const float axisLength = std::sqrt(14.f);
+	const float s = std::sin(0.25f) / axisLength;
+	const float rotation[4] = {s, 2.f * s, 3.f * s, std::cos(0.25f)};
+	const Point halfExtents = {2.f, 1.f, 0.5f};
+	const Point offset = {5.f, -2.f, 1.f};
+	const auto mesh = Box(halfExtents, offset, rotation);
+
+	const auto primitive = fitter.Fit(mesh);
+	ASSERT_TRUE(primitive.has_value());
+	EXPECT_EQ(primitive->shape, ObjectShape::BOX);
+
+	for (int i = 0; i < 3; i++) {
+		EXPECT_NEAR(primitive->center[i], offset[i], 1e-4f);
+	}
+
+	// The axes may come out in any order or direction, so the extents are
+	// compared sorted, and the corners are checked in the box's frame
+	Point fitted = {
+		primitive->halfExtents[0],
+		primitive->halfExtents[1],
+		primitive->halfExtents[2]
+	};
+	std::sort(fitted.begin(), fitted.end());
+	EXPECT_NEAR(fitted[0], 0.5f, 1e-4f);
+	EXPECT_NEAR(fitted[1], 1.f, 1e-4f);
+	EXPECT_NEAR(fitted[2], 2.f, 1e-4f);
+
+	const float *q = primitive->rotation;
+	const float inverse[4] = {-q[0], -q[1], -q[2], q[3]};
+	for (size_t i = 0; i < mesh.vertices.size(); i += 3) {
+		const Point local = Rotate(
+			inverse,
+			{mesh.vertices[i] - primitive->center[0],
+			 mesh.vertices[i + 1] - primitive->center[1],
+			 mesh.vertices[i + 2] - primitive->center[2]}
+		);
+
+		for (int axis = 0; axis < 3; axis++) {
+			EXPECT_NEAR(
+				std::abs(local[axis]), primitive->halfExtents[axis], 1e-4f
+			);
+		}
+	}
+}
+
+TEST(PrimitiveFitter, UVSphere) {
+	const Point center = {1.f, 2.f, 3.f};
+	const auto primitive = fitter.Fit(UVSphere(2.f, center, 12, 24));
+	ASSERT_TRUE(primitive.has_value());
+	EXPECT_EQ(primitive->shape, ObjectShape::SPHERE);
+	EXPECT_NEAR(primitive->radius, 2.f, 2.f * 0.05f);
+
+	for (int i = 0; i < 3; i++) {
+		EXPECT_NEAR(primitive->center[i], center[i], 1e-4f);
+	}
+
+	// Too coarse to pass for a sphere
+	EXPECT_FALSE(fitter.Fit(UVSphere(2.f, center, 3, 4)).has_value());
+}
+
+TEST(PrimitiveFitter, LShapeIsLeftAlone) {
+	// An L in the XY plane, extruded along Z. Its inner corner lies well
+	// inside the bounds, which no box fits.
+	WeldedMesh mesh;
+	for (const float z : {0.f, 1.f}) {
+		AddQuad(mesh, {0.f, 0.f, z}, {2.f, 0.f, z}, {2.f, 1.f, z}, {0.f, 1.f, z});
+		AddQuad(mesh, {0.f, 1.f, z}, {1.f, 1.f, z}, {1.f, 2.f, z}, {0.f, 2.f, z});
+	}
+
+	const Point outline[] = {
+		{0.f, 0.f, 0.f},
+		{2.f, 0.f, 0.f},
+		{2.f, 1.f, 0.f},
+		{1.f, 1.f, 0.f},
+		{1.f, 2.f, 0.f},
+		{0.f, 2.f, 0.f}
+	};
+
+	for (size_t i = 0; i < std::size(outline); i++) {
+		const Point &a = outline[i];
+		const Point &b = outline[(i + 1) % std::size(outline)];
+		AddQuad(mesh, a, b, {b[0], b[1], 1.f}, {a[0], a[1], 1.f});
+	}
+
+	EXPECT_FALSE(fitter.Fit(mesh).has_value());
+}
+
+TEST(PrimitiveFitter, OpenCylinderIsLeftAlone) {
+	constexpr int segments = 32;
+
+	WeldedMesh mesh;
+	for (int i = 0; i < segments; i++) {
+		const float a = 2.f * pi * static_cast<float>(i) / segments;
+		const float b = 2.f * pi * static_cast<float>(i + 1) / segments;
+		AddQuad(
+			mesh,
+			{std::cos(a), std::sin(a), -1.f},
+			{std::cos(b), std::sin(b), -1.f},
+			{std::cos(b), std::sin(b), 1.f},
+			{std::cos(a), std::sin(a), 1.f}
+		);
+	}
+
+	EXPECT_FALSE(fitter.Fit(mesh).has_value());
+}
+
+TEST(PrimitiveFitter, RejectsInvalidMeshes) {
+	auto mesh = Box({1.f, 1.f, 1.f}, {0.f, 0.f, 0.f});
+	EXPECT_FALSE(PrimitiveFitter(0.f).Fit(mesh).has_value());
+	EXPECT_FALSE(fitter.Fit(WeldedMesh{}).has_value());
+	EXPECT_THROW(PrimitiveFitter{-1.f}, std::invalid_argument);
+
+	mesh.indices.back() = mesh.GetVertexCount();
+	EXPECT_THROW(std::ignore = fitter.Fit(mesh), std::invalid_argument);
+}
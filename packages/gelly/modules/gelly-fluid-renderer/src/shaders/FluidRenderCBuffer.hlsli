@@ -43,7 +43,8 @@ CBUFFER_DECLARATION(FluidRenderCBufferData) {
 	float g_DiffuseScale;
 
 	float g_DiffuseMotionBlur;
-	float3 padding2;
+	float g_InterpolationAlpha;
+	float2 padding2;
 };
 #ifdef __cplusplus
 }
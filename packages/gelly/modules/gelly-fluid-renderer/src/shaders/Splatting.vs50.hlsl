@@ -26,7 +26,9 @@ void SolveForHeight(in float4x4 invClip, out float yMin, out float yMax) {
 
 VS_OUTPUT main(VS_INPUT input) {
     VS_OUTPUT output = (VS_OUTPUT)0;
-    output.Pos = float4(input.Pos.xyz, 1.f);
+    // The simulation steps at a fixed rate, so blend between its last two steps
+    float3 pos = lerp(input.PrevPos.xyz, input.Pos.xyz, g_InterpolationAlpha);
+    output.Pos = float4(pos, 1.f);
 
     float4 q1 = input.AnisotropyQ1;
     float4 q2 = input.AnisotropyQ2;
@@ -36,7 +38,7 @@ VS_OUTPUT main(VS_INPUT input) {
     quadric._m00_m10_m20_m30 = float4(q1.xyz * q1.w, 0);
     quadric._m01_m11_m21_m31 = float4(q2.xyz * q2.w, 0);
     quadric._m02_m12_m22_m32 = float4(q3.xyz * q3.w, 0);
-    quadric._m03_m13_m23_m33 = float4(input.Pos.xyz, 1);
+    quadric._m03_m13_m23_m33 = float4(pos, 1);
 
 	output.Variance = max(max(q1.w, q2.w), q3.w);
 
@@ -68,7 +70,7 @@ VS_OUTPUT main(VS_INPUT input) {
     output.InvQ3 = invQuadric._m03_m13_m23_m33;
 
     // and to speed things up we'll pass down the NDC position for frustum culling in the GS
-    output.NDCPos = mul(g_Projection, mul(g_View, float4(input.Pos.xyz, 1.f)));
+    output.NDCPos = mul(g_Projection, mul(g_View, float4(pos, 1.f)));
     output.NDCPos /= output.NDCPos.w;
 
 	output.Absorption = g_Absorption[input.ID];
@@ -4,6 +4,7 @@ struct VS_INPUT {
     float4 AnisotropyQ1 : ANISOTROPY0;
     float4 AnisotropyQ2 : ANISOTROPY1;
     float4 AnisotropyQ3 : ANISOTROPY2;
+    float4 PrevPos : PREVPOSITION;
 };
 
 struct VS_OUTPUT {
@@ -25,6 +25,7 @@ struct InternalBuffers {
 	using BufferCreateInfo = Buffer::BufferCreateInfo;
 
 	std::shared_ptr<Buffer> particlePositions = nullptr;
+	std::shared_ptr<Buffer> previousParticlePositions = nullptr;
 	std::shared_ptr<Buffer> particleAbsorptions = nullptr;
 
 	std::shared_ptr<Buffer> anisotropyQ1 = nullptr;
@@ -49,6 +50,16 @@ struct InternalBuffers {
 				 .bindFlags = D3D11_BIND_VERTEX_BUFFER}
 			))
 		),
+		previousParticlePositions(
+			Buffer::CreateBuffer(BufferCreateInfo::WithAutomaticStride<float4>(
+				{.device = device,
+				 .maxElementCount = maxParticles,
+				 .initialData = nullptr,
+				 .usage = D3D11_USAGE_DEFAULT,
+				 .format = DXGI_FORMAT_R32G32B32A32_FLOAT,
+				 .bindFlags = D3D11_BIND_VERTEX_BUFFER}
+			))
+		),
 		particleAbsorptions(
 			Buffer::CreateBuffer(BufferCreateInfo::WithAutomaticStride<float3>(
 				{.device = device,
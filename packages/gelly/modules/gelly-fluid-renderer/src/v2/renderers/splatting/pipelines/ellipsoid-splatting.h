@@ -127,6 +127,15 @@ inline auto CreateEllipsoidSplattingPipeline(const PipelineInfo &info)
 						.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA,
 						.InstanceDataStepRate = 0
 					},
+					D3D11_INPUT_ELEMENT_DESC{
+						.SemanticName = "PREVPOSITION",
+						.SemanticIndex = 0,
+						.Format = DXGI_FORMAT_R32G32B32A32_FLOAT,
+						.InputSlot = 4,
+						.AlignedByteOffset = 0,
+						.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA,
+						.InstanceDataStepRate = 0
+					},
 				},
 		});
 
@@ -156,6 +165,11 @@ inline auto CreateEllipsoidSplattingPipeline(const PipelineInfo &info)
 			  },
 			  InputVertexBuffer{
 				  .vertexBuffer = info.internalBuffers->anisotropyQ3, .slot = 3
+			  },
+			  InputVertexBuffer{
+				  .vertexBuffer =
+					  info.internalBuffers->previousParticlePositions,
+				  .slot = 4
 			  }},
 		 .outputs =
 			 {OutputTexture{
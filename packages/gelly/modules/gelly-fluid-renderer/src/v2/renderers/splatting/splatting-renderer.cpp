@@ -97,6 +97,7 @@ auto SplattingRenderer::UpdateSettings(const Settings &settings) -> void {
 
 auto SplattingRenderer::UpdateFrameParams(cbuffer::FluidRenderCBufferData &data
 ) const -> void {
+	data.g_InterpolationAlpha = createInfo.simData->GetInterpolationAlpha();
 	pipelineInfo.internalBuffers->fluidRenderCBuffer.UpdateBuffer(data);
 }
 
@@ -158,6 +159,12 @@ auto SplattingRenderer::LinkBuffersToSimData() const -> void {
 		pipelineInfo.internalBuffers->particlePositions->GetRawBuffer().Get()
 	);
 
+	simData->LinkBuffer(
+		SimBufferType::PREVIOUS_POSITION,
+		pipelineInfo.internalBuffers->previousParticlePositions->GetRawBuffer()
+			.Get()
+	);
+
 	simData->LinkBuffer(
 		SimBufferType::ANISOTROPY_Q1,
 		pipelineInfo.internalBuffers->anisotropyQ1->GetRawBuffer().Get()
@@ -6,6 +6,8 @@
 #include <filesystem>
 
 #include "fluidsim/CD3D11DebugFluidSimulation.h"
+#include "fluidsim/CRecordingFluidSimulation.h"
+#include "fluidsim/CSimTraceReplayer.h"
 #include "fluidsim/ISimContext.h"
 
 namespace Gelly {
@@ -26,6 +28,14 @@ IFluidSimulation *CreateD3D11FlexFluidSimulation(
 	GellyObserverPtr<ISimContext> context
 );
 
+/**
+ * \brief Wraps a simulation so it can be recorded to a trace, see
+ * CRecordingFluidSimulation.
+ * \param sim The simulation to wrap, it is destroyed along with the wrapper.
+ */
+CRecordingFluidSimulation *CreateRecordingFluidSimulation(IFluidSimulation *sim
+);
+
 void DestroyGellyFluidSim(IFluidSimulation *sim);
 
 }  // namespace Gelly
@@ -5,6 +5,7 @@
 #include <GellyObserverPtr.h>
 #include <d3d11.h>
 
+#include "CParticleIdTable.h"
 #include "ISimContext.h"
 #include "ISimData.h"
 
@@ -17,11 +18,17 @@ private:
 	ID3D11Buffer *anisotropyQ1Buffer;
 	ID3D11Buffer *anisotropyQ2Buffer;
 	ID3D11Buffer *anisotropyQ3Buffer;
+	ID3D11Buffer *previousPositionBuffer = nullptr;
 
 	int maxParticles = 0;
 	int maxFoamParticles = 0;
 	int activeParticles = 0;
 	int activeFoamParticles = 0;
+	float interpolationAlpha = 1.f;
+
+	bool particleIdsEnabled = false;
+	CParticleIdTable particleIds;
+	ParticleRemapListener remapListener;
 
 public:
 	explicit CD3D11CPUSimData();
@@ -44,6 +51,17 @@ public:
 
 	void SetActiveParticles(int activeParticles) override;
 	int GetActiveParticles() override;
+
+	void SetInterpolationAlpha(float alpha) override;
+	float GetInterpolationAlpha() override;
+
+	void SetParticleIdsEnabled(bool enabled) override;
+	bool AreParticleIdsEnabled() override;
+	ParticleId GetParticleId(int slot) override;
+	uint32_t GetParticleSlot(ParticleId id) override;
+	void RemapParticles(const uint32_t *previousSlots, int particleCount)
+		override;
+	void SetParticleRemapListener(ParticleRemapListener listener) override;
 };
 
 #endif	// GELLY_CD3D11CPUSIMDATA_H
@@ -2,7 +2,7 @@
 #define GELLY_CD3D11DEBUGFLUIDSIMULATION_H
 
 #include "CD3D11CPUSimData.h"
-#include "CSimpleSimCommandList.h"
+#include "CSimCommandListPool.h"
 #include "IFluidSimulation.h"
 
 /**
@@ -19,7 +19,7 @@ private:
 
 	int maxParticles;
 
-	std::vector<CSimpleSimCommandList *> commandLists;
+	CSimCommandListPool commandListPool;
 
 	void CreateBuffers();
 	void GenerateRandomParticles();
@@ -37,15 +37,28 @@ public:
 	ISimCommandList *CreateCommandList() override;
 	void DestroyCommandList(ISimCommandList *commandList) override;
 	void ExecuteCommandList(ISimCommandList *commandList) override;
+	ISimCommandList *BeginCommandList() override;
+	void SubmitCommandList(ISimCommandList *commandList) override;
 
 	void AttachToContext(GellyObserverPtr<ISimContext> context) override;
 	void Update(float deltaTime) override;
+	void KickUpdate(float deltaTime) override;
+	void WaitForResult() override;
 	void SetTimeStepMultiplier(float timeStepMultiplier) override{};
 
 	const char *GetComputeDeviceName() override;
 	bool CheckFeatureSupport(GELLY_FEATURE feature) override;
 
 	void VisitLatestContactPlanes(ContactPlaneVisitor visitor) override{};
+	void SetQualitySettings(const SimQualitySettings &settings) override{};
+	SimQualityStatus GetQualityStatus() override { return {}; };
+	float GetParticleLocality() override { return 0.f; };
+	void CaptureSnapshot(CSimSnapshot &snapshot) override {
+		snapshot.Clear();
+	};
+	bool GetParticleBounds(float lower[3], float upper[3]) override {
+		return false;
+	};
 };
 
 #endif	// GELLY_CD3D11DEBUGFLUIDSIMULATION_H
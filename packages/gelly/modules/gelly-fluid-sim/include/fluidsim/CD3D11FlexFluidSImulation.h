@@ -4,25 +4,49 @@
 #include <functional>
 
 #include "CD3D11CPUSimData.h"
+#include "CD3D11StepTimer.h"
+#include "CFlexParticleStagingBackend.h"
+#include "CFlexParticleStagingRing.h"
 #include "CFlexSimScene.h"
-#include "CSimpleSimCommandList.h"
+#include "CParticleReorderer.h"
+#include "CParticleSleepTracker.h"
+#include "CSimCommandListPool.h"
+#include "CSimQualityController.h"
+#include "CSimStepController.h"
 #include "IFluidSimulation.h"
 
 class CD3D11FlexFluidSimulation : public IFluidSimulation {
 private:
 	static constexpr SimCommandType supportedCommands =
 		static_cast<SimCommandType>(
-			RESET | ADD_PARTICLE | CHANGE_RADIUS | SET_FLUID_PROPERTIES
+			RESET | ADD_PARTICLE | CHANGE_RADIUS | SET_FLUID_PROPERTIES |
+			ADD_PARTICLE_BATCH
 		);
 
 	CD3D11CPUSimData *simData;
 	GellyObserverPtr<ISimContext> context{};
 
 	int maxParticles;
-
-	std::vector<CSimpleSimCommandList *> commandLists;
+	// The solver is only rebuilt once maxParticles outgrows it, so it can
+	// have room for more particles than are actually allowed.
+	int particleCapacity = 0;
+	// The renderer can swap its buffers out, in which case they need to be
+	// registered again.
+	void *registeredPositionBuffer = nullptr;
+
+	CSimCommandListPool commandListPool;
 	CFlexSimScene *scene;
 
+	// Upload chunk size, anything bigger just spills over into the next slot
+	static constexpr int maxStagedParticles = 16384;
+	CFlexParticleStagingBackend *stagingBackend;
+	CFlexParticleStagingRing *stagingRing;
+
+	// AddParticle and AddParticleBatch commands, in the order they were
+	// recorded. Batches only point into memory owned by the caller, so we can
+	// hold onto them without copying anything until they're staged.
+	std::vector<const SimCommand *> pendingAdditions;
+
 	NvFlexParams solverParams{};
 
 	struct {
@@ -33,6 +57,8 @@ private:
 		NvFlexBuffer *contactVelocities;
 		NvFlexBuffer *contactCounts;
 		NvFlexBuffer *diffuseParticleCount;
+		NvFlexBuffer *boundsLower;
+		NvFlexBuffer *boundsUpper;
 	} buffers{};
 
 	/**
@@ -48,6 +74,63 @@ private:
 		NvFlexBuffer *anisotropyQ3Buffer;
 	} sharedBuffers{};
 
+	static constexpr float fixedTimeStep = 1.f / 60.f;
+	static constexpr int maxStepsPerFrame = 3;
+	CSimStepController stepController;
+	// Set between KickUpdate and WaitForResult
+	bool updateInFlight = false;
+	int stepsInFlight = 0;
+
+	// Settled particles are left out of the solver's active set until
+	// something disturbs them. Velocities are only read back every few
+	// updates, so falling asleep takes checksToSleep * updatesPerSleepCheck
+	// updates.
+	static constexpr uint8_t checksToSleep = 15;
+	static constexpr int updatesPerSleepCheck = 4;
+	CParticleSleepTracker sleepTracker;
+	int updatesSinceSleepCheck = 0;
+	bool sleepReadbackInFlight = false;
+	uint sleepReadbackCount = 0;
+	// Whether the solver's active set skips over any sleeping particles, in
+	// which case new particles can't just be appended to it.
+	bool activeSetCompacted = false;
+	uint activeSetParticleCount = 0;
+
+	// Particles are sorted along a Morton curve every so often, or sooner if
+	// neighbouring slots drift too far apart. The sort piggybacks on the
+	// sleep readback, so it never waits on the GPU either.
+	static constexpr int updatesPerReorder = 600;
+	static constexpr int minUpdatesPerReorder = 60;
+	// In particle radii
+	static constexpr float maxParticleLocality = 8.f;
+	CParticleReorderer reorderer;
+	int updatesSinceReorder = 0;
+	bool reorderReadbackInFlight = false;
+	float particleLocality = 0.f;
+	std::vector<uint> remapSlots;
+
+	struct ParticleBounds {
+		float lower[3];
+		float upper[3];
+		bool valid;
+	};
+
+	// FleX only measures the particles in its active set, so the bounds are
+	// merged with those of the last sleep readback to cover sleeping ones.
+	ParticleBounds activeBounds{};
+	ParticleBounds readbackBounds{};
+
+	// Drains are tested against the sleep readback too, and whatever they
+	// caught is compacted out right before the next step.
+	std::vector<DrainHandle> drainedBy;
+	// Whether the phases were read back for drains, decided when the
+	// readback is kicked rather than from the drains there are once it's in
+	bool drainReadbackInFlight = false;
+	bool drainPending = false;
+
+	CSimQualityController qualityController;
+	CD3D11StepTimer *stepTimer;
+
 	NvFlexLibrary *library{};
 	NvFlexSolver *solver{};
 
@@ -55,11 +138,55 @@ private:
 	float particleRadius = 0.1f;
 	float particleInverseMass = 1.f;
 	uint maxContactsPerParticle = 6;
-	int substeps = 3;
 	float timeStepMultiplier = 1.f;
 
 	void SetupParams();
+	/**
+	 * \brief Creates the solver and everything sized by its capacity, using
+	 * the current solver params.
+	 */
+	void CreateSolver(int capacity);
+	void DestroySolver();
+	/**
+	 * \brief Swaps the solver for one with a different capacity, carrying
+	 * the particles over.
+	 * \note FleX solvers can't be resized, but meshes belong to the library
+	 * so the scene survives untouched.
+	 */
+	void ResizeSolver(int capacity);
+	/**
+	 * \brief How many particles fit into every linked buffer the solver
+	 * writes to.
+	 */
+	[[nodiscard]] int GetLinkedParticleCapacity() const;
 	void DebugDumpParams();
+	/**
+	 * \brief Copies a range of the render positions into the linked
+	 * PREVIOUS_POSITION buffer, if there is one.
+	 */
+	void CopyPositionsToPrevious(uint firstParticle, uint particleCount);
+	/**
+	 * \brief Sends the awake particles over to the solver as its active set.
+	 */
+	void UploadActiveSet();
+	/**
+	 * \brief Wakes everything up, for when the fluid itself changes.
+	 */
+	void WakeAllParticles();
+	/**
+	 * \brief Uploads the particles sorted by the reorderer, and tells
+	 * everyone else where they went.
+	 */
+	void ApplyReorder();
+	/**
+	 * \brief Finds which of the read back particles are inside a drain.
+	 */
+	void CheckDrains(const SimFloat4 *positions, uint particleCount);
+	/**
+	 * \brief Removes the particles caught by drains, moving the rest down to
+	 * fill the gaps.
+	 */
+	void ApplyDrains();
 
 public:
 	CD3D11FlexFluidSimulation();
@@ -83,14 +210,23 @@ public:
 	ISimCommandList *CreateCommandList() override;
 	void DestroyCommandList(ISimCommandList *commandList) override;
 	void ExecuteCommandList(ISimCommandList *commandList) override;
+	ISimCommandList *BeginCommandList() override;
+	void SubmitCommandList(ISimCommandList *commandList) override;
 
 	void Update(float deltaTime) override;
+	void KickUpdate(float deltaTime) override;
+	void WaitForResult() override;
 	void SetTimeStepMultiplier(float timeStepMultiplier) override;
 
 	const char *GetComputeDeviceName() override;
 	bool CheckFeatureSupport(GELLY_FEATURE feature) override;
 
 	void VisitLatestContactPlanes(ContactPlaneVisitor visitor) override;
+	void SetQualitySettings(const SimQualitySettings &settings) override;
+	SimQualityStatus GetQualityStatus() override;
+	float GetParticleLocality() override;
+	void CaptureSnapshot(CSimSnapshot &snapshot) override;
+	bool GetParticleBounds(float lower[3], float upper[3]) override;
 };
 
 #endif	// CD3D11FLEXFLUIDSIMULATION_H
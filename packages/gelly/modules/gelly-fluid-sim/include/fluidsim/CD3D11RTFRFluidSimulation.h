@@ -2,7 +2,7 @@
 #define CD3D11RTFRFLUIDSIMULATION_H
 
 #include "CD3D11CPUSimData.h"
-#include "CSimpleSimCommandList.h"
+#include "CSimCommandListPool.h"
 #include "IFluidSimulation.h"
 #include "rtfr/Dataset.h"
 
@@ -21,7 +21,7 @@ private:
 	rtfr::DatasetInfo datasetInfo;
 	rtfr::Dataset dataset;
 
-	std::vector<CSimpleSimCommandList *> commandLists;
+	CSimCommandListPool commandListPool;
 
 	void CreateBuffers();
 	void LoadFrameIntoBuffers();
@@ -42,15 +42,28 @@ public:
 	ISimCommandList *CreateCommandList() override;
 	void DestroyCommandList(ISimCommandList *commandList) override;
 	void ExecuteCommandList(ISimCommandList *commandList) override;
+	ISimCommandList *BeginCommandList() override;
+	void SubmitCommandList(ISimCommandList *commandList) override;
 
 	void AttachToContext(GellyObserverPtr<ISimContext> context) override;
 
 	void Update(float deltaTime) override;
+	void KickUpdate(float deltaTime) override;
+	void WaitForResult() override;
 	void SetTimeStepMultiplier(float timeStepMultiplier) override{};
 	const char *GetComputeDeviceName() override;
 	bool CheckFeatureSupport(GELLY_FEATURE feature) override;
 
 	void VisitLatestContactPlanes(ContactPlaneVisitor visitor) override{};
+	void SetQualitySettings(const SimQualitySettings &settings) override{};
+	SimQualityStatus GetQualityStatus() override { return {}; };
+	float GetParticleLocality() override { return 0.f; };
+	void CaptureSnapshot(CSimSnapshot &snapshot) override {
+		snapshot.Clear();
+	};
+	bool GetParticleBounds(float lower[3], float upper[3]) override {
+		return false;
+	};
 };
 
 #endif	// CD3D11RTFRFLUIDSIMULATION_H
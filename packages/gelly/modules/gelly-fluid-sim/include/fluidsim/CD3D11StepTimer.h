@@ -0,0 +1,40 @@
+#ifndef GELLY_CD3D11STEPTIMER_H
+#define GELLY_CD3D11STEPTIMER_H
+
+#include <d3d11.h>
+
+#include <optional>
+
+/**
+ * \brief Measures how long the GPU spends on the work issued between Begin
+ * and End, using timestamp queries.
+ * \note The result is read without stalling, so it's only available once the
+ * GPU has actually gotten through the measured work.
+ */
+class CD3D11StepTimer {
+private:
+	ID3D11DeviceContext *deviceContext;
+	ID3D11Query *disjointQuery = nullptr;
+	ID3D11Query *startQuery = nullptr;
+	ID3D11Query *endQuery = nullptr;
+
+	bool measuring = false;
+
+public:
+	CD3D11StepTimer(ID3D11Device *device, ID3D11DeviceContext *deviceContext);
+	~CD3D11StepTimer();
+
+	CD3D11StepTimer(const CD3D11StepTimer &) = delete;
+	CD3D11StepTimer &operator=(const CD3D11StepTimer &) = delete;
+
+	void Begin();
+	void End();
+
+	/**
+	 * \return Milliseconds between Begin and End, or nothing if the GPU
+	 * hasn't finished yet or the timestamps were unreliable.
+	 */
+	std::optional<float> Resolve();
+};
+
+#endif	// GELLY_CD3D11STEPTIMER_H
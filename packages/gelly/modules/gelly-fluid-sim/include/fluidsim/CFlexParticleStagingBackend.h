@@ -0,0 +1,45 @@
+#ifndef CFLEXPARTICLESTAGINGBACKEND_H
+#define CFLEXPARTICLESTAGINGBACKEND_H
+
+#include <NvFlex.h>
+
+#include <vector>
+
+#include "IParticleStagingBackend.h"
+
+/**
+ * \brief Stages particles in FleX host buffers and uploads them with
+ * NvFlexCopyDesc offsets, so only the copied range of the solver changes.
+ */
+class CFlexParticleStagingBackend : public IParticleStagingBackend {
+private:
+	struct Slot {
+		NvFlexBuffer *positions;
+		NvFlexBuffer *velocities;
+		NvFlexBuffer *phases;
+		NvFlexBuffer *actives;
+	};
+
+	NvFlexLibrary *library;
+	NvFlexSolver *solver;
+	// Destroyed slots are left empty, handles are never reused
+	std::vector<Slot> slots;
+
+	[[nodiscard]] const Slot &GetSlot(SlotHandle slot) const;
+
+public:
+	CFlexParticleStagingBackend(NvFlexLibrary *library, NvFlexSolver *solver);
+	~CFlexParticleStagingBackend() override;
+
+	CFlexParticleStagingBackend(const CFlexParticleStagingBackend &) = delete;
+	CFlexParticleStagingBackend &operator=(const CFlexParticleStagingBackend &
+	) = delete;
+
+	SlotHandle CreateSlot(uint capacity) override;
+	void DestroySlot(SlotHandle slot) override;
+	ParticleStagingView MapSlot(SlotHandle slot) override;
+	void UnmapSlot(SlotHandle slot) override;
+	void UploadSlot(SlotHandle slot, uint firstParticle, uint count) override;
+};
+
+#endif	// CFLEXPARTICLESTAGINGBACKEND_H
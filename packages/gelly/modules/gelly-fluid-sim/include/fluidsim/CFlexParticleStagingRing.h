@@ -0,0 +1,97 @@
+#ifndef CFLEXPARTICLESTAGINGRING_H
+#define CFLEXPARTICLESTAGINGRING_H
+
+#include <GellyDataTypes.h>
+
+#include "IParticleStagingBackend.h"
+#include "ISimData.h"
+
+using namespace Gelly::DataTypes;
+
+/**
+ * \brief Uploads newly added particles to a FleX solver without touching the
+ * particles that are already alive.
+ *
+ * Particles are written into a small ring of host buffers and copied to the
+ * end of the solver's particle range with NvFlexCopyDesc offsets. Each slot is
+ * only reused after the rest of the ring, so mapping it again doesn't have to
+ * wait on the GPU still reading the previous upload.
+ *
+ * Usage:
+ * @code{.cpp}
+ * ring.Begin(activeParticles, maxParticles);
+ * ring.Write(positions, velocities, nullptr, defaultPhase, 1.f, count);
+ * activeParticles += ring.End();
+ * @endcode
+ */
+class CFlexParticleStagingRing {
+private:
+	static constexpr int slotCount = 3;
+
+	IParticleStagingBackend *backend;
+	IParticleStagingBackend::SlotHandle slots[slotCount]{};
+	uint slotCapacity;
+	int currentSlot = 0;
+
+	uint uploadOffset = 0;
+	uint slotFill = 0;
+	uint particlesWritten = 0;
+	uint particleLimit = 0;
+
+	ParticleStagingView mapped{};
+
+	void MapCurrentSlot();
+	void UploadCurrentSlot();
+	void EnsureSlotSpace();
+
+public:
+	/**
+	 * \param backend Not owned, has to outlive the ring.
+	 */
+	CFlexParticleStagingRing(
+		IParticleStagingBackend *backend, uint slotCapacity
+	);
+	~CFlexParticleStagingRing();
+
+	CFlexParticleStagingRing(const CFlexParticleStagingRing &) = delete;
+	CFlexParticleStagingRing &operator=(const CFlexParticleStagingRing &) =
+		delete;
+
+	/**
+	 * \brief Starts an upload. Every particle written afterwards is placed
+	 * right after the previous one, starting at firstParticle.
+	 * \param maxParticles Solver capacity, nothing is written at or past it.
+	 */
+	void Begin(uint firstParticle, uint maxParticles);
+
+	/**
+	 * \brief Writes a run of particles, spilling into the next slots if it
+	 * doesn't fit into the current one.
+	 * \param phases Optional, defaultPhase is used for every particle if null.
+	 * \param inverseMass Replaces the w component of every position.
+	 * \return How many particles fit before reaching maxParticles.
+	 */
+	uint Write(
+		const SimFloat4 *positions,
+		const SimFloat3 *velocities,
+		const int *phases,
+		int defaultPhase,
+		float inverseMass,
+		uint count
+	);
+
+	/**
+	 * \return False if the solver is already full.
+	 */
+	bool WriteParticle(
+		const SimFloat4 &position, const SimFloat3 &velocity, int phase
+	);
+
+	/**
+	 * \brief Uploads whatever is left in the current slot.
+	 * \return How many particles were written since Begin.
+	 */
+	uint End();
+};
+
+#endif	// CFLEXPARTICLESTAGINGRING_H
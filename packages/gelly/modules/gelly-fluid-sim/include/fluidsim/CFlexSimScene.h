@@ -3,8 +3,11 @@
 
 #include <NvFlex.h>
 
+#include <functional>
 #include <unordered_map>
+#include <vector>
 
+#include "ISimData.h"
 #include "ISimScene.h"
 
 /**
@@ -21,21 +24,99 @@ struct ObjectData {
 		float halfHeight;
 	};
 
+	struct Convex {
+		NvFlexConvexMeshId id;
+		float scale[3];
+	};
+
+	struct Sphere {
+		float radius;
+	};
+
+	struct Box {
+		float halfExtents[3];
+	};
+
 	ObjectShape shape{};
 	float position[3]{};
 	float rotation[4]{};
-	bool firstFrame = true;
+	// Where the shape sits relative to the object, only spheres and boxes
+	// can be moved off the origin
+	float localPosition[3]{};
+	float localRotation[4]{0.f, 0.f, 0.f, 1.f};
+	// Conservative radius around the object's origin which encloses the shape
+	float boundingRadius{};
+	// Set when the object moves, along with where it was before moving
+	bool moved = false;
+	float movedFrom[3]{};
+	// The shape transform last written for the solver, kept here rather than
+	// read back from the slot so that it follows the object between slots
+	float shapePosition[4]{};
+	float shapeRotation[4]{};
 
-	std::variant<TriangleMesh, Capsule> shapeData;
-	uint currentShapeIndex{};
+	std::variant<TriangleMesh, Capsule, Convex, Sphere, Box> shapeData;
 };
 
 class CFlexSimScene : public ISimScene {
+public:
+	/**
+	 * \brief Receives a bounding sphere that fluid may need to react to.
+	 */
+	using DisturbanceVisitor =
+		std::function<void(const float position[3], float radius)>;
+	using TransformVisitor = std::function<void(
+		ObjectHandle handle, const float position[3], const float rotation[4]
+	)>;
+
 private:
 	static constexpr uint maxColliders = 8192;
+	static constexpr uint invalidSlot = 0xFFFFFFFF;
 
-	uint monotonicObjectId = 0;
-	bool dirty = false;
+	// Handles index into handleEntries, with an 8-bit generation in the top
+	// bits so that handles to removed objects are very unlikely to be valid
+	// once the entry is reused. They only match again after the entry has been
+	// reused a multiple of 256 times.
+	static constexpr uint handleIndexBits = 24;
+	static constexpr uint handleIndexMask = (1u << handleIndexBits) - 1;
+
+	struct HandleEntry {
+		uint slot;
+		uint8_t generation;
+	};
+
+	std::vector<HandleEntry> handleEntries;
+	std::vector<uint> freeHandles;
+
+	/**
+	 * \brief Marks which parts of a shape slot need writing on the next
+	 * update.
+	 */
+	enum SlotDirtyFlags : uint8_t {
+		SLOT_TRANSFORM = 1 << 0,
+		// Everything, including the shape itself. The previous transform is
+		// reset too, so a new or re-enabled object doesn't sweep through the
+		// scene.
+		SLOT_SHAPE = 1 << 1,
+		// Moved last update, so the previous transform needs to catch up
+		SLOT_SETTLE = 1 << 2,
+		// Another object was moved into the slot. Its shape is rewritten, but
+		// it keeps sweeping from where it was in its old slot.
+		SLOT_MOVED = 1 << 3,
+	};
+
+	// Objects are packed into the first objects.size() shape slots, in the
+	// same order as the solver sees them. Removing one moves the last object
+	// into its place. Enabled objects come first, only those enabledCount
+	// slots are handed to the solver.
+	std::vector<ObjectData> objects;
+	std::vector<ObjectHandle> slotHandles;
+	std::vector<uint8_t> slotDirty;
+	std::vector<uint> dirtySlots;
+	std::vector<uint> settlingSlots;
+	uint enabledCount = 0;
+	// The solver keeps its shapes between updates, so they're only sent when
+	// something changes.
+	bool shapesUploadRequired = false;
 
 	NvFlexLibrary *library = nullptr;
 	NvFlexSolver *solver = nullptr;
@@ -49,7 +130,79 @@ private:
 		NvFlexBuffer *flags;
 	} geometry = {};
 
-	std::unordered_map<ObjectHandle, ObjectData> objects;
+	struct DrainData {
+		DrainCreationParams params;
+		uint drainedParticles = 0;
+	};
+
+	uint monotonicDrainId = 0;
+	std::unordered_map<DrainHandle, DrainData> drains;
+
+	struct RemovedBounds {
+		float position[3];
+		float radius;
+	};
+
+	std::vector<RemovedBounds> removedBounds;
+
+	/**
+	 * \brief Identifies a triangle mesh by its contents, so that objects with
+	 * the same geometry share one FleX mesh and BVH.
+	 * \note The contents are kept along with their hash, meshes which only
+	 * share a hash are told apart by comparing them.
+	 */
+	struct MeshKey {
+		uint64_t hash;
+		// Every word that went into the hash, starting with the counts
+		std::vector<uint32_t> words;
+
+		/**
+		 * \brief Hashes the words with FNV-1a.
+		 */
+		explicit MeshKey(std::vector<uint32_t> words);
+
+		bool operator==(const MeshKey &other) const {
+			return hash == other.hash && words == other.words;
+		}
+	};
+
+	struct MeshKeyHasher {
+		size_t operator()(const MeshKey &key) const {
+			return static_cast<size_t>(key.hash);
+		}
+	};
+
+	struct CachedMesh {
+		NvFlexTriangleMeshId id;
+		uint referenceCount;
+		float minVertex[3];
+		float maxVertex[3];
+	};
+
+	std::unordered_map<MeshKey, CachedMesh, MeshKeyHasher> meshCache;
+	// Points into meshCache, which doesn't move its elements, so the mesh's
+	// contents aren't held twice
+	std::unordered_map<NvFlexTriangleMeshId, const MeshKey *> meshKeys;
+
+	// Convex meshes are shared the same way, keyed by their planes and bounds
+	struct CachedConvexMesh {
+		NvFlexConvexMeshId id;
+		uint referenceCount;
+	};
+
+	std::unordered_map<MeshKey, CachedConvexMesh, MeshKeyHasher> convexCache;
+	std::unordered_map<NvFlexConvexMeshId, const MeshKey *> convexKeys;
+
+	void MarkMoved(ObjectData &object);
+	void MarkDirty(uint slot, uint8_t flags);
+	[[nodiscard]] uint FindSlot(ObjectHandle handle) const;
+	/**
+	 * \brief Exchanges the objects in two slots, rewriting both. Pending
+	 * writes follow their objects.
+	 */
+	void SwapSlots(uint first, uint second);
+	[[nodiscard]] ObjectHandle AllocateHandle(uint slot);
+	void ReleaseHandle(ObjectHandle handle);
 
 	// FYI: In FleX, the triangle mesh is the only special case.
 	// Anything else is POD, but since these have meshes,
@@ -57,18 +210,55 @@ private:
 	// We still have CreateXXXX functions for the other shapes for consistency.
 	[[nodiscard]] ObjectData CreateTriangleMesh(
 		const ObjectCreationParams::TriangleMesh &params
+	);
+
+	[[nodiscard]] static MeshKey GetTriangleMeshKey(
+		const ObjectCreationParams::TriangleMesh &params
+	);
+
+	[[nodiscard]] CachedMesh BuildTriangleMesh(
+		const ObjectCreationParams::TriangleMesh &params
 	) const;
 
+	/**
+	 * \brief Drops an object's reference to a mesh, destroying the mesh once
+	 * nothing uses it.
+	 */
+	void ReleaseTriangleMesh(NvFlexTriangleMeshId id);
+
 	[[nodiscard]] ObjectData CreateCapsule(
 		const ObjectCreationParams::Capsule &params
 	) const;
 
+	[[nodiscard]] ObjectData CreateConvex(
+		const ObjectCreationParams::Convex &params
+	);
+
+	[[nodiscard]] static MeshKey GetConvexKey(
+		const ObjectCreationParams::Convex &params
+	);
+
+	[[nodiscard]] NvFlexConvexMeshId BuildConvexMesh(
+		const ObjectCreationParams::Convex &params
+	) const;
+
+	void ReleaseConvexMesh(NvFlexConvexMeshId id);
+
+	[[nodiscard]] ObjectData CreateSphere(
+		const ObjectCreationParams::Sphere &params
+	) const;
+
+	[[nodiscard]] ObjectData CreateBox(
+		const ObjectCreationParams::Box &params
+	) const;
+
 public:
 	CFlexSimScene(NvFlexLibrary *library, NvFlexSolver *solver);
 	~CFlexSimScene() override;
 
 	ObjectHandle CreateObject(const ObjectCreationParams &params) override;
 	void RemoveObject(ObjectHandle handle) override;
+	void SetObjectEnabled(ObjectHandle handle, bool enabled) override;
 
 	void SetObjectPosition(ObjectHandle handle, float x, float y, float z)
 		override;
@@ -77,9 +267,45 @@ public:
 		ObjectHandle handle, float x, float y, float z, float w
 	) override;
 
+	void SetObjectTransforms(
+		const ObjectHandle *handles,
+		const ObjectTransform *transforms,
+		uint objectCount
+	) override;
+
+	DrainHandle CreateDrain(const DrainCreationParams &params) override;
+	void RemoveDrain(DrainHandle handle) override;
+	uint GetDrainedParticleCount(DrainHandle handle) override;
+
+	[[nodiscard]] bool HasDrains() const;
+	/**
+	 * \return The drain containing the position, or INVALID_DRAIN_HANDLE.
+	 */
+	[[nodiscard]] DrainHandle FindDrain(const SimFloat4 &position) const;
+	/**
+	 * \brief Credits a drain with particles the simulation removed.
+	 * \note Drains which were removed in the meantime are ignored.
+	 */
+	void AddDrainedParticles(DrainHandle handle, uint particleCount);
+
 	NvFlexBuffer *GetShapePositions();
 	ObjectHandle GetHandleFromShapeIndex(const uint &shapeIndex);
 
+	/**
+	 * \brief Visits the bounds of every object which moved or was removed
+	 * since the last call.
+	 * \note Moved objects are visited at both their old and new positions.
+	 */
+	void ConsumeDisturbances(const DisturbanceVisitor &visitor);
+
+	void VisitObjectTransforms(const TransformVisitor &visitor) const;
+
+	/**
+	 * \brief Points the scene at a new solver from the same library.
+	 * \note Meshes belong to the library, so every object carries over.
+	 */
+	void SetSolver(NvFlexSolver *solver);
+
 	void Update() override;
 };
 
@@ -0,0 +1,66 @@
+#ifndef GELLY_CPARTICLEIDTABLE_H
+#define GELLY_CPARTICLEIDTABLE_H
+
+#include <GellyDataTypes.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ISimData.h"
+
+using namespace Gelly::DataTypes;
+
+/**
+ * \brief Keeps track of which slot in the particle buffers each particle ID
+ * lives in, and the other way around.
+ *
+ * IDs are handed out densely, and an ID's index is only reused after its
+ * particle is gone. The upper 8 bits of an ID count how many times its index
+ * has been reused, so a stale ID is very unlikely to resolve to some other
+ * particle. It still can if the index is reused a multiple of 256 times
+ * before the stale ID is looked up again.
+ */
+class CParticleIdTable {
+private:
+	static constexpr uint indexBits = 24;
+	static constexpr uint indexMask = (1u << indexBits) - 1;
+
+	std::vector<ParticleId> slotToId;
+	// Indexed by the index part of an ID
+	std::vector<uint> indexToSlot;
+	std::vector<uint8_t> indexGenerations;
+	std::vector<uint> freeIndices;
+
+	std::vector<ParticleId> remapScratch;
+	std::vector<ParticleId> remappedIds;
+
+	ParticleId Allocate(uint slot);
+	void Release(ParticleId id);
+
+public:
+	CParticleIdTable() = default;
+
+	void Clear();
+
+	/**
+	 * \brief Gives IDs to any slots past the old count, or releases the IDs of
+	 * any slots that were cut off.
+	 */
+	void Resize(uint particleCount);
+
+	/**
+	 * \brief Moves IDs along with their particles.
+	 * \param previousSlots For each slot, the slot its particle was in before.
+	 * Slots that aren't mentioned anywhere lose their particle.
+	 * \param particleCount How many particles are left afterwards.
+	 * \note Throws invalid_argument, leaving the table untouched, if a
+	 * previous slot is out of range or mentioned more than once.
+	 */
+	void Remap(const uint *previousSlots, uint particleCount);
+
+	[[nodiscard]] ParticleId GetId(uint slot) const;
+	[[nodiscard]] uint GetSlot(ParticleId id) const;
+	[[nodiscard]] uint GetParticleCount() const;
+};
+
+#endif	// GELLY_CPARTICLEIDTABLE_H
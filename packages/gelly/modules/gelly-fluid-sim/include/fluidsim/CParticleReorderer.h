@@ -0,0 +1,78 @@
+#ifndef GELLY_CPARTICLEREORDERER_H
+#define GELLY_CPARTICLEREORDERER_H
+
+#include <GellyDataTypes.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ISimData.h"
+
+using namespace Gelly::DataTypes;
+
+/**
+ * \brief Sorts particles along a Morton curve so that particles which are
+ * close in space also end up close in memory.
+ *
+ * Particles are copied in with Prepare, and the sorted copies stay around
+ * until the simulation gets a chance to upload them.
+ */
+class CParticleReorderer {
+private:
+	struct SortKey {
+		uint32_t code;
+		uint slot;
+	};
+
+	std::vector<SortKey> keys;
+	std::vector<uint> previousSlots;
+	std::vector<SimFloat4> positions;
+	std::vector<SimFloat3> velocities;
+	std::vector<int> phases;
+	bool pending = false;
+
+	static uint32_t SpreadBits(uint32_t value);
+
+public:
+	CParticleReorderer() = default;
+
+	/**
+	 * \brief Measures how spread out neighbouring slots are.
+	 * \return The average distance between particles in consecutive slots,
+	 * in multiples of the particle radius.
+	 */
+	static float MeasureLocality(
+		const SimFloat4 *positions, uint particleCount, float particleRadius
+	);
+
+	/**
+	 * \brief Works out the sorted order of the particles and copies them into
+	 * it.
+	 */
+	void Prepare(
+		const SimFloat4 *positions,
+		const SimFloat3 *velocities,
+		const int *phases,
+		uint particleCount,
+		float particleRadius
+	);
+
+	/**
+	 * \brief Forgets the prepared reorder, either because it was applied or
+	 * because the particles it was prepared from are gone.
+	 */
+	void Clear();
+
+	[[nodiscard]] bool IsPending() const;
+
+	[[nodiscard]] uint GetParticleCount() const;
+	/**
+	 * \brief For each slot, the slot its particle was in before sorting.
+	 */
+	[[nodiscard]] const uint *GetPreviousSlots() const;
+	[[nodiscard]] const SimFloat4 *GetPositions() const;
+	[[nodiscard]] const SimFloat3 *GetVelocities() const;
+	[[nodiscard]] const int *GetPhases() const;
+};
+
+#endif	// GELLY_CPARTICLEREORDERER_H
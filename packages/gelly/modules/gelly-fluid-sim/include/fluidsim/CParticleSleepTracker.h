@@ -0,0 +1,97 @@
+#ifndef GELLY_CPARTICLESLEEPTRACKER_H
+#define GELLY_CPARTICLESLEEPTRACKER_H
+
+#include <GellyDataTypes.h>
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "ISimData.h"
+
+using namespace Gelly::DataTypes;
+
+/**
+ * \brief Decides which particles have settled enough to be left out of the
+ * solver entirely.
+ *
+ * A particle falls asleep after staying under the sleep speed for a number of
+ * consecutive checks. Sleeping particles wake back up when a moving particle
+ * gets within a grid cell of them, or when a collider that moved overlaps
+ * them.
+ *
+ * \note Particles the tracker hasn't seen yet (like ones added since the last
+ * check) are always considered awake.
+ */
+class CParticleSleepTracker {
+private:
+	struct ColliderDisturbance {
+		SimFloat3 position;
+		float radius;
+	};
+
+	uint8_t checksToSleep;
+	std::vector<uint8_t> stillChecks;
+	std::vector<uint8_t> asleep;
+	std::vector<uint8_t> remapScratch;
+	uint sleepingCount = 0;
+	bool activeSetChanged = false;
+
+	float cellSize = 1.f;
+	std::unordered_set<uint64_t> disturbedCells;
+	std::vector<ColliderDisturbance> colliderDisturbances;
+
+	[[nodiscard]] uint64_t GetCellKey(int x, int y, int z) const;
+	void DisturbAround(const SimFloat4 &position);
+	[[nodiscard]] bool IsDisturbed(const SimFloat4 &position) const;
+
+public:
+	explicit CParticleSleepTracker(uint8_t checksToSleep);
+
+	/**
+	 * \brief Wakes every particle and forgets everything known about them.
+	 */
+	void Reset();
+
+	/**
+	 * \brief Makes sure everything near the collider gets woken up during the
+	 * next check.
+	 */
+	void DisturbCollider(const SimFloat3 &position, float radius);
+
+	/**
+	 * \brief Runs a check over particles read back from the simulation.
+	 * \param sleepSpeed Particles slower than this are considered still.
+	 * \param wakeDistance How close a moving particle has to be to wake a
+	 * sleeping one, roughly.
+	 */
+	void Check(
+		const SimFloat4 *positions,
+		const SimFloat3 *velocities,
+		uint particleCount,
+		float sleepSpeed,
+		float wakeDistance
+	);
+
+	/**
+	 * \brief Moves what's known about each particle along with it.
+	 * \param previousSlots For each slot, the slot its particle was in before.
+	 */
+	void Remap(const uint *previousSlots, uint particleCount);
+
+	/**
+	 * \brief Whether the set of awake particles changed since the last call to
+	 * FillActiveIndices.
+	 */
+	[[nodiscard]] bool HasActiveSetChanged() const;
+	[[nodiscard]] uint GetSleepingCount() const;
+
+	/**
+	 * \brief Writes out the indices of every awake particle, in order.
+	 * \param indices Must have room for particleCount indices.
+	 * \return How many indices were written.
+	 */
+	uint FillActiveIndices(uint *indices, uint particleCount);
+};
+
+#endif	// GELLY_CPARTICLESLEEPTRACKER_H
@@ -0,0 +1,69 @@
+#ifndef GELLY_CRECORDINGFLUIDSIMULATION_H
+#define GELLY_CRECORDINGFLUIDSIMULATION_H
+
+#include <filesystem>
+#include <memory>
+
+#include "CRecordingSimScene.h"
+#include "CSimTraceWriter.h"
+#include "IFluidSimulation.h"
+
+/**
+ * \brief Wraps another simulation and, while recording, writes every executed
+ * command list, scene mutation and update to a trace file. The trace can be
+ * played back on any simulation with CSimTraceReplayer, which makes gameplay
+ * workloads reproducible outside of the game.
+ * \note Nothing is written until StartRecording is called, so this can stay
+ * wrapped around a simulation permanently. Objects that were created before
+ * recording started are not part of the trace, so start recording before
+ * loading the map to capture the world.
+ */
+class CRecordingFluidSimulation : public IFluidSimulation {
+private:
+	IFluidSimulation *sim;
+	CRecordingSimScene scene;
+	std::unique_ptr<CSimTraceWriter> writer;
+
+public:
+	/**
+	 * \param sim The simulation to record, ownership is taken.
+	 */
+	explicit CRecordingFluidSimulation(IFluidSimulation *sim);
+	~CRecordingFluidSimulation() override;
+
+	void StartRecording(const std::filesystem::path &path);
+	void StopRecording();
+	[[nodiscard]] bool IsRecording() const;
+
+	void SetMaxParticles(int maxParticles) override;
+	void Initialize() override;
+
+	ISimData *GetSimulationData() override;
+	ISimScene *GetScene() override;
+	SimContextAPI GetComputeAPI() override;
+
+	void AttachToContext(GellyObserverPtr<ISimContext> context) override;
+
+	ISimCommandList *CreateCommandList() override;
+	void DestroyCommandList(ISimCommandList *commandList) override;
+	void ExecuteCommandList(ISimCommandList *commandList) override;
+	ISimCommandList *BeginCommandList() override;
+	void SubmitCommandList(ISimCommandList *commandList) override;
+
+	void Update(float deltaTime) override;
+	void KickUpdate(float deltaTime) override;
+	void WaitForResult() override;
+	void SetTimeStepMultiplier(float timeStepMultiplier) override;
+
+	const char *GetComputeDeviceName() override;
+	bool CheckFeatureSupport(GELLY_FEATURE feature) override;
+
+	void VisitLatestContactPlanes(ContactPlaneVisitor visitor) override;
+	void SetQualitySettings(const SimQualitySettings &settings) override;
+	SimQualityStatus GetQualityStatus() override;
+	float GetParticleLocality() override;
+	void CaptureSnapshot(CSimSnapshot &snapshot) override;
+	bool GetParticleBounds(float lower[3], float upper[3]) override;
+};
+
+#endif	// GELLY_CRECORDINGFLUIDSIMULATION_H
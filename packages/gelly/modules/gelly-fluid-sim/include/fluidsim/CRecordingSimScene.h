@@ -0,0 +1,50 @@
+#ifndef GELLY_CRECORDINGSIMSCENE_H
+#define GELLY_CRECORDINGSIMSCENE_H
+
+#include "ISimScene.h"
+
+class CSimTraceWriter;
+
+/**
+ * \brief Forwards everything to another scene, writing each mutation to a
+ * trace while one is attached.
+ * \note The wrapped scene isn't owned, simulations are free to recreate their
+ * scene whenever they're initialized so it has to be re-targeted afterwards.
+ */
+class CRecordingSimScene : public ISimScene {
+private:
+	ISimScene *scene = nullptr;
+	CSimTraceWriter *writer = nullptr;
+
+public:
+	CRecordingSimScene() = default;
+	~CRecordingSimScene() override = default;
+
+	void SetScene(ISimScene *scene);
+	void SetWriter(CSimTraceWriter *writer);
+
+	ObjectHandle CreateObject(const ObjectCreationParams &params) override;
+	void RemoveObject(ObjectHandle handle) override;
+	void SetObjectEnabled(ObjectHandle handle, bool enabled) override;
+
+	void SetObjectPosition(ObjectHandle handle, float x, float y, float z)
+		override;
+
+	void SetObjectQuaternion(
+		ObjectHandle handle, float x, float y, float z, float w
+	) override;
+
+	void SetObjectTransforms(
+		const ObjectHandle *handles,
+		const ObjectTransform *transforms,
+		uint objectCount
+	) override;
+
+	DrainHandle CreateDrain(const DrainCreationParams &params) override;
+	void RemoveDrain(DrainHandle handle) override;
+	uint GetDrainedParticleCount(DrainHandle handle) override;
+
+	void Update() override;
+};
+
+#endif	// GELLY_CRECORDINGSIMSCENE_H
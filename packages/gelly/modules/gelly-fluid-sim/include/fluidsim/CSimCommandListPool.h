@@ -0,0 +1,73 @@
+#ifndef CSIMCOMMANDLISTPOOL_H
+#define CSIMCOMMANDLISTPOOL_H
+
+#include <memory>
+#include <vector>
+
+#include "CSimpleSimCommandList.h"
+
+/**
+ * \brief Owns every command list a simulation hands out.
+ *
+ * Lists made with Create live until they're destroyed or the pool goes away.
+ * Lists taken with Acquire are recycled once released, and since clearing a
+ * list keeps its storage around, recording the same amount of commands again
+ * doesn't touch the heap.
+ */
+class CSimCommandListPool {
+private:
+	using CommandListPtr = std::unique_ptr<CSimpleSimCommandList>;
+
+	SimCommandType supportedCommands;
+
+	std::vector<CommandListPtr> createdLists;
+	std::vector<CommandListPtr> pooledLists;
+	std::vector<CSimpleSimCommandList *> freeLists;
+
+public:
+	explicit CSimCommandListPool(SimCommandType supportedCommands);
+	~CSimCommandListPool() = default;
+
+	CSimCommandListPool(const CSimCommandListPool &) = delete;
+	CSimCommandListPool &operator=(const CSimCommandListPool &) = delete;
+
+	[[nodiscard]] ISimCommandList *Create();
+	/**
+	 * \brief Destroys a list made with Create.
+	 * \note Null is ignored, but throws if the list isn't owned by this pool,
+	 * which usually means it was destroyed twice.
+	 */
+	void Destroy(ISimCommandList *commandList);
+
+	/**
+	 * \brief Hands out an empty list from the pool, only allocating if every
+	 * pooled list is currently in use.
+	 */
+	[[nodiscard]] ISimCommandList *Acquire();
+	/**
+	 * \brief Clears a list made with Acquire and puts it back in the pool.
+	 * \note Throws if the list wasn't acquired from this pool.
+	 */
+	void Release(ISimCommandList *commandList);
+
+	/**
+	 * \brief Executes a list made with Acquire and releases it, which
+	 * happens even if executing it throws so the list isn't lost to the pool.
+	 */
+	template <typename Execute>
+	void ExecuteAndRelease(ISimCommandList *commandList, Execute &&execute) {
+		try {
+			execute(commandList);
+		} catch (...) {
+			if (commandList != nullptr) {
+				Release(commandList);
+			}
+
+			throw;
+		}
+
+		Release(commandList);
+	}
+};
+
+#endif	// CSIMCOMMANDLISTPOOL_H
@@ -0,0 +1,54 @@
+#ifndef GELLY_CSIMQUALITYCONTROLLER_H
+#define GELLY_CSIMQUALITYCONTROLLER_H
+
+#include "SimQuality.h"
+
+/**
+ * \brief Picks solver iterations and substeps that keep a simulation step
+ * within its time budget.
+ *
+ * Quality drops quickly once steps run over budget, and only comes back after
+ * they've had plenty of headroom for a while, so it doesn't flip back and
+ * forth around the budget. Iterations are traded away before substeps, since
+ * substeps matter more for stability.
+ */
+class CSimQualityController {
+private:
+	// Consecutive samples needed before changing quality in either direction
+	static constexpr int downgradeSamples = 5;
+	static constexpr int upgradeSamples = 120;
+	// Steps have to fit in this fraction of the budget before upgrading
+	static constexpr float upgradeHeadroom = 0.6f;
+	static constexpr float smoothingFactor = 0.2f;
+
+	SimQualitySettings settings;
+	int iterations = 0;
+	int substeps = 0;
+
+	float smoothedStepTimeMs = 0.f;
+	int samplesOverBudget = 0;
+	int samplesUnderBudget = 0;
+
+	void Downgrade();
+	void Upgrade();
+
+public:
+	explicit CSimQualityController(const SimQualitySettings &settings);
+
+	/**
+	 * \brief Applies new bounds, quality is reset to the maximum.
+	 */
+	void SetSettings(const SimQualitySettings &settings);
+
+	/**
+	 * \brief Feeds in how long a single step took.
+	 * \return True if the iterations or substeps changed.
+	 */
+	bool AddSample(float stepTimeMs);
+
+	[[nodiscard]] int GetIterations() const;
+	[[nodiscard]] int GetSubsteps() const;
+	[[nodiscard]] SimQualityStatus GetStatus() const;
+};
+
+#endif	// GELLY_CSIMQUALITYCONTROLLER_H
@@ -0,0 +1,81 @@
+#ifndef GELLY_CSIMSNAPSHOT_H
+#define GELLY_CSIMSNAPSHOT_H
+
+#include <GellyDataTypes.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <vector>
+
+#include "ISimData.h"
+#include "ISimScene.h"
+
+using namespace Gelly::DataTypes;
+
+class IFluidSimulation;
+
+/**
+ * \brief A copy of everything needed to put a simulation back into the state
+ * it was captured in. Snapshots aren't tied to the backend which captured
+ * them, they're restored through plain command lists.
+ *
+ * \note Materials are stored per particle, but the simulation doesn't know
+ * about them. Whoever owns the material data fills in absorptions.
+ */
+class CSimSnapshot {
+public:
+	enum class Quantization : uint8_t {
+		NONE,
+		/**
+		 * Positions and velocities are stored as 16-bit fixed point within
+		 * the range they span, which is well under a particle radius for any
+		 * sensibly sized scene.
+		 */
+		BITS_16,
+	};
+
+	struct ColliderTransform {
+		ObjectHandle handle;
+		float position[3];
+		float rotation[4];
+	};
+
+	std::vector<SimFloat4> positions;
+	std::vector<SimFloat3> velocities;
+	std::vector<int> phases;
+	// Either empty, or one per particle
+	std::vector<SimFloat3> absorptions;
+	std::vector<ColliderTransform> colliders;
+
+	CSimSnapshot() = default;
+
+	void Clear();
+	[[nodiscard]] uint GetParticleCount() const;
+
+	/**
+	 * \brief Serializes the snapshot, works with files and string streams
+	 * alike.
+	 */
+	void Write(
+		std::ostream &stream, Quantization quantization = Quantization::NONE
+	) const;
+	void Read(std::istream &stream);
+
+	void WriteToFile(
+		const std::filesystem::path &path,
+		Quantization quantization = Quantization::NONE
+	) const;
+	void ReadFromFile(const std::filesystem::path &path);
+
+	/**
+	 * \brief Replaces every particle in the simulation with the captured ones.
+	 * Particles past the simulation's capacity are dropped.
+	 * \param restoreColliders Whether to move the captured objects back. The
+	 * handles have to refer to the same objects as when this was captured,
+	 * so this is only useful within the same scene.
+	 */
+	void Restore(IFluidSimulation *sim, bool restoreColliders) const;
+};
+
+#endif	// GELLY_CSIMSNAPSHOT_H
@@ -0,0 +1,40 @@
+#ifndef GELLY_CSIMSTEPCONTROLLER_H
+#define GELLY_CSIMSTEPCONTROLLER_H
+
+/**
+ * \brief Turns variable frame times into a whole number of fixed simulation
+ * steps. Leftover time is carried over to the next frame, and the number of
+ * steps per frame is capped, so a slow frame can't snowball into even slower
+ * ones.
+ * \note This doesn't know anything about the simulation itself, it only
+ * decides how many steps to run and how far rendering is into the next one.
+ */
+class CSimStepController {
+private:
+	float fixedDeltaTime;
+	int maxStepsPerFrame;
+	float accumulator = 0.f;
+
+public:
+	/**
+	 * \param fixedDeltaTime Length of a single simulation step in seconds.
+	 * \param maxStepsPerFrame Time past this many steps is dropped.
+	 */
+	CSimStepController(float fixedDeltaTime, int maxStepsPerFrame);
+
+	/**
+	 * \brief Adds the frame's time to the accumulator.
+	 * \return How many fixed steps should be simulated this frame.
+	 */
+	int Advance(float deltaTime);
+
+	/**
+	 * \return How far the leftover time is into the next step, from 0 to 1.
+	 */
+	[[nodiscard]] float GetInterpolationAlpha() const;
+	[[nodiscard]] float GetFixedDeltaTime() const;
+
+	void Reset();
+};
+
+#endif	// GELLY_CSIMSTEPCONTROLLER_H
@@ -0,0 +1,70 @@
+#ifndef GELLY_CSIMTRACEREPLAYER_H
+#define GELLY_CSIMTRACEREPLAYER_H
+
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "IFluidSimulation.h"
+#include "SimTrace.h"
+
+/**
+ * \brief Plays a trace written by CRecordingFluidSimulation back onto any
+ * simulation, one recorded update at a time.
+ * \note The target simulation has to be initialized already, and should have
+ * at least GetMaxParticles() particles to reproduce the recording faithfully.
+ * Object handles are remapped to whatever the target's scene hands out, and
+ * records for objects the trace never created are skipped.
+ */
+class CSimTraceReplayer {
+private:
+	std::ifstream stream;
+	SimTrace::Header header{};
+	uint framesReplayed = 0;
+
+	std::unordered_map<ObjectHandle, ObjectHandle> objectHandles;
+	std::unordered_map<DrainHandle, DrainHandle> drainHandles;
+
+	// Reused between command lists so replaying doesn't allocate every frame
+	ISimCommandList::CommandVec commands;
+	std::vector<SimFloat4> batchPositions;
+	std::vector<SimFloat3> batchVelocities;
+	std::vector<int> batchPhases;
+	std::vector<float> meshVertices;
+	std::vector<uint8_t> meshIndices;
+
+	template <typename T>
+	T Read() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		T value;
+		ReadBytes(&value, sizeof(T));
+		return value;
+	}
+
+	void ReadBytes(void *destination, size_t size);
+
+	void ReplayCommandList(IFluidSimulation *sim);
+	void ReplayCreateObject(ISimScene *scene);
+	[[nodiscard]] ObjectHandle ReadObjectHandle();
+	void ReplayCreateDrain(ISimScene *scene);
+
+public:
+	explicit CSimTraceReplayer(const std::filesystem::path &path);
+	~CSimTraceReplayer() = default;
+
+	CSimTraceReplayer(const CSimTraceReplayer &) = delete;
+	CSimTraceReplayer &operator=(const CSimTraceReplayer &) = delete;
+
+	[[nodiscard]] int GetMaxParticles() const;
+	[[nodiscard]] uint GetFramesReplayed() const;
+
+	/**
+	 * \brief Replays every record up to and including the next update.
+	 * \return False once the end of the trace has been reached.
+	 */
+	bool ReplayFrame(IFluidSimulation *sim);
+};
+
+#endif	// GELLY_CSIMTRACEREPLAYER_H
@@ -0,0 +1,74 @@
+#ifndef GELLY_CSIMTRACEWRITER_H
+#define GELLY_CSIMTRACEWRITER_H
+
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#include "ISimCommandList.h"
+#include "ISimScene.h"
+#include "SimTrace.h"
+
+/**
+ * \brief Serializes everything that changes a simulation's state into a
+ * binary trace, which can be played back later by CSimTraceReplayer.
+ * \note Each write goes straight to the file stream, nothing is buffered
+ * beyond what the stream does on its own.
+ */
+class CSimTraceWriter {
+private:
+	std::ofstream stream;
+
+	template <typename T>
+	void Write(const T &value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	void WriteArray(const T *values, size_t count) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		stream.write(
+			reinterpret_cast<const char *>(values), sizeof(T) * count
+		);
+	}
+
+	void WriteCommand(const SimCommand &command);
+
+public:
+	CSimTraceWriter(const std::filesystem::path &path, int maxParticles);
+	~CSimTraceWriter() = default;
+
+	CSimTraceWriter(const CSimTraceWriter &) = delete;
+	CSimTraceWriter &operator=(const CSimTraceWriter &) = delete;
+
+	void WriteCommandList(ISimCommandList *commandList);
+
+	/**
+	 * \param handle The handle the live scene gave the object, the replayer
+	 * uses it to match up the records that refer to it later on.
+	 */
+	void WriteCreateObject(
+		ObjectHandle handle, const ObjectCreationParams &params
+	);
+
+	void WriteRemoveObject(ObjectHandle handle);
+	void WriteObjectEnabled(ObjectHandle handle, bool enabled);
+	void WriteObjectPosition(ObjectHandle handle, float x, float y, float z);
+	void WriteObjectQuaternion(
+		ObjectHandle handle, float x, float y, float z, float w
+	);
+
+	void WriteCreateDrain(
+		DrainHandle handle, const DrainCreationParams &params
+	);
+	void WriteRemoveDrain(DrainHandle handle);
+
+	void WriteSceneUpdate();
+	void WriteUpdate(float deltaTime);
+	void WriteTimeStepMultiplier(float timeStepMultiplier);
+
+	void Flush();
+};
+
+#endif	// GELLY_CSIMTRACEWRITER_H
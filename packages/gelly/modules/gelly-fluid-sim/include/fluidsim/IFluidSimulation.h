@@ -6,12 +6,14 @@
 #include <functional>
 
 #include "GellyInterface.h"
+#include "CSimSnapshot.h"
 #include "GellyObserverPtr.h"
 #include "IFeatureQuery.h"
 #include "ISimCommandList.h"
 #include "ISimContext.h"
 #include "ISimData.h"
 #include "ISimScene.h"
+#include "SimQuality.h"
 
 using namespace DirectX;
 
@@ -29,6 +31,12 @@ public:
 
 	virtual ~IFluidSimulation() = default;
 
+	/**
+	 * \brief Sets how many particles the simulation may hold.
+	 * \note Simulations supporting FLUIDSIM_LIVE_RESIZE can also be resized
+	 * after initialization. Existing particles and scene objects are kept,
+	 * but any linked buffers must already be big enough.
+	 */
 	virtual void SetMaxParticles(int maxParticles) = 0;
 	/**
 	 * \brief Signals to the underlying simulation that it should initialize.
@@ -66,15 +74,50 @@ public:
 	virtual void DestroyCommandList(ISimCommandList * commandList) = 0;
 	virtual void ExecuteCommandList(ISimCommandList * commandList) = 0;
 
+	/**
+	 * \brief Hands out an empty command list from the simulation's pool.
+	 * Pooled lists keep their capacity between uses, so something that records
+	 * commands every tick won't allocate once it has warmed up.
+	 * \note The list must be given back with SubmitCommandList, and must not be
+	 * used after that.
+	 * \return An empty command list.
+	 */
+	virtual ISimCommandList *BeginCommandList() = 0;
+	/**
+	 * \brief Executes a list from BeginCommandList and returns it to the pool.
+	 * \param commandList The command list to execute.
+	 */
+	virtual void SubmitCommandList(ISimCommandList * commandList) = 0;
+
 	/**
 	 * \brief Will throw if the simulation data buffers are not linked.
 	 * \param deltaTime Time since last update in seconds. It's highly
 	 * preferable to keep this constant. Most simulations will require a
 	 * constant delta time to function properly. It's also known as the "fixed
 	 * time step".
+	 * \note Simulations may instead accumulate the time and advance in fixed
+	 * steps of their own, see CSimStepController. They report how far they are
+	 * into the next step through ISimData::GetInterpolationAlpha.
 	 */
 	virtual void Update(float deltaTime) = 0;
 
+	/**
+	 * \brief Starts an update without waiting for its results, so the caller
+	 * can get on with other work (like rendering) while the simulation runs.
+	 * Equivalent to Update when followed immediately by WaitForResult.
+	 * \note Only one update can be in flight, kicking another one waits for
+	 * the previous one first. Command lists executed while an update is in
+	 * flight apply to the next one.
+	 * \param deltaTime Same as in Update.
+	 */
+	virtual void KickUpdate(float deltaTime) = 0;
+	/**
+	 * \brief Blocks until the update started by KickUpdate has finished, and
+	 * publishes its results (like the foam particle count) to the simulation
+	 * data. Does nothing if no update is in flight.
+	 */
+	virtual void WaitForResult() = 0;
+
 	/**
 	 * \brief Sets the time step multiplier for the simulation, which may or may
 	 * not invoke a recompile of the simulation's parameters. (could mean a gpu
@@ -89,6 +132,38 @@ public:
 
 	// Past this point is mainly feature-specific stuff.
 	virtual void VisitLatestContactPlanes(ContactPlaneVisitor visitor) = 0;
+
+	/**
+	 * \brief Sets the bounds the simulation may scale its solver quality
+	 * within to stay inside its time budget.
+	 * \note Requires FLUIDSIM_ADAPTIVE_QUALITY, ignored otherwise.
+	 */
+	virtual void SetQualitySettings(const SimQualitySettings &settings) = 0;
+	virtual SimQualityStatus GetQualityStatus() = 0;
+
+	/**
+	 * \brief Average distance between particles in neighbouring slots, in
+	 * particle radii. Lower means particles which are close together are also
+	 * close in memory.
+	 * \note Requires FLUIDSIM_PARTICLE_REORDERING, returns 0 otherwise.
+	 */
+	virtual float GetParticleLocality() = 0;
+
+	/**
+	 * \brief Copies every particle and the transforms of every object in the
+	 * scene into the snapshot. Snapshots are restored with
+	 * CSimSnapshot::Restore, into any simulation.
+	 * \note Requires FLUIDSIM_SNAPSHOTS, the snapshot is left empty otherwise.
+	 */
+	virtual void CaptureSnapshot(CSimSnapshot &snapshot) = 0;
+
+	/**
+	 * \brief Gets the box around every particle as of the last result, which
+	 * trails the particles by a step like the foam particle count.
+	 * \return False if there are no particles, or the bounds aren't known.
+	 * \note Requires FLUIDSIM_PARTICLE_BOUNDS, returns false otherwise.
+	 */
+	virtual bool GetParticleBounds(float lower[3], float upper[3]) = 0;
 };
 
 #endif	// GELLY_IFLUIDSIMULATION_H
@@ -0,0 +1,52 @@
+#ifndef IPARTICLESTAGINGBACKEND_H
+#define IPARTICLESTAGINGBACKEND_H
+
+#include <GellyDataTypes.h>
+#include <GellyInterface.h>
+
+#include "ISimData.h"
+
+using namespace Gelly::DataTypes;
+
+/**
+ * \brief Host memory of a staging slot, valid while the slot is mapped.
+ */
+struct ParticleStagingView {
+	SimFloat4 *positions;
+	SimFloat3 *velocities;
+	int *phases;
+	uint *actives;
+};
+
+/**
+ * \brief Owns the host buffers CFlexParticleStagingRing writes into, and
+ * copies them over to the solver.
+ */
+gelly_interface IParticleStagingBackend {
+public:
+	using SlotHandle = uint;
+
+	virtual ~IParticleStagingBackend() = default;
+
+	/**
+	 * \brief Allocates host buffers for up to capacity particles.
+	 */
+	virtual SlotHandle CreateSlot(uint capacity) = 0;
+	virtual void DestroySlot(SlotHandle slot) = 0;
+
+	/**
+	 * \brief Maps the slot for writing, waiting on any upload that's still
+	 * reading from it.
+	 */
+	virtual ParticleStagingView MapSlot(SlotHandle slot) = 0;
+	virtual void UnmapSlot(SlotHandle slot) = 0;
+
+	/**
+	 * \brief Copies the first count particles of an unmapped slot into the
+	 * solver, starting at firstParticle, along with their active indices.
+	 */
+	virtual void UploadSlot(SlotHandle slot, uint firstParticle, uint count) =
+		0;
+};
+
+#endif	// IPARTICLESTAGINGBACKEND_H
@@ -1,11 +1,14 @@
 #ifndef ISIMCOMMANDLIST_H
 #define ISIMCOMMANDLIST_H
 
+#include <GellyDataTypes.h>
 #include <GellyInterface.h>
 
 #include <variant>
 #include <vector>
 
+#include "ISimData.h"
+
 namespace Gelly {
 namespace SimCommands {
 struct AddParticle {
@@ -13,6 +16,30 @@ struct AddParticle {
 	float vx, vy, vz;
 };
 
+/**
+ * \brief Adds many particles at once. Each attribute is stored in its own
+ * tightly packed array, so the simulation can copy a whole batch straight into
+ * its particle buffers.
+ */
+struct AddParticleBatch {
+	/**
+	 * \brief None of these arrays are copied or modified when the command is
+	 * added. It is up to the caller to ensure that they stay valid until the
+	 * command list has been executed.
+	 * \note The w component of each position is ignored, the simulation gives
+	 * every particle its own inverse mass.
+	 */
+	const SimFloat4 *positions;
+	const SimFloat3 *velocities;
+	/**
+	 * \brief Optional, every particle is given the default fluid phase if this
+	 * is null.
+	 */
+	const int *phases;
+
+	DataTypes::uint particleCount;
+};
+
 struct ChangeRadius {
 	float radius;
 };
@@ -32,12 +59,19 @@ enum SimCommandType {
 	ADD_PARTICLE = 0b0001,
 	CHANGE_RADIUS = 0b0010,
 	RESET = 0b0100,
-	SET_FLUID_PROPERTIES = 0b1000
+	SET_FLUID_PROPERTIES = 0b1000,
+	ADD_PARTICLE_BATCH = 0b10000
 };
 
 struct SimCommand {
 	SimCommandType type;
-	std::variant<AddParticle, Reset, ChangeRadius, SetFluidProperties> data;
+	std::variant<
+		AddParticle,
+		Reset,
+		ChangeRadius,
+		SetFluidProperties,
+		AddParticleBatch>
+		data;
 };
 }  // namespace SimCommands
 }  // namespace Gelly
@@ -49,7 +83,8 @@ using namespace Gelly::SimCommands;
  * simulation fast. This is used for making things such as particle emitters,
  * particle attractors, and other things that need to be updated every frame.
  * \note It's recommended to keep a single command list for each type of
- * action you want to perform rather than to make one every frame.
+ * action you want to perform rather than to make one every frame, or to use
+ * the simulation's pooled lists through BeginCommandList.
  */
 gelly_interface ISimCommandList {
 public:
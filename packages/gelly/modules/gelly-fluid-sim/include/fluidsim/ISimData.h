@@ -1,10 +1,17 @@
 #ifndef GELLY_ISIMDATA_H
 #define GELLY_ISIMDATA_H
 
+#include <cstdint>
+#include <functional>
+
 #include "GellyInterface.h"
 #include "ISimContext.h"
 
 namespace Gelly {
+struct SimFloat3 {
+	float x, y, z;
+};
+
 struct SimFloat4 {
 	float x, y, z, w;
 };
@@ -17,14 +24,32 @@ enum class SimBufferType {
 	// Basis vectors for oriented ellipsoid surface extraction
 	ANISOTROPY_Q1,
 	ANISOTROPY_Q2,
-	ANISOTROPY_Q3
+	ANISOTROPY_Q3,
+	// Positions from the step before the latest one, used to interpolate
+	// between fixed time steps when rendering
+	PREVIOUS_POSITION
 };
+
+/**
+ * \brief Identifies a particle for as long as it's alive, no matter which
+ * slot of the particle buffers it ends up in.
+ */
+using ParticleId = uint32_t;
+constexpr ParticleId INVALID_PARTICLE_ID = 0xFFFFFFFF;
+constexpr uint32_t INVALID_PARTICLE_SLOT = 0xFFFFFFFF;
 }  // namespace Gelly
 
 using namespace Gelly;
 
 gelly_interface ISimData {
 public:
+	/**
+	 * \brief Receives the slot each particle came from whenever particles are
+	 * moved between slots, along with how many particles are left.
+	 */
+	using ParticleRemapListener =
+		std::function<void(const uint32_t *previousSlots, int particleCount)>;
+
 	/**
 	 * Destroys the underlying buffers.
 	 */
@@ -54,6 +79,50 @@ public:
 
 	virtual void SetActiveParticles(int activeParticles) = 0;
 	virtual int GetActiveParticles() = 0;
+
+	/**
+	 * \brief How far along the render frame is between the previous and the
+	 * latest simulation step, from 0 to 1. Renderers should blend from the
+	 * PREVIOUS_POSITION buffer to the POSITION buffer by this amount.
+	 * \note Simulations that don't step at a fixed rate leave this at 1.
+	 */
+	virtual void SetInterpolationAlpha(float alpha) = 0;
+	virtual float GetInterpolationAlpha() = 0;
+
+	/**
+	 * \brief Turns the stable particle ID channel on or off. While it's on,
+	 * every particle is given an ID which follows it around as the simulation
+	 * reorders or removes particles.
+	 * \note Particles which are already alive are given IDs in slot order.
+	 */
+	virtual void SetParticleIdsEnabled(bool enabled) = 0;
+	virtual bool AreParticleIdsEnabled() = 0;
+
+	/**
+	 * \return INVALID_PARTICLE_ID if IDs are disabled or the slot is empty.
+	 */
+	virtual ParticleId GetParticleId(int slot) = 0;
+	/**
+	 * \return INVALID_PARTICLE_SLOT if IDs are disabled or the particle is
+	 * gone.
+	 */
+	virtual uint32_t GetParticleSlot(ParticleId id) = 0;
+
+	/**
+	 * \brief Used by simulations to report that particles moved between slots,
+	 * which also sets the active particle count.
+	 * \param previousSlots For each slot, the slot its particle was in before.
+	 * Slots that aren't mentioned anywhere lose their particle.
+	 */
+	virtual void RemapParticles(
+		const uint32_t *previousSlots, int particleCount
+	) = 0;
+
+	/**
+	 * \brief Anything stored per slot outside of the simulation, like
+	 * absorption, has to be moved along with the particles through this.
+	 */
+	virtual void SetParticleRemapListener(ParticleRemapListener listener) = 0;
 };
 
 #endif	// GELLY_ISIMDATA_H
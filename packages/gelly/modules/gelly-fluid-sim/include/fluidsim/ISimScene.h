@@ -13,6 +13,9 @@ namespace Gelly {
 enum class ObjectShape : uint8_t {
 	TRIANGLE_MESH,
 	CAPSULE,
+	CONVEX,
+	SPHERE,
+	BOX,
 };
 
 struct ObjectCreationParams {
@@ -46,21 +49,106 @@ struct ObjectCreationParams {
 		float halfHeight;
 	};
 
+	/**
+	 * \brief A convex polyhedron, described by the planes bounding it.
+	 */
+	struct Convex {
+		/**
+		 * \brief Four floats per plane, (nx, ny, nz, w), where every point
+		 * inside satisfies dot(n, p) + w <= 0. Like the triangle mesh arrays,
+		 * this is not copied.
+		 */
+		const float *planes;
+		uint planeCount;
+
+		float lower[3];
+		float upper[3];
+		float scale[3];
+	};
+
+	/**
+	 * \brief A sphere, which doesn't have to be centered on the object's
+	 * origin.
+	 */
+	struct Sphere {
+		float radius;
+		// In the object's frame
+		float center[3];
+	};
+
+	/**
+	 * \brief A box, which may be moved and turned away from the object's
+	 * origin.
+	 */
+	struct Box {
+		float halfExtents[3];
+		// In the object's frame
+		float center[3];
+		/**
+		 * \brief Quaternion from the box's frame to the object's, in x, y,
+		 * z, w order.
+		 */
+		float rotation[4];
+	};
+
 	ObjectShape shape = ObjectShape::TRIANGLE_MESH;
-	std::variant<TriangleMesh, Capsule> shapeData;
+	std::variant<TriangleMesh, Capsule, Convex, Sphere, Box> shapeData;
 };
 
 using ObjectHandle = uint;
 
+struct ObjectTransform {
+	float position[3];
+	/**
+	 * \brief Quaternion, in x, y, z, w order.
+	 */
+	float rotation[4];
+};
+
 constexpr ObjectHandle INVALID_OBJECT_HANDLE = 0xFFFFFFFF;
+
+enum class DrainShape : uint8_t {
+	AABB,
+	SPHERE,
+	PLANE,
+};
+
+struct DrainCreationParams {
+	struct AABB {
+		float min[3];
+		float max[3];
+	};
+
+	struct Sphere {
+		float center[3];
+		float radius;
+	};
+
+	/**
+	 * \brief Drains everything behind the plane, which is every point p with
+	 * dot(normal, p) < distance.
+	 */
+	struct Plane {
+		float normal[3];
+		float distance;
+	};
+
+	DrainShape shape = DrainShape::AABB;
+	std::variant<AABB, Sphere, Plane> shapeData;
+};
+
+using DrainHandle = uint;
+
+constexpr DrainHandle INVALID_DRAIN_HANDLE = 0xFFFFFFFF;
 }  // namespace Gelly
 
 using namespace Gelly;
 
 /**
  * This abstraction allows the user to add objects to the simulation.
- * Currently, this only allows for triangle meshes and capsules. Convex hulls
- * are not supported.
+ * Objects can be triangle meshes, convex polyhedra, capsules, spheres or boxes.
+ * Convex objects are much cheaper for the fluid to collide with than triangle
+ * meshes, and spheres and boxes are cheaper still.
  */
 gelly_interface ISimScene {
 public:
@@ -68,6 +156,12 @@ public:
 
 	virtual ObjectHandle CreateObject(const ObjectCreationParams &params) = 0;
 	virtual void RemoveObject(ObjectHandle handle) = 0;
+	/**
+	 * \brief Takes an object out of the simulation without destroying it, so
+	 * that it can be put back cheaply. Objects are created enabled.
+	 * \note Disabled objects keep their transforms up to date.
+	 */
+	virtual void SetObjectEnabled(ObjectHandle handle, bool enabled) = 0;
 
 	virtual void SetObjectPosition(
 		ObjectHandle handle, float x, float y, float z
@@ -77,6 +171,33 @@ public:
 		ObjectHandle handle, float x, float y, float z, float w
 	) = 0;
 
+	/**
+	 * \brief Moves many objects at once, which is much cheaper than setting
+	 * each transform on its own.
+	 * \note Handles which don't belong to an object are skipped.
+	 */
+	virtual void SetObjectTransforms(
+		const ObjectHandle *handles,
+		const ObjectTransform *transforms,
+		uint objectCount
+	) = 0;
+
+	/**
+	 * \brief Adds a volume which removes any particle that ends up inside it.
+	 * \note Drains are evaluated by the simulation as it steps, so particles
+	 * can linger inside one for a few steps before they're removed.
+	 * \throws std::invalid_argument if the shape isn't finite, or is empty
+	 * (a box without volume, a sphere without radius or a plane without a
+	 * normal).
+	 */
+	virtual DrainHandle CreateDrain(const DrainCreationParams &params) = 0;
+	virtual void RemoveDrain(DrainHandle handle) = 0;
+	/**
+	 * \return How many particles the drain has removed since it was created,
+	 * or 0 if there's no such drain.
+	 */
+	virtual uint GetDrainedParticleCount(DrainHandle handle) = 0;
+
 	/**
 	 * \brief Updates the internal representation of the scene.
 	 * \note Different implementations may have different requirements for
@@ -0,0 +1,41 @@
+#ifndef GELLY_SIMQUALITY_H
+#define GELLY_SIMQUALITY_H
+
+namespace Gelly {
+/**
+ * \brief Bounds for the adaptive solver quality, see CSimQualityController.
+ */
+struct SimQualitySettings {
+	/**
+	 * \brief When disabled, the simulation always runs at the maximum
+	 * iterations and substeps.
+	 */
+	bool adaptive = true;
+	/**
+	 * \brief How long a single simulation step is allowed to take, in
+	 * milliseconds.
+	 */
+	float targetStepTimeMs = 4.f;
+
+	int minIterations = 1;
+	int maxIterations = 3;
+	int minSubsteps = 1;
+	int maxSubsteps = 3;
+};
+
+struct SimQualityStatus {
+	bool adaptive;
+	/**
+	 * \brief Smoothed time taken by a single simulation step, in milliseconds.
+	 */
+	float stepTimeMs;
+	float targetStepTimeMs;
+
+	int iterations;
+	int substeps;
+};
+}  // namespace Gelly
+
+using namespace Gelly;
+
+#endif	// GELLY_SIMQUALITY_H
@@ -0,0 +1,42 @@
+#ifndef GELLY_SIMTRACE_H
+#define GELLY_SIMTRACE_H
+
+#include <cstdint>
+
+namespace Gelly {
+/**
+ * \brief Layout of a simulation trace:
+ * - Header: magic, version and the max particle count of the recorded sim.
+ * - Records: a SimTraceRecord tag followed by that record's payload, until
+ * the end of the file.
+ *
+ * Everything is written in the host's native byte order, traces are meant
+ * to be replayed on the machine type they were recorded on.
+ */
+namespace SimTrace {
+constexpr uint32_t MAGIC = 0x43525447;	// "GTRC"
+constexpr uint32_t VERSION = 1;
+
+struct Header {
+	uint32_t magic;
+	uint32_t version;
+	int32_t maxParticles;
+};
+
+enum class Record : uint8_t {
+	EXECUTE_COMMAND_LIST,
+	CREATE_OBJECT,
+	REMOVE_OBJECT,
+	SET_OBJECT_POSITION,
+	SET_OBJECT_QUATERNION,
+	UPDATE_SCENE,
+	UPDATE,
+	SET_TIME_STEP_MULTIPLIER,
+	CREATE_DRAIN,
+	REMOVE_DRAIN,
+	SET_OBJECT_ENABLED,
+};
+}  // namespace SimTrace
+}  // namespace Gelly
+
+#endif	// GELLY_SIMTRACE_H
@@ -44,4 +44,10 @@ IFluidSimulation *Gelly::CreateD3D11FlexFluidSimulation(
 	return sim;
 }
 
+CRecordingFluidSimulation *Gelly::CreateRecordingFluidSimulation(
+	IFluidSimulation *sim
+) {
+	return new CRecordingFluidSimulation(sim);
+}
+
 void Gelly::DestroyGellyFluidSim(IFluidSimulation *sim) { delete sim; }
\ No newline at end of file
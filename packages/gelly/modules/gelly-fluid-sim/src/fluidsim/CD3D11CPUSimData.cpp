@@ -26,6 +26,9 @@ void CD3D11CPUSimData::LinkBuffer(SimBufferType type, void *buffer) {
 		case SimBufferType::ANISOTROPY_Q3:
 			anisotropyQ3Buffer = static_cast<ID3D11Buffer *>(buffer);
 			break;
+		case SimBufferType::PREVIOUS_POSITION:
+			previousPositionBuffer = static_cast<ID3D11Buffer *>(buffer);
+			break;
 	}
 }
 
@@ -45,6 +48,8 @@ bool CD3D11CPUSimData::IsBufferLinked(SimBufferType type) {
 			return anisotropyQ2Buffer != nullptr;
 		case SimBufferType::ANISOTROPY_Q3:
 			return anisotropyQ3Buffer != nullptr;
+		case SimBufferType::PREVIOUS_POSITION:
+			return previousPositionBuffer != nullptr;
 	}
 	return false;
 }
@@ -65,6 +70,8 @@ void *CD3D11CPUSimData::GetLinkedBuffer(SimBufferType type) {
 			return anisotropyQ2Buffer;
 		case SimBufferType::ANISOTROPY_Q3:
 			return anisotropyQ3Buffer;
+		case SimBufferType::PREVIOUS_POSITION:
+			return previousPositionBuffer;
 	}
 	return nullptr;
 }
@@ -79,6 +86,10 @@ int CD3D11CPUSimData::GetMaxParticles() { return maxParticles; }
 
 void CD3D11CPUSimData::SetActiveParticles(const int activeParticles) {
 	this->activeParticles = activeParticles;
+
+	if (particleIdsEnabled) {
+		particleIds.Resize(static_cast<uint>(activeParticles));
+	}
 }
 
 int CD3D11CPUSimData::GetActiveParticles() { return activeParticles; }
@@ -93,4 +104,60 @@ void CD3D11CPUSimData::SetActiveFoamParticles(const int activeFoamParticles) {
 	this->activeFoamParticles = activeFoamParticles;
 }
 
-int CD3D11CPUSimData::GetActiveFoamParticles() { return activeFoamParticles; }
\ No newline at end of file
+int CD3D11CPUSimData::GetActiveFoamParticles() { return activeFoamParticles; }
+void CD3D11CPUSimData::SetInterpolationAlpha(const float alpha) {
+	interpolationAlpha = alpha;
+}
+
+float CD3D11CPUSimData::GetInterpolationAlpha() { return interpolationAlpha; }
+
+void CD3D11CPUSimData::SetParticleIdsEnabled(const bool enabled) {
+	if (enabled == particleIdsEnabled) {
+		return;
+	}
+
+	particleIdsEnabled = enabled;
+	particleIds.Clear();
+
+	if (enabled) {
+		particleIds.Resize(static_cast<uint>(activeParticles));
+	}
+}
+
+bool CD3D11CPUSimData::AreParticleIdsEnabled() { return particleIdsEnabled; }
+
+ParticleId CD3D11CPUSimData::GetParticleId(const int slot) {
+	if (!particleIdsEnabled || slot < 0) {
+		return INVALID_PARTICLE_ID;
+	}
+
+	return particleIds.GetId(static_cast<uint>(slot));
+}
+
+uint32_t CD3D11CPUSimData::GetParticleSlot(const ParticleId id) {
+	if (!particleIdsEnabled) {
+		return INVALID_PARTICLE_SLOT;
+	}
+
+	return particleIds.GetSlot(id);
+}
+
+void CD3D11CPUSimData::RemapParticles(
+	const uint32_t *previousSlots, const int particleCount
+) {
+	if (particleIdsEnabled) {
+		particleIds.Remap(previousSlots, static_cast<uint>(particleCount));
+	}
+
+	activeParticles = particleCount;
+
+	if (remapListener) {
+		remapListener(previousSlots, particleCount);
+	}
+}
+
+void CD3D11CPUSimData::SetParticleRemapListener(
+	ParticleRemapListener listener
+) {
+	remapListener = std::move(listener);
+}
\ No newline at end of file
@@ -5,7 +5,8 @@
 CD3D11DebugFluidSimulation::CD3D11DebugFluidSimulation()
 	: simData(new CD3D11CPUSimData()),
 	  positionBuffer(nullptr),
-	  maxParticles(0) {}
+	  maxParticles(0),
+	  commandListPool(supportedCommands) {}
 
 CD3D11DebugFluidSimulation::~CD3D11DebugFluidSimulation() {
 	delete simData;
@@ -131,16 +132,12 @@ SimContextAPI CD3D11DebugFluidSimulation::GetComputeAPI() {
 }
 
 ISimCommandList *CD3D11DebugFluidSimulation::CreateCommandList() {
-	auto *commandList = new CSimpleSimCommandList(supportedCommands);
-	commandLists.push_back(commandList);
-	return commandList;
+	return commandListPool.Create();
 }
 
 void CD3D11DebugFluidSimulation::DestroyCommandList(ISimCommandList *commandList
 ) {
-	// delete on nullptr is a no-op so it's fine to call this after the
-	// simulation is destroyed.
-	delete commandList;
+	commandListPool.Destroy(commandList);
 }
 
 void CD3D11DebugFluidSimulation::ExecuteCommandList(ISimCommandList *commandList
@@ -173,6 +170,17 @@ void CD3D11DebugFluidSimulation::ExecuteCommandList(ISimCommandList *commandList
 	}
 }
 
+ISimCommandList *CD3D11DebugFluidSimulation::BeginCommandList() {
+	return commandListPool.Acquire();
+}
+
+void CD3D11DebugFluidSimulation::SubmitCommandList(ISimCommandList *commandList
+) {
+	commandListPool.ExecuteAndRelease(commandList, [this](auto *list) {
+		ExecuteCommandList(list);
+	});
+}
+
 void CD3D11DebugFluidSimulation::AttachToContext(
 	const GellyObserverPtr<ISimContext> context
 ) {
@@ -183,6 +191,13 @@ void CD3D11DebugFluidSimulation::Update(const float deltaTime) {
 	// Do nothing.
 }
 
+void CD3D11DebugFluidSimulation::KickUpdate(const float deltaTime) {
+	// Nothing here runs asynchronously, so the results are ready right away.
+	Update(deltaTime);
+}
+
+void CD3D11DebugFluidSimulation::WaitForResult() {}
+
 const char *CD3D11DebugFluidSimulation::GetComputeDeviceName() { return "CPU"; }
 
 // Aside from the inherent base featureset, this simulation has nothing.
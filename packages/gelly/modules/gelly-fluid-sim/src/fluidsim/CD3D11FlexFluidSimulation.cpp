@@ -2,6 +2,9 @@
 
 #include <NvFlex.h>
 
+#include <algorithm>
+#include <climits>
+#include <execution>
 #include <string>
 
 // TODO: deduplicate this
@@ -13,6 +16,12 @@ struct FlexFloat3 {
 	float x, y, z;
 };
 
+static_assert(
+	sizeof(FlexFloat4) == sizeof(SimFloat4) &&
+		sizeof(FlexFloat3) == sizeof(SimFloat3),
+	"Particles are staged directly into FleX buffers"
+);
+
 // flex's design isn't exactly what i'd call flexible so
 // we set up a global error callback to throw exceptions
 // when flex errors occur
@@ -26,92 +35,79 @@ static void FlexErrorCallback(
 CD3D11FlexFluidSimulation::CD3D11FlexFluidSimulation() :
 	simData(new CD3D11CPUSimData()),
 	maxParticles(0),
-	commandLists({}),
-	scene(nullptr) {}
+	commandListPool(supportedCommands),
+	scene(nullptr),
+	stagingBackend(nullptr),
+	stagingRing(nullptr),
+	stepController(fixedTimeStep, maxStepsPerFrame),
+	sleepTracker(checksToSleep),
+	qualityController(SimQualitySettings{}),
+	stepTimer(nullptr) {}
 
 CD3D11FlexFluidSimulation::~CD3D11FlexFluidSimulation() {
 	delete simData;
 	delete scene;
+	delete stepTimer;
 
-	if (buffers.positions != nullptr) {
-		NvFlexFreeBuffer(buffers.positions);
-	}
+	DestroySolver();
+	NvFlexShutdown(library);
+}
 
-	if (buffers.velocities != nullptr) {
-		NvFlexFreeBuffer(buffers.velocities);
+void CD3D11FlexFluidSimulation::SetMaxParticles(const int maxParticles) {
+	if (maxParticles <= 0) {
+		throw std::invalid_argument(
+			"CD3D11FlexFluidSimulation::SetMaxParticles: maxParticles must be "
+			"greater than 0."
+		);
 	}
 
-	if (buffers.phases != nullptr) {
-		NvFlexFreeBuffer(buffers.phases);
-	}
+	this->maxParticles = maxParticles;
+	simData->SetMaxParticles(maxParticles);
 
-	if (buffers.actives != nullptr) {
-		NvFlexFreeBuffer(buffers.actives);
+	if (solver == nullptr) {
+		simData->SetMaxFoamParticles(maxParticles);
+		return;
 	}
 
-	if (buffers.contactCounts != nullptr) {
-		NvFlexFreeBuffer(buffers.contactCounts);
-	}
+	WaitForResult();
 
-	if (buffers.contactVelocities != nullptr) {
-		NvFlexFreeBuffer(buffers.contactVelocities);
+	if (simData->GetActiveParticles() > maxParticles) {
+		simData->SetActiveParticles(maxParticles);
+		WakeAllParticles();
 	}
 
-	NvFlexDestroySolver(solver);
-	NvFlexShutdown(library);
-}
-
-void CD3D11FlexFluidSimulation::SetMaxParticles(const int maxParticles) {
-	this->maxParticles = maxParticles;
-	simData->SetMaxParticles(maxParticles);
-	simData->SetMaxFoamParticles(maxParticles);
-}
-
-void CD3D11FlexFluidSimulation::Initialize() {
-	if (!context) {
-		throw std::runtime_error(
-			"CD3D11FlexFluidSimulation::Initialize: context must be set before "
-			"initializing the simulation."
-		);
-	}
+	const bool buffersChanged =
+		simData->GetLinkedBuffer(SimBufferType::POSITION) !=
+		registeredPositionBuffer;
 
-	if (!simData->IsBufferLinked(SimBufferType::POSITION)) {
-		// We need to register our flex buffers at this point.
-		throw std::runtime_error(
-			"CD3D11FlexFluidSimulation::Initialize: position buffer must be "
-			"linked before initializing the simulation."
-		);
+	if (maxParticles <= particleCapacity && !buffersChanged) {
+		return;
 	}
 
-	if (!simData->IsBufferLinked(SimBufferType::ANISOTROPY_Q1) ||
-		!simData->IsBufferLinked(SimBufferType::ANISOTROPY_Q2) ||
-		!simData->IsBufferLinked(SimBufferType::ANISOTROPY_Q3)) {
+	const int linkedCapacity = GetLinkedParticleCapacity();
+	if (linkedCapacity < maxParticles) {
 		throw std::runtime_error(
-			"CD3D11FlexFluidSimulation::Initialize: anisotropy buffers must be "
-			"linked before initializing the simulation."
+			"CD3D11FlexFluidSimulation::SetMaxParticles: the linked buffers "
+			"only have room for " +
+			std::to_string(linkedCapacity) + " particles."
 		);
 	}
 
-	NvFlexInitDesc initDesc = {};
-	initDesc.computeType = eNvFlexD3D11;
-	initDesc.renderDevice =
-		context->GetAPIHandle(SimContextHandle::D3D11_DEVICE);
-#ifdef GELLY_ENABLE_RENDERDOC_CAPTURES
-	// FleX will try to use GPU extensions and compute queues which destroy most
-	// rendering debuggers
-	initDesc.enableExtensions = false;
-	initDesc.runOnRenderContext = true;
-#else
-	initDesc.enableExtensions = false;
-	initDesc.runOnRenderContext = true;
-#endif
+	// Grows geometrically so that creeping the limit up doesn't rebuild the
+	// solver every time.
+	ResizeSolver(std::min(
+		std::max(maxParticles, particleCapacity * 2), linkedCapacity
+	));
+}
 
-	library = NvFlexInit(NV_FLEX_VERSION, FlexErrorCallback, &initDesc);
+void CD3D11FlexFluidSimulation::CreateSolver(const int capacity) {
+	particleCapacity = capacity;
+	simData->SetMaxFoamParticles(capacity);
 
 	NvFlexSolverDesc solverDesc = {};
 	NvFlexSetSolverDescDefaults(&solverDesc);
 
-	solverDesc.maxParticles = maxParticles;
+	solverDesc.maxParticles = capacity;
 	// soon...
 	solverDesc.maxDiffuseParticles = simData->GetMaxFoamParticles();
 	solverDesc.maxNeighborsPerParticle = 64;
@@ -119,46 +115,51 @@ void CD3D11FlexFluidSimulation::Initialize() {
 	solverDesc.featureMode = eNvFlexFeatureModeSimpleFluids;
 
 	solver = NvFlexCreateSolver(library, &solverDesc);
-
-	// flex params are massive so we set them up in a separate function
-	SetupParams();
 	NvFlexSetParams(solver, &solverParams);
 
 	buffers.positions = NvFlexAllocBuffer(
-		library, maxParticles, sizeof(FlexFloat4), eNvFlexBufferHost
+		library, capacity, sizeof(FlexFloat4), eNvFlexBufferHost
 	);
 
 	buffers.velocities = NvFlexAllocBuffer(
-		library, maxParticles, sizeof(FlexFloat3), eNvFlexBufferHost
+		library, capacity, sizeof(FlexFloat3), eNvFlexBufferHost
 	);
 
-	buffers.phases = NvFlexAllocBuffer(
-		library, maxParticles, sizeof(uint), eNvFlexBufferHost
-	);
+	buffers.phases =
+		NvFlexAllocBuffer(library, capacity, sizeof(int), eNvFlexBufferHost);
+
+	buffers.actives =
+		NvFlexAllocBuffer(library, capacity, sizeof(uint), eNvFlexBufferHost);
 
-	buffers.actives = NvFlexAllocBuffer(
-		library, maxParticles, sizeof(uint), eNvFlexBufferHost
+	stagingBackend = new CFlexParticleStagingBackend(library, solver);
+	stagingRing = new CFlexParticleStagingRing(
+		stagingBackend, std::min(capacity, maxStagedParticles)
 	);
 
 	buffers.contactVelocities = NvFlexAllocBuffer(
 		library,
-		maxParticles * maxContactsPerParticle,
+		capacity * maxContactsPerParticle,
 		sizeof(FlexFloat4),
 		eNvFlexBufferHost
 	);
 
-	buffers.contactCounts = NvFlexAllocBuffer(
-		library, maxParticles, sizeof(uint), eNvFlexBufferHost
-	);
+	buffers.contactCounts =
+		NvFlexAllocBuffer(library, capacity, sizeof(uint), eNvFlexBufferHost);
 
 	buffers.diffuseParticleCount =
 		NvFlexAllocBuffer(library, 1, sizeof(int), eNvFlexBufferHost);
 
+	buffers.boundsLower =
+		NvFlexAllocBuffer(library, 1, sizeof(FlexFloat3), eNvFlexBufferHost);
+
+	buffers.boundsUpper =
+		NvFlexAllocBuffer(library, 1, sizeof(FlexFloat3), eNvFlexBufferHost);
+
+	registeredPositionBuffer =
+		simData->GetLinkedBuffer(SimBufferType::POSITION);
+
 	sharedBuffers.positions = NvFlexRegisterD3DBuffer(
-		library,
-		simData->GetLinkedBuffer(SimBufferType::POSITION),
-		maxParticles,
-		sizeof(FlexFloat4)
+		library, registeredPositionBuffer, capacity, sizeof(FlexFloat4)
 	);
 
 	sharedBuffers.foamPositions = NvFlexRegisterD3DBuffer(
@@ -178,26 +179,201 @@ void CD3D11FlexFluidSimulation::Initialize() {
 	sharedBuffers.anisotropyQ1Buffer = NvFlexRegisterD3DBuffer(
 		library,
 		simData->GetLinkedBuffer(SimBufferType::ANISOTROPY_Q1),
-		maxParticles,
+		capacity,
 		sizeof(FlexFloat4)
 	);
 
 	sharedBuffers.anisotropyQ2Buffer = NvFlexRegisterD3DBuffer(
 		library,
 		simData->GetLinkedBuffer(SimBufferType::ANISOTROPY_Q2),
-		maxParticles,
+		capacity,
 		sizeof(FlexFloat4)
 	);
 
 	sharedBuffers.anisotropyQ3Buffer = NvFlexRegisterD3DBuffer(
 		library,
 		simData->GetLinkedBuffer(SimBufferType::ANISOTROPY_Q3),
-		maxParticles,
+		capacity,
 		sizeof(FlexFloat4)
 	);
+}
+
+void CD3D11FlexFluidSimulation::DestroySolver() {
+	delete stagingRing;
+	stagingRing = nullptr;
+	delete stagingBackend;
+	stagingBackend = nullptr;
+
+	for (auto *buffer :
+		 {buffers.positions,
+		  buffers.velocities,
+		  buffers.phases,
+		  buffers.actives,
+		  buffers.contactVelocities,
+		  buffers.contactCounts,
+		  buffers.diffuseParticleCount,
+		  buffers.boundsLower,
+		  buffers.boundsUpper}) {
+		if (buffer != nullptr) {
+			NvFlexFreeBuffer(buffer);
+		}
+	}
+
+	for (auto *buffer :
+		 {sharedBuffers.positions,
+		  sharedBuffers.foamPositions,
+		  sharedBuffers.foamVelocities,
+		  sharedBuffers.anisotropyQ1Buffer,
+		  sharedBuffers.anisotropyQ2Buffer,
+		  sharedBuffers.anisotropyQ3Buffer}) {
+		if (buffer != nullptr) {
+			NvFlexUnregisterD3DBuffer(buffer);
+		}
+	}
+
+	buffers = {};
+	sharedBuffers = {};
+	registeredPositionBuffer = nullptr;
+
+	if (solver != nullptr) {
+		NvFlexDestroySolver(solver);
+		solver = nullptr;
+	}
+
+	particleCapacity = 0;
+}
+
+void CD3D11FlexFluidSimulation::ResizeSolver(const int capacity) {
+	CSimSnapshot particles;
+	CaptureSnapshot(particles);
+
+	DestroySolver();
+	CreateSolver(capacity);
+	scene->SetSolver(solver);
+
+	// Slots are kept as-is, so particle IDs and anything else indexed by
+	// slot stay valid.
+	const uint particleCount = std::min(
+		particles.GetParticleCount(), static_cast<uint>(maxParticles)
+	);
+
+	stagingRing->Begin(0, particleCount);
+	stagingRing->Write(
+		particles.positions.data(),
+		particles.velocities.data(),
+		particles.phases.data(),
+		NvFlexMakePhase(0, eNvFlexPhaseSelfCollide | eNvFlexPhaseFluid),
+		particleInverseMass,
+		particleCount
+	);
+	stagingRing->End();
+
+	NvFlexCopyDesc copyDesc = {};
+	copyDesc.srcOffset = 0;
+	copyDesc.dstOffset = 0;
+	copyDesc.elementCount = static_cast<int>(particleCount);
+
+	// The renderer's buffers may be brand new, so they need filling in
+	// before the next step.
+	NvFlexGetParticles(solver, sharedBuffers.positions, &copyDesc);
+	CopyPositionsToPrevious(0, particleCount);
+
+	WakeAllParticles();
+	activeSetCompacted = false;
+	activeSetParticleCount = 0;
+}
+
+int CD3D11FlexFluidSimulation::GetLinkedParticleCapacity() const {
+	int capacity = INT_MAX;
+
+	for (const auto type :
+		 {SimBufferType::POSITION,
+		  SimBufferType::PREVIOUS_POSITION,
+		  SimBufferType::FOAM_POSITION,
+		  SimBufferType::FOAM_VELOCITY,
+		  SimBufferType::ANISOTROPY_Q1,
+		  SimBufferType::ANISOTROPY_Q2,
+		  SimBufferType::ANISOTROPY_Q3}) {
+		if (!simData->IsBufferLinked(type)) {
+			continue;
+		}
+
+		D3D11_BUFFER_DESC desc = {};
+		static_cast<ID3D11Buffer *>(simData->GetLinkedBuffer(type))
+			->GetDesc(&desc);
+
+		capacity = std::min(
+			capacity, static_cast<int>(desc.ByteWidth / sizeof(FlexFloat4))
+		);
+	}
+
+	return capacity;
+}
+
+void CD3D11FlexFluidSimulation::Initialize() {
+	if (!context) {
+		throw std::runtime_error(
+			"CD3D11FlexFluidSimulation::Initialize: context must be set before "
+			"initializing the simulation."
+		);
+	}
+
+	if (!simData->IsBufferLinked(SimBufferType::POSITION)) {
+		// We need to register our flex buffers at this point.
+		throw std::runtime_error(
+			"CD3D11FlexFluidSimulation::Initialize: position buffer must be "
+			"linked before initializing the simulation."
+		);
+	}
+
+	if (!simData->IsBufferLinked(SimBufferType::ANISOTROPY_Q1) ||
+		!simData->IsBufferLinked(SimBufferType::ANISOTROPY_Q2) ||
+		!simData->IsBufferLinked(SimBufferType::ANISOTROPY_Q3)) {
+		throw std::runtime_error(
+			"CD3D11FlexFluidSimulation::Initialize: anisotropy buffers must be "
+			"linked before initializing the simulation."
+		);
+	}
+
+	NvFlexInitDesc initDesc = {};
+	initDesc.computeType = eNvFlexD3D11;
+	initDesc.renderDevice =
+		context->GetAPIHandle(SimContextHandle::D3D11_DEVICE);
+#ifdef GELLY_ENABLE_RENDERDOC_CAPTURES
+	// FleX will try to use GPU extensions and compute queues which destroy most
+	// rendering debuggers
+	initDesc.enableExtensions = false;
+	initDesc.runOnRenderContext = true;
+#else
+	initDesc.enableExtensions = false;
+	initDesc.runOnRenderContext = true;
+#endif
+
+	library = NvFlexInit(NV_FLEX_VERSION, FlexErrorCallback, &initDesc);
+
+	// flex params are massive so we set them up in a separate function
+	SetupParams();
+	CreateSolver(maxParticles);
 
 	delete scene;
 	scene = new CFlexSimScene(library, solver);
+
+	stepController.Reset();
+	simData->SetInterpolationAlpha(1.f);
+	updateInFlight = false;
+	WakeAllParticles();
+	activeSetCompacted = false;
+	activeSetParticleCount = 0;
+
+	delete stepTimer;
+	stepTimer = new CD3D11StepTimer(
+		static_cast<ID3D11Device *>(
+			context->GetAPIHandle(SimContextHandle::D3D11_DEVICE)
+		),
+		static_cast<ID3D11DeviceContext *>(
+			context->GetAPIHandle(SimContextHandle::D3D11_DEVICE_CONTEXT)
+		)
+	);
 }
 
 ISimData *CD3D11FlexFluidSimulation::GetSimulationData() { return simData; }
@@ -213,14 +389,12 @@ void CD3D11FlexFluidSimulation::AttachToContext(
 }
 
 ISimCommandList *CD3D11FlexFluidSimulation::CreateCommandList() {
-	auto *commandList = new CSimpleSimCommandList(supportedCommands);
-	commandLists.push_back(commandList);
-	return commandList;
+	return commandListPool.Create();
 }
 
 void CD3D11FlexFluidSimulation::DestroyCommandList(ISimCommandList *commandList
 ) {
-	delete commandList;
+	commandListPool.Destroy(commandList);
 }
 
 void CD3D11FlexFluidSimulation::ExecuteCommandList(ISimCommandList *commandList
@@ -234,8 +408,9 @@ void CD3D11FlexFluidSimulation::ExecuteCommandList(ISimCommandList *commandList
 
 	const auto iterators = commandList->GetCommands();
 
-	bool mappingRequired = false;
-	std::vector<AddParticle> newParticles;
+	// these keep their capacity between calls so emitting every tick doesn't
+	// allocate
+	pendingAdditions.clear();
 
 	for (auto it = iterators.first; it != iterators.second; ++it) {
 		auto &command = *it;
@@ -244,9 +419,12 @@ void CD3D11FlexFluidSimulation::ExecuteCommandList(ISimCommandList *commandList
 				using T = std::decay_t<decltype(arg)>;
 				if constexpr (std::is_same_v<T, Reset>) {
 					simData->SetActiveParticles(0);
-				} else if constexpr (std::is_same_v<T, AddParticle>) {
-					mappingRequired = true;
-					newParticles.push_back(arg);
+					WakeAllParticles();
+					// Anything added before the reset would've been removed
+					pendingAdditions.clear();
+				} else if constexpr (std::is_same_v<T, AddParticle> ||
+									 std::is_same_v<T, AddParticleBatch>) {
+					pendingAdditions.push_back(&command);
 				} else if constexpr (std::is_same_v<T, SetFluidProperties>) {
 					solverParams.adhesion = arg.adhesion;
 					solverParams.cohesion = arg.cohesion;
@@ -255,88 +433,180 @@ void CD3D11FlexFluidSimulation::ExecuteCommandList(ISimCommandList *commandList
 						arg.vorticityConfinement;
 					solverParams.viscosity = arg.viscosity;
 					solverParams.dynamicFriction = arg.dynamicFriction;
+					WakeAllParticles();
 				} else if constexpr (std::is_same_v<T, ChangeRadius>) {
 					particleRadius = arg.radius;
 					SetupParams();
+					WakeAllParticles();
 				}
 			},
 			command.data
 		);
 	}
 
-	// batches the particle updates
-	if (mappingRequired) {
-		uint currentActiveParticles = simData->GetActiveParticles();
-		uint newActiveParticles = currentActiveParticles + newParticles.size();
-
-		// Update the positions and velocities of the particles
-		NvFlexGetParticles(solver, buffers.positions, nullptr);
-		NvFlexGetVelocities(solver, buffers.velocities, nullptr);
-		auto *positions = reinterpret_cast<FlexFloat4 *>(
-			NvFlexMap(buffers.positions, eNvFlexMapWait)
+	// Only the particles being added are uploaded, and they land right after
+	// the ones already alive. Nothing is read back from the solver, so adding
+	// particles never waits on the simulation that's in flight.
+	if (!pendingAdditions.empty()) {
+		const int defaultPhase =
+			NvFlexMakePhase(0, eNvFlexPhaseSelfCollide | eNvFlexPhaseFluid);
+
+		// Staged in the order they were recorded, so callers can work out
+		// which slots their particles land in. Anything past maxParticles is
+		// dropped by the ring.
+		stagingRing->Begin(
+			simData->GetActiveParticles(), static_cast<uint>(maxParticles)
 		);
+		for (const auto *command : pendingAdditions) {
+			if (const auto *batch =
+					std::get_if<AddParticleBatch>(&command->data)) {
+				stagingRing->Write(
+					batch->positions,
+					batch->velocities,
+					batch->phases,
+					defaultPhase,
+					particleInverseMass,
+					batch->particleCount
+				);
+				continue;
+			}
 
-		auto *velocities = reinterpret_cast<FlexFloat3 *>(
-			NvFlexMap(buffers.velocities, eNvFlexMapWait)
-		);
+			const auto &particle = std::get<AddParticle>(command->data);
+			stagingRing->WriteParticle(
+				SimFloat4{
+					particle.x, particle.y, particle.z, particleInverseMass
+				},
+				SimFloat3{particle.vx, particle.vy, particle.vz},
+				defaultPhase
+			);
+		}
 
-		auto *phases =
-			reinterpret_cast<int *>(NvFlexMap(buffers.phases, eNvFlexMapWait));
+		const uint firstNewParticle = simData->GetActiveParticles();
+		const uint newParticleCount = stagingRing->End();
+		simData->SetActiveParticles(firstNewParticle + newParticleCount);
 
-		auto *actives =
-			reinterpret_cast<uint *>(NvFlexMap(buffers.actives, eNvFlexMapWait)
-			);
+		// New particles would otherwise be invisible (or interpolate from
+		// whatever was left in the buffers) until the next step runs.
+		NvFlexCopyDesc copyDesc = {};
+		copyDesc.srcOffset = static_cast<int>(firstNewParticle);
+		copyDesc.dstOffset = static_cast<int>(firstNewParticle);
+		copyDesc.elementCount = static_cast<int>(newParticleCount);
 
-		for (uint i = currentActiveParticles; i < newActiveParticles; i++) {
-			_mm_prefetch(
-				reinterpret_cast<const char *>(
-					&newParticles[i - currentActiveParticles] + 1
-				),
-				_MM_HINT_T0
-			);
+		NvFlexGetParticles(solver, sharedBuffers.positions, &copyDesc);
+		CopyPositionsToPrevious(firstNewParticle, newParticleCount);
+	}
+}
 
-			const auto &position = newParticles[i - currentActiveParticles];
-			positions[i] = FlexFloat4{
-				position.x, position.y, position.z, particleInverseMass
-			};
+ISimCommandList *CD3D11FlexFluidSimulation::BeginCommandList() {
+	return commandListPool.Acquire();
+}
 
-			velocities[i] = FlexFloat3{position.vx, position.vy, position.vz};
-			phases[i] =
-				NvFlexMakePhase(0, eNvFlexPhaseSelfCollide | eNvFlexPhaseFluid);
+void CD3D11FlexFluidSimulation::SubmitCommandList(ISimCommandList *commandList
+) {
+	commandListPool.ExecuteAndRelease(commandList, [this](auto *list) {
+		ExecuteCommandList(list);
+	});
+}
 
-			actives[i] = i;
-		}
+void CD3D11FlexFluidSimulation::Update(float deltaTime) {
+	KickUpdate(deltaTime);
+	WaitForResult();
+}
 
-		NvFlexUnmap(buffers.positions);
-		NvFlexUnmap(buffers.velocities);
-		NvFlexUnmap(buffers.phases);
-		NvFlexUnmap(buffers.actives);
+void CD3D11FlexFluidSimulation::KickUpdate(float deltaTime) {
+	WaitForResult();
 
-		simData->SetActiveParticles(newActiveParticles);
+	const bool interpolating =
+		simData->IsBufferLinked(SimBufferType::PREVIOUS_POSITION);
 
-		NvFlexCopyDesc copyDesc = {};
-		copyDesc.dstOffset = 0;
-		copyDesc.srcOffset = 0;
-		copyDesc.elementCount = simData->GetActiveParticles();
+	const int steps = stepController.Advance(deltaTime);
+	simData->SetInterpolationAlpha(
+		interpolating ? stepController.GetInterpolationAlpha() : 1.f
+	);
 
-		NvFlexSetParticles(solver, buffers.positions, &copyDesc);
-		NvFlexSetVelocities(solver, buffers.velocities, &copyDesc);
-		NvFlexSetPhases(solver, buffers.phases, &copyDesc);
-		NvFlexSetActive(solver, buffers.actives, &copyDesc);
+	if (steps == 0) {
+		return;
 	}
-}
 
-void CD3D11FlexFluidSimulation::Update(float deltaTime) {
 	NvFlexCopyDesc copyDesc = {};
 	copyDesc.dstOffset = 0;
 	copyDesc.srcOffset = 0;
 	copyDesc.elementCount = simData->GetActiveParticles();
 
+	updatesSinceReorder++;
+	if (drainPending) {
+		ApplyDrains();
+	}
+
+	if (reorderer.IsPending()) {
+		ApplyReorder();
+	}
+
+	solverParams.numIterations = qualityController.GetIterations();
 	NvFlexSetParams(solver, &solverParams);
-	NvFlexSetActiveCount(solver, simData->GetActiveParticles());
+	// New particles are only appended to the active set by the staging ring,
+	// which is wrong once it skips over sleeping particles.
+	if (sleepTracker.HasActiveSetChanged() ||
+		(activeSetCompacted &&
+		 activeSetParticleCount != simData->GetActiveParticles())) {
+		UploadActiveSet();
+	} else if (!activeSetCompacted) {
+		NvFlexSetActiveCount(solver, simData->GetActiveParticles());
+	}
+
 	scene->Update();
 
-	NvFlexUpdateSolver(solver, deltaTime * timeStepMultiplier, substeps, false);
+	const float stepDeltaTime =
+		stepController.GetFixedDeltaTime() * timeStepMultiplier;
+
+	const int substeps = qualityController.GetSubsteps();
+	stepTimer->Begin();
+	for (int step = 0; step < steps; step++) {
+		if (step == steps - 1 && interpolating) {
+			// Only the last two states are interpolated between, so the
+			// render positions need to be caught up if steps already ran.
+			if (step > 0) {
+				NvFlexGetSmoothParticles(
+					solver, sharedBuffers.positions, &copyDesc
+				);
+			}
+
+			CopyPositionsToPrevious(0, simData->GetActiveParticles());
+		}
+
+		NvFlexUpdateSolver(solver, stepDeltaTime, substeps, false);
+	}
+	stepTimer->End();
+	stepsInFlight = steps;
+	NvFlexGetBounds(solver, buffers.boundsLower, buffers.boundsUpper);
+
+	// Read back before the foam count so that mapping the count in
+	// WaitForResult covers these copies too
+	if (++updatesSinceSleepCheck >= updatesPerSleepCheck) {
+		updatesSinceSleepCheck = 0;
+		sleepReadbackCount = simData->GetActiveParticles();
+		sleepReadbackInFlight = true;
+
+		NvFlexGetParticles(solver, buffers.positions, &copyDesc);
+		NvFlexGetVelocities(solver, buffers.velocities, &copyDesc);
+
+		const bool reorderDue =
+			updatesSinceReorder >= updatesPerReorder ||
+			(updatesSinceReorder >= minUpdatesPerReorder &&
+			 particleLocality > maxParticleLocality);
+
+		reorderReadbackInFlight = reorderDue && !reorderer.IsPending();
+
+		// Drained particles are compacted out of this same readback, so it
+		// needs to cover everything that gets uploaded again. Lua can add a
+		// drain before the result is in, which has to wait for the next
+		// readback since the phases weren't read back with this one.
+		drainReadbackInFlight = scene->HasDrains();
+		if (reorderReadbackInFlight || drainReadbackInFlight) {
+			NvFlexGetPhases(solver, buffers.phases, &copyDesc);
+		}
+	}
+
 	NvFlexGetSmoothParticles(solver, sharedBuffers.positions, &copyDesc);
 	NvFlexGetAnisotropy(
 		solver,
@@ -352,6 +622,17 @@ void CD3D11FlexFluidSimulation::Update(float deltaTime) {
 		buffers.diffuseParticleCount
 	);
 
+	// FleX shares the render context, so everything above is just queued
+	// behind the game's own GPU work and nothing has to wait on it until the
+	// foam count is read back.
+	updateInFlight = true;
+}
+
+void CD3D11FlexFluidSimulation::WaitForResult() {
+	if (!updateInFlight) {
+		return;
+	}
+
 	// unfortunately, the GPU runs the diffuse spawning code now so we really
 	// gotta synchronize our CPU particles with the GPU
 	const auto *diffuseParticleCount = static_cast<int *>(
@@ -360,6 +641,332 @@ void CD3D11FlexFluidSimulation::Update(float deltaTime) {
 
 	simData->SetActiveFoamParticles(*diffuseParticleCount);
 	NvFlexUnmap(buffers.diffuseParticleCount);
+
+	const auto *boundsLower = static_cast<FlexFloat3 *>(
+		NvFlexMap(buffers.boundsLower, eNvFlexMapWait)
+	);
+	const auto *boundsUpper = static_cast<FlexFloat3 *>(
+		NvFlexMap(buffers.boundsUpper, eNvFlexMapWait)
+	);
+
+	activeBounds = {
+		{boundsLower->x, boundsLower->y, boundsLower->z},
+		{boundsUpper->x, boundsUpper->y, boundsUpper->z},
+		// An empty active set leaves the bounds inside out
+		boundsLower->x <= boundsUpper->x
+	};
+
+	NvFlexUnmap(buffers.boundsLower);
+	NvFlexUnmap(buffers.boundsUpper);
+
+	// The map above already waited for the steps, so this won't stall
+	if (const auto stepTimeMs = stepTimer->Resolve()) {
+		qualityController.AddSample(*stepTimeMs / stepsInFlight);
+	}
+
+	if (sleepReadbackInFlight) {
+		scene->ConsumeDisturbances(
+			[&](const float position[3], const float radius) {
+				sleepTracker.DisturbCollider(
+					SimFloat3{position[0], position[1], position[2]}, radius
+				);
+			}
+		);
+
+		const auto *positions = static_cast<SimFloat4 *>(
+			NvFlexMap(buffers.positions, eNvFlexMapWait)
+		);
+		const auto *velocities = static_cast<SimFloat3 *>(
+			NvFlexMap(buffers.velocities, eNvFlexMapWait)
+		);
+
+		// Still means moving less than a small fraction of the radius per step
+		const float stepDeltaTime =
+			stepController.GetFixedDeltaTime() * timeStepMultiplier;
+		const float sleepSpeed = particleRadius * 0.05f / stepDeltaTime;
+
+		sleepTracker.Check(
+			positions,
+			velocities,
+			sleepReadbackCount,
+			sleepSpeed,
+			particleRadius * 2.f
+		);
+
+		particleLocality = CParticleReorderer::MeasureLocality(
+			positions, sleepReadbackCount, particleRadius
+		);
+
+		readbackBounds = {
+			{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}, false
+		};
+		for (uint i = 0; i < sleepReadbackCount; i++) {
+			const float position[3] = {
+				positions[i].x, positions[i].y, positions[i].z
+			};
+
+			for (int axis = 0; axis < 3; axis++) {
+				readbackBounds.lower[axis] =
+					std::min(readbackBounds.lower[axis], position[axis]);
+				readbackBounds.upper[axis] =
+					std::max(readbackBounds.upper[axis], position[axis]);
+			}
+		}
+
+		readbackBounds.valid = sleepReadbackCount > 0;
+
+		if (drainReadbackInFlight) {
+			CheckDrains(positions, sleepReadbackCount);
+		}
+
+		// Sorting would be undone by the compaction anyway, so it waits for
+		// the next readback.
+		if (reorderReadbackInFlight && !drainPending) {
+			const auto *phases =
+				static_cast<int *>(NvFlexMap(buffers.phases, eNvFlexMapWait));
+
+			reorderer.Prepare(
+				positions,
+				velocities,
+				phases,
+				sleepReadbackCount,
+				particleRadius
+			);
+
+			NvFlexUnmap(buffers.phases);
+			updatesSinceReorder = 0;
+		}
+
+		reorderReadbackInFlight = false;
+		drainReadbackInFlight = false;
+
+		NvFlexUnmap(buffers.positions);
+		NvFlexUnmap(buffers.velocities);
+		sleepReadbackInFlight = false;
+	}
+
+	updateInFlight = false;
+}
+
+void CD3D11FlexFluidSimulation::UploadActiveSet() {
+	const uint particleCount = simData->GetActiveParticles();
+
+	auto *actives =
+		static_cast<uint *>(NvFlexMap(buffers.actives, eNvFlexMapWait));
+	const uint activeCount =
+		sleepTracker.FillActiveIndices(actives, particleCount);
+	NvFlexUnmap(buffers.actives);
+
+	NvFlexCopyDesc copyDesc = {};
+	copyDesc.srcOffset = 0;
+	copyDesc.dstOffset = 0;
+	copyDesc.elementCount = static_cast<int>(activeCount);
+
+	NvFlexSetActive(solver, buffers.actives, &copyDesc);
+	NvFlexSetActiveCount(solver, static_cast<int>(activeCount));
+
+	activeSetCompacted = activeCount < particleCount;
+	activeSetParticleCount = particleCount;
+}
+
+void CD3D11FlexFluidSimulation::WakeAllParticles() {
+	sleepTracker.Reset();
+	// Anything in flight describes particles which may not exist anymore
+	sleepReadbackInFlight = false;
+	updatesSinceSleepCheck = 0;
+
+	reorderer.Clear();
+	reorderReadbackInFlight = false;
+
+	drainReadbackInFlight = false;
+	drainPending = false;
+}
+
+void CD3D11FlexFluidSimulation::ApplyReorder() {
+	const uint sortedCount = reorderer.GetParticleCount();
+	const auto particleCount =
+		static_cast<uint>(simData->GetActiveParticles());
+
+	// Particles added since the readback keep their slots, as they come after
+	// all of the sorted ones.
+	remapSlots.resize(particleCount);
+	std::copy_n(reorderer.GetPreviousSlots(), sortedCount, remapSlots.begin());
+	for (uint i = sortedCount; i < particleCount; i++) {
+		remapSlots[i] = i;
+	}
+
+	auto *positions = static_cast<SimFloat4 *>(
+		NvFlexMap(buffers.positions, eNvFlexMapWait)
+	);
+	auto *velocities = static_cast<SimFloat3 *>(
+		NvFlexMap(buffers.velocities, eNvFlexMapWait)
+	);
+	auto *phases =
+		static_cast<int *>(NvFlexMap(buffers.phases, eNvFlexMapWait));
+
+	std::copy_n(reorderer.GetPositions(), sortedCount, positions);
+	std::copy_n(reorderer.GetVelocities(), sortedCount, velocities);
+	std::copy_n(reorderer.GetPhases(), sortedCount, phases);
+
+	NvFlexUnmap(buffers.positions);
+	NvFlexUnmap(buffers.velocities);
+	NvFlexUnmap(buffers.phases);
+
+	NvFlexCopyDesc copyDesc = {};
+	copyDesc.srcOffset = 0;
+	copyDesc.dstOffset = 0;
+	copyDesc.elementCount = static_cast<int>(sortedCount);
+
+	NvFlexSetParticles(solver, buffers.positions, &copyDesc);
+	NvFlexSetVelocities(solver, buffers.velocities, &copyDesc);
+	NvFlexSetPhases(solver, buffers.phases, &copyDesc);
+
+	// The previous positions are taken from these before the next step, so
+	// interpolation carries on in the new order.
+	NvFlexGetParticles(solver, sharedBuffers.positions, &copyDesc);
+
+	sleepTracker.Remap(remapSlots.data(), particleCount);
+	simData->RemapParticles(remapSlots.data(), static_cast<int>(particleCount));
+
+	reorderer.Clear();
+}
+
+void CD3D11FlexFluidSimulation::CheckDrains(
+	const SimFloat4 *positions, uint particleCount
+) {
+	drainedBy.resize(particleCount);
+	std::transform(
+		std::execution::par_unseq,
+		positions,
+		positions + particleCount,
+		drainedBy.begin(),
+		[&](const SimFloat4 &position) { return scene->FindDrain(position); }
+	);
+
+	drainPending = std::any_of(
+		drainedBy.begin(),
+		drainedBy.end(),
+		[](const DrainHandle handle) { return handle != INVALID_DRAIN_HANDLE; }
+	);
+}
+
+void CD3D11FlexFluidSimulation::ApplyDrains() {
+	drainPending = false;
+
+	const auto readbackCount = static_cast<uint>(drainedBy.size());
+	const auto particleCount =
+		static_cast<uint>(simData->GetActiveParticles());
+
+	if (particleCount < readbackCount) {
+		// Particles were removed since, so the slots can't be trusted. Drains
+		// will catch them again on the next readback.
+		return;
+	}
+
+	// Everything before the first drained particle stays where it is
+	const auto firstDrained = static_cast<uint>(
+		std::find_if(
+			drainedBy.begin(),
+			drainedBy.end(),
+			[](const DrainHandle handle) {
+				return handle != INVALID_DRAIN_HANDLE;
+			}
+		) -
+		drainedBy.begin()
+	);
+
+	NvFlexCopyDesc copyDesc = {};
+
+	// Particles added since the readback aren't in it, but they still have
+	// to move down. This is the only part that waits on the GPU.
+	if (particleCount > readbackCount) {
+		copyDesc.srcOffset = static_cast<int>(readbackCount);
+		copyDesc.dstOffset = static_cast<int>(readbackCount);
+		copyDesc.elementCount = static_cast<int>(particleCount - readbackCount);
+
+		NvFlexGetParticles(solver, buffers.positions, &copyDesc);
+		NvFlexGetVelocities(solver, buffers.velocities, &copyDesc);
+		NvFlexGetPhases(solver, buffers.phases, &copyDesc);
+	}
+
+	auto *positions = static_cast<SimFloat4 *>(
+		NvFlexMap(buffers.positions, eNvFlexMapWait)
+	);
+	auto *velocities = static_cast<SimFloat3 *>(
+		NvFlexMap(buffers.velocities, eNvFlexMapWait)
+	);
+	auto *phases =
+		static_cast<int *>(NvFlexMap(buffers.phases, eNvFlexMapWait));
+
+	remapSlots.resize(particleCount);
+	uint keptCount = 0;
+	for (uint slot = 0; slot < particleCount; slot++) {
+		if (slot < readbackCount && drainedBy[slot] != INVALID_DRAIN_HANDLE) {
+			scene->AddDrainedParticles(drainedBy[slot], 1);
+			continue;
+		}
+
+		positions[keptCount] = positions[slot];
+		velocities[keptCount] = velocities[slot];
+		phases[keptCount] = phases[slot];
+		remapSlots[keptCount] = slot;
+		keptCount++;
+	}
+
+	NvFlexUnmap(buffers.positions);
+	NvFlexUnmap(buffers.velocities);
+	NvFlexUnmap(buffers.phases);
+
+	copyDesc.srcOffset = static_cast<int>(firstDrained);
+	copyDesc.dstOffset = static_cast<int>(firstDrained);
+	copyDesc.elementCount = static_cast<int>(keptCount - firstDrained);
+
+	NvFlexSetParticles(solver, buffers.positions, &copyDesc);
+	NvFlexSetVelocities(solver, buffers.velocities, &copyDesc);
+	NvFlexSetPhases(solver, buffers.phases, &copyDesc);
+	NvFlexGetParticles(solver, sharedBuffers.positions, &copyDesc);
+
+	sleepTracker.Remap(remapSlots.data(), keptCount);
+	simData->RemapParticles(remapSlots.data(), static_cast<int>(keptCount));
+}
+
+void CD3D11FlexFluidSimulation::CopyPositionsToPrevious(
+	uint firstParticle, uint particleCount
+) {
+	if (!simData->IsBufferLinked(SimBufferType::PREVIOUS_POSITION)) {
+		return;
+	}
+
+	auto *deviceContext = static_cast<ID3D11DeviceContext *>(
+		context->GetAPIHandle(SimContextHandle::D3D11_DEVICE_CONTEXT)
+	);
+
+	constexpr uint stride = sizeof(FlexFloat4);
+	const D3D11_BOX range = {
+		firstParticle * stride,
+		0,
+		0,
+		(firstParticle + particleCount) * stride,
+		1,
+		1
+	};
+
+	// FleX runs on the render context, so this is ordered with the solver's
+	// own work.
+	deviceContext->CopySubresourceRegion(
+		static_cast<ID3D11Buffer *>(
+			simData->GetLinkedBuffer(SimBufferType::PREVIOUS_POSITION)
+		),
+		0,
+		firstParticle * stride,
+		0,
+		0,
+		static_cast<ID3D11Buffer *>(
+			simData->GetLinkedBuffer(SimBufferType::POSITION)
+		),
+		0,
+		&range
+	);
 }
 
 void CD3D11FlexFluidSimulation::SetTimeStepMultiplier(float timeStepMultiplier
@@ -384,7 +991,7 @@ void CD3D11FlexFluidSimulation::SetupParams() {
 	solverParams.freeSurfaceDrag = 0.0f;
 	solverParams.drag = 0.0f;
 	solverParams.lift = 0.0f;
-	solverParams.numIterations = 3;
+	solverParams.numIterations = qualityController.GetIterations();
 	// According to the manual, the ratio of radius and rest distance should be
 	// 2:1
 	solverParams.fluidRestDistance = solverParams.radius * 0.73f;
@@ -476,6 +1083,11 @@ const char *CD3D11FlexFluidSimulation::GetComputeDeviceName() {
 bool CD3D11FlexFluidSimulation::CheckFeatureSupport(GELLY_FEATURE feature) {
 	switch (feature) {
 		case GELLY_FEATURE::FLUIDSIM_CONTACTPLANES:
+		case GELLY_FEATURE::FLUIDSIM_ADAPTIVE_QUALITY:
+		case GELLY_FEATURE::FLUIDSIM_PARTICLE_REORDERING:
+		case GELLY_FEATURE::FLUIDSIM_SNAPSHOTS:
+		case GELLY_FEATURE::FLUIDSIM_LIVE_RESIZE:
+		case GELLY_FEATURE::FLUIDSIM_PARTICLE_BOUNDS:
 			return true;
 		default:
 			return false;
@@ -527,4 +1139,92 @@ void CD3D11FlexFluidSimulation::VisitLatestContactPlanes(
 
 	NvFlexUnmap(buffers.contactVelocities);
 	NvFlexUnmap(buffers.contactCounts);
+}
+
+void CD3D11FlexFluidSimulation::SetQualitySettings(
+	const SimQualitySettings &settings
+) {
+	qualityController.SetSettings(settings);
+}
+
+SimQualityStatus CD3D11FlexFluidSimulation::GetQualityStatus() {
+	return qualityController.GetStatus();
+}
+
+float CD3D11FlexFluidSimulation::GetParticleLocality() {
+	return particleLocality;
+}
+
+bool CD3D11FlexFluidSimulation::GetParticleBounds(
+	float lower[3], float upper[3]
+) {
+	if (simData->GetActiveParticles() == 0) {
+		return false;
+	}
+
+	bool valid = false;
+	for (const auto &bounds : {activeBounds, readbackBounds}) {
+		if (!bounds.valid) {
+			continue;
+		}
+
+		for (int axis = 0; axis < 3; axis++) {
+			lower[axis] =
+				valid ? std::min(lower[axis], bounds.lower[axis])
+					  : bounds.lower[axis];
+			upper[axis] =
+				valid ? std::max(upper[axis], bounds.upper[axis])
+					  : bounds.upper[axis];
+		}
+
+		valid = true;
+	}
+
+	return valid;
+}
+
+void CD3D11FlexFluidSimulation::CaptureSnapshot(CSimSnapshot &snapshot) {
+	// Capturing is rare enough that stalling on the solver is fine
+	WaitForResult();
+
+	const auto particleCount =
+		static_cast<uint>(simData->GetActiveParticles());
+
+	NvFlexCopyDesc copyDesc = {};
+	copyDesc.srcOffset = 0;
+	copyDesc.dstOffset = 0;
+	copyDesc.elementCount = static_cast<int>(particleCount);
+
+	NvFlexGetParticles(solver, buffers.positions, &copyDesc);
+	NvFlexGetVelocities(solver, buffers.velocities, &copyDesc);
+	NvFlexGetPhases(solver, buffers.phases, &copyDesc);
+
+	const auto *positions = static_cast<SimFloat4 *>(
+		NvFlexMap(buffers.positions, eNvFlexMapWait)
+	);
+	const auto *velocities = static_cast<SimFloat3 *>(
+		NvFlexMap(buffers.velocities, eNvFlexMapWait)
+	);
+	const auto *phases =
+		static_cast<int *>(NvFlexMap(buffers.phases, eNvFlexMapWait));
+
+	snapshot.Clear();
+	snapshot.positions.assign(positions, positions + particleCount);
+	snapshot.velocities.assign(velocities, velocities + particleCount);
+	snapshot.phases.assign(phases, phases + particleCount);
+
+	NvFlexUnmap(buffers.positions);
+	NvFlexUnmap(buffers.velocities);
+	NvFlexUnmap(buffers.phases);
+
+	scene->VisitObjectTransforms(
+		[&](ObjectHandle handle, const float position[3],
+			const float rotation[4]) {
+			snapshot.colliders.push_back(
+				{handle,
+				 {position[0], position[1], position[2]},
+				 {rotation[0], rotation[1], rotation[2], rotation[3]}}
+			);
+		}
+	);
 }
\ No newline at end of file
@@ -12,7 +12,8 @@ CD3D11RTFRFluidSimulation::CD3D11RTFRFluidSimulation()
 	  activeParticles(0),
 	  datasetInfo({}),
 	  dataset(),
-	  currentFrameIndex(0) {}
+	  currentFrameIndex(0),
+	  commandListPool(supportedCommands) {}
 
 CD3D11RTFRFluidSimulation::~CD3D11RTFRFluidSimulation() {
 	delete simData;
@@ -153,14 +154,12 @@ SimContextAPI CD3D11RTFRFluidSimulation::GetComputeAPI() {
 }
 
 ISimCommandList *CD3D11RTFRFluidSimulation::CreateCommandList() {
-	auto *commandList = new CSimpleSimCommandList(supportedCommands);
-	commandLists.push_back(commandList);
-	return commandList;
+	return commandListPool.Create();
 }
 
 void CD3D11RTFRFluidSimulation::DestroyCommandList(ISimCommandList *commandList
 ) {
-	delete commandList;
+	commandListPool.Destroy(commandList);
 }
 
 void CD3D11RTFRFluidSimulation::ExecuteCommandList(ISimCommandList *commandList
@@ -193,6 +192,17 @@ void CD3D11RTFRFluidSimulation::ExecuteCommandList(ISimCommandList *commandList
 	}
 }
 
+ISimCommandList *CD3D11RTFRFluidSimulation::BeginCommandList() {
+	return commandListPool.Acquire();
+}
+
+void CD3D11RTFRFluidSimulation::SubmitCommandList(ISimCommandList *commandList
+) {
+	commandListPool.ExecuteAndRelease(commandList, [this](auto *list) {
+		ExecuteCommandList(list);
+	});
+}
+
 void CD3D11RTFRFluidSimulation::AttachToContext(
 	const GellyObserverPtr<ISimContext> context
 ) {
@@ -216,6 +226,13 @@ void CD3D11RTFRFluidSimulation::Update(const float deltaTime) {
 	LoadFrameIntoBuffers();
 }
 
+void CD3D11RTFRFluidSimulation::KickUpdate(const float deltaTime) {
+	// Frames are uploaded on the spot, there's never anything to wait for.
+	Update(deltaTime);
+}
+
+void CD3D11RTFRFluidSimulation::WaitForResult() {}
+
 const char *CD3D11RTFRFluidSimulation::GetComputeDeviceName() { return "CPU"; }
 
 // Aside from the inherent base featureset, this simulation has nothing.
@@ -0,0 +1,83 @@
+#include "fluidsim/CD3D11StepTimer.h"
+
+#include <stdexcept>
+
+CD3D11StepTimer::CD3D11StepTimer(
+	ID3D11Device *device, ID3D11DeviceContext *deviceContext
+) :
+	deviceContext(deviceContext) {
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+
+	if (FAILED(device->CreateQuery(&queryDesc, &disjointQuery))) {
+		throw std::runtime_error(
+			"CD3D11StepTimer::CD3D11StepTimer: Failed to create the disjoint "
+			"query."
+		);
+	}
+
+	queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+	if (FAILED(device->CreateQuery(&queryDesc, &startQuery)) ||
+		FAILED(device->CreateQuery(&queryDesc, &endQuery))) {
+		throw std::runtime_error(
+			"CD3D11StepTimer::CD3D11StepTimer: Failed to create the timestamp "
+			"queries."
+		);
+	}
+}
+
+CD3D11StepTimer::~CD3D11StepTimer() {
+	if (disjointQuery != nullptr) {
+		disjointQuery->Release();
+	}
+
+	if (startQuery != nullptr) {
+		startQuery->Release();
+	}
+
+	if (endQuery != nullptr) {
+		endQuery->Release();
+	}
+}
+
+void CD3D11StepTimer::Begin() {
+	deviceContext->Begin(disjointQuery);
+	deviceContext->End(startQuery);
+}
+
+void CD3D11StepTimer::End() {
+	deviceContext->End(endQuery);
+	deviceContext->End(disjointQuery);
+	measuring = true;
+}
+
+std::optional<float> CD3D11StepTimer::Resolve() {
+	if (!measuring) {
+		return std::nullopt;
+	}
+
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData = {};
+	if (deviceContext->GetData(
+			disjointQuery,
+			&disjointData,
+			sizeof(disjointData),
+			D3D11_ASYNC_GETDATA_DONOTFLUSH
+		) != S_OK) {
+		return std::nullopt;
+	}
+
+	measuring = false;
+
+	UINT64 start = 0;
+	UINT64 end = 0;
+	if (disjointData.Disjoint ||
+		deviceContext->GetData(startQuery, &start, sizeof(start), 0) != S_OK ||
+		deviceContext->GetData(endQuery, &end, sizeof(end), 0) != S_OK) {
+		return std::nullopt;
+	}
+
+	return static_cast<float>(
+		static_cast<double>(end - start) * 1000.0 /
+		static_cast<double>(disjointData.Frequency)
+	);
+}
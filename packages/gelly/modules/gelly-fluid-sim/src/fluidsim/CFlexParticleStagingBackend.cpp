@@ -0,0 +1,104 @@
+#include "fluidsim/CFlexParticleStagingBackend.h"
+
+#include <stdexcept>
+
+CFlexParticleStagingBackend::CFlexParticleStagingBackend(
+	NvFlexLibrary *library, NvFlexSolver *solver
+) :
+	library(library), solver(solver) {}
+
+CFlexParticleStagingBackend::~CFlexParticleStagingBackend() {
+	for (SlotHandle slot = 0; slot < slots.size(); slot++) {
+		if (slots[slot].positions != nullptr) {
+			DestroySlot(slot);
+		}
+	}
+}
+
+const CFlexParticleStagingBackend::Slot &CFlexParticleStagingBackend::GetSlot(
+	SlotHandle slot
+) const {
+	if (slot >= slots.size() || slots[slot].positions == nullptr) {
+		throw std::out_of_range(
+			"CFlexParticleStagingBackend::GetSlot: Invalid slot handle"
+		);
+	}
+
+	return slots[slot];
+}
+
+IParticleStagingBackend::SlotHandle CFlexParticleStagingBackend::CreateSlot(
+	uint capacity
+) {
+	const int elementCount = static_cast<int>(capacity);
+
+	Slot slot = {};
+	slot.positions = NvFlexAllocBuffer(
+		library, elementCount, sizeof(SimFloat4), eNvFlexBufferHost
+	);
+
+	slot.velocities = NvFlexAllocBuffer(
+		library, elementCount, sizeof(SimFloat3), eNvFlexBufferHost
+	);
+
+	slot.phases =
+		NvFlexAllocBuffer(library, elementCount, sizeof(int), eNvFlexBufferHost);
+
+	slot.actives = NvFlexAllocBuffer(
+		library, elementCount, sizeof(uint), eNvFlexBufferHost
+	);
+
+	slots.push_back(slot);
+	return static_cast<SlotHandle>(slots.size() - 1);
+}
+
+void CFlexParticleStagingBackend::DestroySlot(SlotHandle slot) {
+	const auto &buffers = GetSlot(slot);
+	NvFlexFreeBuffer(buffers.positions);
+	NvFlexFreeBuffer(buffers.velocities);
+	NvFlexFreeBuffer(buffers.phases);
+	NvFlexFreeBuffer(buffers.actives);
+
+	slots[slot] = {};
+}
+
+ParticleStagingView CFlexParticleStagingBackend::MapSlot(SlotHandle slot) {
+	const auto &buffers = GetSlot(slot);
+
+	ParticleStagingView view = {};
+	view.positions = static_cast<SimFloat4 *>(
+		NvFlexMap(buffers.positions, eNvFlexMapWait)
+	);
+	view.velocities = static_cast<SimFloat3 *>(
+		NvFlexMap(buffers.velocities, eNvFlexMapWait)
+	);
+	view.phases = static_cast<int *>(NvFlexMap(buffers.phases, eNvFlexMapWait));
+	view.actives =
+		static_cast<uint *>(NvFlexMap(buffers.actives, eNvFlexMapWait));
+
+	return view;
+}
+
+void CFlexParticleStagingBackend::UnmapSlot(SlotHandle slot) {
+	const auto &buffers = GetSlot(slot);
+	NvFlexUnmap(buffers.positions);
+	NvFlexUnmap(buffers.velocities);
+	NvFlexUnmap(buffers.phases);
+	NvFlexUnmap(buffers.actives);
+}
+
+void CFlexParticleStagingBackend::UploadSlot(
+	SlotHandle slot, uint firstParticle, uint count
+) {
+	const auto &buffers = GetSlot(slot);
+
+	NvFlexCopyDesc copyDesc = {};
+	copyDesc.srcOffset = 0;
+	copyDesc.dstOffset = static_cast<int>(firstParticle);
+	copyDesc.elementCount = static_cast<int>(count);
+
+	NvFlexSetParticles(solver, buffers.positions, &copyDesc);
+	NvFlexSetVelocities(solver, buffers.velocities, &copyDesc);
+	NvFlexSetPhases(solver, buffers.phases, &copyDesc);
+	NvFlexSetActive(solver, buffers.actives, &copyDesc);
+}
@@ -0,0 +1,135 @@
+#include "fluidsim/CFlexParticleStagingRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+CFlexParticleStagingRing::CFlexParticleStagingRing(
+	IParticleStagingBackend *backend, uint slotCapacity
+) :
+	backend(backend), slotCapacity(slotCapacity) {
+	for (auto &slot : slots) {
+		slot = backend->CreateSlot(slotCapacity);
+	}
+}
+
+CFlexParticleStagingRing::~CFlexParticleStagingRing() {
+	for (const auto slot : slots) {
+		backend->DestroySlot(slot);
+	}
+}
+
+void CFlexParticleStagingRing::MapCurrentSlot() {
+	// By the time the ring wraps back around to this slot, its last copy has
+	// almost always finished, so this rarely ends up waiting.
+	mapped = backend->MapSlot(slots[currentSlot]);
+}
+
+void CFlexParticleStagingRing::UploadCurrentSlot() {
+	backend->UnmapSlot(slots[currentSlot]);
+	mapped = {};
+
+	if (slotFill > 0) {
+		backend->UploadSlot(slots[currentSlot], uploadOffset, slotFill);
+	}
+
+	uploadOffset += slotFill;
+	slotFill = 0;
+	currentSlot = (currentSlot + 1) % slotCount;
+}
+
+void CFlexParticleStagingRing::EnsureSlotSpace() {
+	if (slotFill == slotCapacity) {
+		UploadCurrentSlot();
+		MapCurrentSlot();
+	}
+}
+
+void CFlexParticleStagingRing::Begin(uint firstParticle, uint maxParticles) {
+	uploadOffset = firstParticle;
+	slotFill = 0;
+	particlesWritten = 0;
+	particleLimit = std::max(firstParticle, maxParticles) - firstParticle;
+
+	MapCurrentSlot();
+}
+
+uint CFlexParticleStagingRing::Write(
+	const SimFloat4 *positions,
+	const SimFloat3 *velocities,
+	const int *phases,
+	int defaultPhase,
+	float inverseMass,
+	uint count
+) {
+	count = std::min(count, particleLimit - particlesWritten);
+	const uint written = count;
+
+	while (count > 0) {
+		EnsureSlotSpace();
+
+		const uint runLength = std::min(count, slotCapacity - slotFill);
+		std::memcpy(
+			mapped.positions + slotFill,
+			positions,
+			runLength * sizeof(SimFloat4)
+		);
+
+		for (uint i = 0; i < runLength; i++) {
+			mapped.positions[slotFill + i].w = inverseMass;
+		}
+
+		std::memcpy(
+			mapped.velocities + slotFill,
+			velocities,
+			runLength * sizeof(SimFloat3)
+		);
+
+		if (phases != nullptr) {
+			std::memcpy(
+				mapped.phases + slotFill, phases, runLength * sizeof(int)
+			);
+			phases += runLength;
+		} else {
+			std::fill_n(mapped.phases + slotFill, runLength, defaultPhase);
+		}
+
+		std::iota(
+			mapped.actives + slotFill,
+			mapped.actives + slotFill + runLength,
+			uploadOffset + slotFill
+		);
+
+		positions += runLength;
+		velocities += runLength;
+		slotFill += runLength;
+		particlesWritten += runLength;
+		count -= runLength;
+	}
+
+	return written;
+}
+
+bool CFlexParticleStagingRing::WriteParticle(
+	const SimFloat4 &position, const SimFloat3 &velocity, int phase
+) {
+	if (particlesWritten == particleLimit) {
+		return false;
+	}
+
+	EnsureSlotSpace();
+
+	mapped.positions[slotFill] = position;
+	mapped.velocities[slotFill] = velocity;
+	mapped.phases[slotFill] = phase;
+	mapped.actives[slotFill] = uploadOffset + slotFill;
+
+	slotFill++;
+	particlesWritten++;
+	return true;
+}
+
+uint CFlexParticleStagingRing::End() {
+	UploadCurrentSlot();
+	return particlesWritten;
+}
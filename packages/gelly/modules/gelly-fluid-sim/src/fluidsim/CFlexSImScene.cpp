@@ -4,14 +4,12 @@
 
 #include <stdexcept>
 
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
 #include <float.h>
 
 #include <algorithm>
 #include <cmath>
-#undef min
-#undef max
+#include <cstring>
+#include <utility>
 // Would use XMVECTOR but we need to be able to pass this to NvFlex without
 // having alignment issues
 struct FlexFloat3 {
@@ -24,19 +22,84 @@ struct FlexQuat {
 
 using FlexFloat4 = FlexQuat;
 
+static FlexQuat MultiplyQuaternions(const FlexQuat &a, const FlexQuat &b) {
+	return {
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+	};
+}
+
+static FlexFloat3 RotateVector(const FlexQuat &q, const FlexFloat3 &v) {
+	// v + 2w(q x v) + 2q x (q x v)
+	const FlexFloat3 t = {
+		2.f * (q.y * v.z - q.z * v.y),
+		2.f * (q.z * v.x - q.x * v.z),
+		2.f * (q.x * v.y - q.y * v.x)
+	};
+
+	return {
+		v.x + q.w * t.x + (q.y * t.z - q.z * t.y),
+		v.y + q.w * t.y + (q.z * t.x - q.x * t.z),
+		v.z + q.w * t.z + (q.x * t.y - q.y * t.x)
+	};
+}
+
+/**
+ * \brief Places the object's shape in the world, offset from the object by
+ * its local transform.
+ */
+static void GetShapeTransform(
+	const ObjectData &object, FlexFloat4 &position, FlexQuat &rotation
+) {
+	const FlexQuat objectRotation = {
+		object.rotation[0],
+		object.rotation[1],
+		object.rotation[2],
+		object.rotation[3]
+	};
+	const FlexQuat localRotation = {
+		object.localRotation[0],
+		object.localRotation[1],
+		object.localRotation[2],
+		object.localRotation[3]
+	};
+	const FlexFloat3 offset = RotateVector(
+		objectRotation,
+		{object.localPosition[0],
+		 object.localPosition[1],
+		 object.localPosition[2]}
+	);
+
+	position = {
+		object.position[0] + offset.x,
+		object.position[1] + offset.y,
+		object.position[2] + offset.z,
+		1.f
+	};
+	rotation = MultiplyQuaternions(objectRotation, localRotation);
+}
+
 static NvFlexCollisionShapeType GetFlexShapeType(ObjectShape shape) {
 	switch (shape) {
 		case ObjectShape::TRIANGLE_MESH:
 			return eNvFlexShapeTriangleMesh;
 		case ObjectShape::CAPSULE:
 			return eNvFlexShapeCapsule;
+		case ObjectShape::CONVEX:
+			return eNvFlexShapeConvexMesh;
+		case ObjectShape::SPHERE:
+			return eNvFlexShapeSphere;
+		case ObjectShape::BOX:
+			return eNvFlexShapeBox;
 		default:
 			throw std::runtime_error("GetFlexShapeType: Invalid object shape");
 	}
 }
 
 CFlexSimScene::CFlexSimScene(NvFlexLibrary *library, NvFlexSolver *solver) :
-	library(library), solver(solver), objects({}) {
+	library(library), solver(solver) {
 	geometry.positions = NvFlexAllocBuffer(
 		library, maxColliders, sizeof(FlexFloat4), eNvFlexBufferHost
 	);
@@ -66,12 +129,12 @@ CFlexSimScene::CFlexSimScene(NvFlexLibrary *library, NvFlexSolver *solver) :
 }
 
 CFlexSimScene::~CFlexSimScene() {
-	for (const auto &object : objects) {
-		if (object.second.shape == ObjectShape::TRIANGLE_MESH) {
-			const auto &mesh =
-				std::get<ObjectData::TriangleMesh>(object.second.shapeData);
-			NvFlexDestroyTriangleMesh(library, mesh.id);
-		}
+	for (const auto &[key, mesh] : meshCache) {
+		NvFlexDestroyTriangleMesh(library, mesh.id);
+	}
+
+	for (const auto &[key, mesh] : convexCache) {
+		NvFlexDestroyConvexMesh(library, mesh.id);
 	}
 
 	NvFlexFreeBuffer(geometry.positions);
@@ -83,6 +146,14 @@ CFlexSimScene::~CFlexSimScene() {
 }
 
 ObjectHandle CFlexSimScene::CreateObject(const ObjectCreationParams &params) {
+	if (objects.size() >= maxColliders) {
+		throw std::runtime_error(
+			"CFlexSimScene::CreateObject: The scene is full, it can only "
+			"hold " +
+			std::to_string(maxColliders) + " objects"
+		);
+	}
+
 	ObjectData data = {};
 
 	switch (params.shape) {
@@ -96,17 +167,40 @@ ObjectHandle CFlexSimScene::CreateObject(const ObjectCreationParams &params) {
 				std::get<ObjectCreationParams::Capsule>(params.shapeData)
 			);
 			break;
+		case ObjectShape::CONVEX:
+			data = CreateConvex(
+				std::get<ObjectCreationParams::Convex>(params.shapeData)
+			);
+			break;
+		case ObjectShape::SPHERE:
+			data = CreateSphere(
+				std::get<ObjectCreationParams::Sphere>(params.shapeData)
+			);
+			break;
+		case ObjectShape::BOX:
+			data = CreateBox(
+				std::get<ObjectCreationParams::Box>(params.shapeData)
+			);
+			break;
 		default:
 			throw std::runtime_error(
 				"CFlexSimScene::CreateObject: Invalid object shape"
 			);
 	}
 
-	data.firstFrame = true;
-	objects[monotonicObjectId] = data;
-	dirty = true;
+	const auto slot = static_cast<uint>(objects.size());
+	const ObjectHandle handle = AllocateHandle(slot);
+
+	objects.push_back(data);
+	slotHandles.push_back(handle);
+	slotDirty.push_back(0);
+	MarkDirty(slot, SLOT_SHAPE);
+
+	// New objects are enabled, so they're moved in front of the disabled ones
+	SwapSlots(slot, enabledCount);
+	enabledCount++;
 
-	return monotonicObjectId++;
+	return handle;
 }
 
 void CFlexSimScene::RemoveObject(ObjectHandle handle) {
@@ -117,24 +211,92 @@ void CFlexSimScene::RemoveObject(ObjectHandle handle) {
 		);
 	}
 
-	const auto &object = objects.find(handle);
-	if (object == objects.end()) {
+	uint slot = FindSlot(handle);
+	if (slot == invalidSlot) {
 		return;
 	}
 
-	if (object->second.shape == ObjectShape::TRIANGLE_MESH) {
-		const auto &mesh =
-			std::get<ObjectData::TriangleMesh>(object->second.shapeData);
-		NvFlexDestroyTriangleMesh(library, mesh.id);
+	const auto &object = objects[slot];
+	if (object.shape == ObjectShape::TRIANGLE_MESH) {
+		const auto &mesh = std::get<ObjectData::TriangleMesh>(object.shapeData);
+		ReleaseTriangleMesh(mesh.id);
+	} else if (object.shape == ObjectShape::CONVEX) {
+		const auto &convex = std::get<ObjectData::Convex>(object.shapeData);
+		ReleaseConvexMesh(convex.id);
+	}
+
+	// Anything resting on the object is about to fall
+	removedBounds.push_back(
+		{{object.position[0], object.position[1], object.position[2]},
+		 object.boundingRadius}
+	);
+
+	// Disabling it first keeps the enabled objects packed too
+	if (slot < enabledCount) {
+		enabledCount--;
+		SwapSlots(slot, enabledCount);
+		slot = enabledCount;
+	}
+
+	// The last object fills the gap, so the slots stay packed
+	const auto lastSlot = static_cast<uint>(objects.size() - 1);
+	if (slot != lastSlot) {
+		objects[slot] = std::move(objects[lastSlot]);
+		slotHandles[slot] = slotHandles[lastSlot];
+		handleEntries[slotHandles[slot] & handleIndexMask].slot = slot;
+
+		// Whatever was pending for the removed object no longer applies
+		slotDirty[slot] = 0;
+		MarkDirty(slot, slotDirty[lastSlot] | SLOT_MOVED);
 	}
 
-	objects.erase(object);
+	objects.pop_back();
+	slotHandles.pop_back();
+	slotDirty.pop_back();
+	ReleaseHandle(handle);
+
+	shapesUploadRequired = true;
+}
+
+void CFlexSimScene::SetObjectEnabled(ObjectHandle handle, bool enabled) {
+	const uint slot = FindSlot(handle);
+	if (slot == invalidSlot) {
+		throw std::out_of_range(
+			"CFlexSimScene::SetObjectEnabled: Invalid object handle"
+		);
+	}
+
+	if (enabled == (slot < enabledCount)) {
+		return;
+	}
+
+	// Either way the object crosses the boundary between the enabled and
+	// disabled slots
+	if (enabled) {
+		SwapSlots(slot, enabledCount);
+		// The solver hasn't seen it since it was disabled, so it shouldn't
+		// sweep in from wherever it was back then
+		MarkDirty(enabledCount, SLOT_SHAPE);
+		enabledCount++;
+	} else {
+		enabledCount--;
+		SwapSlots(slot, enabledCount);
+	}
+
+	shapesUploadRequired = true;
 }
 
 void CFlexSimScene::SetObjectPosition(
 	ObjectHandle handle, float x, float y, float z
 ) {
-	auto &object = objects.at(handle);
+	const uint slot = FindSlot(handle);
+	if (slot == invalidSlot) {
+		throw std::out_of_range(
+			"CFlexSimScene::SetObjectPosition: Invalid object handle"
+		);
+	}
+
+	auto &object = objects[slot];
 	if (object.position[0] == x && object.position[1] == y &&
 		object.position[2] == z) {
 		return;
@@ -144,17 +306,25 @@ void CFlexSimScene::SetObjectPosition(
 		return;
 	}
 
+	MarkMoved(object);
 	object.position[0] = x;
 	object.position[1] = y;
 	object.position[2] = z;
 
-	dirty = true;
+	MarkDirty(slot, SLOT_TRANSFORM);
 }
 
 void CFlexSimScene::SetObjectQuaternion(
 	ObjectHandle handle, float x, float y, float z, float w
 ) {
-	auto &object = objects.at(handle);
+	const uint slot = FindSlot(handle);
+	if (slot == invalidSlot) {
+		throw std::out_of_range(
+			"CFlexSimScene::SetObjectQuaternion: Invalid object handle"
+		);
+	}
+
+	auto &object = objects[slot];
 	if (object.rotation[0] == x && object.rotation[1] == y &&
 		object.rotation[2] == z && object.rotation[3] == w) {
 		return;
@@ -164,17 +334,282 @@ void CFlexSimScene::SetObjectQuaternion(
 		return;
 	}
 
+	MarkMoved(object);
 	object.rotation[0] = x;
 	object.rotation[1] = y;
 	object.rotation[2] = z;
 	object.rotation[3] = w;
 
-	dirty = true;
+	MarkDirty(slot, SLOT_TRANSFORM);
+}
+
+DrainHandle CFlexSimScene::CreateDrain(const DrainCreationParams &params) {
+	DrainData data = {params};
+
+	switch (params.shape) {
+		case DrainShape::AABB: {
+			const auto &box =
+				std::get<DrainCreationParams::AABB>(params.shapeData);
+			for (int axis = 0; axis < 3; axis++) {
+				if (!std::isfinite(box.min[axis]) ||
+					!std::isfinite(box.max[axis])) {
+					throw std::invalid_argument(
+						"CFlexSimScene::CreateDrain: AABB must be finite"
+					);
+				}
+
+				// A flat box would only catch particles exactly on it
+				if (!(box.min[axis] < box.max[axis])) {
+					throw std::invalid_argument(
+						"CFlexSimScene::CreateDrain: AABB min must be less "
+						"than its max"
+					);
+				}
+			}
+			break;
+		}
+		case DrainShape::SPHERE: {
+			const auto &sphere =
+				std::get<DrainCreationParams::Sphere>(params.shapeData);
+			if (!std::isfinite(sphere.center[0]) ||
+				!std::isfinite(sphere.center[1]) ||
+				!std::isfinite(sphere.center[2]) ||
+				!std::isfinite(sphere.radius)) {
+				throw std::invalid_argument(
+					"CFlexSimScene::CreateDrain: Sphere must be finite"
+				);
+			}
+
+			if (sphere.radius <= 0.f) {
+				throw std::invalid_argument(
+					"CFlexSimScene::CreateDrain: Sphere radius must be greater "
+					"than 0"
+				);
+			}
+			break;
+		}
+		case DrainShape::PLANE: {
+			// Normalized up front so that the distance test stays cheap
+			auto &plane =
+				std::get<DrainCreationParams::Plane>(data.params.shapeData);
+			const float length = std::sqrt(
+				plane.normal[0] * plane.normal[0] +
+				plane.normal[1] * plane.normal[1] +
+				plane.normal[2] * plane.normal[2]
+			);
+
+			if (!std::isfinite(length) || !std::isfinite(plane.distance)) {
+				throw std::invalid_argument(
+					"CFlexSimScene::CreateDrain: Plane must be finite"
+				);
+			}
+
+			if (length <= 0.f) {
+				throw std::invalid_argument(
+					"CFlexSimScene::CreateDrain: Plane normal must not be zero"
+				);
+			}
+
+			plane.normal[0] /= length;
+			plane.normal[1] /= length;
+			plane.normal[2] /= length;
+			plane.distance /= length;
+			break;
+		}
+		default:
+			throw std::runtime_error(
+				"CFlexSimScene::CreateDrain: Invalid drain shape"
+			);
+	}
+
+	drains[monotonicDrainId] = data;
+	return monotonicDrainId++;
+}
+
+void CFlexSimScene::RemoveDrain(DrainHandle handle) { drains.erase(handle); }
+
+uint CFlexSimScene::GetDrainedParticleCount(DrainHandle handle) {
+	const auto drain = drains.find(handle);
+	return drain == drains.end() ? 0 : drain->second.drainedParticles;
+}
+
+bool CFlexSimScene::HasDrains() const { return !drains.empty(); }
+
+DrainHandle CFlexSimScene::FindDrain(const SimFloat4 &position) const {
+	for (const auto &[handle, drain] : drains) {
+		const auto &shapeData = drain.params.shapeData;
+		bool inside = false;
+
+		switch (drain.params.shape) {
+			case DrainShape::AABB: {
+				const auto &box =
+					std::get<DrainCreationParams::AABB>(shapeData);
+				inside = position.x >= box.min[0] && position.x <= box.max[0] &&
+						 position.y >= box.min[1] && position.y <= box.max[1] &&
+						 position.z >= box.min[2] && position.z <= box.max[2];
+				break;
+			}
+			case DrainShape::SPHERE: {
+				const auto &sphere =
+					std::get<DrainCreationParams::Sphere>(shapeData);
+				const float dx = position.x - sphere.center[0];
+				const float dy = position.y - sphere.center[1];
+				const float dz = position.z - sphere.center[2];
+				inside = dx * dx + dy * dy + dz * dz <=
+						 sphere.radius * sphere.radius;
+				break;
+			}
+			case DrainShape::PLANE: {
+				const auto &plane =
+					std::get<DrainCreationParams::Plane>(shapeData);
+				inside = plane.normal[0] * position.x +
+							 plane.normal[1] * position.y +
+							 plane.normal[2] * position.z <
+						 plane.distance;
+				break;
+			}
+		}
+
+		if (inside) {
+			return handle;
+		}
+	}
+
+	return INVALID_DRAIN_HANDLE;
+}
+
+void CFlexSimScene::AddDrainedParticles(
+	DrainHandle handle, uint particleCount
+) {
+	if (const auto drain = drains.find(handle); drain != drains.end()) {
+		drain->second.drainedParticles += particleCount;
+	}
+}
+
+void CFlexSimScene::SetObjectTransforms(
+	const ObjectHandle *handles,
+	const ObjectTransform *transforms,
+	uint objectCount
+) {
+	for (uint i = 0; i < objectCount; i++) {
+		const uint slot = FindSlot(handles[i]);
+		if (slot == invalidSlot) {
+			continue;
+		}
+
+		const auto &transform = transforms[i];
+		auto &data = objects[slot];
+
+		if (std::equal(
+				transform.position, transform.position + 3, data.position
+			) &&
+			std::equal(
+				transform.rotation, transform.rotation + 4, data.rotation
+			)) {
+			continue;
+		}
+
+		if (std::any_of(
+				transform.position,
+				transform.position + 3,
+				[](const float value) { return std::isnan(value); }
+			) ||
+			std::any_of(
+				transform.rotation,
+				transform.rotation + 4,
+				[](const float value) { return std::isnan(value); }
+			)) {
+			continue;
+		}
+
+		MarkMoved(data);
+		std::copy_n(transform.position, 3, data.position);
+		std::copy_n(transform.rotation, 4, data.rotation);
+
+		MarkDirty(slot, SLOT_TRANSFORM);
+	}
+}
+
+void CFlexSimScene::MarkMoved(ObjectData &object) {
+	if (object.moved) {
+		return;
+	}
+
+	object.moved = true;
+	object.movedFrom[0] = object.position[0];
+	object.movedFrom[1] = object.position[1];
+	object.movedFrom[2] = object.position[2];
+}
+
+void CFlexSimScene::MarkDirty(uint slot, uint8_t flags) {
+	// A slot may end up listed twice if it's emptied and refilled, Update
+	// only acts on the first entry.
+	if (slotDirty[slot] == 0) {
+		dirtySlots.push_back(slot);
+	}
+
+	slotDirty[slot] |= flags;
+}
+
+uint CFlexSimScene::FindSlot(ObjectHandle handle) const {
+	const uint index = handle & handleIndexMask;
+	if (handle == INVALID_OBJECT_HANDLE || index >= handleEntries.size()) {
+		return invalidSlot;
+	}
+
+	const auto &entry = handleEntries[index];
+	if (entry.generation != static_cast<uint8_t>(handle >> handleIndexBits)) {
+		return invalidSlot;
+	}
+
+	return entry.slot;
+}
+
+void CFlexSimScene::SwapSlots(uint first, uint second) {
+	if (first == second) {
+		return;
+	}
+
+	std::swap(objects[first], objects[second]);
+	std::swap(slotHandles[first], slotHandles[second]);
+	handleEntries[slotHandles[first] & handleIndexMask].slot = first;
+	handleEntries[slotHandles[second] & handleIndexMask].slot = second;
+
+	// Pending writes follow their objects
+	const uint8_t firstFlags = std::exchange(slotDirty[first], 0);
+	const uint8_t secondFlags = std::exchange(slotDirty[second], 0);
+	MarkDirty(first, secondFlags | SLOT_MOVED);
+	MarkDirty(second, firstFlags | SLOT_MOVED);
+}
+
+ObjectHandle CFlexSimScene::AllocateHandle(uint slot) {
+	uint index;
+	if (!freeHandles.empty()) {
+		index = freeHandles.back();
+		freeHandles.pop_back();
+	} else {
+		index = static_cast<uint>(handleEntries.size());
+		handleEntries.push_back({invalidSlot, 0});
+	}
+
+	auto &entry = handleEntries[index];
+	entry.slot = slot;
+
+	return static_cast<ObjectHandle>(entry.generation) << handleIndexBits |
+		   index;
+}
+
+void CFlexSimScene::ReleaseHandle(ObjectHandle handle) {
+	const uint index = handle & handleIndexMask;
+	auto &entry = handleEntries[index];
+
+	entry.slot = invalidSlot;
+	entry.generation++;
+	freeHandles.push_back(index);
 }
 
 void CFlexSimScene::Update() {
-	if (dirty) {
-		OutputDebugStringA("CFlexSimScene::Update: Dirty\n");
+	if (!dirtySlots.empty()) {
 		auto *info = static_cast<NvFlexCollisionGeometry *>(
 			NvFlexMap(geometry.info, eNvFlexMapWait)
 		);
@@ -195,65 +630,102 @@ void CFlexSimScene::Update() {
 			NvFlexMap(geometry.prevRotations, eNvFlexMapWait)
 		);
 
-		auto *flags =
+		auto *shapeFlags =
 			static_cast<int *>(NvFlexMap(geometry.flags, eNvFlexMapWait));
 
-		uint valueIndex = 0;
-		for (auto &object : objects) {
-			switch (object.second.shape) {
-				case ObjectShape::TRIANGLE_MESH: {
-					const auto &mesh = std::get<ObjectData::TriangleMesh>(
-						object.second.shapeData
-					);
-					info[valueIndex].triMesh.mesh = mesh.id;
-					info[valueIndex].triMesh.scale[0] = mesh.scale[0];
-					info[valueIndex].triMesh.scale[1] = mesh.scale[1];
-					info[valueIndex].triMesh.scale[2] = mesh.scale[2];
-					break;
-				}
-
-				case ObjectShape::CAPSULE: {
-					const auto &capsule =
-						std::get<ObjectData::Capsule>(object.second.shapeData);
-					info[valueIndex].capsule.radius = capsule.radius;
-					info[valueIndex].capsule.halfHeight = capsule.halfHeight;
-					break;
-				}
+		const auto objectCount = static_cast<uint>(objects.size());
+		for (const uint slot : dirtySlots) {
+			if (slot >= objectCount) {
+				continue;
 			}
 
-			if (object.second.firstFrame) {
-				// set their previous transform to the new one
-				object.second.firstFrame = false;
-				prevPositions[valueIndex].x = object.second.position[0];
-				prevPositions[valueIndex].y = object.second.position[1];
-				prevPositions[valueIndex].z = object.second.position[2];
-				prevPositions[valueIndex].w = 1.f;
-
-				prevRotations[valueIndex].x = object.second.rotation[0];
-				prevRotations[valueIndex].y = object.second.rotation[1];
-				prevRotations[valueIndex].z = object.second.rotation[2];
-				prevRotations[valueIndex].w = object.second.rotation[3];
-			} else {
-				prevPositions[valueIndex] = positions[valueIndex];
-				prevRotations[valueIndex] = rotations[valueIndex];
+			const uint8_t flags = std::exchange(slotDirty[slot], 0);
+			if (flags == 0) {
+				continue;
 			}
 
-			positions[valueIndex].x = object.second.position[0];
-			positions[valueIndex].y = object.second.position[1];
-			positions[valueIndex].z = object.second.position[2];
-			positions[valueIndex].w = 1.f;
+			auto &object = objects[slot];
+			FlexFloat4 position;
+			FlexQuat rotation;
+			GetShapeTransform(object, position, rotation);
+
+			if (flags & (SLOT_SHAPE | SLOT_MOVED)) {
+				switch (object.shape) {
+					case ObjectShape::TRIANGLE_MESH: {
+						const auto &mesh = std::get<ObjectData::TriangleMesh>(
+							object.shapeData
+						);
+						info[slot].triMesh.mesh = mesh.id;
+						info[slot].triMesh.scale[0] = mesh.scale[0];
+						info[slot].triMesh.scale[1] = mesh.scale[1];
+						info[slot].triMesh.scale[2] = mesh.scale[2];
+						break;
+					}
+
+					case ObjectShape::CAPSULE: {
+						const auto &capsule =
+							std::get<ObjectData::Capsule>(object.shapeData);
+						info[slot].capsule.radius = capsule.radius;
+						info[slot].capsule.halfHeight = capsule.halfHeight;
+						break;
+					}
+
+					case ObjectShape::CONVEX: {
+						const auto &convex =
+							std::get<ObjectData::Convex>(object.shapeData);
+						info[slot].convexMesh.mesh = convex.id;
+						info[slot].convexMesh.scale[0] = convex.scale[0];
+						info[slot].convexMesh.scale[1] = convex.scale[1];
+						info[slot].convexMesh.scale[2] = convex.scale[2];
+						break;
+					}
+
+					case ObjectShape::SPHERE: {
+						const auto &sphere =
+							std::get<ObjectData::Sphere>(object.shapeData);
+						info[slot].sphere.radius = sphere.radius;
+						break;
+					}
+
+					case ObjectShape::BOX: {
+						const auto &box =
+							std::get<ObjectData::Box>(object.shapeData);
+						info[slot].box.halfExtents[0] = box.halfExtents[0];
+						info[slot].box.halfExtents[1] = box.halfExtents[1];
+						info[slot].box.halfExtents[2] = box.halfExtents[2];
+						break;
+					}
+				}
 
-			rotations[valueIndex].x = object.second.rotation[0];
-			rotations[valueIndex].y = object.second.rotation[1];
-			rotations[valueIndex].z = object.second.rotation[2];
-			rotations[valueIndex].w = object.second.rotation[3];
+				shapeFlags[slot] =
+					NvFlexMakeShapeFlags(GetFlexShapeType(object.shape), true);
+			}
 
-			flags[valueIndex] = NvFlexMakeShapeFlags(
-				GetFlexShapeType(object.second.shape), true
-			);
+			// The solver sweeps shapes from their previous transform. New
+			// shapes start at rest, otherwise the sweep starts from wherever
+			// the object was last written, even if that was another slot. A
+			// settling object catches up and stops pushing fluid along.
+			FlexFloat4 prevPosition = position;
+			FlexQuat prevRotation = rotation;
+			if (!(flags & SLOT_SHAPE)) {
+				std::memcpy(
+					&prevPosition, object.shapePosition, sizeof(prevPosition)
+				);
+				std::memcpy(
+					&prevRotation, object.shapeRotation, sizeof(prevRotation)
+				);
+
+				if (flags & SLOT_TRANSFORM) {
+					settlingSlots.push_back(slot);
+				}
+			}
 
-			object.second.currentShapeIndex = valueIndex;
-			valueIndex++;
+			positions[slot] = position;
+			rotations[slot] = rotation;
+			prevPositions[slot] = prevPosition;
+			prevRotations[slot] = prevRotation;
+			std::memcpy(object.shapePosition, &position, sizeof(position));
+			std::memcpy(object.shapeRotation, &rotation, sizeof(rotation));
 		}
 
 		NvFlexUnmap(geometry.info);
@@ -263,9 +735,21 @@ void CFlexSimScene::Update() {
 		NvFlexUnmap(geometry.prevRotations);
 		NvFlexUnmap(geometry.flags);
 
-		dirty = false;
+		dirtySlots.clear();
+		for (const uint slot : settlingSlots) {
+			MarkDirty(slot, SLOT_SETTLE);
+		}
+
+		settlingSlots.clear();
+		shapesUploadRequired = true;
 	}
 
+	if (!shapesUploadRequired) {
+		return;
+	}
+
+	// FleX has no way to set a range of shapes, but only the dirty slots
+	// were written above. Disabled objects sit past the end.
 	NvFlexSetShapes(
 		solver,
 		geometry.info,
@@ -274,12 +758,105 @@ void CFlexSimScene::Update() {
 		geometry.prevPositions,
 		geometry.prevRotations,
 		geometry.flags,
-		objects.size()
+		static_cast<int>(enabledCount)
 	);
+
+	shapesUploadRequired = false;
 }
 
 ObjectData CFlexSimScene::CreateTriangleMesh(
 	const ObjectCreationParams::TriangleMesh &params
+) {
+	MeshKey key = GetTriangleMeshKey(params);
+	auto cached = meshCache.find(key);
+	if (cached == meshCache.end()) {
+		cached =
+			meshCache.emplace(std::move(key), BuildTriangleMesh(params)).first;
+		meshKeys[cached->second.id] = &cached->first;
+	}
+
+	auto &mesh = cached->second;
+	mesh.referenceCount++;
+
+	ObjectData data = {};
+	data.shape = ObjectShape::TRIANGLE_MESH;
+
+	const float extentX =
+		std::max(std::abs(mesh.minVertex[0]), std::abs(mesh.maxVertex[0]));
+	const float extentY =
+		std::max(std::abs(mesh.minVertex[1]), std::abs(mesh.maxVertex[1]));
+	const float extentZ =
+		std::max(std::abs(mesh.minVertex[2]), std::abs(mesh.maxVertex[2]));
+	const float maxScale =
+		std::max({params.scale[0], params.scale[1], params.scale[2]});
+
+	data.boundingRadius =
+		std::sqrt(extentX * extentX + extentY * extentY + extentZ * extentZ) *
+		maxScale;
+
+	data.position[0] = 0.0f;
+	data.position[1] = 0.0f;
+	data.position[2] = 0.0f;
+
+	data.rotation[0] = 0.0f;
+	data.rotation[1] = 0.0f;
+	data.rotation[2] = 0.0f;
+	data.rotation[3] = 1.0f;
+
+	// The scale isn't part of the mesh, so differently scaled objects can
+	// still share it
+	data.shapeData = ObjectData::TriangleMesh{
+		mesh.id, {params.scale[0], params.scale[1], params.scale[2]}
+	};
+
+	return data;
+}
+
+CFlexSimScene::MeshKey::MeshKey(std::vector<uint32_t> words)
+	: words(std::move(words)) {
+	// FNV-1a over whole words
+	constexpr uint64_t offsetBasis = 0xcbf29ce484222325ull;
+	constexpr uint64_t prime = 0x100000001b3ull;
+
+	hash = offsetBasis;
+	for (const uint32_t word : this->words) {
+		hash ^= word;
+		hash *= prime;
+	}
+}
+
+CFlexSimScene::MeshKey CFlexSimScene::GetTriangleMeshKey(
+	const ObjectCreationParams::TriangleMesh &params
+) {
+	// Indices are kept at full width, so a mesh matches itself whichever
+	// index type it was given with.
+	std::vector<uint32_t> words;
+	words.reserve(2 + params.vertexCount * 3 + params.indexCount);
+	words.push_back(params.vertexCount);
+	words.push_back(params.indexCount);
+
+	const size_t firstVertexWord = words.size();
+	words.resize(firstVertexWord + params.vertexCount * 3);
+	std::memcpy(
+		words.data() + firstVertexWord,
+		params.vertices,
+		params.vertexCount * 3 * sizeof(float)
+	);
+
+	for (uint i = 0; i < params.indexCount; i++) {
+		words.push_back(
+			params.indexType ==
+					ObjectCreationParams::TriangleMesh::IndexType::UINT16
+				? params.indices16[i]
+				: params.indices32[i]
+		);
+	}
+
+	return MeshKey(std::move(words));
+}
+
+CFlexSimScene::CachedMesh CFlexSimScene::BuildTriangleMesh(
+	const ObjectCreationParams::TriangleMesh &params
 ) const {
 	// a bit of preprocessing is required, we need to find the min/max vertex
 	FlexFloat3 minVertex = {FLT_MAX, FLT_MAX, FLT_MAX};
@@ -347,8 +924,41 @@ ObjectData CFlexSimScene::CreateTriangleMesh(
 		&maxVertex.x
 	);
 
+	// FleX copies the mesh when updating it
+	NvFlexFreeBuffer(indicesBuffer);
+	NvFlexFreeBuffer(verticesBuffer);
+
+	return {
+		meshId,
+		0,
+		{minVertex.x, minVertex.y, minVertex.z},
+		{maxVertex.x, maxVertex.y, maxVertex.z}
+	};
+}
+
+void CFlexSimScene::ReleaseTriangleMesh(NvFlexTriangleMeshId id) {
+	const auto key = meshKeys.find(id);
+	if (key == meshKeys.end()) {
+		return;
+	}
+
+	const auto cached = meshCache.find(*key->second);
+	if (--cached->second.referenceCount > 0) {
+		return;
+	}
+
+	NvFlexDestroyTriangleMesh(library, id);
+	meshKeys.erase(key);
+	meshCache.erase(cached);
+}
+
+ObjectData CFlexSimScene::CreateCapsule(
+	const ObjectCreationParams::Capsule &params
+) const {
 	ObjectData data = {};
-	data.shape = ObjectShape::TRIANGLE_MESH;
+
+	data.shape = ObjectShape::CAPSULE;
+	data.boundingRadius = params.radius + params.halfHeight;
 
 	data.position[0] = 0.0f;
 	data.position[1] = 0.0f;
@@ -359,19 +969,120 @@ ObjectData CFlexSimScene::CreateTriangleMesh(
 	data.rotation[2] = 0.0f;
 	data.rotation[3] = 1.0f;
 
-	data.shapeData = ObjectData::TriangleMesh{
-		meshId, {params.scale[0], params.scale[1], params.scale[2]}
-	};
+	data.shapeData = ObjectData::Capsule{params.radius, params.halfHeight};
 
 	return data;
 }
 
-ObjectData CFlexSimScene::CreateCapsule(
-	const ObjectCreationParams::Capsule &params
+ObjectData CFlexSimScene::CreateSphere(
+	const ObjectCreationParams::Sphere &params
 ) const {
+	if (!(params.radius > 0.f)) {
+		throw std::invalid_argument(
+			"CFlexSimScene::CreateSphere: The radius must be positive"
+		);
+	}
+
 	ObjectData data = {};
 
-	data.shape = ObjectShape::CAPSULE;
+	data.shape = ObjectShape::SPHERE;
+	data.boundingRadius =
+		std::sqrt(
+			params.center[0] * params.center[0] +
+			params.center[1] * params.center[1] +
+			params.center[2] * params.center[2]
+		) +
+		params.radius;
+
+	data.rotation[3] = 1.0f;
+	data.localPosition[0] = params.center[0];
+	data.localPosition[1] = params.center[1];
+	data.localPosition[2] = params.center[2];
+
+	data.shapeData = ObjectData::Sphere{params.radius};
+
+	return data;
+}
+
+ObjectData CFlexSimScene::CreateBox(const ObjectCreationParams::Box &params
+) const {
+	if (!(params.halfExtents[0] > 0.f && params.halfExtents[1] > 0.f &&
+		  params.halfExtents[2] > 0.f)) {
+		throw std::invalid_argument(
+			"CFlexSimScene::CreateBox: The half extents must be positive"
+		);
+	}
+
+	ObjectData data = {};
+
+	data.shape = ObjectShape::BOX;
+	const float *extents = params.halfExtents;
+	const float *center = params.center;
+	data.boundingRadius =
+		std::sqrt(
+			center[0] * center[0] + center[1] * center[1] +
+			center[2] * center[2]
+		) +
+		std::sqrt(
+			extents[0] * extents[0] + extents[1] * extents[1] +
+			extents[2] * extents[2]
+		);
+
+	data.rotation[3] = 1.0f;
+	for (int i = 0; i < 3; i++) {
+		data.localPosition[i] = params.center[i];
+	}
+
+	for (int i = 0; i < 4; i++) {
+		data.localRotation[i] = params.rotation[i];
+	}
+
+	data.shapeData = ObjectData::Box{
+		{params.halfExtents[0], params.halfExtents[1], params.halfExtents[2]}
+	};
+
+	return data;
+}
+
+ObjectData CFlexSimScene::CreateConvex(
+	const ObjectCreationParams::Convex &params
+) {
+	if (params.planes == nullptr || params.planeCount == 0) {
+		throw std::invalid_argument(
+			"CFlexSimScene::CreateConvex: A convex object needs at least one "
+			"plane"
+		);
+	}
+
+	MeshKey key = GetConvexKey(params);
+	auto cached = convexCache.find(key);
+	if (cached == convexCache.end()) {
+		cached = convexCache
+					 .emplace(
+						 std::move(key),
+						 CachedConvexMesh{BuildConvexMesh(params), 0}
+					 )
+					 .first;
+		convexKeys[cached->second.id] = &cached->first;
+	}
+
+	cached->second.referenceCount++;
+
+	ObjectData data = {};
+	data.shape = ObjectShape::CONVEX;
+
+	const float extentX =
+		std::max(std::abs(params.lower[0]), std::abs(params.upper[0]));
+	const float extentY =
+		std::max(std::abs(params.lower[1]), std::abs(params.upper[1]));
+	const float extentZ =
+		std::max(std::abs(params.lower[2]), std::abs(params.upper[2]));
+	const float maxScale =
+		std::max({params.scale[0], params.scale[1], params.scale[2]});
+
+	data.boundingRadius =
+		std::sqrt(extentX * extentX + extentY * extentY + extentZ * extentZ) *
+		maxScale;
 
 	data.position[0] = 0.0f;
 	data.position[1] = 0.0f;
@@ -382,27 +1093,111 @@ ObjectData CFlexSimScene::CreateCapsule(
 	data.rotation[2] = 0.0f;
 	data.rotation[3] = 1.0f;
 
-	data.shapeData = ObjectData::Capsule{params.radius, params.halfHeight};
+	data.shapeData = ObjectData::Convex{
+		cached->second.id, {params.scale[0], params.scale[1], params.scale[2]}
+	};
 
 	return data;
 }
 
-ObjectHandle CFlexSimScene::GetHandleFromShapeIndex(const uint &shapeIndex) {
-	const auto it = std::find_if(
-		objects.begin(),
-		objects.end(),
-		[&](const std::pair<ObjectHandle, ObjectData> &object) {
-			return object.second.currentShapeIndex == shapeIndex;
-		}
+CFlexSimScene::MeshKey CFlexSimScene::GetConvexKey(
+	const ObjectCreationParams::Convex &params
+) {
+	std::vector<uint32_t> words(1 + params.planeCount * 4 + 6);
+	words[0] = params.planeCount;
+
+	uint32_t *next = words.data() + 1;
+	std::memcpy(next, params.planes, params.planeCount * 4 * sizeof(float));
+	next += params.planeCount * 4;
+	std::memcpy(next, params.lower, 3 * sizeof(float));
+	std::memcpy(next + 3, params.upper, 3 * sizeof(float));
+
+	return MeshKey(std::move(words));
+}
+
+NvFlexConvexMeshId CFlexSimScene::BuildConvexMesh(
+	const ObjectCreationParams::Convex &params
+) const {
+	NvFlexBuffer *planesBuffer = NvFlexAllocBuffer(
+		library, params.planeCount, sizeof(FlexFloat4), eNvFlexBufferHost
+	);
+
+	void *planesDst = NvFlexMap(planesBuffer, eNvFlexMapWait);
+	std::memcpy(
+		planesDst, params.planes, params.planeCount * sizeof(FlexFloat4)
 	);
+	NvFlexUnmap(planesBuffer);
 
-	if (it == objects.end()) {
+	const auto meshId = NvFlexCreateConvexMesh(library);
+	NvFlexUpdateConvexMesh(
+		library,
+		meshId,
+		planesBuffer,
+		static_cast<int>(params.planeCount),
+		params.lower,
+		params.upper
+	);
+
+	NvFlexFreeBuffer(planesBuffer);
+	return meshId;
+}
+
+void CFlexSimScene::ReleaseConvexMesh(NvFlexConvexMeshId id) {
+	const auto key = convexKeys.find(id);
+	if (key == convexKeys.end()) {
+		return;
+	}
+
+	const auto cached = convexCache.find(*key->second);
+	if (--cached->second.referenceCount > 0) {
+		return;
+	}
+
+	NvFlexDestroyConvexMesh(library, id);
+	convexKeys.erase(key);
+	convexCache.erase(cached);
+}
+
+ObjectHandle CFlexSimScene::GetHandleFromShapeIndex(const uint &shapeIndex) {
+	if (shapeIndex >= slotHandles.size()) {
 		throw std::runtime_error(
 			"CFlexSimScene::GetHandleFromShapeIndex: Invalid shape index"
 		);
 	}
 
-	return it->first;
+	return slotHandles[shapeIndex];
+}
+
+NvFlexBuffer *CFlexSimScene::GetShapePositions() { return geometry.positions; }
+
+void CFlexSimScene::ConsumeDisturbances(const DisturbanceVisitor &visitor) {
+	for (auto &object : objects) {
+		if (!object.moved) {
+			continue;
+		}
+
+		visitor(object.movedFrom, object.boundingRadius);
+		visitor(object.position, object.boundingRadius);
+		object.moved = false;
+	}
+
+	for (const auto &bounds : removedBounds) {
+		visitor(bounds.position, bounds.radius);
+	}
+
+	removedBounds.clear();
 }
 
-NvFlexBuffer *CFlexSimScene::GetShapePositions() { return geometry.positions; }
\ No newline at end of file
+void CFlexSimScene::SetSolver(NvFlexSolver *solver) {
+	this->solver = solver;
+	shapesUploadRequired = true;
+}
+
+void CFlexSimScene::VisitObjectTransforms(const TransformVisitor &visitor
+) const {
+	for (size_t slot = 0; slot < objects.size(); slot++) {
+		visitor(
+			slotHandles[slot], objects[slot].position, objects[slot].rotation
+		);
+	}
+}
\ No newline at end of file
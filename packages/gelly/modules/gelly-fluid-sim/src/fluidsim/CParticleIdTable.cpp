@@ -0,0 +1,118 @@
+#include "fluidsim/CParticleIdTable.h"
+
+#include <stdexcept>
+
+ParticleId CParticleIdTable::Allocate(uint slot) {
+	uint index;
+	if (!freeIndices.empty()) {
+		index = freeIndices.back();
+		freeIndices.pop_back();
+	} else {
+		index = static_cast<uint>(indexToSlot.size());
+		// The all-ones index is reserved for INVALID_PARTICLE_ID
+		if (index >= indexMask) {
+			throw std::runtime_error(
+				"CParticleIdTable::Allocate: Ran out of particle IDs"
+			);
+		}
+
+		indexToSlot.push_back(INVALID_PARTICLE_SLOT);
+		indexGenerations.push_back(0);
+	}
+
+	indexToSlot[index] = slot;
+	return index | static_cast<uint>(indexGenerations[index]) << indexBits;
+}
+
+void CParticleIdTable::Release(ParticleId id) {
+	const uint index = id & indexMask;
+
+	indexToSlot[index] = INVALID_PARTICLE_SLOT;
+	indexGenerations[index]++;
+	freeIndices.push_back(index);
+}
+
+void CParticleIdTable::Clear() {
+	slotToId.clear();
+	indexToSlot.clear();
+	indexGenerations.clear();
+	freeIndices.clear();
+}
+
+void CParticleIdTable::Resize(uint particleCount) {
+	const auto oldCount = static_cast<uint>(slotToId.size());
+
+	for (uint slot = particleCount; slot < oldCount; slot++) {
+		Release(slotToId[slot]);
+	}
+
+	slotToId.resize(particleCount);
+	for (uint slot = oldCount; slot < particleCount; slot++) {
+		slotToId[slot] = Allocate(slot);
+	}
+}
+
+void CParticleIdTable::Remap(const uint *previousSlots, uint particleCount) {
+	const auto oldCount = static_cast<uint>(slotToId.size());
+
+	// The whole permutation is checked before anything changes, so a bad one
+	// leaves the table as it was. Whatever isn't carried over is left in the
+	// scratch and released afterwards.
+	remapScratch.assign(slotToId.begin(), slotToId.end());
+	for (uint slot = 0; slot < particleCount; slot++) {
+		const uint previousSlot = previousSlots[slot];
+		if (previousSlot >= oldCount) {
+			throw std::invalid_argument(
+				"CParticleIdTable::Remap: Previous slot is out of range"
+			);
+		}
+
+		if (remapScratch[previousSlot] == INVALID_PARTICLE_ID) {
+			throw std::invalid_argument(
+				"CParticleIdTable::Remap: Previous slot was used more than once"
+			);
+		}
+
+		remapScratch[previousSlot] = INVALID_PARTICLE_ID;
+	}
+
+	remappedIds.resize(particleCount);
+	for (uint slot = 0; slot < particleCount; slot++) {
+		const ParticleId id = slotToId[previousSlots[slot]];
+		remappedIds[slot] = id;
+		indexToSlot[id & indexMask] = slot;
+	}
+
+	slotToId.swap(remappedIds);
+
+	for (const ParticleId id : remapScratch) {
+		if (id != INVALID_PARTICLE_ID) {
+			Release(id);
+		}
+	}
+}
+
+ParticleId CParticleIdTable::GetId(uint slot) const {
+	if (slot >= slotToId.size()) {
+		return INVALID_PARTICLE_ID;
+	}
+
+	return slotToId[slot];
+}
+
+uint CParticleIdTable::GetSlot(ParticleId id) const {
+	const uint index = id & indexMask;
+	if (id == INVALID_PARTICLE_ID || index >= indexToSlot.size()) {
+		return INVALID_PARTICLE_SLOT;
+	}
+
+	if (indexGenerations[index] != static_cast<uint8_t>(id >> indexBits)) {
+		return INVALID_PARTICLE_SLOT;
+	}
+
+	return indexToSlot[index];
+}
+
+uint CParticleIdTable::GetParticleCount() const {
+	return static_cast<uint>(slotToId.size());
+}
@@ -0,0 +1,162 @@
+#include "fluidsim/CParticleReorderer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <execution>
+
+// 10 bits per axis, so the codes fit in 32 bits
+static constexpr uint32_t maxCellCoordinate = (1 << 10) - 1;
+
+uint32_t CParticleReorderer::SpreadBits(uint32_t value) {
+	value &= 0x000003FF;
+	value = (value | (value << 16)) & 0xFF0000FF;
+	value = (value | (value << 8)) & 0x0300F00F;
+	value = (value | (value << 4)) & 0x030C30C3;
+	value = (value | (value << 2)) & 0x09249249;
+	return value;
+}
+
+float CParticleReorderer::MeasureLocality(
+	const SimFloat4 *positions, uint particleCount, float particleRadius
+) {
+	if (particleCount < 2 || particleRadius <= 0.f) {
+		return 0.f;
+	}
+
+	double totalDistance = 0.0;
+	for (uint i = 1; i < particleCount; i++) {
+		const float dx = positions[i].x - positions[i - 1].x;
+		const float dy = positions[i].y - positions[i - 1].y;
+		const float dz = positions[i].z - positions[i - 1].z;
+
+		totalDistance += std::sqrt(dx * dx + dy * dy + dz * dz);
+	}
+
+	return static_cast<float>(
+		totalDistance / (particleCount - 1) / particleRadius
+	);
+}
+
+void CParticleReorderer::Prepare(
+	const SimFloat4 *positions,
+	const SimFloat3 *velocities,
+	const int *phases,
+	uint particleCount,
+	float particleRadius
+) {
+	SimFloat3 minPosition = {FLT_MAX, FLT_MAX, FLT_MAX};
+	SimFloat3 maxPosition = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+	for (uint i = 0; i < particleCount; i++) {
+		minPosition.x = std::min(minPosition.x, positions[i].x);
+		minPosition.y = std::min(minPosition.y, positions[i].y);
+		minPosition.z = std::min(minPosition.z, positions[i].z);
+
+		maxPosition.x = std::max(maxPosition.x, positions[i].x);
+		maxPosition.y = std::max(maxPosition.y, positions[i].y);
+		maxPosition.z = std::max(maxPosition.z, positions[i].z);
+	}
+
+	// Cells any smaller than a particle don't improve anything, so very
+	// spread out fluid just gets a coarser curve
+	const float extent = std::max(
+		{maxPosition.x - minPosition.x,
+		 maxPosition.y - minPosition.y,
+		 maxPosition.z - minPosition.z}
+	);
+	const float cellSize = std::max(
+		{extent / static_cast<float>(maxCellCoordinate),
+		 particleRadius,
+		 FLT_MIN}
+	);
+
+	const auto toCell = [&](float coordinate, float minCoordinate) {
+		const float cell = (coordinate - minCoordinate) / cellSize;
+		return static_cast<uint32_t>(
+			std::clamp(cell, 0.f, static_cast<float>(maxCellCoordinate))
+		);
+	};
+
+	keys.resize(particleCount);
+	for (uint i = 0; i < particleCount; i++) {
+		const auto &position = positions[i];
+		keys[i] = {
+			SpreadBits(toCell(position.x, minPosition.x)) |
+				SpreadBits(toCell(position.y, minPosition.y)) << 1 |
+				SpreadBits(toCell(position.z, minPosition.z)) << 2,
+			i
+		};
+	}
+
+	// Ties are broken by slot so the order doesn't churn for no reason
+	std::sort(
+		std::execution::par_unseq,
+		keys.begin(),
+		keys.end(),
+		[](const SortKey &a, const SortKey &b) {
+			return a.code < b.code || (a.code == b.code && a.slot < b.slot);
+		}
+	);
+
+	previousSlots.resize(particleCount);
+	std::transform(
+		std::execution::par_unseq,
+		keys.begin(),
+		keys.end(),
+		previousSlots.begin(),
+		[](const SortKey &key) { return key.slot; }
+	);
+
+	this->positions.resize(particleCount);
+	this->velocities.resize(particleCount);
+	this->phases.resize(particleCount);
+
+	std::transform(
+		std::execution::par_unseq,
+		previousSlots.begin(),
+		previousSlots.end(),
+		this->positions.begin(),
+		[&](uint slot) { return positions[slot]; }
+	);
+
+	std::transform(
+		std::execution::par_unseq,
+		previousSlots.begin(),
+		previousSlots.end(),
+		this->velocities.begin(),
+		[&](uint slot) { return velocities[slot]; }
+	);
+
+	std::transform(
+		std::execution::par_unseq,
+		previousSlots.begin(),
+		previousSlots.end(),
+		this->phases.begin(),
+		[&](uint slot) { return phases[slot]; }
+	);
+
+	pending = true;
+}
+
+void CParticleReorderer::Clear() { pending = false; }
+
+bool CParticleReorderer::IsPending() const { return pending; }
+
+uint CParticleReorderer::GetParticleCount() const {
+	return static_cast<uint>(previousSlots.size());
+}
+
+const uint *CParticleReorderer::GetPreviousSlots() const {
+	return previousSlots.data();
+}
+
+const SimFloat4 *CParticleReorderer::GetPositions() const {
+	return positions.data();
+}
+
+const SimFloat3 *CParticleReorderer::GetVelocities() const {
+	return velocities.data();
+}
+
+const int *CParticleReorderer::GetPhases() const { return phases.data(); }
@@ -0,0 +1,181 @@
+#include "fluidsim/CParticleSleepTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+CParticleSleepTracker::CParticleSleepTracker(uint8_t checksToSleep) :
+	checksToSleep(checksToSleep) {}
+
+void CParticleSleepTracker::Reset() {
+	activeSetChanged = activeSetChanged || sleepingCount > 0;
+
+	stillChecks.clear();
+	asleep.clear();
+	sleepingCount = 0;
+	colliderDisturbances.clear();
+}
+
+void CParticleSleepTracker::DisturbCollider(
+	const SimFloat3 &position, float radius
+) {
+	colliderDisturbances.push_back({position, radius});
+}
+
+uint64_t CParticleSleepTracker::GetCellKey(int x, int y, int z) const {
+	// 21 bits per axis is plenty for any map at the cell sizes we use
+	constexpr uint64_t mask = (1 << 21) - 1;
+	return (static_cast<uint64_t>(x) & mask) |
+		   (static_cast<uint64_t>(y) & mask) << 21 |
+		   (static_cast<uint64_t>(z) & mask) << 42;
+}
+
+void CParticleSleepTracker::DisturbAround(const SimFloat4 &position) {
+	const int cellX = static_cast<int>(std::floor(position.x / cellSize));
+	const int cellY = static_cast<int>(std::floor(position.y / cellSize));
+	const int cellZ = static_cast<int>(std::floor(position.z / cellSize));
+
+	for (int z = -1; z <= 1; z++) {
+		for (int y = -1; y <= 1; y++) {
+			for (int x = -1; x <= 1; x++) {
+				disturbedCells.insert(
+					GetCellKey(cellX + x, cellY + y, cellZ + z)
+				);
+			}
+		}
+	}
+}
+
+bool CParticleSleepTracker::IsDisturbed(const SimFloat4 &position) const {
+	const int cellX = static_cast<int>(std::floor(position.x / cellSize));
+	const int cellY = static_cast<int>(std::floor(position.y / cellSize));
+	const int cellZ = static_cast<int>(std::floor(position.z / cellSize));
+
+	if (disturbedCells.count(GetCellKey(cellX, cellY, cellZ)) > 0) {
+		return true;
+	}
+
+	for (const auto &collider : colliderDisturbances) {
+		const float dx = position.x - collider.position.x;
+		const float dy = position.y - collider.position.y;
+		const float dz = position.z - collider.position.z;
+		const float reach = collider.radius + cellSize;
+
+		if (dx * dx + dy * dy + dz * dz <= reach * reach) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CParticleSleepTracker::Check(
+	const SimFloat4 *positions,
+	const SimFloat3 *velocities,
+	uint particleCount,
+	float sleepSpeed,
+	float wakeDistance
+) {
+	if (particleCount < asleep.size()) {
+		// Particles were cleared since the last check
+		Reset();
+	}
+
+	stillChecks.resize(particleCount, 0);
+	asleep.resize(particleCount, 0);
+	cellSize = std::max(wakeDistance, 1e-3f);
+	disturbedCells.clear();
+
+	const float sleepSpeedSquared = sleepSpeed * sleepSpeed;
+
+	// First find everything that's still moving, so that it can wake up any
+	// sleeping neighbours below
+	for (uint i = 0; i < particleCount; i++) {
+		if (asleep[i]) {
+			continue;
+		}
+
+		const auto &velocity = velocities[i];
+		const float speedSquared = velocity.x * velocity.x +
+								   velocity.y * velocity.y +
+								   velocity.z * velocity.z;
+
+		if (speedSquared < sleepSpeedSquared) {
+			stillChecks[i] = std::min<uint8_t>(stillChecks[i] + 1, 0xFF);
+		} else {
+			stillChecks[i] = 0;
+			DisturbAround(positions[i]);
+		}
+	}
+
+	for (uint i = 0; i < particleCount; i++) {
+		if (asleep[i]) {
+			if (IsDisturbed(positions[i])) {
+				asleep[i] = 0;
+				stillChecks[i] = 0;
+				sleepingCount--;
+				activeSetChanged = true;
+			}
+		} else if (stillChecks[i] >= checksToSleep &&
+				   !IsDisturbed(positions[i])) {
+			asleep[i] = 1;
+			sleepingCount++;
+			activeSetChanged = true;
+		}
+	}
+
+	colliderDisturbances.clear();
+}
+
+void CParticleSleepTracker::Remap(
+	const uint *previousSlots, uint particleCount
+) {
+	const auto trackedCount = static_cast<uint>(asleep.size());
+
+	remapScratch.assign(particleCount, 0);
+	for (uint i = 0; i < particleCount; i++) {
+		if (previousSlots[i] < trackedCount) {
+			remapScratch[i] = stillChecks[previousSlots[i]];
+		}
+	}
+	stillChecks.swap(remapScratch);
+
+	remapScratch.assign(particleCount, 0);
+	sleepingCount = 0;
+	for (uint i = 0; i < particleCount; i++) {
+		if (previousSlots[i] < trackedCount) {
+			remapScratch[i] = asleep[previousSlots[i]];
+			sleepingCount += remapScratch[i];
+		}
+	}
+	asleep.swap(remapScratch);
+
+	// The active set is made of slots, so it's stale either way
+	activeSetChanged = activeSetChanged || sleepingCount > 0;
+}
+
+bool CParticleSleepTracker::HasActiveSetChanged() const {
+	return activeSetChanged;
+}
+
+uint CParticleSleepTracker::GetSleepingCount() const { return sleepingCount; }
+
+uint CParticleSleepTracker::FillActiveIndices(
+	uint *indices, uint particleCount
+) {
+	uint activeCount = 0;
+	const uint trackedCount =
+		std::min(particleCount, static_cast<uint>(asleep.size()));
+
+	for (uint i = 0; i < trackedCount; i++) {
+		if (!asleep[i]) {
+			indices[activeCount++] = i;
+		}
+	}
+
+	for (uint i = trackedCount; i < particleCount; i++) {
+		indices[activeCount++] = i;
+	}
+
+	activeSetChanged = false;
+	return activeCount;
+}
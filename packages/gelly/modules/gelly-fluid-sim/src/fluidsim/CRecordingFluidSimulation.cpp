@@ -0,0 +1,163 @@
+#include "fluidsim/CRecordingFluidSimulation.h"
+
+CRecordingFluidSimulation::CRecordingFluidSimulation(IFluidSimulation *sim) :
+	sim(sim) {
+	scene.SetScene(sim->GetScene());
+}
+
+CRecordingFluidSimulation::~CRecordingFluidSimulation() {
+	StopRecording();
+	delete sim;
+}
+
+void CRecordingFluidSimulation::StartRecording(
+	const std::filesystem::path &path
+) {
+	writer = std::make_unique<CSimTraceWriter>(
+		path, sim->GetSimulationData()->GetMaxParticles()
+	);
+
+	scene.SetWriter(writer.get());
+}
+
+void CRecordingFluidSimulation::StopRecording() {
+	scene.SetWriter(nullptr);
+
+	if (writer) {
+		writer->Flush();
+		writer.reset();
+	}
+}
+
+bool CRecordingFluidSimulation::IsRecording() const {
+	return writer != nullptr;
+}
+
+void CRecordingFluidSimulation::SetMaxParticles(int maxParticles) {
+	sim->SetMaxParticles(maxParticles);
+}
+
+void CRecordingFluidSimulation::Initialize() {
+	sim->Initialize();
+	// the underlying scene gets recreated when initializing
+	scene.SetScene(sim->GetScene());
+}
+
+ISimData *CRecordingFluidSimulation::GetSimulationData() {
+	return sim->GetSimulationData();
+}
+
+ISimScene *CRecordingFluidSimulation::GetScene() {
+	if (sim->GetScene() == nullptr) {
+		return nullptr;
+	}
+
+	return &scene;
+}
+
+SimContextAPI CRecordingFluidSimulation::GetComputeAPI() {
+	return sim->GetComputeAPI();
+}
+
+void CRecordingFluidSimulation::AttachToContext(
+	GellyObserverPtr<ISimContext> context
+) {
+	sim->AttachToContext(context);
+}
+
+ISimCommandList *CRecordingFluidSimulation::CreateCommandList() {
+	return sim->CreateCommandList();
+}
+
+void CRecordingFluidSimulation::DestroyCommandList(ISimCommandList *commandList
+) {
+	sim->DestroyCommandList(commandList);
+}
+
+void CRecordingFluidSimulation::ExecuteCommandList(ISimCommandList *commandList
+) {
+	if (writer && commandList != nullptr) {
+		writer->WriteCommandList(commandList);
+	}
+
+	sim->ExecuteCommandList(commandList);
+}
+
+ISimCommandList *CRecordingFluidSimulation::BeginCommandList() {
+	return sim->BeginCommandList();
+}
+
+void CRecordingFluidSimulation::SubmitCommandList(ISimCommandList *commandList
+) {
+	if (writer && commandList != nullptr) {
+		writer->WriteCommandList(commandList);
+	}
+
+	sim->SubmitCommandList(commandList);
+}
+
+void CRecordingFluidSimulation::Update(float deltaTime) {
+	if (writer) {
+		writer->WriteUpdate(deltaTime);
+	}
+
+	sim->Update(deltaTime);
+}
+
+void CRecordingFluidSimulation::KickUpdate(float deltaTime) {
+	if (writer) {
+		// Replays are synchronous, the handoff doesn't change the results
+		writer->WriteUpdate(deltaTime);
+	}
+
+	sim->KickUpdate(deltaTime);
+}
+
+void CRecordingFluidSimulation::WaitForResult() { sim->WaitForResult(); }
+
+void CRecordingFluidSimulation::SetTimeStepMultiplier(float timeStepMultiplier
+) {
+	if (writer) {
+		writer->WriteTimeStepMultiplier(timeStepMultiplier);
+	}
+
+	sim->SetTimeStepMultiplier(timeStepMultiplier);
+}
+
+const char *CRecordingFluidSimulation::GetComputeDeviceName() {
+	return sim->GetComputeDeviceName();
+}
+
+bool CRecordingFluidSimulation::CheckFeatureSupport(GELLY_FEATURE feature) {
+	return sim->CheckFeatureSupport(feature);
+}
+
+void CRecordingFluidSimulation::VisitLatestContactPlanes(
+	ContactPlaneVisitor visitor
+) {
+	sim->VisitLatestContactPlanes(visitor);
+}
+
+void CRecordingFluidSimulation::SetQualitySettings(
+	const SimQualitySettings &settings
+) {
+	sim->SetQualitySettings(settings);
+}
+
+SimQualityStatus CRecordingFluidSimulation::GetQualityStatus() {
+	return sim->GetQualityStatus();
+}
+
+float CRecordingFluidSimulation::GetParticleLocality() {
+	return sim->GetParticleLocality();
+}
+
+void CRecordingFluidSimulation::CaptureSnapshot(CSimSnapshot &snapshot) {
+	sim->CaptureSnapshot(snapshot);
+}
+
+bool CRecordingFluidSimulation::GetParticleBounds(
+	float lower[3], float upper[3]
+) {
+	return sim->GetParticleBounds(lower, upper);
+}
\ No newline at end of file
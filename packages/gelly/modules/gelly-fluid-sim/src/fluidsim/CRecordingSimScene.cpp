@@ -0,0 +1,116 @@
+#include "fluidsim/CRecordingSimScene.h"
+
+#include "fluidsim/CSimTraceWriter.h"
+
+void CRecordingSimScene::SetScene(ISimScene *scene) { this->scene = scene; }
+
+void CRecordingSimScene::SetWriter(CSimTraceWriter *writer) {
+	this->writer = writer;
+}
+
+ObjectHandle CRecordingSimScene::CreateObject(
+	const ObjectCreationParams &params
+) {
+	const ObjectHandle handle = scene->CreateObject(params);
+
+	if (writer != nullptr && handle != INVALID_OBJECT_HANDLE) {
+		writer->WriteCreateObject(handle, params);
+	}
+
+	return handle;
+}
+
+void CRecordingSimScene::RemoveObject(ObjectHandle handle) {
+	if (writer != nullptr) {
+		writer->WriteRemoveObject(handle);
+	}
+
+	scene->RemoveObject(handle);
+}
+
+void CRecordingSimScene::SetObjectEnabled(ObjectHandle handle, bool enabled) {
+	if (writer != nullptr) {
+		writer->WriteObjectEnabled(handle, enabled);
+	}
+
+	scene->SetObjectEnabled(handle, enabled);
+}
+
+void CRecordingSimScene::SetObjectPosition(
+	ObjectHandle handle, float x, float y, float z
+) {
+	if (writer != nullptr) {
+		writer->WriteObjectPosition(handle, x, y, z);
+	}
+
+	scene->SetObjectPosition(handle, x, y, z);
+}
+
+void CRecordingSimScene::SetObjectQuaternion(
+	ObjectHandle handle, float x, float y, float z, float w
+) {
+	if (writer != nullptr) {
+		writer->WriteObjectQuaternion(handle, x, y, z, w);
+	}
+
+	scene->SetObjectQuaternion(handle, x, y, z, w);
+}
+
+void CRecordingSimScene::SetObjectTransforms(
+	const ObjectHandle *handles,
+	const ObjectTransform *transforms,
+	uint objectCount
+) {
+	// Recorded one object at a time, which replays to the same result
+	if (writer != nullptr) {
+		for (uint i = 0; i < objectCount; i++) {
+			const auto &transform = transforms[i];
+			writer->WriteObjectPosition(
+				handles[i],
+				transform.position[0],
+				transform.position[1],
+				transform.position[2]
+			);
+			writer->WriteObjectQuaternion(
+				handles[i],
+				transform.rotation[0],
+				transform.rotation[1],
+				transform.rotation[2],
+				transform.rotation[3]
+			);
+		}
+	}
+
+	scene->SetObjectTransforms(handles, transforms, objectCount);
+}
+
+DrainHandle CRecordingSimScene::CreateDrain(const DrainCreationParams &params
+) {
+	const DrainHandle handle = scene->CreateDrain(params);
+
+	if (writer != nullptr) {
+		writer->WriteCreateDrain(handle, params);
+	}
+
+	return handle;
+}
+
+void CRecordingSimScene::RemoveDrain(DrainHandle handle) {
+	if (writer != nullptr) {
+		writer->WriteRemoveDrain(handle);
+	}
+
+	scene->RemoveDrain(handle);
+}
+
+uint CRecordingSimScene::GetDrainedParticleCount(DrainHandle handle) {
+	return scene->GetDrainedParticleCount(handle);
+}
+
+void CRecordingSimScene::Update() {
+	if (writer != nullptr) {
+		writer->WriteSceneUpdate();
+	}
+
+	scene->Update();
+}
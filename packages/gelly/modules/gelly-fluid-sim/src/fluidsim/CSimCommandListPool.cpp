@@ -0,0 +1,79 @@
+#include "fluidsim/CSimCommandListPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+CSimCommandListPool::CSimCommandListPool(SimCommandType supportedCommands) :
+	supportedCommands(supportedCommands),
+	createdLists(),
+	pooledLists(),
+	freeLists() {}
+
+ISimCommandList *CSimCommandListPool::Create() {
+	return createdLists
+		.emplace_back(std::make_unique<CSimpleSimCommandList>(supportedCommands)
+		)
+		.get();
+}
+
+void CSimCommandListPool::Destroy(ISimCommandList *commandList) {
+	if (commandList == nullptr) {
+		return;
+	}
+
+	const auto it = std::find_if(
+		createdLists.begin(),
+		createdLists.end(),
+		[&](const CommandListPtr &list) { return list.get() == commandList; }
+	);
+
+	if (it == createdLists.end()) {
+		throw std::invalid_argument(
+			"CSimCommandListPool::Destroy: commandList is not owned by this "
+			"pool, it may have already been destroyed."
+		);
+	}
+
+	createdLists.erase(it);
+}
+
+ISimCommandList *CSimCommandListPool::Acquire() {
+	if (freeLists.empty()) {
+		return pooledLists
+			.emplace_back(
+				std::make_unique<CSimpleSimCommandList>(supportedCommands)
+			)
+			.get();
+	}
+
+	auto *commandList = freeLists.back();
+	freeLists.pop_back();
+	return commandList;
+}
+
+void CSimCommandListPool::Release(ISimCommandList *commandList) {
+	const auto it = std::find_if(
+		pooledLists.begin(),
+		pooledLists.end(),
+		[&](const CommandListPtr &list) { return list.get() == commandList; }
+	);
+
+	if (it == pooledLists.end()) {
+		throw std::invalid_argument(
+			"CSimCommandListPool::Release: commandList was not acquired from "
+			"this pool."
+		);
+	}
+
+	if (std::find(freeLists.begin(), freeLists.end(), it->get()) !=
+		freeLists.end()) {
+		throw std::invalid_argument(
+			"CSimCommandListPool::Release: commandList has already been "
+			"released."
+		);
+	}
+
+	// clearing keeps the capacity, which is the whole point of the pool
+	(*it)->ClearCommands();
+	freeLists.push_back(it->get());
+}
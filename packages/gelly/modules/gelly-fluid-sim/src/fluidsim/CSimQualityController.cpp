@@ -0,0 +1,96 @@
+#include "fluidsim/CSimQualityController.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+CSimQualityController::CSimQualityController(
+	const SimQualitySettings &settings
+) {
+	SetSettings(settings);
+}
+
+void CSimQualityController::SetSettings(const SimQualitySettings &settings) {
+	if (settings.minIterations < 1 || settings.minSubsteps < 1 ||
+		settings.maxIterations < settings.minIterations ||
+		settings.maxSubsteps < settings.minSubsteps) {
+		throw std::invalid_argument(
+			"CSimQualityController::SetSettings: quality bounds must be at "
+			"least 1 and the maximums can't be below the minimums."
+		);
+	}
+
+	if (settings.targetStepTimeMs <= 0.f) {
+		throw std::invalid_argument(
+			"CSimQualityController::SetSettings: targetStepTimeMs must be "
+			"positive."
+		);
+	}
+
+	this->settings = settings;
+	iterations = settings.maxIterations;
+	substeps = settings.maxSubsteps;
+	samplesOverBudget = 0;
+	samplesUnderBudget = 0;
+}
+
+void CSimQualityController::Downgrade() {
+	if (iterations > settings.minIterations) {
+		iterations--;
+	} else if (substeps > settings.minSubsteps) {
+		substeps--;
+	}
+}
+
+void CSimQualityController::Upgrade() {
+	if (substeps < settings.maxSubsteps) {
+		substeps++;
+	} else if (iterations < settings.maxIterations) {
+		iterations++;
+	}
+}
+
+bool CSimQualityController::AddSample(float stepTimeMs) {
+	smoothedStepTimeMs += (stepTimeMs - smoothedStepTimeMs) * smoothingFactor;
+
+	if (!settings.adaptive) {
+		return false;
+	}
+
+	const int previousIterations = iterations;
+	const int previousSubsteps = substeps;
+
+	if (smoothedStepTimeMs > settings.targetStepTimeMs) {
+		samplesUnderBudget = 0;
+		if (++samplesOverBudget >= downgradeSamples) {
+			samplesOverBudget = 0;
+			Downgrade();
+		}
+	} else if (smoothedStepTimeMs <
+			   settings.targetStepTimeMs * upgradeHeadroom) {
+		samplesOverBudget = 0;
+		if (++samplesUnderBudget >= upgradeSamples) {
+			samplesUnderBudget = 0;
+			Upgrade();
+		}
+	} else {
+		// Inside the band, so the current quality is about right
+		samplesOverBudget = 0;
+		samplesUnderBudget = 0;
+	}
+
+	return iterations != previousIterations || substeps != previousSubsteps;
+}
+
+int CSimQualityController::GetIterations() const { return iterations; }
+
+int CSimQualityController::GetSubsteps() const { return substeps; }
+
+SimQualityStatus CSimQualityController::GetStatus() const {
+	return {
+		settings.adaptive,
+		smoothedStepTimeMs,
+		settings.targetStepTimeMs,
+		iterations,
+		substeps
+	};
+}
@@ -0,0 +1,307 @@
+#include "fluidsim/CSimSnapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "fluidsim/IFluidSimulation.h"
+
+namespace {
+constexpr uint32_t MAGIC = 0x504E5347;	// "GSNP"
+constexpr uint32_t VERSION = 1;
+constexpr float QUANTIZED_MAX = 65535.f;
+
+struct Header {
+	uint32_t magic;
+	uint32_t version;
+	CSimSnapshot::Quantization quantization;
+	uint8_t hasAbsorptions;
+	uint32_t particleCount;
+	uint32_t colliderCount;
+};
+
+template <typename T>
+void Write(std::ostream &stream, const T &value) {
+	static_assert(std::is_trivially_copyable_v<T>);
+	stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+void WriteArray(std::ostream &stream, const T *values, size_t count) {
+	static_assert(std::is_trivially_copyable_v<T>);
+	stream.write(reinterpret_cast<const char *>(values), sizeof(T) * count);
+}
+
+template <typename T>
+void Read(std::istream &stream, T &value) {
+	static_assert(std::is_trivially_copyable_v<T>);
+	stream.read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+template <typename T>
+void ReadArray(std::istream &stream, T *values, size_t count) {
+	static_assert(std::is_trivially_copyable_v<T>);
+	stream.read(reinterpret_cast<char *>(values), sizeof(T) * count);
+}
+
+uint16_t Quantize(float value, float min, float range) {
+	if (range <= 0.f) {
+		return 0;
+	}
+
+	const float normalized = std::clamp((value - min) / range, 0.f, 1.f);
+	return static_cast<uint16_t>(std::lround(normalized * QUANTIZED_MAX));
+}
+
+float Dequantize(uint16_t value, float min, float range) {
+	return min + static_cast<float>(value) / QUANTIZED_MAX * range;
+}
+
+/**
+ * \brief Quantizes xyz triples, which are laid out with the given stride.
+ */
+void WriteQuantized(
+	std::ostream &stream, const float *values, size_t count, size_t stride
+) {
+	float min[3] = {0.f, 0.f, 0.f};
+	float max[3] = {0.f, 0.f, 0.f};
+
+	for (size_t i = 0; i < count; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			const float value = values[i * stride + axis];
+			min[axis] = i == 0 ? value : std::min(min[axis], value);
+			max[axis] = i == 0 ? value : std::max(max[axis], value);
+		}
+	}
+
+	const float range[3] = {
+		max[0] - min[0], max[1] - min[1], max[2] - min[2]
+	};
+
+	Write(stream, min);
+	Write(stream, range);
+
+	for (size_t i = 0; i < count; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			Write(
+				stream,
+				Quantize(values[i * stride + axis], min[axis], range[axis])
+			);
+		}
+	}
+}
+
+void ReadQuantized(
+	std::istream &stream, float *values, size_t count, size_t stride
+) {
+	float min[3];
+	float range[3];
+	Read(stream, min);
+	Read(stream, range);
+
+	for (size_t i = 0; i < count; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			uint16_t value;
+			Read(stream, value);
+			values[i * stride + axis] =
+				Dequantize(value, min[axis], range[axis]);
+		}
+	}
+}
+}  // namespace
+
+void CSimSnapshot::Clear() {
+	positions.clear();
+	velocities.clear();
+	phases.clear();
+	absorptions.clear();
+	colliders.clear();
+}
+
+uint CSimSnapshot::GetParticleCount() const {
+	return static_cast<uint>(positions.size());
+}
+
+void CSimSnapshot::Write(std::ostream &stream, Quantization quantization)
+	const {
+	const size_t particleCount = positions.size();
+	if (velocities.size() != particleCount || phases.size() != particleCount ||
+		(!absorptions.empty() && absorptions.size() != particleCount)) {
+		throw std::invalid_argument(
+			"CSimSnapshot::Write: Particle arrays have mismatched sizes"
+		);
+	}
+
+	::Write(
+		stream,
+		Header{
+			MAGIC,
+			VERSION,
+			quantization,
+			static_cast<uint8_t>(!absorptions.empty()),
+			static_cast<uint32_t>(particleCount),
+			static_cast<uint32_t>(colliders.size())
+		}
+	);
+
+	if (quantization == Quantization::BITS_16) {
+		WriteQuantized(
+			stream,
+			reinterpret_cast<const float *>(positions.data()),
+			particleCount,
+			sizeof(SimFloat4) / 4
+		);
+		WriteQuantized(
+			stream,
+			reinterpret_cast<const float *>(velocities.data()),
+			particleCount,
+			sizeof(SimFloat3) / 4
+		);
+
+		// Inverse masses are left alone, they're usually all the same anyway
+		for (const auto &position : positions) {
+			::Write(stream, position.w);
+		}
+	} else {
+		WriteArray(stream, positions.data(), particleCount);
+		WriteArray(stream, velocities.data(), particleCount);
+	}
+
+	WriteArray(stream, phases.data(), particleCount);
+	WriteArray(stream, absorptions.data(), absorptions.size());
+	WriteArray(stream, colliders.data(), colliders.size());
+
+	if (!stream) {
+		throw std::runtime_error("CSimSnapshot::Write: Failed to write");
+	}
+}
+
+void CSimSnapshot::Read(std::istream &stream) {
+	Header header = {};
+	::Read(stream, header);
+
+	if (!stream || header.magic != MAGIC) {
+		throw std::runtime_error("CSimSnapshot::Read: Not a snapshot");
+	}
+
+	if (header.version != VERSION) {
+		throw std::runtime_error(
+			"CSimSnapshot::Read: Snapshot version " +
+			std::to_string(header.version) + " is not supported"
+		);
+	}
+
+	const size_t particleCount = header.particleCount;
+	positions.resize(particleCount);
+	velocities.resize(particleCount);
+	phases.resize(particleCount);
+	absorptions.resize(header.hasAbsorptions ? particleCount : 0);
+	colliders.resize(header.colliderCount);
+
+	if (header.quantization == Quantization::BITS_16) {
+		ReadQuantized(
+			stream,
+			reinterpret_cast<float *>(positions.data()),
+			particleCount,
+			sizeof(SimFloat4) / 4
+		);
+		ReadQuantized(
+			stream,
+			reinterpret_cast<float *>(velocities.data()),
+			particleCount,
+			sizeof(SimFloat3) / 4
+		);
+
+		for (auto &position : positions) {
+			::Read(stream, position.w);
+		}
+	} else {
+		ReadArray(stream, positions.data(), particleCount);
+		ReadArray(stream, velocities.data(), particleCount);
+	}
+
+	ReadArray(stream, phases.data(), particleCount);
+	ReadArray(stream, absorptions.data(), absorptions.size());
+	ReadArray(stream, colliders.data(), colliders.size());
+
+	if (!stream) {
+		Clear();
+		throw std::runtime_error(
+			"CSimSnapshot::Read: Snapshot ended unexpectedly"
+		);
+	}
+}
+
+void CSimSnapshot::WriteToFile(
+	const std::filesystem::path &path, Quantization quantization
+) const {
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	if (!stream) {
+		throw std::runtime_error(
+			"CSimSnapshot::WriteToFile: Failed to open " + path.string() +
+			" for writing"
+		);
+	}
+
+	Write(stream, quantization);
+}
+
+void CSimSnapshot::ReadFromFile(const std::filesystem::path &path) {
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream) {
+		throw std::runtime_error(
+			"CSimSnapshot::ReadFromFile: Failed to open " + path.string()
+		);
+	}
+
+	Read(stream);
+}
+
+void CSimSnapshot::Restore(IFluidSimulation *sim, bool restoreColliders)
+	const {
+	auto *commandList = sim->BeginCommandList();
+	commandList->AddCommand(SimCommand{RESET, Reset{}});
+
+	if (!positions.empty()) {
+		commandList->AddCommand(SimCommand{
+			ADD_PARTICLE_BATCH,
+			AddParticleBatch{
+				positions.data(),
+				velocities.data(),
+				phases.data(),
+				GetParticleCount()
+			}
+		});
+	}
+
+	sim->SubmitCommandList(commandList);
+
+	if (!restoreColliders) {
+		return;
+	}
+
+	auto *scene = sim->GetScene();
+	if (scene == nullptr) {
+		return;
+	}
+
+	for (const auto &collider : colliders) {
+		scene->SetObjectPosition(
+			collider.handle,
+			collider.position[0],
+			collider.position[1],
+			collider.position[2]
+		);
+
+		scene->SetObjectQuaternion(
+			collider.handle,
+			collider.rotation[0],
+			collider.rotation[1],
+			collider.rotation[2],
+			collider.rotation[3]
+		);
+	}
+}
@@ -0,0 +1,55 @@
+#include "fluidsim/CSimStepController.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Callers usually pass the fixed step itself, which doesn't always add up to
+// a whole step in floating point. This keeps that from alternating between
+// zero and two steps per frame.
+static constexpr float STEP_TOLERANCE = 1e-3f;
+
+CSimStepController::CSimStepController(
+	float fixedDeltaTime, int maxStepsPerFrame
+) :
+	fixedDeltaTime(fixedDeltaTime), maxStepsPerFrame(maxStepsPerFrame) {
+	if (fixedDeltaTime <= 0.f) {
+		throw std::invalid_argument(
+			"CSimStepController::CSimStepController: fixedDeltaTime must be "
+			"positive."
+		);
+	}
+
+	if (maxStepsPerFrame < 1) {
+		throw std::invalid_argument(
+			"CSimStepController::CSimStepController: maxStepsPerFrame must be "
+			"at least 1."
+		);
+	}
+}
+
+int CSimStepController::Advance(float deltaTime) {
+	accumulator += std::max(deltaTime, 0.f);
+
+	const float threshold = fixedDeltaTime * (1.f - STEP_TOLERANCE);
+	int steps = 0;
+	while (accumulator >= threshold && steps < maxStepsPerFrame) {
+		accumulator = std::max(accumulator - fixedDeltaTime, 0.f);
+		steps++;
+	}
+
+	if (accumulator >= threshold) {
+		// We're too far behind to catch up, so drop the backlog instead of
+		// making the next frame even slower.
+		accumulator = 0.f;
+	}
+
+	return steps;
+}
+
+float CSimStepController::GetInterpolationAlpha() const {
+	return std::clamp(accumulator / fixedDeltaTime, 0.f, 1.f);
+}
+
+float CSimStepController::GetFixedDeltaTime() const { return fixedDeltaTime; }
+
+void CSimStepController::Reset() { accumulator = 0.f; }
@@ -0,0 +1,333 @@
+#include "fluidsim/CSimTraceReplayer.h"
+
+#include <stdexcept>
+#include <string>
+
+using namespace Gelly::SimTrace;
+
+CSimTraceReplayer::CSimTraceReplayer(const std::filesystem::path &path) :
+	stream(path, std::ios::binary) {
+	if (!stream) {
+		throw std::runtime_error(
+			"CSimTraceReplayer::CSimTraceReplayer: failed to open " +
+			path.string()
+		);
+	}
+
+	header = Read<Header>();
+	if (header.magic != MAGIC) {
+		throw std::runtime_error(
+			"CSimTraceReplayer::CSimTraceReplayer: " + path.string() +
+			" is not a simulation trace."
+		);
+	}
+
+	if (header.version != VERSION) {
+		throw std::runtime_error(
+			"CSimTraceReplayer::CSimTraceReplayer: trace version " +
+			std::to_string(header.version) + " is not supported."
+		);
+	}
+}
+
+void CSimTraceReplayer::ReadBytes(void *destination, size_t size) {
+	stream.read(static_cast<char *>(destination), size);
+
+	if (static_cast<size_t>(stream.gcount()) != size) {
+		throw std::runtime_error(
+			"CSimTraceReplayer::ReadBytes: trace ended in the middle of a "
+			"record."
+		);
+	}
+}
+
+int CSimTraceReplayer::GetMaxParticles() const { return header.maxParticles; }
+
+uint CSimTraceReplayer::GetFramesReplayed() const { return framesReplayed; }
+
+void CSimTraceReplayer::ReplayCommandList(IFluidSimulation *sim) {
+	const auto commandCount = Read<uint32_t>();
+
+	struct BatchOffsets {
+		size_t commandIndex;
+		size_t particleOffset;
+		bool hasPhases;
+	};
+
+	commands.clear();
+	batchPositions.clear();
+	batchVelocities.clear();
+	batchPhases.clear();
+
+	// The batches can only point into the staging vectors once they've
+	// stopped growing, so their pointers are patched up after reading.
+	std::vector<BatchOffsets> batches;
+
+	for (uint32_t i = 0; i < commandCount; i++) {
+		SimCommand command{};
+		command.type = static_cast<SimCommandType>(Read<uint32_t>());
+
+		switch (command.type) {
+			case ADD_PARTICLE:
+				command.data = Read<AddParticle>();
+				break;
+			case CHANGE_RADIUS:
+				command.data = Read<ChangeRadius>();
+				break;
+			case RESET:
+				command.data = Reset{};
+				break;
+			case SET_FLUID_PROPERTIES:
+				command.data = Read<SetFluidProperties>();
+				break;
+			case ADD_PARTICLE_BATCH: {
+				const auto particleCount = Read<uint32_t>();
+				const bool hasPhases = Read<uint8_t>() != 0;
+				const size_t offset = batchPositions.size();
+
+				batchPositions.resize(offset + particleCount);
+				batchVelocities.resize(offset + particleCount);
+				ReadBytes(
+					batchPositions.data() + offset,
+					particleCount * sizeof(SimFloat4)
+				);
+				ReadBytes(
+					batchVelocities.data() + offset,
+					particleCount * sizeof(SimFloat3)
+				);
+
+				if (hasPhases) {
+					batchPhases.resize(offset + particleCount);
+					ReadBytes(
+						batchPhases.data() + offset,
+						particleCount * sizeof(int)
+					);
+				}
+
+				batches.push_back({commands.size(), offset, hasPhases});
+				command.data = AddParticleBatch{
+					nullptr, nullptr, nullptr, particleCount
+				};
+				break;
+			}
+			default:
+				throw std::runtime_error(
+					"CSimTraceReplayer::ReplayCommandList: unknown command "
+					"type " +
+					std::to_string(command.type)
+				);
+		}
+
+		commands.push_back(command);
+	}
+
+	for (const auto &batch : batches) {
+		auto &data =
+			std::get<AddParticleBatch>(commands[batch.commandIndex].data);
+		data.positions = batchPositions.data() + batch.particleOffset;
+		data.velocities = batchVelocities.data() + batch.particleOffset;
+		data.phases = batch.hasPhases
+						  ? batchPhases.data() + batch.particleOffset
+						  : nullptr;
+	}
+
+	auto *commandList = sim->BeginCommandList();
+	commandList->Reserve(commands.size());
+	for (const auto &command : commands) {
+		commandList->AddCommand(command);
+	}
+
+	sim->SubmitCommandList(commandList);
+}
+
+void CSimTraceReplayer::ReplayCreateObject(ISimScene *scene) {
+	const auto recordedHandle = Read<ObjectHandle>();
+
+	ObjectCreationParams params = {};
+	params.shape = Read<ObjectShape>();
+
+	switch (params.shape) {
+		case ObjectShape::TRIANGLE_MESH: {
+			using TriangleMesh = ObjectCreationParams::TriangleMesh;
+
+			TriangleMesh mesh = {};
+			mesh.indexType = Read<TriangleMesh::IndexType>();
+			mesh.vertexCount = Read<uint>();
+			mesh.indexCount = Read<uint>();
+			ReadBytes(mesh.scale, sizeof(mesh.scale));
+
+			meshVertices.resize(mesh.vertexCount * 3);
+			ReadBytes(meshVertices.data(), meshVertices.size() * sizeof(float));
+
+			const size_t indexSize =
+				mesh.indexType == TriangleMesh::IndexType::UINT16
+					? sizeof(uint16_t)
+					: sizeof(uint32_t);
+
+			meshIndices.resize(mesh.indexCount * indexSize);
+			ReadBytes(meshIndices.data(), meshIndices.size());
+
+			mesh.vertices = meshVertices.data();
+			if (mesh.indexType == TriangleMesh::IndexType::UINT16) {
+				mesh.indices16 =
+					reinterpret_cast<const uint16_t *>(meshIndices.data());
+			} else {
+				mesh.indices32 =
+					reinterpret_cast<const uint32_t *>(meshIndices.data());
+			}
+
+			params.shapeData = mesh;
+			break;
+		}
+		case ObjectShape::CAPSULE:
+			params.shapeData = Read<ObjectCreationParams::Capsule>();
+			break;
+		case ObjectShape::SPHERE:
+			params.shapeData = Read<ObjectCreationParams::Sphere>();
+			break;
+		case ObjectShape::BOX:
+			params.shapeData = Read<ObjectCreationParams::Box>();
+			break;
+		case ObjectShape::CONVEX: {
+			ObjectCreationParams::Convex convex = {};
+			convex.planeCount = Read<uint>();
+			ReadBytes(convex.lower, sizeof(convex.lower));
+			ReadBytes(convex.upper, sizeof(convex.upper));
+			ReadBytes(convex.scale, sizeof(convex.scale));
+
+			// The planes take the place of the vertices
+			meshVertices.resize(convex.planeCount * 4);
+			ReadBytes(meshVertices.data(), meshVertices.size() * sizeof(float));
+			convex.planes = meshVertices.data();
+
+			params.shapeData = convex;
+			break;
+		}
+		default:
+			throw std::runtime_error(
+				"CSimTraceReplayer::ReplayCreateObject: unknown object shape."
+			);
+	}
+
+	if (scene != nullptr) {
+		objectHandles[recordedHandle] = scene->CreateObject(params);
+	}
+}
+
+ObjectHandle CSimTraceReplayer::ReadObjectHandle() {
+	const auto recordedHandle = Read<ObjectHandle>();
+
+	if (const auto it = objectHandles.find(recordedHandle);
+		it != objectHandles.end()) {
+		return it->second;
+	}
+
+	return INVALID_OBJECT_HANDLE;
+}
+
+void CSimTraceReplayer::ReplayCreateDrain(ISimScene *scene) {
+	const auto recordedHandle = Read<DrainHandle>();
+
+	DrainCreationParams params = {};
+	params.shape = Read<DrainShape>();
+
+	switch (params.shape) {
+		case DrainShape::AABB:
+			params.shapeData = Read<DrainCreationParams::AABB>();
+			break;
+		case DrainShape::SPHERE:
+			params.shapeData = Read<DrainCreationParams::Sphere>();
+			break;
+		case DrainShape::PLANE:
+			params.shapeData = Read<DrainCreationParams::Plane>();
+			break;
+		default:
+			throw std::runtime_error(
+				"CSimTraceReplayer::ReplayCreateDrain: unknown drain shape."
+			);
+	}
+
+	if (scene != nullptr) {
+		drainHandles[recordedHandle] = scene->CreateDrain(params);
+	}
+}
+
+bool CSimTraceReplayer::ReplayFrame(IFluidSimulation *sim) {
+	ISimScene *scene = sim->GetScene();
+
+	while (stream.peek() != std::ifstream::traits_type::eof()) {
+		switch (Read<Record>()) {
+			case Record::EXECUTE_COMMAND_LIST:
+				ReplayCommandList(sim);
+				break;
+			case Record::CREATE_OBJECT:
+				ReplayCreateObject(scene);
+				break;
+			case Record::REMOVE_OBJECT: {
+				const ObjectHandle handle = ReadObjectHandle();
+				if (scene != nullptr && handle != INVALID_OBJECT_HANDLE) {
+					scene->RemoveObject(handle);
+				}
+				break;
+			}
+			case Record::SET_OBJECT_ENABLED: {
+				const ObjectHandle handle = ReadObjectHandle();
+				const bool enabled = Read<uint8_t>() != 0;
+				if (scene != nullptr && handle != INVALID_OBJECT_HANDLE) {
+					scene->SetObjectEnabled(handle, enabled);
+				}
+				break;
+			}
+			case Record::SET_OBJECT_POSITION: {
+				const ObjectHandle handle = ReadObjectHandle();
+				const auto position = Read<SimFloat3>();
+				if (scene != nullptr && handle != INVALID_OBJECT_HANDLE) {
+					scene->SetObjectPosition(
+						handle, position.x, position.y, position.z
+					);
+				}
+				break;
+			}
+			case Record::SET_OBJECT_QUATERNION: {
+				const ObjectHandle handle = ReadObjectHandle();
+				const auto rotation = Read<SimFloat4>();
+				if (scene != nullptr && handle != INVALID_OBJECT_HANDLE) {
+					scene->SetObjectQuaternion(
+						handle, rotation.x, rotation.y, rotation.z, rotation.w
+					);
+				}
+				break;
+			}
+			case Record::CREATE_DRAIN:
+				ReplayCreateDrain(scene);
+				break;
+			case Record::REMOVE_DRAIN: {
+				const auto recordedHandle = Read<DrainHandle>();
+				if (const auto it = drainHandles.find(recordedHandle);
+					scene != nullptr && it != drainHandles.end()) {
+					scene->RemoveDrain(it->second);
+					drainHandles.erase(it);
+				}
+				break;
+			}
+			case Record::UPDATE_SCENE:
+				if (scene != nullptr) {
+					scene->Update();
+				}
+				break;
+			case Record::UPDATE:
+				sim->Update(Read<float>());
+				framesReplayed++;
+				return true;
+			case Record::SET_TIME_STEP_MULTIPLIER:
+				sim->SetTimeStepMultiplier(Read<float>());
+				break;
+			default:
+				throw std::runtime_error(
+					"CSimTraceReplayer::ReplayFrame: unknown record type."
+				);
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,175 @@
+#include "fluidsim/CSimTraceWriter.h"
+
+#include <stdexcept>
+
+using namespace Gelly::SimTrace;
+
+CSimTraceWriter::CSimTraceWriter(
+	const std::filesystem::path &path, int maxParticles
+) :
+	stream(path, std::ios::binary | std::ios::trunc) {
+	if (!stream) {
+		throw std::runtime_error(
+			"CSimTraceWriter::CSimTraceWriter: failed to open " +
+			path.string() + " for writing."
+		);
+	}
+
+	Write(Header{MAGIC, VERSION, maxParticles});
+}
+
+void CSimTraceWriter::WriteCommand(const SimCommand &command) {
+	Write(static_cast<uint32_t>(command.type));
+
+	std::visit(
+		[&](auto &&arg) {
+			using T = std::decay_t<decltype(arg)>;
+			if constexpr (std::is_same_v<T, AddParticleBatch>) {
+				// The batch only points at the caller's memory, so the actual
+				// particle data has to be written out here.
+				Write(static_cast<uint32_t>(arg.particleCount));
+				Write(static_cast<uint8_t>(arg.phases != nullptr));
+				WriteArray(arg.positions, arg.particleCount);
+				WriteArray(arg.velocities, arg.particleCount);
+
+				if (arg.phases != nullptr) {
+					WriteArray(arg.phases, arg.particleCount);
+				}
+			} else if constexpr (!std::is_same_v<T, Reset>) {
+				Write(arg);
+			}
+		},
+		command.data
+	);
+}
+
+void CSimTraceWriter::WriteCommandList(ISimCommandList *commandList) {
+	const auto [begin, end] = commandList->GetCommands();
+
+	Write(Record::EXECUTE_COMMAND_LIST);
+	Write(static_cast<uint32_t>(std::distance(begin, end)));
+
+	for (auto it = begin; it != end; ++it) {
+		WriteCommand(*it);
+	}
+}
+
+void CSimTraceWriter::WriteCreateObject(
+	ObjectHandle handle, const ObjectCreationParams &params
+) {
+	Write(Record::CREATE_OBJECT);
+	Write(handle);
+	Write(params.shape);
+
+	switch (params.shape) {
+		case ObjectShape::TRIANGLE_MESH: {
+			const auto &mesh =
+				std::get<ObjectCreationParams::TriangleMesh>(params.shapeData);
+
+			Write(mesh.indexType);
+			Write(mesh.vertexCount);
+			Write(mesh.indexCount);
+			Write(mesh.scale);
+			WriteArray(mesh.vertices, mesh.vertexCount * 3);
+
+			if (mesh.indexType ==
+				ObjectCreationParams::TriangleMesh::IndexType::UINT16) {
+				WriteArray(mesh.indices16, mesh.indexCount);
+			} else {
+				WriteArray(mesh.indices32, mesh.indexCount);
+			}
+			break;
+		}
+		case ObjectShape::CAPSULE:
+			Write(std::get<ObjectCreationParams::Capsule>(params.shapeData));
+			break;
+		case ObjectShape::SPHERE:
+			Write(std::get<ObjectCreationParams::Sphere>(params.shapeData));
+			break;
+		case ObjectShape::BOX:
+			Write(std::get<ObjectCreationParams::Box>(params.shapeData));
+			break;
+		case ObjectShape::CONVEX: {
+			const auto &convex =
+				std::get<ObjectCreationParams::Convex>(params.shapeData);
+
+			Write(convex.planeCount);
+			Write(convex.lower);
+			Write(convex.upper);
+			Write(convex.scale);
+			WriteArray(convex.planes, convex.planeCount * 4);
+			break;
+		}
+	}
+}
+
+void CSimTraceWriter::WriteRemoveObject(ObjectHandle handle) {
+	Write(Record::REMOVE_OBJECT);
+	Write(handle);
+}
+
+void CSimTraceWriter::WriteObjectEnabled(ObjectHandle handle, bool enabled) {
+	Write(Record::SET_OBJECT_ENABLED);
+	Write(handle);
+	Write(static_cast<uint8_t>(enabled));
+}
+
+void CSimTraceWriter::WriteObjectPosition(
+	ObjectHandle handle, float x, float y, float z
+) {
+	Write(Record::SET_OBJECT_POSITION);
+	Write(handle);
+	Write(x);
+	Write(y);
+	Write(z);
+}
+
+void CSimTraceWriter::WriteObjectQuaternion(
+	ObjectHandle handle, float x, float y, float z, float w
+) {
+	Write(Record::SET_OBJECT_QUATERNION);
+	Write(handle);
+	Write(x);
+	Write(y);
+	Write(z);
+	Write(w);
+}
+
+void CSimTraceWriter::WriteCreateDrain(
+	DrainHandle handle, const DrainCreationParams &params
+) {
+	Write(Record::CREATE_DRAIN);
+	Write(handle);
+	Write(params.shape);
+
+	switch (params.shape) {
+		case DrainShape::AABB:
+			Write(std::get<DrainCreationParams::AABB>(params.shapeData));
+			break;
+		case DrainShape::SPHERE:
+			Write(std::get<DrainCreationParams::Sphere>(params.shapeData));
+			break;
+		case DrainShape::PLANE:
+			Write(std::get<DrainCreationParams::Plane>(params.shapeData));
+			break;
+	}
+}
+
+void CSimTraceWriter::WriteRemoveDrain(DrainHandle handle) {
+	Write(Record::REMOVE_DRAIN);
+	Write(handle);
+}
+
+void CSimTraceWriter::WriteSceneUpdate() { Write(Record::UPDATE_SCENE); }
+
+void CSimTraceWriter::WriteUpdate(float deltaTime) {
+	Write(Record::UPDATE);
+	Write(deltaTime);
+}
+
+void CSimTraceWriter::WriteTimeStepMultiplier(float timeStepMultiplier) {
+	Write(Record::SET_TIME_STEP_MULTIPLIER);
+	Write(timeStepMultiplier);
+}
+
+void CSimTraceWriter::Flush() { stream.flush(); }
@@ -0,0 +1,311 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "fluidsim/CFlexParticleStagingRing.h"
+
+namespace {
+constexpr float sentinel = -1234.f;
+constexpr int sentinelPhase = -1;
+constexpr uint sentinelActive = 0xFFFFFFFF;
+
+/**
+ * Keeps the "solver" on the CPU so every upload can be checked afterwards.
+ */
+class CMockStagingBackend : public IParticleStagingBackend {
+public:
+	struct Slot {
+		std::vector<SimFloat4> positions;
+		std::vector<SimFloat3> velocities;
+		std::vector<int> phases;
+		std::vector<uint> actives;
+		bool mapped = false;
+		bool destroyed = false;
+	};
+
+	struct Upload {
+		SlotHandle slot;
+		uint firstParticle;
+		uint count;
+	};
+
+	std::vector<Slot> slots;
+	std::vector<Upload> uploads;
+
+	std::vector<SimFloat4> positions;
+	std::vector<SimFloat3> velocities;
+	std::vector<int> phases;
+	std::vector<uint> actives;
+
+	explicit CMockStagingBackend(uint solverCapacity) :
+		positions(
+			solverCapacity, SimFloat4{sentinel, sentinel, sentinel, sentinel}
+		),
+		velocities(solverCapacity, SimFloat3{sentinel, sentinel, sentinel}),
+		phases(solverCapacity, sentinelPhase),
+		actives(solverCapacity, sentinelActive) {}
+
+	SlotHandle CreateSlot(uint capacity) override {
+		Slot slot;
+		slot.positions.resize(capacity);
+		slot.velocities.resize(capacity);
+		slot.phases.resize(capacity);
+		slot.actives.resize(capacity);
+		slots.push_back(std::move(slot));
+		return static_cast<SlotHandle>(slots.size() - 1);
+	}
+
+	void DestroySlot(SlotHandle slot) override {
+		slots.at(slot).destroyed = true;
+	}
+
+	ParticleStagingView MapSlot(SlotHandle slot) override {
+		auto &buffers = slots.at(slot);
+		EXPECT_FALSE(buffers.mapped);
+		buffers.mapped = true;
+		return {
+			buffers.positions.data(),
+			buffers.velocities.data(),
+			buffers.phases.data(),
+			buffers.actives.data()
+		};
+	}
+
+	void UnmapSlot(SlotHandle slot) override {
+		auto &buffers = slots.at(slot);
+		EXPECT_TRUE(buffers.mapped);
+		buffers.mapped = false;
+	}
+
+	void UploadSlot(SlotHandle slot, uint firstParticle, uint count)
+		override {
+		const auto &buffers = slots.at(slot);
+		EXPECT_FALSE(buffers.mapped);
+		EXPECT_LE(count, buffers.positions.size());
+		// Anything past the solver's capacity would be out of bounds
+		ASSERT_LE(firstParticle + count, positions.size());
+
+		uploads.push_back({slot, firstParticle, count});
+		for (uint i = 0; i < count; i++) {
+			positions[firstParticle + i] = buffers.positions[i];
+			velocities[firstParticle + i] = buffers.velocities[i];
+			phases[firstParticle + i] = buffers.phases[i];
+			actives[firstParticle + i] = buffers.actives[i];
+		}
+	}
+};
+
+struct Particles {
+	std::vector<SimFloat4> positions;
+	std::vector<SimFloat3> velocities;
+	std::vector<int> phases;
+};
+
+Particles MakeParticles(uint count, float base) {
+	Particles particles;
+	for (uint i = 0; i < count; i++) {
+		const float value = base + static_cast<float>(i);
+		particles.positions.push_back({value, value + 0.25f, value + 0.5f, 9.f}
+		);
+		particles.velocities.push_back({-value, -value, -value});
+		particles.phases.push_back(static_cast<int>(i) + 100);
+	}
+
+	return particles;
+}
+
+bool IsUntouched(const CMockStagingBackend &backend, uint particle) {
+	return backend.positions[particle].x == sentinel &&
+		   backend.positions[particle].w == sentinel &&
+		   backend.velocities[particle].x == sentinel &&
+		   backend.phases[particle] == sentinelPhase &&
+		   backend.actives[particle] == sentinelActive;
+}
+}  // namespace
+
+TEST(CFlexParticleStagingRing, LiveParticlesAreNeverRewritten) {
+	CMockStagingBackend backend(64);
+	CFlexParticleStagingRing ring(&backend, 4);
+	const auto particles = MakeParticles(10, 0.f);
+
+	constexpr uint activeParticles = 20;
+	ring.Begin(activeParticles, 64);
+	ring.Write(
+		particles.positions.data(),
+		particles.velocities.data(),
+		nullptr,
+		7,
+		1.f,
+		10
+	);
+	EXPECT_EQ(ring.End(), 10u);
+
+	for (uint i = 0; i < activeParticles; i++) {
+		EXPECT_TRUE(IsUntouched(backend, i)) << "particle " << i;
+	}
+
+	for (const auto &upload : backend.uploads) {
+		EXPECT_GE(upload.firstParticle, activeParticles);
+	}
+}
+
+TEST(CFlexParticleStagingRing, NewParticlesLandAfterActiveOnes) {
+	CMockStagingBackend backend(64);
+	CFlexParticleStagingRing ring(&backend, 4);
+	const auto particles = MakeParticles(10, 1.f);
+
+	constexpr uint activeParticles = 5;
+	ring.Begin(activeParticles, 64);
+	ring.Write(
+		particles.positions.data(),
+		particles.velocities.data(),
+		particles.phases.data(),
+		7,
+		0.5f,
+		10
+	);
+	ring.End();
+
+	for (uint i = 0; i < 10; i++) {
+		const uint particle = activeParticles + i;
+		EXPECT_EQ(backend.positions[particle].x, particles.positions[i].x);
+		EXPECT_EQ(backend.positions[particle].z, particles.positions[i].z);
+		EXPECT_EQ(backend.positions[particle].w, 0.5f);
+		EXPECT_EQ(backend.velocities[particle].y, particles.velocities[i].y);
+		EXPECT_EQ(backend.phases[particle], particles.phases[i]);
+		EXPECT_EQ(backend.actives[particle], particle);
+	}
+
+	for (uint i = activeParticles + 10; i < 64; i++) {
+		EXPECT_TRUE(IsUntouched(backend, i)) << "particle " << i;
+	}
+}
+
+TEST(CFlexParticleStagingRing, SpillsAcrossSlotsContiguously) {
+	CMockStagingBackend backend(64);
+	CFlexParticleStagingRing ring(&backend, 4);
+	const auto first = MakeParticles(3, 0.f);
+	const auto second = MakeParticles(6, 50.f);
+
+	ring.Begin(2, 64);
+	ring.Write(
+		first.positions.data(), first.velocities.data(), nullptr, 7, 1.f, 3
+	);
+	EXPECT_TRUE(ring.WriteParticle({1.f, 2.f, 3.f, 1.f}, {0.f, 0.f, 0.f}, 8)
+	);
+	ring.Write(
+		second.positions.data(), second.velocities.data(), nullptr, 7, 1.f, 6
+	);
+	EXPECT_EQ(ring.End(), 10u);
+
+	ASSERT_EQ(backend.uploads.size(), 3u);
+	uint expectedOffset = 2;
+	for (const auto &upload : backend.uploads) {
+		EXPECT_EQ(upload.firstParticle, expectedOffset);
+		expectedOffset += upload.count;
+	}
+	EXPECT_EQ(expectedOffset, 12u);
+
+	// Consecutive uploads rotate through the ring instead of reusing a slot
+	EXPECT_NE(backend.uploads[0].slot, backend.uploads[1].slot);
+	EXPECT_NE(backend.uploads[1].slot, backend.uploads[2].slot);
+
+	EXPECT_EQ(backend.phases[2], 7);
+	EXPECT_EQ(backend.phases[5], 8);
+	EXPECT_EQ(backend.positions[5].x, 1.f);
+	EXPECT_EQ(backend.positions[6].x, 50.f);
+	EXPECT_EQ(backend.positions[11].x, 55.f);
+	for (uint i = 2; i < 12; i++) {
+		EXPECT_EQ(backend.actives[i], i);
+	}
+}
+
+TEST(CFlexParticleStagingRing, NothingIsWrittenPastCapacity) {
+	constexpr uint capacity = 16;
+	// The mock has room past the capacity, so overruns would show up
+	CMockStagingBackend backend(capacity + 8);
+	CFlexParticleStagingRing ring(&backend, 4);
+	const auto particles = MakeParticles(10, 0.f);
+
+	ring.Begin(10, capacity);
+	EXPECT_EQ(
+		ring.Write(
+			particles.positions.data(),
+			particles.velocities.data(),
+			nullptr,
+			7,
+			1.f,
+			10
+		),
+		6u
+	);
+	EXPECT_FALSE(ring.WriteParticle({}, {}, 7));
+	EXPECT_EQ(
+		ring.Write(
+			particles.positions.data(),
+			particles.velocities.data(),
+			nullptr,
+			7,
+			1.f,
+			10
+		),
+		0u
+	);
+	EXPECT_EQ(ring.End(), 6u);
+
+	for (uint i = 10; i < capacity; i++) {
+		EXPECT_FALSE(IsUntouched(backend, i)) << "particle " << i;
+	}
+
+	for (uint i = capacity; i < capacity + 8; i++) {
+		EXPECT_TRUE(IsUntouched(backend, i)) << "particle " << i;
+	}
+}
+
+TEST(CFlexParticleStagingRing, FullSolverUploadsNothing) {
+	CMockStagingBackend backend(8);
+	CFlexParticleStagingRing ring(&backend, 4);
+
+	ring.Begin(8, 8);
+	EXPECT_FALSE(ring.WriteParticle({}, {}, 7));
+	EXPECT_EQ(ring.End(), 0u);
+	EXPECT_TRUE(backend.uploads.empty());
+}
+
+TEST(CFlexParticleStagingRing, UploadsStartWhereTheLastOneEnded) {
+	CMockStagingBackend backend(32);
+	CFlexParticleStagingRing ring(&backend, 4);
+
+	uint activeParticles = 0;
+	for (int batch = 0; batch < 5; batch++) {
+		const auto particles = MakeParticles(3, batch * 10.f);
+		ring.Begin(activeParticles, 32);
+		ring.Write(
+			particles.positions.data(),
+			particles.velocities.data(),
+			nullptr,
+			batch,
+			1.f,
+			3
+		);
+		activeParticles += ring.End();
+	}
+
+	EXPECT_EQ(activeParticles, 15u);
+	for (uint i = 0; i < activeParticles; i++) {
+		EXPECT_EQ(backend.phases[i], static_cast<int>(i / 3));
+		EXPECT_EQ(backend.actives[i], i);
+	}
+	EXPECT_TRUE(IsUntouched(backend, 15));
+}
+
+TEST(CFlexParticleStagingRing, ReleasesEverySlot) {
+	CMockStagingBackend backend(8);
+	{ CFlexParticleStagingRing ring(&backend, 4); }
+
+	ASSERT_FALSE(backend.slots.empty());
+	for (const auto &slot : backend.slots) {
+		EXPECT_TRUE(slot.destroyed);
+		EXPECT_FALSE(slot.mapped);
+	}
+}
@@ -0,0 +1,450 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <vector>
+
+#include "FakeNvFlex.h"
+#include "fluidsim/CFlexSimScene.h"
+
+namespace {
+class CFlexSimSceneTest : public ::testing::Test {
+protected:
+	CFlexSimScene *scene = nullptr;
+
+	void SetUp() override {
+		ResetFakeFlex();
+		scene = new CFlexSimScene(nullptr, nullptr);
+	}
+
+	void TearDown() override {
+		delete scene;
+		EXPECT_EQ(GetFakeFlex().liveBuffers, 0);
+	}
+
+	/**
+	 * Spheres are told apart by their radius once they reach the solver.
+	 */
+	ObjectHandle CreateSphere(float radius) {
+		ObjectCreationParams params = {};
+		params.shape = ObjectShape::SPHERE;
+		params.shapeData =
+			ObjectCreationParams::Sphere{radius, {0.f, 0.f, 0.f}};
+		return scene->CreateObject(params);
+	}
+
+	static std::vector<float> UploadedRadii() {
+		std::vector<float> radii;
+		for (const auto &shape : GetFakeFlex().shapes) {
+			radii.push_back(shape.geometry.sphere.radius);
+		}
+
+		return radii;
+	}
+
+	/**
+	 * A single triangle.
+	 */
+	static ObjectCreationParams TriangleParams(const float *vertices) {
+		static const uint32_t indices[] = {0, 1, 2};
+
+		ObjectCreationParams::TriangleMesh mesh = {};
+		mesh.indexType = ObjectCreationParams::TriangleMesh::IndexType::UINT32;
+		mesh.vertices = vertices;
+		mesh.indices32 = indices;
+		mesh.vertexCount = 3;
+		mesh.indexCount = 3;
+		mesh.scale[0] = mesh.scale[1] = mesh.scale[2] = 1.f;
+
+		ObjectCreationParams params = {};
+		params.shape = ObjectShape::TRIANGLE_MESH;
+		params.shapeData = mesh;
+		return params;
+	}
+
+	static ObjectCreationParams ConvexParams(const float *plane) {
+		ObjectCreationParams::Convex convex = {};
+		convex.planes = plane;
+		convex.planeCount = 1;
+		convex.scale[0] = convex.scale[1] = convex.scale[2] = 1.f;
+
+		ObjectCreationParams params = {};
+		params.shape = ObjectShape::CONVEX;
+		params.shapeData = convex;
+		return params;
+	}
+
+	static const FakeFlexShape &UploadedSphere(float radius) {
+		for (const auto &shape : GetFakeFlex().shapes) {
+			if (shape.geometry.sphere.radius == radius) {
+				return shape;
+			}
+		}
+
+		throw std::out_of_range("No sphere with that radius was uploaded");
+	}
+};
+}  // namespace
+
+TEST_F(CFlexSimSceneTest, RemovedHandlesAreRejected) {
+	const auto first = CreateSphere(1.f);
+	scene->RemoveObject(first);
+
+	// The entry is reused under the next generation
+	const auto second = CreateSphere(2.f);
+	EXPECT_NE(first, second);
+	EXPECT_EQ(first & 0xFFFFFF, second & 0xFFFFFF);
+	EXPECT_EQ((first >> 24) + 1, second >> 24);
+
+	EXPECT_THROW(
+		scene->SetObjectPosition(first, 1.f, 2.f, 3.f), std::out_of_range
+	);
+	EXPECT_THROW(scene->SetObjectEnabled(first, false), std::out_of_range);
+	scene->RemoveObject(first);
+
+	scene->Update();
+	EXPECT_EQ(UploadedRadii(), std::vector<float>{2.f});
+	EXPECT_EQ(scene->GetHandleFromShapeIndex(0), second);
+}
+
+TEST_F(CFlexSimSceneTest, GenerationsWrapAfter256Reuses) {
+	const auto stale = CreateSphere(1.f);
+	scene->RemoveObject(stale);
+
+	for (int i = 0; i < 255; i++) {
+		scene->RemoveObject(CreateSphere(1.f));
+	}
+
+	// Only 8 bits of generation fit in a handle
+	EXPECT_EQ(CreateSphere(1.f), stale);
+}
+
+TEST_F(CFlexSimSceneTest, RemovingFillsTheGapWithTheLastObject) {
+	const auto a = CreateSphere(1.f);
+	const auto b = CreateSphere(2.f);
+	const auto c = CreateSphere(3.f);
+	scene->Update();
+	EXPECT_EQ(UploadedRadii(), (std::vector<float>{1.f, 2.f, 3.f}));
+
+	scene->RemoveObject(a);
+	scene->Update();
+	EXPECT_EQ(UploadedRadii(), (std::vector<float>{3.f, 2.f}));
+	EXPECT_EQ(scene->GetHandleFromShapeIndex(0), c);
+	EXPECT_EQ(scene->GetHandleFromShapeIndex(1), b);
+	EXPECT_THROW(scene->GetHandleFromShapeIndex(2), std::runtime_error);
+
+	// Handles still reach their objects after being moved
+	scene->SetObjectPosition(c, 5.f, 0.f, 0.f);
+	scene->Update();
+	EXPECT_EQ(UploadedSphere(3.f).position[0], 5.f);
+}
+
+TEST_F(CFlexSimSceneTest, DisabledObjectsAreNotUploaded) {
+	const auto a = CreateSphere(1.f);
+	CreateSphere(2.f);
+	CreateSphere(3.f);
+
+	scene->SetObjectEnabled(a, false);
+	scene->Update();
+	EXPECT_EQ(UploadedRadii(), (std::vector<float>{3.f, 2.f}));
+
+	// Objects created while something is disabled still come first
+	CreateSphere(4.f);
+	scene->Update();
+	EXPECT_EQ(UploadedRadii(), (std::vector<float>{3.f, 2.f, 4.f}));
+
+	scene->SetObjectEnabled(a, true);
+	scene->Update();
+	EXPECT_EQ(UploadedRadii(), (std::vector<float>{3.f, 2.f, 4.f, 1.f}));
+}
+
+TEST_F(CFlexSimSceneTest, OnlyDirtySlotsCauseAnUpload) {
+	const auto a = CreateSphere(1.f);
+	scene->Update();
+	scene->Update();
+	EXPECT_EQ(GetFakeFlex().setShapesCalls, 1);
+
+	// Moving to the same place isn't a change
+	scene->SetObjectPosition(a, 0.f, 0.f, 0.f);
+	scene->Update();
+	EXPECT_EQ(GetFakeFlex().setShapesCalls, 1);
+
+	scene->SetObjectPosition(a, 1.f, 0.f, 0.f);
+	scene->Update();
+	EXPECT_EQ(GetFakeFlex().setShapesCalls, 2);
+	EXPECT_EQ(UploadedSphere(1.f).prevPosition[0], 0.f);
+	EXPECT_EQ(UploadedSphere(1.f).position[0], 1.f);
+
+	// The previous transform catches up on the next update, then the slot
+	// is clean again
+	scene->Update();
+	EXPECT_EQ(GetFakeFlex().setShapesCalls, 3);
+	EXPECT_EQ(UploadedSphere(1.f).prevPosition[0], 1.f);
+
+	scene->Update();
+	EXPECT_EQ(GetFakeFlex().setShapesCalls, 3);
+}
+
+TEST_F(CFlexSimSceneTest, MovedSlotsKeepTheirPreviousTransform) {
+	const auto a = CreateSphere(1.f);
+	CreateSphere(2.f);
+	const auto c = CreateSphere(3.f);
+	scene->SetObjectPosition(c, 1.f, 0.f, 0.f);
+	scene->Update();
+
+	// c is swept from 1 to 5, then takes a's slot before the solver sees it
+	scene->SetObjectPosition(c, 5.f, 0.f, 0.f);
+	scene->RemoveObject(a);
+	scene->Update();
+
+	const auto &moved = UploadedSphere(3.f);
+	EXPECT_EQ(moved.prevPosition[0], 1.f);
+	EXPECT_EQ(moved.position[0], 5.f);
+	EXPECT_EQ(GetFakeFlex().shapes[0].geometry.sphere.radius, 3.f);
+
+	scene->Update();
+	EXPECT_EQ(UploadedSphere(3.f).prevPosition[0], 5.f);
+}
+
+TEST_F(CFlexSimSceneTest, DisablingKeepsTheSweepOfTheObjectFillingIn) {
+	const auto a = CreateSphere(1.f);
+	const auto b = CreateSphere(2.f);
+	scene->Update();
+
+	// b takes a's slot in the same update it moves in
+	scene->SetObjectPosition(b, 4.f, 0.f, 0.f);
+	scene->SetObjectEnabled(a, false);
+	scene->Update();
+
+	ASSERT_EQ(UploadedRadii(), std::vector<float>{2.f});
+	EXPECT_EQ(UploadedSphere(2.f).prevPosition[0], 0.f);
+	EXPECT_EQ(UploadedSphere(2.f).position[0], 4.f);
+}
+
+TEST_F(CFlexSimSceneTest, ReenabledObjectsDontSweep) {
+	const auto a = CreateSphere(1.f);
+	CreateSphere(2.f);
+	scene->Update();
+
+	scene->SetObjectEnabled(a, false);
+	scene->Update();
+	scene->SetObjectPosition(a, 10.f, 0.f, 0.f);
+	scene->SetObjectEnabled(a, true);
+	scene->Update();
+
+	const auto &shape = UploadedSphere(1.f);
+	EXPECT_EQ(shape.prevPosition[0], 10.f);
+	EXPECT_EQ(shape.position[0], 10.f);
+}
+
+TEST_F(CFlexSimSceneTest, SharedMeshesAreDestroyedWithTheLastObject) {
+	const float vertices[] = {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f};
+	const auto params = TriangleParams(vertices);
+
+	const auto first = scene->CreateObject(params);
+	const auto second = scene->CreateObject(params);
+	EXPECT_EQ(GetFakeFlex().liveTriangleMeshes, 1);
+
+	scene->RemoveObject(first);
+	EXPECT_EQ(GetFakeFlex().liveTriangleMeshes, 1);
+	scene->RemoveObject(second);
+	EXPECT_EQ(GetFakeFlex().liveTriangleMeshes, 0);
+}
+
+namespace {
+DrainCreationParams BoxDrain(
+	const std::array<float, 3> &min, const std::array<float, 3> &max
+) {
+	DrainCreationParams params = {};
+	params.shape = DrainShape::AABB;
+	params.shapeData = DrainCreationParams::AABB{
+		{min[0], min[1], min[2]}, {max[0], max[1], max[2]}
+	};
+	return params;
+}
+
+DrainCreationParams SphereDrain(float x, float radius) {
+	DrainCreationParams params = {};
+	params.shape = DrainShape::SPHERE;
+	params.shapeData = DrainCreationParams::Sphere{{x, 0.f, 0.f}, radius};
+	return params;
+}
+
+DrainCreationParams PlaneDrain(const std::array<float, 3> &normal, float d) {
+	DrainCreationParams params = {};
+	params.shape = DrainShape::PLANE;
+	params.shapeData =
+		DrainCreationParams::Plane{{normal[0], normal[1], normal[2]}, d};
+	return params;
+}
+
+SimFloat4 At(float x, float y = 0.f, float z = 0.f) {
+	return {x, y, z, 1.f};
+}
+}  // namespace
+
+TEST_F(CFlexSimSceneTest, CreateDrainRejectsEmptyOrInfiniteShapes) {
+	const float inf = std::numeric_limits<float>::infinity();
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+
+	// Inverted, flat, and unbounded boxes
+	for (const auto &params :
+		 {BoxDrain({1.f, 0.f, 0.f}, {0.f, 1.f, 1.f}),
+		  BoxDrain({0.f, 0.f, 1.f}, {1.f, 1.f, 1.f}),
+		  BoxDrain({0.f, 0.f, 0.f}, {inf, 1.f, 1.f}),
+		  BoxDrain({-inf, 0.f, 0.f}, {1.f, 1.f, 1.f}),
+		  BoxDrain({nan, 0.f, 0.f}, {1.f, 1.f, 1.f}),
+		  SphereDrain(0.f, 0.f),
+		  SphereDrain(0.f, -1.f),
+		  SphereDrain(0.f, inf),
+		  SphereDrain(nan, 1.f),
+		  PlaneDrain({0.f, 0.f, 0.f}, 0.f),
+		  PlaneDrain({0.f, 0.f, 1.f}, nan),
+		  PlaneDrain({inf, 0.f, 0.f}, 0.f)}) {
+		EXPECT_THROW(scene->CreateDrain(params), std::invalid_argument);
+	}
+
+	EXPECT_FALSE(scene->HasDrains());
+	scene->CreateDrain(BoxDrain({0.f, 0.f, 0.f}, {1.f, 1.f, 1.f}));
+	EXPECT_TRUE(scene->HasDrains());
+}
+
+TEST_F(CFlexSimSceneTest, FindDrainTestsEveryShape) {
+	const auto box =
+		scene->CreateDrain(BoxDrain({0.f, 0.f, 0.f}, {1.f, 1.f, 1.f}));
+	const auto sphere = scene->CreateDrain(SphereDrain(10.f, 2.f));
+	// Everything below z = -5, the normal's length doesn't matter
+	const auto plane = scene->CreateDrain(PlaneDrain({0.f, 0.f, 2.f}, -10.f));
+
+	// Boxes and spheres include their surface
+	EXPECT_EQ(scene->FindDrain(At(0.5f, 0.5f, 0.5f)), box);
+	EXPECT_EQ(scene->FindDrain(At(1.f, 1.f, 1.f)), box);
+	EXPECT_EQ(scene->FindDrain(At(1.5f, 0.5f, 0.5f)), INVALID_DRAIN_HANDLE);
+
+	EXPECT_EQ(scene->FindDrain(At(11.f)), sphere);
+	EXPECT_EQ(scene->FindDrain(At(12.f)), sphere);
+	EXPECT_EQ(scene->FindDrain(At(10.f, 1.5f, 1.5f)), INVALID_DRAIN_HANDLE);
+
+	EXPECT_EQ(scene->FindDrain(At(50.f, 0.f, -6.f)), plane);
+	EXPECT_EQ(scene->FindDrain(At(50.f, 0.f, -5.f)), INVALID_DRAIN_HANDLE);
+
+	scene->RemoveDrain(sphere);
+	EXPECT_EQ(scene->FindDrain(At(11.f)), INVALID_DRAIN_HANDLE);
+	EXPECT_EQ(scene->FindDrain(At(0.5f, 0.5f, 0.5f)), box);
+}
+
+TEST_F(CFlexSimSceneTest, DrainedParticlesAreCountedPerDrain) {
+	const auto first = scene->CreateDrain(SphereDrain(0.f, 1.f));
+	const auto second = scene->CreateDrain(SphereDrain(10.f, 1.f));
+	EXPECT_NE(first, second);
+
+	scene->AddDrainedParticles(first, 3);
+	scene->AddDrainedParticles(first, 2);
+	scene->AddDrainedParticles(second, 7);
+	EXPECT_EQ(scene->GetDrainedParticleCount(first), 5u);
+	EXPECT_EQ(scene->GetDrainedParticleCount(second), 7u);
+
+	// Particles caught by a drain which was removed since are dropped, and
+	// handles aren't reused so they can't be credited to a newer drain
+	scene->RemoveDrain(first);
+	scene->AddDrainedParticles(first, 4);
+	EXPECT_EQ(scene->GetDrainedParticleCount(first), 0u);
+
+	const auto third = scene->CreateDrain(SphereDrain(0.f, 1.f));
+	EXPECT_NE(third, first);
+	EXPECT_EQ(scene->GetDrainedParticleCount(third), 0u);
+	EXPECT_EQ(scene->GetDrainedParticleCount(INVALID_DRAIN_HANDLE), 0u);
+}
+
+namespace {
+/**
+ * FNV-1a over the words, the way the scene hashes mesh contents.
+ */
+uint64_t HashWords(std::initializer_list<uint32_t> words) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const uint32_t word : words) {
+		hash ^= word;
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+std::vector<uint32_t> Bits(const float *values, size_t count) {
+	std::vector<uint32_t> bits(count);
+	std::memcpy(bits.data(), values, count * sizeof(float));
+	return bits;
+}
+}  // namespace
+
+TEST_F(CFlexSimSceneTest, MeshesWithCollidingHashesAreNotShared) {
+	// Found by searching for an FNV-1a collision, the two meshes only differ
+	// in their second and third words
+	const float first[] = {
+		0.f,
+		std::bit_cast<float>(0x448ac333u),
+		std::bit_cast<float>(0x3aa00000u),
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f
+	};
+	const float second[] = {
+		0.f,
+		std::bit_cast<float>(0xbb8ac330u),
+		std::bit_cast<float>(0xc1a00fb5u),
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f
+	};
+
+	// The vertex and index counts come first, then the vertices, then the
+	// indices
+	const auto hash = [](const float *vertices) {
+		const auto bits = Bits(vertices, 9);
+		return HashWords(
+			{3, 3, bits[0], bits[1], bits[2], bits[3], bits[4], bits[5],
+			 bits[6], bits[7], bits[8], 0, 1, 2}
+		);
+	};
+	ASSERT_EQ(hash(first), hash(second));
+
+	scene->CreateObject(TriangleParams(first));
+	scene->CreateObject(TriangleParams(second));
+	EXPECT_EQ(GetFakeFlex().liveTriangleMeshes, 2);
+
+	scene->CreateObject(TriangleParams(second));
+	EXPECT_EQ(GetFakeFlex().liveTriangleMeshes, 2);
+}
+
+TEST_F(CFlexSimSceneTest, ConvexMeshesWithCollidingHashesAreNotShared) {
+	const float first[] = {
+		2.f,
+		std::bit_cast<float>(0x409604ceu),
+		std::bit_cast<float>(0x3aa00000u),
+		1.f
+	};
+	const float second[] = {
+		2.f,
+		std::bit_cast<float>(0xbf9604cdu),
+		std::bit_cast<float>(0xc1a00fb5u),
+		1.f
+	};
+
+	// The plane count comes first, then the planes and the bounds, which are
+	// all zero here
+	const auto hash = [](const float *plane) {
+		const auto bits = Bits(plane, 4);
+		return HashWords(
+			{1, bits[0], bits[1], bits[2], bits[3], 0, 0, 0, 0, 0, 0}
+		);
+	};
+	ASSERT_EQ(hash(first), hash(second));
+
+	scene->CreateObject(ConvexParams(first));
+	scene->CreateObject(ConvexParams(second));
+	EXPECT_EQ(GetFakeFlex().liveConvexMeshes, 2);
+
+	scene->CreateObject(ConvexParams(first));
+	EXPECT_EQ(GetFakeFlex().liveConvexMeshes, 2);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "fluidsim/CParticleIdTable.h"
+
+namespace {
+std::vector<ParticleId> Ids(const CParticleIdTable &table) {
+	std::vector<ParticleId> ids;
+	for (uint slot = 0; slot < table.GetParticleCount(); slot++) {
+		ids.push_back(table.GetId(slot));
+	}
+
+	return ids;
+}
+
+void ExpectConsistent(const CParticleIdTable &table) {
+	for (uint slot = 0; slot < table.GetParticleCount(); slot++) {
+		EXPECT_EQ(table.GetSlot(table.GetId(slot)), slot);
+	}
+}
+}  // namespace
+
+TEST(CParticleIdTable, StaleIdsAreRejectedAfterReuse) {
+	CParticleIdTable table;
+	table.Resize(3);
+	const auto stale = table.GetId(2);
+
+	table.Resize(2);
+	EXPECT_EQ(table.GetSlot(stale), INVALID_PARTICLE_SLOT);
+
+	// The index is reused under the next generation
+	table.Resize(3);
+	const auto reused = table.GetId(2);
+	EXPECT_NE(reused, stale);
+	EXPECT_EQ(reused & 0xFFFFFF, stale & 0xFFFFFF);
+	EXPECT_EQ(table.GetSlot(stale), INVALID_PARTICLE_SLOT);
+	EXPECT_EQ(table.GetSlot(reused), 2u);
+
+	EXPECT_EQ(table.GetId(3), INVALID_PARTICLE_ID);
+	EXPECT_EQ(table.GetSlot(INVALID_PARTICLE_ID), INVALID_PARTICLE_SLOT);
+	EXPECT_EQ(table.GetSlot(12345), INVALID_PARTICLE_SLOT);
+}
+
+TEST(CParticleIdTable, GenerationsWrapAfter256Reuses) {
+	CParticleIdTable table;
+	table.Resize(1);
+	const auto stale = table.GetId(0);
+
+	for (int i = 0; i < 255; i++) {
+		table.Resize(0);
+		table.Resize(1);
+		EXPECT_NE(table.GetId(0), stale);
+		EXPECT_EQ(table.GetSlot(stale), INVALID_PARTICLE_SLOT);
+	}
+
+	// The 8-bit generation is back where it started, so the stale ID matches
+	// again. This is the limit the IDs are documented to have.
+	table.Resize(0);
+	table.Resize(1);
+	EXPECT_EQ(table.GetId(0), stale);
+	EXPECT_EQ(table.GetSlot(stale), 0u);
+}
+
+TEST(CParticleIdTable, RemapFollowsAReorder) {
+	CParticleIdTable table;
+	table.Resize(4);
+	const auto before = Ids(table);
+
+	const uint previousSlots[] = {2, 0, 3, 1};
+	table.Remap(previousSlots, 4);
+
+	EXPECT_EQ(
+		Ids(table),
+		(std::vector<ParticleId>{before[2], before[0], before[3], before[1]})
+	);
+	ExpectConsistent(table);
+}
+
+TEST(CParticleIdTable, RemapReleasesCompactedParticles) {
+	CParticleIdTable table;
+	table.Resize(5);
+	const auto before = Ids(table);
+
+	// Slots 1 and 3 were drained and everything after them moved down
+	const uint previousSlots[] = {0, 2, 4};
+	table.Remap(previousSlots, 3);
+
+	EXPECT_EQ(
+		Ids(table), (std::vector<ParticleId>{before[0], before[2], before[4]})
+	);
+	ExpectConsistent(table);
+	EXPECT_EQ(table.GetSlot(before[1]), INVALID_PARTICLE_SLOT);
+	EXPECT_EQ(table.GetSlot(before[3]), INVALID_PARTICLE_SLOT);
+
+	// New particles reuse the released indices under a new generation
+	table.Resize(5);
+	for (const auto id : {table.GetId(3), table.GetId(4)}) {
+		EXPECT_NE(id, before[1]);
+		EXPECT_NE(id, before[3]);
+	}
+	ExpectConsistent(table);
+}
+
+TEST(CParticleIdTable, InvalidRemapsLeaveTheTableUntouched) {
+	CParticleIdTable table;
+	table.Resize(3);
+	const auto before = Ids(table);
+
+	// The bad slot comes last, so that a partial remap would show
+	const uint outOfRange[] = {2, 1, 3};
+	EXPECT_THROW(table.Remap(outOfRange, 3), std::invalid_argument);
+	EXPECT_EQ(Ids(table), before);
+	ExpectConsistent(table);
+
+	const uint repeated[] = {2, 0, 2};
+	EXPECT_THROW(table.Remap(repeated, 3), std::invalid_argument);
+	EXPECT_EQ(Ids(table), before);
+	ExpectConsistent(table);
+}
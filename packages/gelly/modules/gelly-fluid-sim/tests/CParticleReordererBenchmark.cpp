@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "fluidsim/CParticleReorderer.h"
+
+/**
+ * Times preparing a reorder of a blob of fluid whose slots have been mixed up,
+ * which is what the simulation does on the readback it sorts. Particles sit a
+ * radius apart in a cube, in random slots, and the locality before and after
+ * shows what the sort buys.
+ *
+ * Not a test, it's run by hand from a release build:
+ * gelly_fluid_sim_reorder_benchmark [particles...]
+ */
+int main(int argc, char **argv) {
+	std::vector<int> particleCounts;
+	for (int i = 1; i < argc; i++) {
+		particleCounts.push_back(std::atoi(argv[i]));
+	}
+
+	if (particleCounts.empty()) {
+		particleCounts = {100000, 1000000};
+	}
+
+	constexpr int warmupRuns = 2;
+	constexpr int runs = 10;
+	constexpr float particleRadius = 1.f;
+
+	for (const int particleCount : particleCounts) {
+		const auto side = static_cast<int>(std::ceil(std::cbrt(particleCount)));
+
+		std::vector<SimFloat4> positions;
+		positions.reserve(particleCount);
+		for (int i = 0; i < particleCount; i++) {
+			positions.push_back(
+				{static_cast<float>(i % side),
+				 static_cast<float>(i / side % side),
+				 static_cast<float>(i / (side * side)),
+				 1.f}
+			);
+		}
+
+		std::mt19937 random(1234);
+		std::shuffle(positions.begin(), positions.end(), random);
+
+		const std::vector<SimFloat3> velocities(particleCount, {0.f, 0.f, 0.f});
+		const std::vector<int> phases(particleCount, 0);
+
+		// Every run starts from the same mixed up slots, so they all do the
+		// same work
+		CParticleReorderer reorderer;
+		std::vector<double> milliseconds;
+		for (int run = 0; run < warmupRuns + runs; run++) {
+			const auto start = std::chrono::steady_clock::now();
+			reorderer.Prepare(
+				positions.data(),
+				velocities.data(),
+				phases.data(),
+				static_cast<uint>(particleCount),
+				particleRadius
+			);
+			const auto end = std::chrono::steady_clock::now();
+
+			if (run >= warmupRuns) {
+				milliseconds.push_back(
+					std::chrono::duration<double, std::milli>(end - start)
+						.count()
+				);
+			}
+		}
+
+		std::sort(milliseconds.begin(), milliseconds.end());
+		const float before = CParticleReorderer::MeasureLocality(
+			positions.data(), static_cast<uint>(particleCount), particleRadius
+		);
+		const float after = CParticleReorderer::MeasureLocality(
+			reorderer.GetPositions(),
+			reorderer.GetParticleCount(),
+			particleRadius
+		);
+
+		std::printf(
+			"%d particles: %.2fms per reorder (best %.2fms), locality %.1f -> "
+			"%.2f radii\n",
+			particleCount,
+			milliseconds[milliseconds.size() / 2],
+			milliseconds.front(),
+			before,
+			after
+		);
+	}
+
+	return 0;
+}
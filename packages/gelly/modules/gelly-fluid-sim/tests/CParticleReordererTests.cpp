@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "fluidsim/CParticleReorderer.h"
+
+namespace {
+constexpr float particleRadius = 1.f;
+
+struct Particles {
+	std::vector<SimFloat4> positions;
+	std::vector<SimFloat3> velocities;
+	std::vector<int> phases;
+
+	void Add(float x, float y, float z) {
+		const auto index = static_cast<float>(positions.size());
+		positions.push_back({x, y, z, 1.f});
+		velocities.push_back({index, -index, 0.f});
+		phases.push_back(static_cast<int>(positions.size()) - 1);
+	}
+
+	[[nodiscard]] uint Count() const {
+		return static_cast<uint>(positions.size());
+	}
+
+	void Prepare(CParticleReorderer &reorderer) const {
+		reorderer.Prepare(
+			positions.data(),
+			velocities.data(),
+			phases.data(),
+			Count(),
+			particleRadius
+		);
+	}
+};
+
+/**
+ * A block of particles a radius apart, in shuffled slots.
+ */
+Particles MakeShuffledBlock(int size) {
+	std::vector<SimFloat3> cells;
+	for (int z = 0; z < size; z++) {
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				cells.push_back(
+					{static_cast<float>(x),
+					 static_cast<float>(y),
+					 static_cast<float>(z)}
+				);
+			}
+		}
+	}
+
+	std::mt19937 random(1234);
+	std::shuffle(cells.begin(), cells.end(), random);
+
+	Particles particles;
+	for (const auto &cell : cells) {
+		particles.Add(cell.x, cell.y, cell.z);
+	}
+
+	return particles;
+}
+}  // namespace
+
+TEST(CParticleReorderer, MeasuresDistanceBetweenNeighbouringSlots) {
+	const SimFloat4 positions[] = {
+		{0.f, 0.f, 0.f, 1.f}, {4.f, 0.f, 0.f, 1.f}, {4.f, 3.f, 0.f, 1.f}
+	};
+
+	EXPECT_FLOAT_EQ(
+		CParticleReorderer::MeasureLocality(positions, 3, 0.5f), 7.f
+	);
+	EXPECT_EQ(CParticleReorderer::MeasureLocality(positions, 1, 0.5f), 0.f);
+	EXPECT_EQ(CParticleReorderer::MeasureLocality(positions, 3, 0.f), 0.f);
+}
+
+TEST(CParticleReorderer, OutputIsAPermutationOfTheInput) {
+	const auto particles = MakeShuffledBlock(8);
+	CParticleReorderer reorderer;
+	particles.Prepare(reorderer);
+
+	ASSERT_TRUE(reorderer.IsPending());
+	ASSERT_EQ(reorderer.GetParticleCount(), particles.Count());
+
+	std::vector<uint> previousSlots(
+		reorderer.GetPreviousSlots(),
+		reorderer.GetPreviousSlots() + particles.Count()
+	);
+	std::sort(previousSlots.begin(), previousSlots.end());
+	for (uint i = 0; i < particles.Count(); i++) {
+		ASSERT_EQ(previousSlots[i], i);
+	}
+
+	// Every attribute has to move along with its particle
+	for (uint i = 0; i < particles.Count(); i++) {
+		const uint slot = reorderer.GetPreviousSlots()[i];
+		EXPECT_EQ(reorderer.GetPositions()[i].x, particles.positions[slot].x);
+		EXPECT_EQ(reorderer.GetPositions()[i].z, particles.positions[slot].z);
+		EXPECT_EQ(
+			reorderer.GetVelocities()[i].y, particles.velocities[slot].y
+		);
+		EXPECT_EQ(reorderer.GetPhases()[i], particles.phases[slot]);
+	}
+}
+
+TEST(CParticleReorderer, PermutationIsABijectionAtScale) {
+	// Big enough for the parallel algorithms to split the work, with
+	// clusters of identical positions so that ties are common too
+	constexpr uint particleCount = 100000;
+	std::mt19937 random(5678);
+	std::uniform_real_distribution<float> coordinate(-500.f, 500.f);
+
+	Particles particles;
+	for (uint i = 0; i < particleCount; i++) {
+		if (i % 10 == 0 || particles.positions.empty()) {
+			particles.Add(coordinate(random), coordinate(random), 0.f);
+			particles.positions.back().z = coordinate(random);
+		} else {
+			const auto previous = particles.positions.back();
+			particles.Add(previous.x, previous.y, previous.z);
+		}
+
+		particles.positions.back().w = coordinate(random);
+		particles.velocities.back().z = coordinate(random);
+		particles.phases.back() = static_cast<int>(random());
+	}
+
+	CParticleReorderer reorderer;
+	particles.Prepare(reorderer);
+	ASSERT_EQ(reorderer.GetParticleCount(), particleCount);
+
+	std::vector<bool> seen(particleCount, false);
+	for (uint i = 0; i < particleCount; i++) {
+		const uint slot = reorderer.GetPreviousSlots()[i];
+		ASSERT_LT(slot, particleCount);
+		ASSERT_FALSE(seen[slot]) << "Slot " << slot << " was used twice";
+		seen[slot] = true;
+
+		// Compared bit for bit, every component has to come along
+		const auto &position = reorderer.GetPositions()[i];
+		const auto &velocity = reorderer.GetVelocities()[i];
+		ASSERT_EQ(
+			std::memcmp(
+				&position, &particles.positions[slot], sizeof(SimFloat4)
+			),
+			0
+		) << "Position " << i;
+		ASSERT_EQ(
+			std::memcmp(
+				&velocity, &particles.velocities[slot], sizeof(SimFloat3)
+			),
+			0
+		) << "Velocity " << i;
+		ASSERT_EQ(reorderer.GetPhases()[i], particles.phases[slot])
+			<< "Phase " << i;
+	}
+}
+
+TEST(CParticleReorderer, SortingImprovesLocality) {
+	const auto particles = MakeShuffledBlock(16);
+	const float before = CParticleReorderer::MeasureLocality(
+		particles.positions.data(), particles.Count(), particleRadius
+	);
+
+	CParticleReorderer reorderer;
+	particles.Prepare(reorderer);
+	const float after = CParticleReorderer::MeasureLocality(
+		reorderer.GetPositions(), reorderer.GetParticleCount(), particleRadius
+	);
+
+	// Neighbours on a Morton curve over a unit grid are about a cell apart
+	EXPECT_LT(after, 2.f);
+	EXPECT_LT(after * 4.f, before);
+}
+
+TEST(CParticleReorderer, SortedParticlesKeepTheirOrder) {
+	const auto shuffled = MakeShuffledBlock(8);
+	CParticleReorderer reorderer;
+	shuffled.Prepare(reorderer);
+
+	Particles sorted;
+	for (uint i = 0; i < reorderer.GetParticleCount(); i++) {
+		const auto &position = reorderer.GetPositions()[i];
+		sorted.Add(position.x, position.y, position.z);
+	}
+
+	sorted.Prepare(reorderer);
+	for (uint i = 0; i < sorted.Count(); i++) {
+		ASSERT_EQ(reorderer.GetPreviousSlots()[i], i);
+	}
+}
+
+TEST(CParticleReorderer, TiesKeepSlotOrder) {
+	Particles particles;
+	for (int i = 0; i < 64; i++) {
+		particles.Add(0.1f, 0.2f, 0.3f);
+	}
+
+	CParticleReorderer reorderer;
+	particles.Prepare(reorderer);
+
+	std::vector<uint> expected(particles.Count());
+	std::iota(expected.begin(), expected.end(), 0);
+	EXPECT_EQ(
+		std::vector<uint>(
+			reorderer.GetPreviousSlots(),
+			reorderer.GetPreviousSlots() + particles.Count()
+		),
+		expected
+	);
+}
+
+TEST(CParticleReorderer, ClearDropsThePendingReorder) {
+	Particles particles;
+	particles.Add(0.f, 0.f, 0.f);
+
+	CParticleReorderer reorderer;
+	EXPECT_FALSE(reorderer.IsPending());
+
+	particles.Prepare(reorderer);
+	EXPECT_TRUE(reorderer.IsPending());
+
+	reorderer.Clear();
+	EXPECT_FALSE(reorderer.IsPending());
+
+	Particles none;
+	none.Prepare(reorderer);
+	EXPECT_EQ(reorderer.GetParticleCount(), 0u);
+}
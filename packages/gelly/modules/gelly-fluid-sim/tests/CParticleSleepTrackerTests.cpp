@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "fluidsim/CParticleSleepTracker.h"
+
+namespace {
+constexpr uint8_t checksToSleep = 3;
+constexpr float sleepSpeed = 0.1f;
+constexpr float wakeDistance = 1.f;
+
+/**
+ * A row of particles spaced well apart, all at rest.
+ */
+struct Particles {
+	std::vector<SimFloat4> positions;
+	std::vector<SimFloat3> velocities;
+
+	explicit Particles(uint count, float spacing = 10.f) {
+		for (uint i = 0; i < count; i++) {
+			positions.push_back({static_cast<float>(i) * spacing, 0.f, 0.f, 1.f}
+			);
+			velocities.push_back({0.f, 0.f, 0.f});
+		}
+	}
+
+	[[nodiscard]] uint Count() const {
+		return static_cast<uint>(positions.size());
+	}
+
+	void Check(CParticleSleepTracker &tracker, int times = 1) const {
+		for (int i = 0; i < times; i++) {
+			tracker.Check(
+				positions.data(),
+				velocities.data(),
+				Count(),
+				sleepSpeed,
+				wakeDistance
+			);
+		}
+	}
+};
+
+std::vector<uint> GetActiveIndices(
+	CParticleSleepTracker &tracker, uint particleCount
+) {
+	std::vector<uint> indices(particleCount);
+	indices.resize(tracker.FillActiveIndices(indices.data(), particleCount));
+	return indices;
+}
+}  // namespace
+
+TEST(CParticleSleepTracker, StillParticlesFallAsleepAfterEnoughChecks) {
+	CParticleSleepTracker tracker(checksToSleep);
+	const Particles particles(4);
+
+	particles.Check(tracker, checksToSleep - 1);
+	EXPECT_EQ(tracker.GetSleepingCount(), 0u);
+	EXPECT_FALSE(tracker.HasActiveSetChanged());
+
+	particles.Check(tracker);
+	EXPECT_EQ(tracker.GetSleepingCount(), 4u);
+	EXPECT_TRUE(tracker.HasActiveSetChanged());
+	EXPECT_TRUE(GetActiveIndices(tracker, 4).empty());
+	EXPECT_FALSE(tracker.HasActiveSetChanged());
+}
+
+TEST(CParticleSleepTracker, MovingParticlesStayAwake) {
+	CParticleSleepTracker tracker(checksToSleep);
+	Particles particles(4);
+	particles.velocities[2] = {0.f, -5.f, 0.f};
+
+	particles.Check(tracker, 10);
+	EXPECT_EQ(tracker.GetSleepingCount(), 3u);
+	EXPECT_EQ(GetActiveIndices(tracker, 4), std::vector<uint>{2});
+}
+
+TEST(CParticleSleepTracker, MovementOnlyWakesNearbyParticles) {
+	CParticleSleepTracker tracker(checksToSleep);
+	Particles particles(4);
+	particles.Check(tracker, checksToSleep);
+	ASSERT_EQ(tracker.GetSleepingCount(), 4u);
+
+	// A particle that was asleep can't wake itself up, so one moving near
+	// particle 1 is added
+	particles.positions.push_back({10.5f, 0.f, 0.f, 1.f});
+	particles.velocities.push_back({5.f, 0.f, 0.f});
+	particles.Check(tracker);
+
+	EXPECT_EQ(tracker.GetSleepingCount(), 3u);
+	EXPECT_EQ(GetActiveIndices(tracker, 5), (std::vector<uint>{1, 4}));
+}
+
+TEST(CParticleSleepTracker, MovingNeighboursKeepParticlesFromSleeping) {
+	CParticleSleepTracker tracker(checksToSleep);
+	Particles particles(2, 0.5f);
+	particles.velocities[1] = {5.f, 0.f, 0.f};
+
+	particles.Check(tracker, 10);
+	EXPECT_EQ(tracker.GetSleepingCount(), 0u);
+}
+
+TEST(CParticleSleepTracker, CollidersWakeOverlappingParticlesOnce) {
+	CParticleSleepTracker tracker(checksToSleep);
+	const Particles particles(4);
+	particles.Check(tracker, checksToSleep);
+
+	tracker.DisturbCollider({20.f, 1.f, 0.f}, 2.f);
+	particles.Check(tracker);
+	EXPECT_EQ(GetActiveIndices(tracker, 4), std::vector<uint>{2});
+
+	// The disturbance only applies to the check right after it
+	particles.Check(tracker, checksToSleep);
+	EXPECT_EQ(tracker.GetSleepingCount(), 4u);
+}
+
+TEST(CParticleSleepTracker, UntrackedParticlesAreAwake) {
+	CParticleSleepTracker tracker(checksToSleep);
+	const Particles particles(3);
+	particles.Check(tracker, checksToSleep);
+
+	EXPECT_EQ(GetActiveIndices(tracker, 5), (std::vector<uint>{3, 4}));
+}
+
+TEST(CParticleSleepTracker, RemapMovesStateWithTheParticles) {
+	CParticleSleepTracker tracker(checksToSleep);
+	Particles particles(4);
+	particles.velocities[0] = {5.f, 0.f, 0.f};
+	particles.Check(tracker, checksToSleep);
+	ASSERT_EQ(tracker.GetSleepingCount(), 3u);
+	GetActiveIndices(tracker, 4);
+
+	// Particle 0 (awake) moves to slot 2, 3 moves to 0 and 2 is dropped
+	const uint previousSlots[] = {3, 1, 0};
+	tracker.Remap(previousSlots, 3);
+
+	EXPECT_EQ(tracker.GetSleepingCount(), 2u);
+	EXPECT_TRUE(tracker.HasActiveSetChanged());
+	EXPECT_EQ(GetActiveIndices(tracker, 3), std::vector<uint>{2});
+}
+
+TEST(CParticleSleepTracker, ResetWakesEverything) {
+	CParticleSleepTracker tracker(checksToSleep);
+	const Particles particles(4);
+	particles.Check(tracker, checksToSleep);
+	GetActiveIndices(tracker, 4);
+
+	tracker.Reset();
+	EXPECT_EQ(tracker.GetSleepingCount(), 0u);
+	EXPECT_TRUE(tracker.HasActiveSetChanged());
+	EXPECT_EQ(GetActiveIndices(tracker, 4).size(), 4u);
+}
+
+TEST(CParticleSleepTracker, FewerParticlesThanTrackedStartsOver) {
+	CParticleSleepTracker tracker(checksToSleep);
+	const Particles particles(4);
+	particles.Check(tracker, checksToSleep);
+
+	// Particles were cleared and new ones added, none of them have been
+	// still for long enough yet
+	const Particles fewer(2);
+	fewer.Check(tracker);
+	EXPECT_EQ(tracker.GetSleepingCount(), 0u);
+	EXPECT_EQ(GetActiveIndices(tracker, 2).size(), 2u);
+}
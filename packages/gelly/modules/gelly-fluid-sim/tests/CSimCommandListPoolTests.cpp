@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+#include "fluidsim/CSimCommandListPool.h"
+
+namespace {
+constexpr auto supportedCommands =
+	static_cast<SimCommandType>(RESET | CHANGE_RADIUS);
+
+size_t CountCommands(ISimCommandList *commandList) {
+	const auto [begin, end] = commandList->GetCommands();
+	return static_cast<size_t>(end - begin);
+}
+
+void Record(ISimCommandList *commandList, int commandCount) {
+	for (int i = 0; i < commandCount; i++) {
+		commandList->AddCommand({CHANGE_RADIUS, ChangeRadius{1.f + i}});
+	}
+
+	commandList->AddCommand({RESET, Reset{}});
+}
+}  // namespace
+
+TEST(CSimCommandListPool, ExecuteAndReleaseReleasesWhenExecuteThrows) {
+	CSimCommandListPool pool(supportedCommands);
+	auto *commandList = pool.Acquire();
+	Record(commandList, 3);
+
+	EXPECT_THROW(
+		pool.ExecuteAndRelease(
+			commandList,
+			[](ISimCommandList *) { throw std::runtime_error("Lost device"); }
+		),
+		std::runtime_error
+	);
+
+	// Released exactly once, so releasing it again is caught
+	EXPECT_THROW(pool.Release(commandList), std::invalid_argument);
+
+	auto *reused = pool.Acquire();
+	EXPECT_EQ(reused, commandList);
+	EXPECT_EQ(CountCommands(reused), 0u);
+}
+
+TEST(CSimCommandListPool, ReusedListsComeBackCleared) {
+	CSimCommandListPool pool(supportedCommands);
+	auto *commandList = pool.Acquire();
+	EXPECT_EQ(CountCommands(commandList), 0u);
+
+	Record(commandList, 5);
+	size_t executedCommands = 0;
+	pool.ExecuteAndRelease(commandList, [&](ISimCommandList *list) {
+		executedCommands = CountCommands(list);
+	});
+	EXPECT_EQ(executedCommands, 6u);
+
+	auto *reused = pool.Acquire();
+	ASSERT_EQ(reused, commandList);
+	EXPECT_EQ(CountCommands(reused), 0u);
+
+	// And through Release too
+	Record(reused, 2);
+	pool.Release(reused);
+	reused = pool.Acquire();
+	ASSERT_EQ(reused, commandList);
+	EXPECT_EQ(CountCommands(reused), 0u);
+}
+
+TEST(CSimCommandListPool, NeverHandsOutAListInUse) {
+	CSimCommandListPool pool(supportedCommands);
+	std::set<ISimCommandList *> inUse;
+	std::set<ISimCommandList *> everHandedOut;
+	std::mt19937 random(1234);
+
+	for (int i = 0; i < 2000; i++) {
+		if (inUse.empty() || random() % 3 != 0) {
+			auto *commandList = pool.Acquire();
+			ASSERT_NE(commandList, nullptr);
+			ASSERT_TRUE(inUse.insert(commandList).second)
+				<< "Handed out a list that's in use";
+			everHandedOut.insert(commandList);
+			Record(commandList, 1);
+		} else {
+			auto it = inUse.begin();
+			std::advance(it, random() % inUse.size());
+			pool.Release(*it);
+			inUse.erase(it);
+		}
+
+		if (inUse.size() > 16) {
+			for (auto *commandList : inUse) {
+				pool.Release(commandList);
+			}
+
+			inUse.clear();
+		}
+	}
+
+	// Released lists are reused, so the pool only grows to what was in use
+	// at once
+	EXPECT_LE(everHandedOut.size(), 17u);
+
+	// A rejected second release doesn't put the list in the pool twice
+	auto *commandList = pool.Acquire();
+	pool.Release(commandList);
+	EXPECT_THROW(pool.Release(commandList), std::invalid_argument);
+
+	std::set<ISimCommandList *> acquired;
+	for (size_t i = 0; i < everHandedOut.size() + 1; i++) {
+		EXPECT_TRUE(acquired.insert(pool.Acquire()).second);
+	}
+}
+
+TEST(CSimCommandListPool, CreatedListsArentPooled) {
+	CSimCommandListPool pool(supportedCommands);
+	auto *created = pool.Create();
+	EXPECT_THROW(pool.Release(created), std::invalid_argument);
+	EXPECT_NE(pool.Acquire(), created);
+
+	pool.Destroy(created);
+	EXPECT_THROW(pool.Destroy(created), std::invalid_argument);
+	EXPECT_NO_THROW(pool.Destroy(nullptr));
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include "fluidsim/CSimQualityController.h"
+
+namespace {
+SimQualitySettings MakeSettings() {
+	SimQualitySettings settings;
+	settings.adaptive = true;
+	settings.targetStepTimeMs = 4.f;
+	settings.minIterations = 1;
+	settings.maxIterations = 3;
+	settings.minSubsteps = 1;
+	settings.maxSubsteps = 2;
+	return settings;
+}
+
+/**
+ * Feeds the same step time until quality changes.
+ * \return How many samples it took, or -1 if it never changed.
+ */
+int SamplesUntilChange(
+	CSimQualityController &controller, float stepTimeMs, int limit = 1000
+) {
+	for (int sample = 1; sample <= limit; sample++) {
+		if (controller.AddSample(stepTimeMs)) {
+			return sample;
+		}
+	}
+
+	return -1;
+}
+}  // namespace
+
+TEST(CSimQualityController, StartsAtMaximumQuality) {
+	const CSimQualityController controller(MakeSettings());
+
+	EXPECT_EQ(controller.GetIterations(), 3);
+	EXPECT_EQ(controller.GetSubsteps(), 2);
+}
+
+TEST(CSimQualityController, RejectsInvalidBounds) {
+	auto settings = MakeSettings();
+	settings.minIterations = 0;
+	EXPECT_THROW(CSimQualityController{settings}, std::invalid_argument);
+
+	settings = MakeSettings();
+	settings.maxSubsteps = 0;
+	EXPECT_THROW(CSimQualityController{settings}, std::invalid_argument);
+
+	settings = MakeSettings();
+	settings.targetStepTimeMs = 0.f;
+	EXPECT_THROW(CSimQualityController{settings}, std::invalid_argument);
+
+	CSimQualityController controller(MakeSettings());
+	settings = MakeSettings();
+	settings.maxIterations = 0;
+	EXPECT_THROW(controller.SetSettings(settings), std::invalid_argument);
+	// A rejected update leaves the old bounds alone
+	EXPECT_EQ(controller.GetIterations(), 3);
+}
+
+TEST(CSimQualityController, DropsIterationsBeforeSubsteps) {
+	CSimQualityController controller(MakeSettings());
+
+	EXPECT_NE(SamplesUntilChange(controller, 100.f), -1);
+	EXPECT_EQ(controller.GetIterations(), 2);
+	EXPECT_EQ(controller.GetSubsteps(), 2);
+
+	EXPECT_NE(SamplesUntilChange(controller, 100.f), -1);
+	EXPECT_EQ(controller.GetIterations(), 1);
+	EXPECT_EQ(controller.GetSubsteps(), 2);
+
+	EXPECT_NE(SamplesUntilChange(controller, 100.f), -1);
+	EXPECT_EQ(controller.GetIterations(), 1);
+	EXPECT_EQ(controller.GetSubsteps(), 1);
+
+	// Nowhere left to go
+	EXPECT_EQ(SamplesUntilChange(controller, 100.f), -1);
+}
+
+TEST(CSimQualityController, RaisesSubstepsBeforeIterations) {
+	CSimQualityController controller(MakeSettings());
+	while (controller.GetSubsteps() > 1) {
+		controller.AddSample(100.f);
+	}
+
+	EXPECT_NE(SamplesUntilChange(controller, 0.f), -1);
+	EXPECT_EQ(controller.GetIterations(), 1);
+	EXPECT_EQ(controller.GetSubsteps(), 2);
+
+	EXPECT_NE(SamplesUntilChange(controller, 0.f), -1);
+	EXPECT_EQ(controller.GetIterations(), 2);
+
+	EXPECT_NE(SamplesUntilChange(controller, 0.f), -1);
+	EXPECT_EQ(controller.GetIterations(), 3);
+	EXPECT_EQ(SamplesUntilChange(controller, 0.f), -1);
+}
+
+TEST(CSimQualityController, DowngradesQuicklyAndUpgradesSlowly) {
+	CSimQualityController controller(MakeSettings());
+
+	const int downgradeSamples = SamplesUntilChange(controller, 100.f);
+	ASSERT_NE(downgradeSamples, -1);
+
+	// Settle the smoothed time well under the headroom first
+	for (int i = 0; i < 50; i++) {
+		controller.AddSample(0.f);
+	}
+
+	const int upgradeSamples = SamplesUntilChange(controller, 0.f);
+	ASSERT_NE(upgradeSamples, -1);
+	EXPECT_GT(upgradeSamples, downgradeSamples * 10);
+}
+
+TEST(CSimQualityController, HoldsQualityInsideTheBand) {
+	CSimQualityController controller(MakeSettings());
+
+	// Between the upgrade headroom and the budget, nothing should change no
+	// matter how long it stays there
+	for (int i = 0; i < 100; i++) {
+		controller.AddSample(3.f);
+	}
+	EXPECT_EQ(SamplesUntilChange(controller, 3.f, 500), -1);
+	EXPECT_EQ(controller.GetIterations(), 3);
+	EXPECT_EQ(controller.GetSubsteps(), 2);
+}
+
+TEST(CSimQualityController, SpikesShorterThanTheWindowAreIgnored) {
+	CSimQualityController controller(MakeSettings());
+
+	for (int i = 0; i < 50; i++) {
+		controller.AddSample(3.f);
+	}
+
+	for (int spike = 0; spike < 20; spike++) {
+		EXPECT_FALSE(controller.AddSample(12.f));
+		for (int i = 0; i < 10; i++) {
+			EXPECT_FALSE(controller.AddSample(3.f));
+		}
+	}
+}
+
+TEST(CSimQualityController, FixedQualityNeverChanges) {
+	auto settings = MakeSettings();
+	settings.adaptive = false;
+	CSimQualityController controller(settings);
+
+	EXPECT_EQ(SamplesUntilChange(controller, 100.f), -1);
+	EXPECT_EQ(controller.GetIterations(), 3);
+	EXPECT_EQ(controller.GetSubsteps(), 2);
+
+	// Step times are still tracked for the status
+	const auto status = controller.GetStatus();
+	EXPECT_FALSE(status.adaptive);
+	EXPECT_NEAR(status.stepTimeMs, 100.f, 1.f);
+}
+
+TEST(CSimQualityController, NewSettingsResetToMaximum) {
+	CSimQualityController controller(MakeSettings());
+	while (controller.GetSubsteps() > 1) {
+		controller.AddSample(100.f);
+	}
+
+	auto settings = MakeSettings();
+	settings.maxIterations = 5;
+	controller.SetSettings(settings);
+
+	const auto status = controller.GetStatus();
+	EXPECT_EQ(status.iterations, 5);
+	EXPECT_EQ(status.substeps, 2);
+	EXPECT_EQ(status.targetStepTimeMs, 4.f);
+}
@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <sstream>
+
+#include "MockFluidSimulation.h"
+#include "fluidsim/CSimSnapshot.h"
+
+namespace {
+CSimSnapshot MakeSnapshot(uint particleCount, bool withAbsorptions) {
+	CSimSnapshot snapshot;
+	for (uint i = 0; i < particleCount; i++) {
+		const auto value = static_cast<float>(i);
+		snapshot.positions.push_back(
+			{value * 3.f - 100.f, value * 0.5f, -value, 0.25f}
+		);
+		snapshot.velocities.push_back({value, 10.f - value, 0.f});
+		snapshot.phases.push_back(static_cast<int>(i) * 7);
+
+		if (withAbsorptions) {
+			snapshot.absorptions.push_back({0.1f, 0.2f, value});
+		}
+	}
+
+	snapshot.colliders.push_back(
+		{3, {1.f, 2.f, 3.f}, {0.f, 0.f, 0.707f, 0.707f}}
+	);
+	snapshot.colliders.push_back({9, {-4.f, 0.f, 8.f}, {0.f, 0.f, 0.f, 1.f}});
+	return snapshot;
+}
+
+CSimSnapshot RoundTrip(
+	const CSimSnapshot &snapshot, CSimSnapshot::Quantization quantization
+) {
+	std::stringstream stream;
+	snapshot.Write(stream, quantization);
+
+	CSimSnapshot read;
+	read.Read(stream);
+	return read;
+}
+
+void ExpectCollidersEqual(const CSimSnapshot &a, const CSimSnapshot &b) {
+	ASSERT_EQ(a.colliders.size(), b.colliders.size());
+	for (size_t i = 0; i < a.colliders.size(); i++) {
+		const auto &colliderA = a.colliders[i];
+		const auto &colliderB = b.colliders[i];
+		EXPECT_EQ(colliderA.handle, colliderB.handle);
+		for (int axis = 0; axis < 3; axis++) {
+			EXPECT_EQ(colliderA.position[axis], colliderB.position[axis]);
+		}
+		for (int axis = 0; axis < 4; axis++) {
+			EXPECT_EQ(colliderA.rotation[axis], colliderB.rotation[axis]);
+		}
+	}
+}
+}  // namespace
+
+TEST(CSimSnapshot, UnquantizedRoundTripIsExact) {
+	const auto snapshot = MakeSnapshot(100, true);
+	const auto read = RoundTrip(snapshot, CSimSnapshot::Quantization::NONE);
+
+	ASSERT_EQ(read.GetParticleCount(), 100u);
+	for (uint i = 0; i < 100; i++) {
+		EXPECT_EQ(read.positions[i].x, snapshot.positions[i].x);
+		EXPECT_EQ(read.positions[i].y, snapshot.positions[i].y);
+		EXPECT_EQ(read.positions[i].z, snapshot.positions[i].z);
+		EXPECT_EQ(read.positions[i].w, snapshot.positions[i].w);
+		EXPECT_EQ(read.velocities[i].y, snapshot.velocities[i].y);
+		EXPECT_EQ(read.phases[i], snapshot.phases[i]);
+		EXPECT_EQ(read.absorptions[i].z, snapshot.absorptions[i].z);
+	}
+
+	ExpectCollidersEqual(read, snapshot);
+}
+
+TEST(CSimSnapshot, QuantizedRoundTripStaysWithinAStep) {
+	const auto snapshot = MakeSnapshot(100, false);
+	const auto read = RoundTrip(snapshot, CSimSnapshot::Quantization::BITS_16);
+
+	// The widest axis spans 297 units, a 16-bit step is well under 0.01
+	constexpr float tolerance = 297.f / 65535.f;
+
+	ASSERT_EQ(read.GetParticleCount(), 100u);
+	EXPECT_TRUE(read.absorptions.empty());
+	for (uint i = 0; i < 100; i++) {
+		EXPECT_NEAR(read.positions[i].x, snapshot.positions[i].x, tolerance);
+		EXPECT_NEAR(read.positions[i].y, snapshot.positions[i].y, tolerance);
+		EXPECT_NEAR(read.positions[i].z, snapshot.positions[i].z, tolerance);
+		EXPECT_NEAR(read.velocities[i].x, snapshot.velocities[i].x, tolerance);
+		EXPECT_NEAR(read.velocities[i].y, snapshot.velocities[i].y, tolerance);
+		// Neither of these are quantized
+		EXPECT_EQ(read.positions[i].w, snapshot.positions[i].w);
+		EXPECT_EQ(read.phases[i], snapshot.phases[i]);
+	}
+
+	ExpectCollidersEqual(read, snapshot);
+
+	std::stringstream unquantized;
+	std::stringstream quantized;
+	snapshot.Write(unquantized);
+	snapshot.Write(quantized, CSimSnapshot::Quantization::BITS_16);
+	EXPECT_LT(quantized.str().size(), unquantized.str().size());
+}
+
+TEST(CSimSnapshot, QuantizesFlatAndEmptyRanges) {
+	auto snapshot = MakeSnapshot(1, false);
+	auto read = RoundTrip(snapshot, CSimSnapshot::Quantization::BITS_16);
+	ASSERT_EQ(read.GetParticleCount(), 1u);
+	EXPECT_EQ(read.positions[0].x, snapshot.positions[0].x);
+	EXPECT_EQ(read.velocities[0].y, snapshot.velocities[0].y);
+
+	snapshot = MakeSnapshot(0, false);
+	read = RoundTrip(snapshot, CSimSnapshot::Quantization::BITS_16);
+	EXPECT_EQ(read.GetParticleCount(), 0u);
+	EXPECT_EQ(read.colliders.size(), 2u);
+}
+
+TEST(CSimSnapshot, RejectsMismatchedArrays) {
+	auto snapshot = MakeSnapshot(4, true);
+	snapshot.phases.pop_back();
+
+	std::stringstream stream;
+	EXPECT_THROW(snapshot.Write(stream), std::invalid_argument);
+
+	snapshot = MakeSnapshot(4, true);
+	snapshot.absorptions.pop_back();
+	EXPECT_THROW(snapshot.Write(stream), std::invalid_argument);
+}
+
+TEST(CSimSnapshot, RejectsStreamsThatAreNotSnapshots) {
+	CSimSnapshot read;
+
+	std::stringstream garbage("definitely not a snapshot, but long enough");
+	EXPECT_THROW(read.Read(garbage), std::runtime_error);
+
+	std::stringstream empty;
+	EXPECT_THROW(read.Read(empty), std::runtime_error);
+
+	std::stringstream stream;
+	MakeSnapshot(4, false).Write(stream);
+	auto data = stream.str();
+	// The version follows the magic
+	data[4] = static_cast<char>(data[4] + 1);
+	std::stringstream wrongVersion(data);
+	EXPECT_THROW(read.Read(wrongVersion), std::runtime_error);
+}
+
+TEST(CSimSnapshot, TruncatedSnapshotsThrowAndLeaveItEmpty) {
+	std::stringstream stream;
+	MakeSnapshot(16, true).Write(stream);
+	const auto data = stream.str();
+
+	CSimSnapshot read = MakeSnapshot(2, false);
+	std::stringstream truncated(data.substr(0, data.size() - 5));
+	EXPECT_THROW(read.Read(truncated), std::runtime_error);
+	EXPECT_EQ(read.GetParticleCount(), 0u);
+	EXPECT_TRUE(read.colliders.empty());
+}
+
+TEST(CSimSnapshot, FileRoundTrip) {
+	const auto path =
+		std::filesystem::temp_directory_path() / "gelly-snapshot-test.snap";
+	const auto snapshot = MakeSnapshot(10, true);
+	snapshot.WriteToFile(path, CSimSnapshot::Quantization::NONE);
+
+	CSimSnapshot read;
+	read.ReadFromFile(path);
+	EXPECT_EQ(read.GetParticleCount(), 10u);
+	EXPECT_EQ(read.phases[9], 63);
+	ExpectCollidersEqual(read, snapshot);
+
+	std::filesystem::remove(path);
+	EXPECT_THROW(read.ReadFromFile(path), std::runtime_error);
+}
+
+TEST(CSimSnapshot, RestoreReplacesParticlesAndMovesColliders) {
+	const auto snapshot = MakeSnapshot(5, false);
+
+	CMockFluidSimulation sim;
+	snapshot.Restore(&sim, true);
+
+	ASSERT_EQ(sim.positions.size(), 5u);
+	EXPECT_EQ(sim.log.front(), "Reset");
+	for (uint i = 0; i < 5; i++) {
+		EXPECT_EQ(sim.positions[i].x, snapshot.positions[i].x);
+		EXPECT_EQ(sim.velocities[i].y, snapshot.velocities[i].y);
+		EXPECT_EQ(sim.phases[i], snapshot.phases[i]);
+	}
+
+	ASSERT_EQ(sim.scene.transforms.count(3), 1u);
+	EXPECT_EQ(sim.scene.transforms[3].position[2], 3.f);
+	EXPECT_EQ(sim.scene.transforms[3].rotation[3], 0.707f);
+	EXPECT_EQ(sim.scene.transforms[9].position[0], -4.f);
+
+	// Restoring again replaces the particles rather than adding to them
+	CMockFluidSimulation other;
+	snapshot.Restore(&other, false);
+	snapshot.Restore(&other, false);
+	EXPECT_EQ(other.positions.size(), 5u);
+	EXPECT_TRUE(other.scene.transforms.empty());
+}
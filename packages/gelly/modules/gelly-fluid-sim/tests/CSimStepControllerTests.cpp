@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include "fluidsim/CSimStepController.h"
+
+TEST(CSimStepController, RejectsInvalidSettings) {
+	EXPECT_THROW(CSimStepController(0.f, 1), std::invalid_argument);
+	EXPECT_THROW(CSimStepController(-1.f, 1), std::invalid_argument);
+	EXPECT_THROW(CSimStepController(1.f / 60.f, 0), std::invalid_argument);
+}
+
+TEST(CSimStepController, OneStepPerFixedFrame) {
+	constexpr float step = 1.f / 60.f;
+	CSimStepController controller(step, 4);
+
+	// Summing the step in floating point drifts, which must not turn into an
+	// occasional frame with zero or two steps
+	for (int frame = 0; frame < 1000; frame++) {
+		ASSERT_EQ(controller.Advance(step), 1) << "frame " << frame;
+	}
+}
+
+TEST(CSimStepController, AccumulatesShortFrames) {
+	CSimStepController controller(0.01f, 4);
+
+	EXPECT_EQ(controller.Advance(0.004f), 0);
+	EXPECT_NEAR(controller.GetInterpolationAlpha(), 0.4f, 1e-4f);
+	EXPECT_EQ(controller.Advance(0.004f), 0);
+	EXPECT_NEAR(controller.GetInterpolationAlpha(), 0.8f, 1e-4f);
+	EXPECT_EQ(controller.Advance(0.004f), 1);
+	EXPECT_NEAR(controller.GetInterpolationAlpha(), 0.2f, 1e-4f);
+}
+
+TEST(CSimStepController, LongFramesRunSeveralSteps) {
+	CSimStepController controller(0.01f, 4);
+
+	EXPECT_EQ(controller.Advance(0.035f), 3);
+	EXPECT_NEAR(controller.GetInterpolationAlpha(), 0.5f, 1e-3f);
+}
+
+TEST(CSimStepController, CapsStepsAndDropsTheBacklog) {
+	CSimStepController controller(0.01f, 3);
+
+	EXPECT_EQ(controller.Advance(1.f), 3);
+	// Anything past the cap is thrown away rather than carried over
+	EXPECT_EQ(controller.GetInterpolationAlpha(), 0.f);
+	EXPECT_EQ(controller.Advance(0.f), 0);
+	EXPECT_EQ(controller.Advance(0.01f), 1);
+}
+
+TEST(CSimStepController, IgnoresNegativeTime) {
+	CSimStepController controller(0.01f, 3);
+
+	EXPECT_EQ(controller.Advance(0.005f), 0);
+	EXPECT_EQ(controller.Advance(-1.f), 0);
+	EXPECT_NEAR(controller.GetInterpolationAlpha(), 0.5f, 1e-4f);
+}
+
+TEST(CSimStepController, ResetClearsLeftoverTime) {
+	CSimStepController controller(0.01f, 3);
+
+	controller.Advance(0.008f);
+	controller.Reset();
+	EXPECT_EQ(controller.GetInterpolationAlpha(), 0.f);
+	EXPECT_EQ(controller.Advance(0.008f), 0);
+	EXPECT_FLOAT_EQ(controller.GetFixedDeltaTime(), 0.01f);
+}
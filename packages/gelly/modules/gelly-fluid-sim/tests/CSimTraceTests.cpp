@@ -0,0 +1,294 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "MockFluidSimulation.h"
+#include "fluidsim/CRecordingFluidSimulation.h"
+#include "fluidsim/CSimTraceReplayer.h"
+
+namespace {
+std::filesystem::path GetTracePath() {
+	const auto *test = ::testing::UnitTest::GetInstance()->current_test_info();
+	return std::filesystem::temp_directory_path() /
+		   (std::string("gelly-") + test->name() + ".trace");
+}
+
+/**
+ * Replays the whole trace, returning how many frames it had.
+ */
+uint ReplayAll(CSimTraceReplayer &replayer, IFluidSimulation *sim) {
+	while (replayer.ReplayFrame(sim)) {
+	}
+
+	return replayer.GetFramesReplayed();
+}
+
+void RecordScene(ISimScene *scene) {
+	const float vertices[] = {1.5f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f};
+	const uint16_t indices16[] = {0, 1, 2};
+	const uint32_t indices32[] = {2, 1, 0};
+	const float planes[] = {1.f, 0.f, 0.f, -1.f, -1.f, 0.f, 0.f, -2.f};
+
+	ObjectCreationParams mesh = {};
+	mesh.shape = ObjectShape::TRIANGLE_MESH;
+	ObjectCreationParams::TriangleMesh meshData = {};
+	meshData.indexType = ObjectCreationParams::TriangleMesh::IndexType::UINT16;
+	meshData.vertices = vertices;
+	meshData.indices16 = indices16;
+	meshData.vertexCount = 3;
+	meshData.indexCount = 3;
+	meshData.scale[0] = meshData.scale[1] = meshData.scale[2] = 1.f;
+	mesh.shapeData = meshData;
+	const auto meshHandle = scene->CreateObject(mesh);
+
+	meshData.indexType = ObjectCreationParams::TriangleMesh::IndexType::UINT32;
+	meshData.indices32 = indices32;
+	mesh.shapeData = meshData;
+	scene->CreateObject(mesh);
+
+	ObjectCreationParams convex = {};
+	convex.shape = ObjectShape::CONVEX;
+	convex.shapeData = ObjectCreationParams::Convex{
+		planes, 2, {-1.f, -1.f, -1.f}, {1.f, 1.f, 1.f}, {1.f, 1.f, 1.f}
+	};
+	const auto convexHandle = scene->CreateObject(convex);
+
+	ObjectCreationParams sphere = {};
+	sphere.shape = ObjectShape::SPHERE;
+	sphere.shapeData = ObjectCreationParams::Sphere{4.f, {0.f, 1.f, 0.f}};
+	scene->CreateObject(sphere);
+
+	ObjectCreationParams capsule = {};
+	capsule.shape = ObjectShape::CAPSULE;
+	capsule.shapeData = ObjectCreationParams::Capsule{1.f, 2.f};
+	scene->CreateObject(capsule);
+
+	DrainCreationParams drain = {};
+	drain.shape = DrainShape::SPHERE;
+	drain.shapeData = DrainCreationParams::Sphere{{0.f, 0.f, 0.f}, 10.f};
+	const auto drainHandle = scene->CreateDrain(drain);
+
+	scene->SetObjectPosition(convexHandle, 1.f, 2.f, 3.f);
+	scene->SetObjectQuaternion(convexHandle, 0.f, 0.f, 0.707f, 0.707f);
+	scene->SetObjectEnabled(meshHandle, false);
+
+	const ObjectTransform transform = {{4.f, 5.f, 6.f}, {0.f, 1.f, 0.f, 0.f}};
+	scene->SetObjectTransforms(&meshHandle, &transform, 1);
+
+	scene->Update();
+	scene->RemoveDrain(drainHandle);
+	scene->RemoveObject(convexHandle);
+}
+
+void RecordParticles(IFluidSimulation *sim) {
+	const SimFloat4 positions[] = {{1.f, 2.f, 3.f, 1.f}, {4.f, 5.f, 6.f, 1.f}};
+	const SimFloat3 velocities[] = {{0.f, -1.f, 0.f}, {0.f, -2.f, 0.f}};
+	const int phases[] = {7, 8};
+
+	auto *commandList = sim->BeginCommandList();
+	commandList->AddCommand(
+		{ADD_PARTICLE, AddParticle{1.f, 2.f, 3.f, 4.f, 5.f, 6.f}}
+	);
+	commandList->AddCommand(
+		{ADD_PARTICLE_BATCH, AddParticleBatch{positions, velocities, phases, 2}
+		}
+	);
+	commandList->AddCommand(
+		{ADD_PARTICLE_BATCH,
+		 AddParticleBatch{positions, velocities, nullptr, 2}}
+	);
+	commandList->AddCommand({CHANGE_RADIUS, ChangeRadius{2.5f}});
+	commandList->AddCommand(
+		{SET_FLUID_PROPERTIES,
+		 SetFluidProperties{0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f}}
+	);
+	sim->SubmitCommandList(commandList);
+
+	auto *ownedList = sim->CreateCommandList();
+	ownedList->AddCommand({RESET, Reset{}});
+	sim->ExecuteCommandList(ownedList);
+	sim->DestroyCommandList(ownedList);
+}
+}  // namespace
+
+TEST(CSimTrace, ReplayReproducesTheRecordedRun) {
+	const auto path = GetTracePath();
+
+	auto *recorded = new CMockFluidSimulation(0);
+	recorded->SetMaxParticles(1234);
+	{
+		CRecordingFluidSimulation recorder(recorded);
+		recorder.StartRecording(path);
+
+		RecordScene(recorder.GetScene());
+		recorder.Update(1.f / 60.f);
+		RecordParticles(&recorder);
+		recorder.SetTimeStepMultiplier(0.5f);
+		recorder.Update(1.f / 30.f);
+
+		recorder.StopRecording();
+
+		CMockFluidSimulation replayed(100);
+		CSimTraceReplayer replayer(path);
+		EXPECT_EQ(replayer.GetMaxParticles(), 1234);
+		EXPECT_EQ(ReplayAll(replayer, &replayed), 2u);
+
+		EXPECT_EQ(replayed.log, recorded->log);
+		EXPECT_EQ(replayed.positions.size(), 0u);
+	}
+
+	std::filesystem::remove(path);
+}
+
+TEST(CSimTrace, ReplayRemapsObjectHandles) {
+	const auto path = GetTracePath();
+
+	auto *recorded = new CMockFluidSimulation(5);
+	CRecordingFluidSimulation recorder(recorded);
+	recorder.StartRecording(path);
+
+	ObjectCreationParams sphere = {};
+	sphere.shape = ObjectShape::SPHERE;
+	sphere.shapeData = ObjectCreationParams::Sphere{1.f, {0.f, 0.f, 0.f}};
+	const auto handle = recorder.GetScene()->CreateObject(sphere);
+	recorder.GetScene()->SetObjectPosition(handle, 7.f, 8.f, 9.f);
+	recorder.Update(0.1f);
+	recorder.StopRecording();
+	EXPECT_EQ(handle, 5u);
+
+	CMockFluidSimulation replayed(40);
+	CSimTraceReplayer replayer(path);
+	ReplayAll(replayer, &replayed);
+
+	ASSERT_EQ(replayed.scene.transforms.count(40), 1u);
+	EXPECT_EQ(replayed.scene.transforms[40].position[0], 7.f);
+	EXPECT_EQ(replayed.scene.transforms[40].position[2], 9.f);
+	EXPECT_EQ(replayed.scene.transforms.count(5), 0u);
+
+	std::filesystem::remove(path);
+}
+
+TEST(CSimTrace, ObjectsFromBeforeRecordingAreSkipped) {
+	const auto path = GetTracePath();
+
+	auto *recorded = new CMockFluidSimulation(0);
+	CRecordingFluidSimulation recorder(recorded);
+
+	ObjectCreationParams sphere = {};
+	sphere.shape = ObjectShape::SPHERE;
+	sphere.shapeData = ObjectCreationParams::Sphere{1.f, {0.f, 0.f, 0.f}};
+	const auto handle = recorder.GetScene()->CreateObject(sphere);
+
+	recorder.StartRecording(path);
+	recorder.GetScene()->SetObjectPosition(handle, 1.f, 1.f, 1.f);
+	recorder.GetScene()->RemoveObject(handle);
+	recorder.Update(0.1f);
+	recorder.StopRecording();
+
+	CMockFluidSimulation replayed;
+	CSimTraceReplayer replayer(path);
+	EXPECT_EQ(ReplayAll(replayer, &replayed), 1u);
+	EXPECT_EQ(replayed.log, MockEventLog{"Update 0.100000"});
+
+	std::filesystem::remove(path);
+}
+
+TEST(CSimTrace, NothingIsWrittenWhileNotRecording) {
+	auto *recorded = new CMockFluidSimulation();
+	CRecordingFluidSimulation recorder(recorded);
+	EXPECT_FALSE(recorder.IsRecording());
+
+	RecordParticles(&recorder);
+	recorder.Update(0.1f);
+
+	// Still forwarded to the wrapped simulation
+	EXPECT_EQ(recorded->log.back(), "Update 0.100000");
+}
+
+TEST(CSimTrace, RejectsFilesThatAreNotTraces) {
+	const auto path = GetTracePath();
+
+	{
+		std::ofstream file(path, std::ios::binary);
+		const SimTrace::Header header{0x12345678, SimTrace::VERSION, 10};
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	}
+	EXPECT_THROW(CSimTraceReplayer{path}, std::runtime_error);
+
+	{
+		std::ofstream file(path, std::ios::binary);
+		const SimTrace::Header header{
+			SimTrace::MAGIC, SimTrace::VERSION + 1, 10
+		};
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	}
+	EXPECT_THROW(CSimTraceReplayer{path}, std::runtime_error);
+
+	{
+		std::ofstream file(path, std::ios::binary);
+		file.write("GT", 2);
+	}
+	EXPECT_THROW(CSimTraceReplayer{path}, std::runtime_error);
+
+	EXPECT_THROW(
+		CSimTraceReplayer{path.string() + ".missing"}, std::runtime_error
+	);
+
+	std::filesystem::remove(path);
+}
+
+TEST(CSimTrace, TruncatedRecordsThrow) {
+	const auto path = GetTracePath();
+
+	{
+		auto *recorded = new CMockFluidSimulation();
+		CRecordingFluidSimulation recorder(recorded);
+		recorder.StartRecording(path);
+		RecordParticles(&recorder);
+		recorder.Update(0.1f);
+		recorder.StopRecording();
+	}
+
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+	CMockFluidSimulation replayed;
+	CSimTraceReplayer replayer(path);
+	EXPECT_THROW(ReplayAll(replayer, &replayed), std::runtime_error);
+
+	std::filesystem::remove(path);
+}
+
+TEST(CSimTrace, KickedUpdatesReplayAsUpdates) {
+	const auto path = GetTracePath();
+
+	auto *recorded = new CMockFluidSimulation();
+	CRecordingFluidSimulation recorder(recorded);
+	recorder.StartRecording(path);
+
+	recorder.KickUpdate(0.25f);
+	RecordParticles(&recorder);
+	recorder.WaitForResult();
+	recorder.KickUpdate(0.5f);
+	recorder.WaitForResult();
+	recorder.StopRecording();
+
+	// Both halves reach the wrapped simulation, in order
+	EXPECT_EQ(recorded->log.front(), "KickUpdate 0.250000");
+	EXPECT_EQ(recorded->log.back(), "WaitForResult");
+
+	CMockFluidSimulation replayed;
+	CSimTraceReplayer replayer(path);
+	EXPECT_EQ(ReplayAll(replayer, &replayed), 2u);
+
+	// Replays are synchronous, so the handoff isn't recorded and the command
+	// list executed while the update was in flight applies to the next one
+	ASSERT_GE(replayed.log.size(), 2u);
+	EXPECT_EQ(replayed.log.front(), "Update 0.250000");
+	EXPECT_EQ(replayed.log.back(), "Update 0.500000");
+	for (const auto &event : replayed.log) {
+		EXPECT_NE(event, "WaitForResult");
+	}
+
+	std::filesystem::remove(path);
+}
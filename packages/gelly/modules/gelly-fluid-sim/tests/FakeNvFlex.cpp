@@ -0,0 +1,125 @@
+#include "FakeNvFlex.h"
+
+#include <cstring>
+#include <stdexcept>
+
+struct NvFlexBuffer {
+	std::vector<unsigned char> data;
+	bool mapped;
+};
+
+namespace {
+FakeFlexState state;
+unsigned long long nextMeshId = 1;
+
+template <typename T>
+const T &Element(const NvFlexBuffer *buffer, int index) {
+	if (buffer->mapped) {
+		throw std::logic_error("NvFlexSetShapes: A buffer is still mapped");
+	}
+
+	return reinterpret_cast<const T *>(buffer->data.data())[index];
+}
+}  // namespace
+
+FakeFlexState &GetFakeFlex() { return state; }
+
+void ResetFakeFlex() { state = {}; }
+
+NvFlexBuffer *NvFlexAllocBuffer(
+	NvFlexLibrary *lib, int elementCount, int elementByteStride, NvFlexBufferType
+) {
+	state.liveBuffers++;
+	return new NvFlexBuffer{
+		std::vector<unsigned char>(elementCount * elementByteStride), false
+	};
+}
+
+void NvFlexFreeBuffer(NvFlexBuffer *buf) {
+	state.liveBuffers--;
+	delete buf;
+}
+
+void *NvFlexMap(NvFlexBuffer *buffer, int flags) {
+	buffer->mapped = true;
+	return buffer->data.data();
+}
+
+void NvFlexUnmap(NvFlexBuffer *buffer) { buffer->mapped = false; }
+
+void NvFlexSetShapes(
+	NvFlexSolver *solver,
+	NvFlexBuffer *geometry,
+	NvFlexBuffer *shapePositions,
+	NvFlexBuffer *shapeRotations,
+	NvFlexBuffer *shapePrevPositions,
+	NvFlexBuffer *shapePrevRotations,
+	NvFlexBuffer *shapeFlags,
+	int numShapes
+) {
+	struct Float4 {
+		float values[4];
+	};
+
+	state.setShapesCalls++;
+	state.shapes.resize(numShapes);
+	for (int i = 0; i < numShapes; i++) {
+		auto &shape = state.shapes[i];
+		shape.geometry = Element<NvFlexCollisionGeometry>(geometry, i);
+		std::memcpy(
+			shape.position, &Element<Float4>(shapePositions, i), sizeof(Float4)
+		);
+		std::memcpy(
+			shape.rotation, &Element<Float4>(shapeRotations, i), sizeof(Float4)
+		);
+		std::memcpy(
+			shape.prevPosition,
+			&Element<Float4>(shapePrevPositions, i),
+			sizeof(Float4)
+		);
+		std::memcpy(
+			shape.prevRotation,
+			&Element<Float4>(shapePrevRotations, i),
+			sizeof(Float4)
+		);
+		shape.flags = Element<int>(shapeFlags, i);
+	}
+}
+
+NvFlexTriangleMeshId NvFlexCreateTriangleMesh(NvFlexLibrary *lib) {
+	state.liveTriangleMeshes++;
+	return nextMeshId++;
+}
+
+void NvFlexDestroyTriangleMesh(NvFlexLibrary *lib, NvFlexTriangleMeshId mesh) {
+	state.liveTriangleMeshes--;
+}
+
+void NvFlexUpdateTriangleMesh(
+	NvFlexLibrary *lib,
+	NvFlexTriangleMeshId mesh,
+	NvFlexBuffer *vertices,
+	NvFlexBuffer *indices,
+	int numVertices,
+	int numTriangles,
+	const float *lower,
+	const float *upper
+) {}
+
+NvFlexConvexMeshId NvFlexCreateConvexMesh(NvFlexLibrary *lib) {
+	state.liveConvexMeshes++;
+	return nextMeshId++;
+}
+
+void NvFlexDestroyConvexMesh(NvFlexLibrary *lib, NvFlexConvexMeshId mesh) {
+	state.liveConvexMeshes--;
+}
+
+void NvFlexUpdateConvexMesh(
+	NvFlexLibrary *lib,
+	NvFlexConvexMeshId mesh,
+	NvFlexBuffer *planes,
+	int numPlanes,
+	const float *lower,
+	const float *upper
+) {}
@@ -0,0 +1,35 @@
+#ifndef GELLY_FAKENVFLEX_H
+#define GELLY_FAKENVFLEX_H
+
+#include <NvFlex.h>
+
+#include <vector>
+
+/**
+ * A shape as the solver last received it from NvFlexSetShapes.
+ */
+struct FakeFlexShape {
+	NvFlexCollisionGeometry geometry;
+	float position[4];
+	float rotation[4];
+	float prevPosition[4];
+	float prevRotation[4];
+	int flags;
+};
+
+/**
+ * FakeNvFlex.cpp implements the parts of the FleX API that CFlexSimScene uses
+ * on plain host memory, and records what reaches the solver here.
+ */
+struct FakeFlexState {
+	std::vector<FakeFlexShape> shapes;
+	int setShapesCalls = 0;
+	int liveBuffers = 0;
+	int liveTriangleMeshes = 0;
+	int liveConvexMeshes = 0;
+};
+
+FakeFlexState &GetFakeFlex();
+void ResetFakeFlex();
+
+#endif	// GELLY_FAKENVFLEX_H
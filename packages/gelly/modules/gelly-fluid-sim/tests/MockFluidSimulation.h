@@ -0,0 +1,352 @@
+#ifndef GELLY_MOCKFLUIDSIMULATION_H
+#define GELLY_MOCKFLUIDSIMULATION_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fluidsim/CSimCommandListPool.h"
+#include "fluidsim/IFluidSimulation.h"
+
+/**
+ * Every call that changes the mock simulation or its scene is appended here
+ * as a line of text, so two runs can be compared with a single EXPECT_EQ.
+ */
+using MockEventLog = std::vector<std::string>;
+
+class CMockSimData : public ISimData {
+public:
+	int maxParticles = 0;
+	int activeParticles = 0;
+	float interpolationAlpha = 1.f;
+
+	void LinkBuffer(SimBufferType type, void *buffer) override {}
+	bool IsBufferLinked(SimBufferType type) override { return false; }
+	void *GetLinkedBuffer(SimBufferType type) override { return nullptr; }
+	SimContextAPI GetAPI() override { return SimContextAPI::D3D11; }
+
+	void SetMaxFoamParticles(int maxFoamParticles) override {}
+	int GetMaxFoamParticles() override { return 0; }
+	void SetActiveFoamParticles(int activeFoamParticles) override {}
+	int GetActiveFoamParticles() override { return 0; }
+
+	void SetMaxParticles(int maxParticles) override {
+		this->maxParticles = maxParticles;
+	}
+	int GetMaxParticles() override { return maxParticles; }
+
+	void SetActiveParticles(int activeParticles) override {
+		this->activeParticles = activeParticles;
+	}
+	int GetActiveParticles() override { return activeParticles; }
+
+	void SetInterpolationAlpha(float alpha) override {
+		interpolationAlpha = alpha;
+	}
+	float GetInterpolationAlpha() override { return interpolationAlpha; }
+
+	void SetParticleIdsEnabled(bool enabled) override {}
+	bool AreParticleIdsEnabled() override { return false; }
+	ParticleId GetParticleId(int slot) override { return INVALID_PARTICLE_ID; }
+	uint32_t GetParticleSlot(ParticleId id) override {
+		return INVALID_PARTICLE_SLOT;
+	}
+
+	void RemapParticles(const uint32_t *previousSlots, int particleCount)
+		override {
+		activeParticles = particleCount;
+	}
+	void SetParticleRemapListener(ParticleRemapListener listener) override {}
+};
+
+/**
+ * Hands out handles starting at firstHandle, and logs objects by the order
+ * they were created in so logs from scenes with different handles still
+ * compare equal.
+ */
+class CMockSimScene : public ISimScene {
+private:
+	MockEventLog &log;
+	ObjectHandle nextObject;
+	DrainHandle nextDrain;
+	std::unordered_map<ObjectHandle, int> objectIndices;
+	std::unordered_map<DrainHandle, int> drainIndices;
+
+	[[nodiscard]] std::string Object(ObjectHandle handle) const {
+		const auto it = objectIndices.find(handle);
+		return it == objectIndices.end()
+				   ? "object?"
+				   : "object" + std::to_string(it->second);
+	}
+
+	[[nodiscard]] std::string Drain(DrainHandle handle) const {
+		const auto it = drainIndices.find(handle);
+		return it == drainIndices.end() ? "drain?"
+										: "drain" + std::to_string(it->second);
+	}
+
+public:
+	std::unordered_map<ObjectHandle, ObjectTransform> transforms;
+
+	CMockSimScene(MockEventLog &log, ObjectHandle firstHandle) :
+		log(log), nextObject(firstHandle), nextDrain(firstHandle) {}
+
+	ObjectHandle CreateObject(const ObjectCreationParams &params) override {
+		const auto handle = nextObject++;
+		const auto index = static_cast<int>(objectIndices.size());
+		objectIndices[handle] = index;
+		transforms[handle] = {{0.f, 0.f, 0.f}, {0.f, 0.f, 0.f, 1.f}};
+
+		std::string event =
+			"CreateObject " + std::to_string(static_cast<int>(params.shape));
+		if (const auto *mesh =
+				std::get_if<ObjectCreationParams::TriangleMesh>(
+					&params.shapeData
+				)) {
+			event += " vertices=" + std::to_string(mesh->vertexCount);
+			event += " indices=" + std::to_string(mesh->indexCount);
+			event += " v0=" + std::to_string(mesh->vertices[0]);
+			event += " last=" +
+					 std::to_string(
+						 mesh->indexType == ObjectCreationParams::
+												TriangleMesh::IndexType::UINT16
+							 ? mesh->indices16[mesh->indexCount - 1]
+							 : mesh->indices32[mesh->indexCount - 1]
+					 );
+		} else if (const auto *convex =
+					   std::get_if<ObjectCreationParams::Convex>(
+						   &params.shapeData
+					   )) {
+			event += " planes=" + std::to_string(convex->planeCount);
+			event += " w=" + std::to_string(
+								 convex->planes[convex->planeCount * 4 - 1]
+							 );
+		} else if (const auto *sphere =
+					   std::get_if<ObjectCreationParams::Sphere>(
+						   &params.shapeData
+					   )) {
+			event += " radius=" + std::to_string(sphere->radius);
+		}
+
+		log.push_back(event);
+		return handle;
+	}
+
+	void RemoveObject(ObjectHandle handle) override {
+		log.push_back("RemoveObject " + Object(handle));
+		transforms.erase(handle);
+	}
+
+	void SetObjectEnabled(ObjectHandle handle, bool enabled) override {
+		log.push_back(
+			"SetObjectEnabled " + Object(handle) + " " +
+			std::to_string(enabled)
+		);
+	}
+
+	void SetObjectPosition(ObjectHandle handle, float x, float y, float z)
+		override {
+		log.push_back(
+			"SetObjectPosition " + Object(handle) + " " + std::to_string(x) +
+			" " + std::to_string(y) + " " + std::to_string(z)
+		);
+
+		auto &transform = transforms[handle];
+		transform.position[0] = x;
+		transform.position[1] = y;
+		transform.position[2] = z;
+	}
+
+	void SetObjectQuaternion(
+		ObjectHandle handle, float x, float y, float z, float w
+	) override {
+		log.push_back(
+			"SetObjectQuaternion " + Object(handle) + " " + std::to_string(x) +
+			" " + std::to_string(y) + " " + std::to_string(z) + " " +
+			std::to_string(w)
+		);
+
+		auto &transform = transforms[handle];
+		transform.rotation[0] = x;
+		transform.rotation[1] = y;
+		transform.rotation[2] = z;
+		transform.rotation[3] = w;
+	}
+
+	void SetObjectTransforms(
+		const ObjectHandle *handles,
+		const ObjectTransform *transforms,
+		uint objectCount
+	) override {
+		for (uint i = 0; i < objectCount; i++) {
+			const auto &transform = transforms[i];
+			SetObjectPosition(
+				handles[i],
+				transform.position[0],
+				transform.position[1],
+				transform.position[2]
+			);
+			SetObjectQuaternion(
+				handles[i],
+				transform.rotation[0],
+				transform.rotation[1],
+				transform.rotation[2],
+				transform.rotation[3]
+			);
+		}
+	}
+
+	DrainHandle CreateDrain(const DrainCreationParams &params) override {
+		const auto handle = nextDrain++;
+		const auto index = static_cast<int>(drainIndices.size());
+		drainIndices[handle] = index;
+
+		log.push_back(
+			"CreateDrain " + std::to_string(static_cast<int>(params.shape))
+		);
+		return handle;
+	}
+
+	void RemoveDrain(DrainHandle handle) override {
+		log.push_back("RemoveDrain " + Drain(handle));
+	}
+
+	uint GetDrainedParticleCount(DrainHandle handle) override { return 0; }
+
+	void Update() override { log.push_back("UpdateScene"); }
+};
+
+/**
+ * Runs entirely on the CPU and only keeps track of the particles it was
+ * given, which is all the backend-neutral parts of the simulation need.
+ */
+class CMockFluidSimulation : public IFluidSimulation {
+private:
+	CSimCommandListPool commandListPool;
+
+	void Log(const SimCommand &command) {
+		std::visit(
+			[&](auto &&arg) {
+				using T = std::decay_t<decltype(arg)>;
+				if constexpr (std::is_same_v<T, AddParticle>) {
+					log.push_back(
+						"AddParticle " + std::to_string(arg.x) + " " +
+						std::to_string(arg.vz)
+					);
+					positions.push_back({arg.x, arg.y, arg.z, 1.f});
+					velocities.push_back({arg.vx, arg.vy, arg.vz});
+					phases.push_back(0);
+				} else if constexpr (std::is_same_v<T, AddParticleBatch>) {
+					std::string event =
+						"AddParticleBatch " +
+						std::to_string(arg.particleCount) + " phases=" +
+						std::to_string(arg.phases != nullptr);
+					for (uint i = 0; i < arg.particleCount; i++) {
+						event += " " + std::to_string(arg.positions[i].x) +
+								 "/" + std::to_string(arg.velocities[i].y);
+						if (arg.phases != nullptr) {
+							event += "/" + std::to_string(arg.phases[i]);
+						}
+
+						positions.push_back(arg.positions[i]);
+						velocities.push_back(arg.velocities[i]);
+						phases.push_back(
+							arg.phases != nullptr ? arg.phases[i] : 0
+						);
+					}
+					log.push_back(event);
+				} else if constexpr (std::is_same_v<T, ChangeRadius>) {
+					log.push_back("ChangeRadius " + std::to_string(arg.radius));
+				} else if constexpr (std::is_same_v<T, SetFluidProperties>) {
+					log.push_back(
+						"SetFluidProperties " + std::to_string(arg.viscosity) +
+						" " + std::to_string(arg.dynamicFriction)
+					);
+				} else {
+					log.push_back("Reset");
+					positions.clear();
+					velocities.clear();
+					phases.clear();
+				}
+			},
+			command.data
+		);
+
+		simData.activeParticles = static_cast<int>(positions.size());
+	}
+
+public:
+	MockEventLog log;
+	CMockSimData simData;
+	CMockSimScene scene;
+
+	std::vector<SimFloat4> positions;
+	std::vector<SimFloat3> velocities;
+	std::vector<int> phases;
+
+	explicit CMockFluidSimulation(ObjectHandle firstHandle = 0) :
+		commandListPool(static_cast<SimCommandType>(
+			ADD_PARTICLE | CHANGE_RADIUS | RESET | SET_FLUID_PROPERTIES |
+			ADD_PARTICLE_BATCH
+		)),
+		scene(log, firstHandle) {}
+
+	void SetMaxParticles(int maxParticles) override {
+		simData.SetMaxParticles(maxParticles);
+	}
+	void Initialize() override {}
+
+	ISimData *GetSimulationData() override { return &simData; }
+	ISimScene *GetScene() override { return &scene; }
+	SimContextAPI GetComputeAPI() override { return SimContextAPI::D3D11; }
+	void AttachToContext(GellyObserverPtr<ISimContext> context) override {}
+
+	ISimCommandList *CreateCommandList() override {
+		return commandListPool.Create();
+	}
+	void DestroyCommandList(ISimCommandList *commandList) override {
+		commandListPool.Destroy(commandList);
+	}
+	void ExecuteCommandList(ISimCommandList *commandList) override {
+		const auto [begin, end] = commandList->GetCommands();
+		for (auto it = begin; it != end; ++it) {
+			Log(*it);
+		}
+	}
+
+	ISimCommandList *BeginCommandList() override {
+		return commandListPool.Acquire();
+	}
+	void SubmitCommandList(ISimCommandList *commandList) override {
+		commandListPool.ExecuteAndRelease(commandList, [this](auto *list) {
+			ExecuteCommandList(list);
+		});
+	}
+
+	void Update(float deltaTime) override {
+		log.push_back("Update " + std::to_string(deltaTime));
+	}
+	void KickUpdate(float deltaTime) override {
+		log.push_back("KickUpdate " + std::to_string(deltaTime));
+	}
+	void WaitForResult() override { log.push_back("WaitForResult"); }
+	void SetTimeStepMultiplier(float timeStepMultiplier) override {
+		log.push_back(
+			"SetTimeStepMultiplier " + std::to_string(timeStepMultiplier)
+		);
+	}
+
+	const char *GetComputeDeviceName() override { return "Mock"; }
+	bool CheckFeatureSupport(GELLY_FEATURE feature) override { return false; }
+
+	void VisitLatestContactPlanes(ContactPlaneVisitor visitor) override {}
+	void SetQualitySettings(const SimQualitySettings &settings) override {}
+	SimQualityStatus GetQualityStatus() override { return {}; }
+	float GetParticleLocality() override { return 0.f; }
+	void CaptureSnapshot(CSimSnapshot &snapshot) override {}
+	bool GetParticleBounds(float lower[3], float upper[3]) override {
+		return false;
+	}
+};
+
+#endif	// GELLY_MOCKFLUIDSIMULATION_H
@@ -1,6 +1,11 @@
 #ifndef GELLY_GELLYINTERFACE_H
 #define GELLY_GELLYINTERFACE_H
 
+#ifdef _MSC_VER
 #define gelly_interface class __declspec(novtable)
+#else
+// novtable is an MSVC extension, only the unit tests build elsewhere
+#define gelly_interface class
+#endif
 
 #endif	// GELLY_GELLYINTERFACE_H
@@ -5,6 +5,11 @@
 
 enum class GELLY_FEATURE {
 	FLUIDSIM_CONTACTPLANES,
+	FLUIDSIM_ADAPTIVE_QUALITY,
+	FLUIDSIM_PARTICLE_REORDERING,
+	FLUIDSIM_SNAPSHOTS,
+	FLUIDSIM_LIVE_RESIZE,
+	FLUIDSIM_PARTICLE_BOUNDS,
 	FLUIDRENDER_PER_PARTICLE_ABSORPTION,
 };
 